@@ -0,0 +1,132 @@
+#include "Arduino.h"
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+static std::mt19937 generator(std::random_device{}());
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - boot).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - boot).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+long random(long max) {
+    return max <= 0 ? 0 : (long)(generator() % (unsigned long)max);
+}
+
+long random(long min, long max) {
+    return max <= min ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    generator.seed((std::mt19937::result_type)seed);
+}
+
+uint32_t esp_random() {
+    return (uint32_t)generator();
+}
+
+// GPIO на хосте нет: запись игнорируется, чтение возвращает 0.
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+void analogWrite(uint8_t, int) {}
+uint16_t analogRead(uint8_t) { return 0; }
+
+size_t Print::printf(const char* format, ...) {
+    char stack[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(stack, sizeof(stack), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length < sizeof(stack)) {
+        return write((const uint8_t*)stack, length);
+    }
+
+    std::string heap(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heap[0], heap.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heap.data(), length);
+}
+
+size_t Print::print(const char* value) {
+    return value ? write((const uint8_t*)value, strlen(value)) : 0;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return _output ? fwrite(buffer, 1, size, _output) : size;
+}
+
+void HardwareSerial::flush() {
+    if (_output) {
+        fflush(_output);
+    }
+}
+
+uint64_t EspClass::getEfuseMac() {
+    return 0x010000000002ULL;
+}
+
+// Куча хоста не ограничена; значения условные, как у свежезагруженного ESP32.
+uint32_t EspClass::getFreeHeap() {
+    return 200 * 1024;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return 110 * 1024;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return 180 * 1024;
+}
+
+void EspClass::restart() {
+    fflush(stdout);
+    exit(0);
+}
+
+bool IPAddress::fromString(const char* address) {
+    unsigned parts[4];
+    char tail;
+    if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &tail) != 4) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (parts[i] > 255) {
+            return false;
+        }
+        _bytes[i] = (uint8_t)parts[i];
+    }
+    return true;
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buffer);
+}
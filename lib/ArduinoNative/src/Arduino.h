@@ -0,0 +1,69 @@
+#ifndef ARDUINO_NATIVE_ARDUINO_H
+#define ARDUINO_NATIVE_ARDUINO_H
+
+// Хост-реализация той части Arduino-ESP32 API, которой пользуются прошивки.
+// Нужна для env:native: бенчмарки и прогон общей логики без платы.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+uint16_t analogRead(uint8_t pin);
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+    // Куда идёт вывод; nullptr - отбрасывать (сотни виртуальных устройств).
+    void setOutput(FILE* output) { _output = output; }
+
+private:
+    FILE* _output = stdout;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint64_t getEfuseMac();
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getMinFreeHeap();
+    void restart();
+};
+
+extern EspClass ESP;
+
+#endif
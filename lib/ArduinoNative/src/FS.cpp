@@ -0,0 +1,76 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::FS LittleFS;
+
+namespace fs {
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    return _file ? fread(buffer, 1, size, _file) : 0;
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    return _file ? fwrite(buffer, 1, size, _file) : 0;
+}
+
+bool File::seek(uint32_t position) {
+    return _file && fseek(_file, position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    return _file ? (size_t)ftell(_file) : 0;
+}
+
+size_t File::size() const {
+    if (!_file) {
+        return 0;
+    }
+    long current = ftell(_file);
+    fseek(_file, 0, SEEK_END);
+    long end = ftell(_file);
+    fseek(_file, current, SEEK_SET);
+    return (size_t)end;
+}
+
+void File::flush() {
+    if (_file) {
+        fflush(_file);
+    }
+}
+
+void File::close() {
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+bool FS::begin(bool formatOnFail) {
+    (void)formatOnFail;
+    const char* root = getenv("NATIVE_FS_ROOT");
+    _root = root ? root : ".pio/native_fs";
+    mkdir(".pio", 0755);
+    return mkdir(_root.c_str(), 0755) == 0 || access(_root.c_str(), W_OK) == 0;
+}
+
+String FS::resolve(const char* path) const {
+    return _root + (path[0] == '/' ? "" : "/") + path;
+}
+
+bool FS::exists(const char* path) {
+    return access(resolve(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return unlink(resolve(path).c_str()) == 0;
+}
+
+File FS::open(const char* path, const char* mode) {
+    // Режимы Arduino совпадают с fopen, "b" нужен только на Windows.
+    String binary = String(mode) + "b";
+    return File(fopen(resolve(path).c_str(), binary.c_str()));
+}
+
+}  // namespace fs
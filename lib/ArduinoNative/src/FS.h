@@ -0,0 +1,47 @@
+#ifndef ARDUINO_NATIVE_FS_H
+#define ARDUINO_NATIVE_FS_H
+
+#include <stdio.h>
+#include "Arduino.h"
+
+namespace fs {
+
+class File {
+public:
+    File() {}
+    explicit File(FILE* file) : _file(file) {}
+
+    explicit operator bool() const { return _file != nullptr; }
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(const uint8_t* buffer, size_t size);
+    bool seek(uint32_t position);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+
+private:
+    FILE* _file = nullptr;
+};
+
+// Файловая система в каталоге хоста (по умолчанию .pio/native_fs,
+// переопределяется переменной окружения NATIVE_FS_ROOT).
+class FS {
+public:
+    bool begin(bool formatOnFail = false);
+    bool format() { return true; }
+    bool exists(const char* path);
+    bool remove(const char* path);
+    File open(const char* path, const char* mode = "r");
+
+private:
+    String resolve(const char* path) const;
+    String _root;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
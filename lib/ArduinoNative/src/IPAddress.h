@@ -0,0 +1,35 @@
+#ifndef ARDUINO_NATIVE_IPADDRESS_H
+#define ARDUINO_NATIVE_IPADDRESS_H
+
+#include <stdint.h>
+#include <string.h>
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() { memset(_bytes, 0, sizeof(_bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+
+    operator uint32_t() const {
+        uint32_t address;
+        memcpy(&address, _bytes, sizeof(address));
+        return address;
+    }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t& operator[](int index) { return _bytes[index]; }
+    bool operator==(const IPAddress& other) const { return memcmp(_bytes, other._bytes, 4) == 0; }
+
+    bool fromString(const char* address);
+    String toString() const;
+
+private:
+    uint8_t _bytes[4];
+};
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef ARDUINO_NATIVE_LITTLEFS_H
+#define ARDUINO_NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+extern fs::FS LittleFS;
+
+#endif
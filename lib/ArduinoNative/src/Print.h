@@ -0,0 +1,40 @@
+#ifndef ARDUINO_NATIVE_PRINT_H
+#define ARDUINO_NATIVE_PRINT_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "IPAddress.h"
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) { return write(&value, 1); }
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const char* value);
+    size_t print(const String& value) { return print(value.c_str()); }
+    size_t print(char value) { return write((uint8_t)value); }
+    size_t print(int value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+    size_t print(const IPAddress& value) { return print(value.toString()); }
+
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { return print(value, format) + println(); }
+
+    virtual void flush() {}
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string format_integer(unsigned long value, bool negative, unsigned char base) {
+    char digits[66];
+    size_t pos = sizeof(digits);
+    digits[--pos] = '\0';
+    do {
+        unsigned digit = value % base;
+        digits[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value > 0);
+    if (negative) {
+        digits[--pos] = '-';
+    }
+    return std::string(digits + pos);
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        _value = format_integer(0UL - (unsigned long)value, true, base);
+    } else {
+        _value = format_integer((unsigned long)value, false, base);
+    }
+}
+
+String::String(unsigned long value, unsigned char base) {
+    _value = format_integer(value, false, base);
+}
+
+String::String(double value, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    _value = buffer;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+    size_t pos = _value.find(value, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const char* value, unsigned int from) const {
+    size_t pos = _value.find(value, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+    return substring(from, length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= _value.size()) {
+        return String();
+    }
+    return String(_value.substr(from, to - from).c_str());
+}
+
+void String::trim() {
+    size_t begin = 0;
+    size_t end = _value.size();
+    while (begin < end && isspace((unsigned char)_value[begin])) {
+        begin++;
+    }
+    while (end > begin && isspace((unsigned char)_value[end - 1])) {
+        end--;
+    }
+    _value = _value.substr(begin, end - begin);
+}
+
+long String::toInt() const {
+    return strtol(_value.c_str(), nullptr, 10);
+}
+
+String operator+(const String& a, const String& b) {
+    String result(a);
+    result.concat(b);
+    return result;
+}
+
+String operator+(const String& a, const char* b) {
+    String result(a);
+    result.concat(b);
+    return result;
+}
+
+String operator+(const char* a, const String& b) {
+    String result(a);
+    result.concat(b);
+    return result;
+}
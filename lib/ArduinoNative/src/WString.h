@@ -0,0 +1,92 @@
+#ifndef ARDUINO_NATIVE_WSTRING_H
+#define ARDUINO_NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+// Arduino String на std::string. Выделяет память в куче так же, как оригинал,
+// поэтому счётчики аллокаций в бенчмарках отражают поведение на устройстве.
+class String {
+public:
+    String() {}
+    String(const char* value) : _value(value ? value : "") {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    explicit String(char value) : _value(1, value) {}
+    String(int value, unsigned char base = 10);
+    String(unsigned int value, unsigned char base = 10);
+    String(long value, unsigned char base = 10);
+    String(unsigned long value, unsigned char base = 10);
+    String(double value, unsigned int decimals = 2);
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* value) {
+        _value = value ? value : "";
+        return *this;
+    }
+
+    const char* c_str() const { return _value.c_str(); }
+    unsigned int length() const { return (unsigned int)_value.size(); }
+    bool isEmpty() const { return _value.empty(); }
+    bool reserve(unsigned int size) {
+        _value.reserve(size);
+        return true;
+    }
+
+    bool concat(const String& value) {
+        _value += value._value;
+        return true;
+    }
+    bool concat(const char* value) {
+        if (value) {
+            _value += value;
+        }
+        return true;
+    }
+    bool concat(const char* value, unsigned int length) {
+        _value.append(value, length);
+        return true;
+    }
+    bool concat(char value) {
+        _value += value;
+        return true;
+    }
+
+    String& operator+=(const String& value) { concat(value); return *this; }
+    String& operator+=(const char* value) { concat(value); return *this; }
+    String& operator+=(char value) { concat(value); return *this; }
+
+    char operator[](unsigned int index) const { return index < _value.size() ? _value[index] : 0; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    bool equals(const String& other) const { return _value == other._value; }
+    bool equals(const char* other) const { return _value == (other ? other : ""); }
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* other) const { return equals(other); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* other) const { return !equals(other); }
+    bool operator<(const String& other) const { return _value < other._value; }
+
+    int indexOf(char value, unsigned int from = 0) const;
+    int indexOf(const char* value, unsigned int from = 0) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    void trim();
+    long toInt() const;
+
+    friend String operator+(const String& a, const String& b);
+    friend String operator+(const String& a, const char* b);
+    friend String operator+(const char* a, const String& b);
+
+private:
+    std::string _value;
+};
+
+// Тип результата конкатенации в Arduino; ArduinoJson ссылается на него в адаптерах строк.
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& value) : String(value) {}
+};
+
+#endif
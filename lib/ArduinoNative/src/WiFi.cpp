@@ -0,0 +1,124 @@
+#include "WiFi.h"
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    (void)password;
+    (void)channel;
+    (void)bssid;
+    if (_station->_mode == WIFI_OFF || _station->_mode == WIFI_AP) {
+        _station->_mode = _station->_mode == WIFI_AP ? WIFI_AP_STA : WIFI_STA;
+    }
+    bool wasConnected = status() == WL_CONNECTED;
+    _station->_ssid = ssid ? ssid : "";
+    _station->_started = connect && _station->_ssid.length() > 0;
+    if (wasConnected) {
+        emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    if (_station->_started) {
+        if (_station->_linkUp) {
+            emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+            emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        } else {
+            emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+        }
+    }
+    return status();
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    bool wasStarted = _station->_started;
+    _station->_started = false;
+    if (wasStarted) {
+        emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    if (eraseAp) {
+        _station->_ssid = "";
+    }
+    if (wifiOff) {
+        _station->_mode = WIFI_OFF;
+    }
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    if (!_station->_started) {
+        return WL_DISCONNECTED;
+    }
+    return _station->_linkUp ? WL_CONNECTED : WL_CONNECTION_LOST;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    _station->_mode = mode;
+    if (mode == WIFI_OFF || mode == WIFI_AP) {
+        _station->_started = false;
+    }
+    return true;
+}
+
+bool WiFiClass::config(IPAddress, IPAddress, IPAddress, IPAddress, IPAddress) {
+    return true;
+}
+
+IPAddress WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+bool WiFiClass::softAP(const char*, const char*) {
+    _station->_mode = _station->_mode == WIFI_STA ? WIFI_AP_STA : WIFI_AP;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifiOff) {
+    if (wifiOff) {
+        _station->_mode = WIFI_OFF;
+    }
+    return true;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFullCb callback, arduino_event_id_t event) {
+    for (int i = 0; i < WiFiStation::MAX_LISTENERS; i++) {
+        if (!_station->_listeners[i].callback) {
+            _station->_listeners[i].callback = callback;
+            _station->_listeners[i].event = event;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+    if (id >= 0 && id < WiFiStation::MAX_LISTENERS) {
+        _station->_listeners[id].callback = nullptr;
+    }
+}
+
+void WiFiClass::setLinkUp(bool up) {
+    bool changed = up != _station->_linkUp;
+    _station->_linkUp = up;
+    if (!changed || !_station->_started) {
+        return;
+    }
+    if (up) {
+        emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    } else {
+        emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+    }
+}
+
+void WiFiClass::emit(arduino_event_id_t event, uint8_t reason) {
+    arduino_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.wifi_sta_disconnected.reason = reason;
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        info.got_ip.ip_info.ip.addr = (uint32_t)localIP();
+    }
+    for (int i = 0; i < WiFiStation::MAX_LISTENERS; i++) {
+        if (_station->_listeners[i].callback &&
+            (_station->_listeners[i].event == ARDUINO_EVENT_MAX || _station->_listeners[i].event == event)) {
+            _station->_listeners[i].callback(event, info);
+        }
+    }
+}
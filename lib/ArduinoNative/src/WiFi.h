@@ -0,0 +1,126 @@
+#ifndef ARDUINO_NATIVE_WIFI_H
+#define ARDUINO_NATIVE_WIFI_H
+
+#include <functional>
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+// Подмножество arduino_event_info_t, которое использует прошивка.
+typedef struct {
+    struct {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+    struct {
+        struct {
+            struct {
+                uint32_t addr;
+            } ip;
+        } ip_info;
+    } got_ip;
+} arduino_event_info_t;
+
+#define WIFI_REASON_NO_AP_FOUND 201
+#define WIFI_REASON_AUTH_FAIL 202
+#define WIFI_REASON_ASSOC_LEAVE 8
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFullCb;
+typedef int wifi_event_id_t;
+
+// Состояние одной станции. У WiFi своя станция по умолчанию; симулятор парка
+// держит по станции на виртуальное устройство и переключает их через select().
+class WiFiStation {
+private:
+    friend class WiFiClass;
+
+    struct Listener {
+        WiFiEventFullCb callback;
+        arduino_event_id_t event;
+    };
+    static const int MAX_LISTENERS = 8;
+
+    wifi_mode_t _mode = WIFI_OFF;
+    String _ssid;
+    bool _started = false;
+    bool _linkUp = true;
+    uint8_t _bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    Listener _listeners[MAX_LISTENERS];
+};
+
+// На хосте "станция" подключается сразу после begin(); сеть - это сеть хоста.
+// setLinkUp(false) имитирует потерю точки доступа.
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* password = nullptr,
+                      int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status();
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() { return _station->_mode; }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+
+    IPAddress localIP();
+    IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+    IPAddress dnsIP(uint8_t index = 0) { (void)index; return IPAddress(127, 0, 0, 1); }
+    String SSID() { return _station->_ssid; }
+    String macAddress() { return String("02:00:00:00:00:01"); }
+    int8_t RSSI() { return status() == WL_CONNECTED ? -55 : 0; }
+    int32_t channel() { return 1; }
+    uint8_t* BSSID() { return _station->_bssid; }
+
+    bool softAP(const char* ssid, const char* password = nullptr);
+    bool softAPdisconnect(bool wifiOff = false);
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+
+    bool persistent(bool enabled) { (void)enabled; return true; }
+    bool setAutoReconnect(bool enabled) { (void)enabled; return true; }
+
+    // События приходят синхронно из begin()/disconnect()/setLinkUp().
+    wifi_event_id_t onEvent(WiFiEventFullCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    void removeEvent(wifi_event_id_t id);
+
+    void setLinkUp(bool up);
+
+    // Все вызовы WiFi дальше относятся к station (nullptr - станция по умолчанию).
+    void select(WiFiStation* station) { _station = station ? station : &_default; }
+
+private:
+    void emit(arduino_event_id_t event, uint8_t reason = 0);
+
+    WiFiStation _default;
+    WiFiStation* _station = &_default;
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,128 @@
+#include "WiFiClient.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) {
+        return 0;
+    }
+
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(result);
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int rc = ::connect(fd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return 0;
+    }
+    if (rc < 0) {
+        struct pollfd waiter = { fd, POLLOUT, 0 };
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&waiter, 1, timeoutMs) <= 0 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            close(fd);
+            return 0;
+        }
+    }
+
+    _fd = fd;
+    return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    size_t sent = 0;
+    while (_fd >= 0 && sent < size) {
+        ssize_t rc = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (rc > 0) {
+            sent += rc;
+        } else if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd waiter = { _fd, POLLOUT, 0 };
+            if (poll(&waiter, 1, 1000) <= 0) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (_fd < 0) {
+        return 0;
+    }
+    int count = 0;
+    if (ioctl(_fd, FIONREAD, &count) < 0) {
+        return 0;
+    }
+    return count;
+}
+
+int WiFiClient::read() {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (_fd < 0) {
+        return -1;
+    }
+    ssize_t rc = recv(_fd, buffer, size, MSG_DONTWAIT);
+    return rc > 0 ? (int)rc : -1;
+}
+
+uint8_t WiFiClient::connected() {
+    if (_fd < 0) {
+        return 0;
+    }
+    uint8_t probe;
+    ssize_t rc = recv(_fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (rc == 0 || (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiClient::stop() {
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+int WiFiClient::setNoDelay(bool noDelay) {
+    int flag = noDelay ? 1 : 0;
+    return _fd >= 0 ? setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) : -1;
+}
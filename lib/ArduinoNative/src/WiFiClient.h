@@ -0,0 +1,33 @@
+#ifndef ARDUINO_NATIVE_WIFICLIENT_H
+#define ARDUINO_NATIVE_WIFICLIENT_H
+
+#include "Arduino.h"
+
+// TCP-клиент на POSIX-сокетах с семантикой WiFiClient из Arduino-ESP32:
+// read()/available() не блокируют, connect() ограничен таймаутом.
+class WiFiClient : public Print {
+public:
+    WiFiClient() {}
+    ~WiFiClient() { stop(); }
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+
+    int connect(const char* host, uint16_t port, int32_t timeoutMs = 3000);
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs = 3000);
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available();
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    uint8_t connected();
+    void stop();
+    int setNoDelay(bool noDelay);
+    int fd() const { return _fd; }
+
+    explicit operator bool() { return connected(); }
+
+private:
+    int _fd = -1;
+};
+
+#endif
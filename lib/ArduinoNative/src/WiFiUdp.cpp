@@ -0,0 +1,121 @@
+#include "WiFiUdp.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool WiFiUDP::open() {
+    if (_fd >= 0) {
+        return true;
+    }
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) {
+        return false;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+    return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    if (!open()) {
+        return 0;
+    }
+    int reuse = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _rxLength = _rxRead = 0;
+}
+
+int WiFiUDP::parsePacket() {
+    _rxLength = _rxRead = 0;
+    if (_fd < 0) {
+        return 0;
+    }
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t rc = recvfrom(_fd, _rx, sizeof(_rx), MSG_DONTWAIT, (struct sockaddr*)&from, &fromLength);
+    if (rc <= 0) {
+        return 0;
+    }
+    _rxLength = (int)rc;
+    _remoteIP = IPAddress((uint32_t)from.sin_addr.s_addr);
+    _remotePort = ntohs(from.sin_port);
+    return _rxLength;
+}
+
+int WiFiUDP::read() {
+    return _rxRead < _rxLength ? _rx[_rxRead++] : -1;
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t size) {
+    size_t count = available();
+    if (count > size) {
+        count = size;
+    }
+    memcpy(buffer, _rx + _rxRead, count);
+    _rxRead += count;
+    return (int)count;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    _txAddress = (uint32_t)ip;
+    _txPort = port;
+    _txLength = 0;
+    return open() ? 1 : 0;
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) {
+        return 0;
+    }
+    uint32_t address = ((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+    return beginPacket(IPAddress(address), port);
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+    if (size > sizeof(_tx) - _txLength) {
+        size = sizeof(_tx) - _txLength;
+    }
+    memcpy(_tx + _txLength, buffer, size);
+    _txLength += size;
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    if (_fd < 0 || _txPort == 0) {
+        return 0;
+    }
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = _txAddress;
+    to.sin_port = htons(_txPort);
+    ssize_t rc = sendto(_fd, _tx, _txLength, 0, (struct sockaddr*)&to, sizeof(to));
+    _txLength = 0;
+    return rc >= 0 ? 1 : 0;
+}
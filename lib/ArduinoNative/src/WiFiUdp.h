@@ -0,0 +1,47 @@
+#ifndef ARDUINO_NATIVE_WIFIUDP_H
+#define ARDUINO_NATIVE_WIFIUDP_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// UDP на POSIX-сокетах с семантикой WiFiUDP из Arduino-ESP32: parsePacket()
+// не блокирует, принятая датаграмма читается read() до следующего parsePacket().
+class WiFiUDP : public Print {
+public:
+    WiFiUDP() {}
+    ~WiFiUDP() { stop(); }
+    WiFiUDP(const WiFiUDP&) = delete;
+    WiFiUDP& operator=(const WiFiUDP&) = delete;
+
+    uint8_t begin(uint16_t port);
+    void stop();
+
+    int parsePacket();
+    int available() { return _rxLength - _rxRead; }
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    IPAddress remoteIP() const { return _remoteIP; }
+    uint16_t remotePort() const { return _remotePort; }
+
+    int beginPacket(const char* host, uint16_t port);
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int endPacket();
+
+private:
+    bool open();
+
+    int _fd = -1;
+    uint8_t _rx[1472];
+    int _rxLength = 0;
+    int _rxRead = 0;
+    IPAddress _remoteIP;
+    uint16_t _remotePort = 0;
+    uint8_t _tx[1472];
+    size_t _txLength = 0;
+    uint32_t _txAddress = 0;
+    uint16_t _txPort = 0;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "esp_ota_ops.h"
+#include <string.h>
+#include <vector>
+
+static const esp_partition_t partitions[2] = {
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x10000, 0x1E0000, "app0", false },
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x1F0000, 0x1E0000, "app1", false }
+};
+static std::vector<uint8_t> contents[2];
+static const esp_partition_t* bootPartition = &partitions[0];
+
+// Единственная сессия записи: handle 1, 0 - нет сессии.
+static const esp_partition_t* writing = nullptr;
+static size_t writeOffset = 0;
+
+static std::vector<uint8_t>& data_of(const esp_partition_t* partition) {
+    std::vector<uint8_t>& data = contents[partition - partitions];
+    if (data.empty()) {
+        data.assign(partition->size, 0xFF);
+    }
+    return data;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                      return "ESP_OK";
+        case ESP_FAIL:                    return "ESP_FAIL";
+        case ESP_ERR_INVALID_ARG:         return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_SIZE:        return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:           return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_OTA_VALIDATE_FAILED: return "ESP_ERR_OTA_VALIDATE_FAILED";
+    }
+    return "UNKNOWN ERROR";
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    for (const esp_partition_t& partition : partitions) {
+        if (partition.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.subtype == subtype) &&
+            (!label || strcmp(label, partition.label) == 0)) {
+            return &partition;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    if (!partition || offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, data_of(partition).data() + offset, size);
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return &partitions[0];
+}
+
+const esp_partition_t* esp_ota_get_boot_partition() {
+    return bootPartition;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start) {
+    const esp_partition_t* from = start ? start : esp_ota_get_running_partition();
+    return from == &partitions[0] ? &partitions[1] : &partitions[0];
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t imageSize, esp_ota_handle_t* handle) {
+    if (!partition || partition == esp_ota_get_running_partition() || writing) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (imageSize != OTA_SIZE_UNKNOWN && imageSize != OTA_WITH_SEQUENTIAL_WRITES && imageSize > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    data_of(partition).assign(partition->size, 0xFF);
+    writing = partition;
+    writeOffset = 0;
+    *handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    if (handle != 1 || !writing) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size > writing->size - writeOffset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(data_of(writing).data() + writeOffset, data, size);
+    writeOffset += size;
+    return ESP_OK;
+}
+
+// Образ ESP32 начинается с магического байта 0xE9; остальное не проверяется.
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    if (handle != 1 || !writing) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool valid = writeOffset > 0 && data_of(writing)[0] == 0xE9;
+    writing = nullptr;
+    return valid ? ESP_OK : ESP_ERR_OTA_VALIDATE_FAILED;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+    if (handle != 1 || !writing) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    writing = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    if (!partition || partition->type != ESP_PARTITION_TYPE_APP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bootPartition = partition;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() {
+    return ESP_OK;
+}
@@ -0,0 +1,23 @@
+#ifndef ARDUINO_NATIVE_ESP_OTA_OPS_H
+#define ARDUINO_NATIVE_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+// Два слота как в min_spiffs.csv, содержимое в памяти процесса. Перезагрузка
+// не эмулируется: esp_ota_set_boot_partition() только запоминает выбор.
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN 0xffffffff
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe
+
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_boot_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start);
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t imageSize, esp_ota_handle_t* handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
+
+#endif
@@ -0,0 +1,81 @@
+#include "freertos/task.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Arduino.h"
+
+struct NativeTask {
+    std::mutex mutex;
+    std::condition_variable wake;
+    uint32_t notifications = 0;
+};
+
+static thread_local BaseType_t current_core = 1;
+static thread_local NativeTask* current_task = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackSize,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    (void)name;
+    (void)stackSize;
+    (void)priority;
+    // Задачи не удаляются, поэтому состояние живёт до конца процесса.
+    NativeTask* task = new NativeTask();
+    std::thread([function, parameter, core, task]() {
+        current_core = core;
+        current_task = task;
+        function(parameter);
+    }).detach();
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(millis() / portTICK_PERIOD_MS);
+}
+
+BaseType_t xPortGetCoreID() {
+    return current_core;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (!current_task) {
+        // Поток не из xTaskCreate (главный с loop(), std::thread в тестах).
+        static thread_local NativeTask own;
+        current_task = &own;
+    }
+    return current_task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask* task = (NativeTask*)xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (ticksToWait == portMAX_DELAY) {
+        task->wake.wait(lock, [task]() { return task->notifications > 0; });
+    } else {
+        task->wake.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS),
+                            [task]() { return task->notifications > 0; });
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearCountOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    NativeTask* task = (NativeTask*)handle;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->wake.notify_one();
+    return pdPASS;
+}
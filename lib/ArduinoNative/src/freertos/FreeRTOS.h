@@ -0,0 +1,21 @@
+#ifndef ARDUINO_NATIVE_FREERTOS_H
+#define ARDUINO_NATIVE_FREERTOS_H
+
+#include <stdint.h>
+
+// Минимум FreeRTOS для хоста: задачи - потоки std::thread, тик - 1 мс.
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
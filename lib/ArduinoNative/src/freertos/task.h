@@ -0,0 +1,18 @@
+#ifndef ARDUINO_NATIVE_FREERTOS_TASK_H
+#define ARDUINO_NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackSize,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+BaseType_t xPortGetCoreID();
+
+// Уведомления задач как счётчик (ulTaskNotifyTake/xTaskNotifyGive).
+TaskHandle_t xTaskGetCurrentTaskHandle();
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+#endif
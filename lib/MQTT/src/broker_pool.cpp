@@ -0,0 +1,135 @@
+#include "broker_pool.hpp"
+#include <string.h>
+
+// Оценка брокера без измерений: хуже любого измеренного, но лучше отказавшего.
+static const uint32_t UNMEASURED_SCORE = 0xFFFFFFFE;
+
+BrokerPool::BrokerPool(MqttClock clock, const BrokerPoolConfig& config)
+    : _clock(clock), _config(config) {}
+
+bool BrokerPool::add(const char* host, uint16_t port, uint8_t weight) {
+    if (_count >= MQTT_MAX_BROKERS || !host || strlen(host) >= MQTT_BROKER_HOST_SIZE) {
+        return false;
+    }
+    Broker& broker = _brokers[_count++];
+    strcpy(broker.host, host);
+    broker.port = port;
+    broker.weight = weight > 0 ? weight : 1;
+    broker.failures = 0;
+    broker.rtt = 0;
+    broker.cooldownUntil = 0;
+    return true;
+}
+
+void BrokerPool::clear() {
+    _count = 0;
+    _current = -1;
+    _nextProbe = 0;
+    _betterStreak = 0;
+}
+
+bool BrokerPool::healthy(uint8_t index) const {
+    const Broker& broker = _brokers[index];
+    return broker.failures == 0 || (long)(_clock() - broker.cooldownUntil) >= 0;
+}
+
+uint32_t BrokerPool::score(uint8_t index) const {
+    const Broker& broker = _brokers[index];
+    if (broker.rtt == 0) {
+        return UNMEASURED_SCORE;
+    }
+    return broker.rtt * 100 / broker.weight;
+}
+
+int8_t BrokerPool::best(bool healthyOnly) const {
+    int8_t chosen = -1;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (healthyOnly && !healthy(i)) {
+            continue;
+        }
+        if (chosen < 0 || score(i) < score(chosen)) {
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+int8_t BrokerPool::select() {
+    int8_t chosen = best(true);
+    if (chosen < 0 && _count > 0) {
+        // Отказали все: пробуем тот, чьё окно кончается раньше всех.
+        chosen = 0;
+        for (uint8_t i = 1; i < _count; i++) {
+            if ((long)(_brokers[i].cooldownUntil - _brokers[chosen].cooldownUntil) < 0) {
+                chosen = i;
+            }
+        }
+    }
+    _current = chosen;
+    _betterStreak = 0;
+    _lastProbe = _clock();
+    return chosen;
+}
+
+void BrokerPool::measure(Broker& broker, uint32_t rttMs) {
+    if (rttMs == 0) {
+        rttMs = 1;  // 0 значит "не измерено"
+    }
+    broker.rtt = broker.rtt == 0 ? rttMs : (broker.rtt * 3 + rttMs) / 4;
+}
+
+void BrokerPool::succeeded(uint8_t index, uint32_t rttMs) {
+    Broker& broker = _brokers[index];
+    broker.failures = 0;
+    measure(broker, rttMs);
+}
+
+void BrokerPool::failed(uint8_t index) {
+    Broker& broker = _brokers[index];
+    uint32_t window = _config.cooldownBaseMs;
+    for (uint8_t i = 0; i < broker.failures && window < _config.cooldownMaxMs; i++) {
+        window = window > _config.cooldownMaxMs / 2 ? _config.cooldownMaxMs : window * 2;
+    }
+    if (window > _config.cooldownMaxMs) {
+        window = _config.cooldownMaxMs;
+    }
+    if (broker.failures < 255) {
+        broker.failures++;
+    }
+    broker.cooldownUntil = _clock() + window;
+}
+
+int8_t BrokerPool::probeDue() {
+    if (_count < 2 || _clock() - _lastProbe < _config.probeIntervalMs) {
+        return -1;
+    }
+    _lastProbe = _clock();
+    uint8_t index = _nextProbe % _count;
+    _nextProbe = (index + 1) % _count;
+    return index;
+}
+
+void BrokerPool::probed(uint8_t index, bool reachable, uint32_t rttMs) {
+    if (reachable) {
+        succeeded(index, rttMs);
+    } else if (index != _current) {
+        failed(index);  // текущий судит сама сессия
+    }
+}
+
+int8_t BrokerPool::failbackTarget() {
+    if (_current < 0) {
+        return -1;
+    }
+    int8_t candidate = best(true);
+    if (candidate < 0 || candidate == _current || _brokers[candidate].rtt == 0 ||
+        (uint64_t)score(candidate) * (100 + _config.failbackMarginPct) >= (uint64_t)score(_current) * 100) {
+        _betterStreak = 0;
+        return -1;
+    }
+    if (++_betterStreak < _config.failbackProbes) {
+        return -1;
+    }
+    _betterStreak = 0;
+    return candidate;
+}
@@ -0,0 +1,84 @@
+#ifndef BROKER_POOL_HPP
+#define BROKER_POOL_HPP
+
+#include <stdint.h>
+#include "mqtt_connection.hpp"
+
+#ifndef MQTT_MAX_BROKERS
+#define MQTT_MAX_BROKERS 4
+#endif
+
+#ifndef MQTT_BROKER_HOST_SIZE
+#define MQTT_BROKER_HOST_SIZE 64
+#endif
+
+struct BrokerPoolConfig {
+    uint32_t probeIntervalMs = 30000;   // пока есть сессия, раз в столько проверяется один брокер
+    uint32_t cooldownBaseMs = 5000;     // отказавший брокер не выбирается, окно растёт вдвое
+    uint32_t cooldownMaxMs = 300000;
+    uint8_t failbackMarginPct = 25;     // лучший брокер должен быть быстрее текущего на столько...
+    uint8_t failbackProbes = 3;         // ...столько проб подряд, иначе остаёмся
+};
+
+// Выбор брокера из списка. Оценка брокера - сглаженное время TCP connect,
+// делённое на вес: вес 2 означает, что брокер предпочтительнее, пока он
+// не медленнее другого вдвое. При равной оценке выигрывает добавленный раньше,
+// так что список с одинаковыми весами работает как упорядоченный.
+//
+// Отказавший брокер выключается на растущее окно. Пока сессия есть, брокеры
+// по очереди (включая текущий) проверяются пробным подключением; обратно на
+// лучший брокер переходим, только если он заметно быстрее несколько проб
+// подряд, чтобы не прыгать между близкими брокерами.
+// Часы передаются снаружи: логика прогоняется на хосте без сети.
+class BrokerPool {
+public:
+    explicit BrokerPool(MqttClock clock, const BrokerPoolConfig& config = BrokerPoolConfig());
+
+    // weight 1..255; false - список полон или host слишком длинный.
+    bool add(const char* host, uint16_t port, uint8_t weight = 1);
+    void clear();
+    uint8_t count() const { return _count; }
+
+    const char* host(uint8_t index) const { return _brokers[index].host; }
+    uint16_t port(uint8_t index) const { return _brokers[index].port; }
+    // Сглаженное время подключения, мс; 0 - ещё не измерено.
+    uint32_t rtt(uint8_t index) const { return _brokers[index].rtt; }
+    bool healthy(uint8_t index) const;
+
+    // Брокер для следующего подключения, -1 - список пуст.
+    int8_t select();
+    int8_t current() const { return _current; }
+    void succeeded(uint8_t index, uint32_t rttMs);
+    void failed(uint8_t index);
+
+    // Пока сессия есть: какого брокера проверить сейчас, -1 - ещё рано.
+    int8_t probeDue();
+    void probed(uint8_t index, bool reachable, uint32_t rttMs);
+    // После probed(): брокер, на который пора перейти, или -1.
+    int8_t failbackTarget();
+
+private:
+    struct Broker {
+        char host[MQTT_BROKER_HOST_SIZE];
+        uint16_t port;
+        uint8_t weight;
+        uint8_t failures;
+        uint32_t rtt;
+        unsigned long cooldownUntil;
+    };
+
+    uint32_t score(uint8_t index) const;
+    int8_t best(bool healthyOnly) const;
+    void measure(Broker& broker, uint32_t rttMs);
+
+    MqttClock _clock;
+    BrokerPoolConfig _config;
+    Broker _brokers[MQTT_MAX_BROKERS];
+    uint8_t _count = 0;
+    int8_t _current = -1;
+    uint8_t _nextProbe = 0;
+    uint8_t _betterStreak = 0;
+    unsigned long _lastProbe = 0;
+};
+
+#endif
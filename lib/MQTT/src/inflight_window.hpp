@@ -0,0 +1,97 @@
+#ifndef INFLIGHT_WINDOW_HPP
+#define INFLIGHT_WINDOW_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW 4
+#endif
+
+// QoS 1 PUBLISH packets sent to the broker and not yet acknowledged.
+// Each slot keeps the encoded packet so it can be resent as is (with DUP set)
+// after a reconnect, without going back to the outbound queue.
+template <size_t PacketSize>
+class InflightWindow {
+public:
+    struct Slot {
+        uint16_t packetId = 0;   // 0 - слот свободен
+        unsigned long sentAt = 0;
+        uint32_t sequence = 0;
+        size_t length = 0;
+        uint8_t packet[PacketSize];
+    };
+
+    bool full() const { return _count == MQTT_INFLIGHT_WINDOW; }
+    size_t count() const { return _count; }
+
+    // Свободный слот под новый пакет, либо nullptr.
+    Slot* reserve() {
+        for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+            if (_slots[i].packetId == 0) {
+                return &_slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void commit(Slot* slot, uint16_t packetId, size_t length, unsigned long now) {
+        slot->packetId = packetId;
+        slot->length = length;
+        slot->sentAt = now;
+        slot->sequence = _sequence++;
+        _count++;
+    }
+
+    // Освобождает слот по PUBACK; sentAt - время отправки, для измерения RTT.
+    bool ack(uint16_t packetId, unsigned long* sentAt = nullptr) {
+        for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+            if (_slots[i].packetId == packetId) {
+                if (sentAt) {
+                    *sentAt = _slots[i].sentAt;
+                }
+                _slots[i].packetId = 0;
+                _count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(uint16_t packetId) const {
+        for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+            if (_slots[i].packetId == packetId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Обход в порядке отправки: MQTT требует повторять PUBLISH в исходном порядке.
+    template <typename Fn>
+    void forEach(Fn fn) {
+        Slot* previous = nullptr;
+        for (size_t n = 0; n < _count; n++) {
+            Slot* next = nullptr;
+            for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+                Slot& slot = _slots[i];
+                if (slot.packetId != 0 && (!previous || slot.sequence > previous->sequence) &&
+                    (!next || slot.sequence < next->sequence)) {
+                    next = &slot;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            fn(*next);
+            previous = next;
+        }
+    }
+
+private:
+    Slot _slots[MQTT_INFLIGHT_WINDOW];
+    size_t _count = 0;
+    uint32_t _sequence = 0;
+};
+
+#endif
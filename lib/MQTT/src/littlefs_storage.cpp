@@ -0,0 +1,50 @@
+#include "littlefs_storage.hpp"
+#include <LittleFS.h>
+#include "../../../src/shared/binlog.hpp"
+#include "../../../src/shared/flash_fs.hpp"
+
+bool LittleFsStorage::begin(const char* path, uint32_t capacity) {
+    if (!flash_fs_mount()) {
+        return false;
+    }
+
+    if (LittleFS.exists(path)) {
+        _file = LittleFS.open(path, "r+");
+        if (_file && _file.size() == capacity) {
+            return true;
+        }
+        _file.close();
+    }
+
+    _file = LittleFS.open(path, "w+");
+    if (!_file) {
+        LOG_WARN("[FS] Cannot create %s\n", path);
+        return false;
+    }
+
+    uint8_t zeros[64] = {0};
+    for (uint32_t written = 0; written < capacity; written += sizeof(zeros)) {
+        size_t chunk = capacity - written < sizeof(zeros) ? capacity - written : sizeof(zeros);
+        if (_file.write(zeros, chunk) != chunk) {
+            LOG_WARN("[FS] Cannot allocate %u bytes for %s\n", (unsigned)capacity, path);
+            _file.close();
+            return false;
+        }
+    }
+    _file.flush();
+    return true;
+}
+
+bool LittleFsStorage::read(uint32_t offset, void* data, size_t length) {
+    return _file && _file.seek(offset) && _file.read((uint8_t*)data, length) == length;
+}
+
+bool LittleFsStorage::write(uint32_t offset, const void* data, size_t length) {
+    return _file && _file.seek(offset) && _file.write((const uint8_t*)data, length) == length;
+}
+
+void LittleFsStorage::flush() {
+    if (_file) {
+        _file.flush();
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef LITTLEFS_STORAGE_HPP
+#define LITTLEFS_STORAGE_HPP
+
+#include <FS.h>
+#include "ring_log.hpp"
+
+// LogStorage поверх файла фиксированного размера на LittleFS.
+// Файл создаётся заранее на всю ёмкость, чтобы запись по смещению не меняла его размер.
+class LittleFsStorage : public LogStorage {
+public:
+    bool begin(const char* path, uint32_t capacity);
+
+    bool read(uint32_t offset, void* data, size_t length) override;
+    bool write(uint32_t offset, const void* data, size_t length) override;
+    void flush() override;
+
+private:
+    fs::File _file;
+};
+
+#endif
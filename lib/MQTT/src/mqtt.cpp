@@ -1,97 +1,626 @@
 #include "mqtt.hpp"
 #include <WiFi.h>
-#include <PubSubClient.h>
-#include <ArduinoJson.h>
 #include "../../../src/shared/auth.hpp"
+#include "../../../src/shared/metrics.hpp"
+#include "../../../src/shared/binlog.hpp"
 
-const char* mqtt_server = "192.168.3.137";
-const int mqtt_port = 1883;
+// TCP connect остаётся синхронным, ограничиваем его, чтобы не стопорить loop().
+const int32_t mqtt_connect_timeout_ms = 3000;
 
-WiFiClient espClient;
-PubSubClient client(espClient);
+// Коды _lastError меньше нуля - наши, остальные - return code из CONNACK.
+const int MQTT_ERROR_TCP = -1;
+const int MQTT_ERROR_WRITE = -2;
+const int MQTT_ERROR_PROTOCOL = -3;
+const int MQTT_ERROR_KEEPALIVE = -4;
+const int MQTT_ERROR_TLS = -5;
 
-Auth* authInstance = nullptr;
+static const uint32_t publish_latency_bounds[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+static MetricHistogram publish_latency("mqtt_publish_latency_ms", "pl", "QoS 1 PUBLISH to PUBACK time",
+                                       publish_latency_bounds, 9);
+static const uint32_t reconnect_bounds[] = { 1000, 2000, 5000, 10000, 30000, 60000, 300000 };
+static MetricHistogram reconnect_duration("mqtt_reconnect_duration_ms", "rd",
+                                          "Time from losing the broker to the next session",
+                                          reconnect_bounds, 7);
+static MetricCounter reconnects("mqtt_reconnects_total", "rc", "Broker sessions restored after a loss");
+static MetricCounter dropped("mqtt_dropped_total", "dr", "Messages lost: too large or queue and flash full");
+static MetricGauge queue_depth("mqtt_queue_depth", "qd", "Messages waiting for the broker, RAM and flash");
+static MetricCounter failovers("mqtt_broker_switches_total", "bs", "Sessions opened on a different broker than the last one");
+static const uint32_t tls_handshake_bounds[] = { 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+static MetricHistogram tls_handshake("mqtt_tls_handshake_ms", "th", "TLS handshake time, full and resumed",
+                                     tls_handshake_bounds, 8);
+static MetricCounter tls_resumed("mqtt_tls_resumed_total", "tr", "TLS handshakes that resumed a cached session");
+static MetricGauge broker_rtt("mqtt_broker_connect_ms", "bt", "Smoothed TCP connect time to the current broker");
 
-extern bool wifiCredentialsUpdated;
+static uint32_t mqtt_random() {
+    return esp_random();
+}
+
+static BrokerPoolConfig broker_pool_config() {
+    BrokerPoolConfig config;
+    config.probeIntervalMs = MQTT_BROKER_PROBE_MS;
+    return config;
+}
 
-void callback(char* topic, byte* payload, unsigned int length) {
-    String message;
-    for (unsigned int i = 0; i < length; i++) {
-        message += (char)payload[i];
+static MqttConnectionConfig connection_config() {
+    MqttConnectionConfig config;
+    config.backoffBaseMs = MQTT_BACKOFF_BASE_MS;
+    config.backoffMaxMs = MQTT_BACKOFF_MAX_MS;
+    return config;
+}
+
+MQTT::MQTT()
+    : _connection(*this, millis, mqtt_random, connection_config()),
+      _brokers(millis, broker_pool_config()),
+      _probe(millis),
+      _spillLog(_spillStorage, MQTT_SPILL_CAPACITY) {
+    _clientId[0] = '\0';
+}
+
+void MQTT::setAuthInstance(Auth* auth) {
+    _auth = auth;
+}
+
+void MQTT::setClientId(const char* clientId) {
+    snprintf(_clientId, sizeof(_clientId), "%s", clientId);
+}
+
+bool MQTT::addBroker(const char* host, uint16_t port, uint8_t weight) {
+    if (!_brokers.add(host, port, weight)) {
+        LOG_WARN("[MQTT] Cannot add broker %s:%u\n", host ? host : "", (unsigned)port);
+        return false;
     }
+    return true;
+}
+
+bool MQTT::setTls(TlsConfig* config) {
+    if (_session != Session::Closed || !_net.setTls(config)) {
+        LOG_WARN("[MQTT] Cannot enable TLS\n");
+        return false;
+    }
+    return true;
+}
 
-    Serial.print("Message arrived [");
-    Serial.print(topic);
-    Serial.print("]: ");
-    Serial.println(message);
+const char* MQTT::brokerHost() const {
+    return _broker >= 0 ? _brokers.host(_broker) : nullptr;
+}
 
-    if (String(topic) == "esp32/wifi") {
-        DynamicJsonDocument doc(256);
-        DeserializationError error = deserializeJson(doc, message);
-        if (!error) {
-            String ssid = doc["ssid"].as<String>();
-            String password = doc["password"].as<String>();
-            Serial.println("Received new WiFi credentials.");
-            if (authInstance) {
-                authInstance->setCredentials(ssid, password);
-                wifiCredentialsUpdated = true;  // флаг для переподключения
+void MQTT::connect() {
+    if (!_auth) {
+        LOG_ERROR("[MQTT] No Auth instance, call setAuthInstance() first\n");
+        return;
+    }
+    // Без WiFi state machine ждёт в Idle и подключается, когда сеть появится.
+    if (!_auth->is_connected()) {
+        LOG_INFO("[MQTT] WiFi not connected yet, connecting when it is up\n");
+    }
+
+    // Постоянный client id и clean session = 0: брокер сохраняет сессию,
+    // и неподтверждённые QoS 1 сообщения можно повторить после переподключения.
+    if (_clientId[0] == '\0') {
+        uint32_t chip = (uint32_t)(ESP.getEfuseMac() >> 24) & 0xFFFFFF;
+        snprintf(_clientId, sizeof(_clientId), "ESP32Client-%06X", (unsigned)chip);
+    }
+    if (_brokers.count() == 0) {
+        _brokers.add(MQTT_DEFAULT_BROKER_HOST,
+                     _net.secure() ? MQTT_DEFAULT_BROKER_TLS_PORT : MQTT_DEFAULT_BROKER_PORT);
+    }
+    _connection.start();
+}
+
+void MQTT::disconnect() {
+    if (_session == Session::Connected) {
+        size_t length = mqtt_encode_empty(_tx, sizeof(_tx), MQTT_DISCONNECT);
+        writePacket(_tx, length);
+    }
+    _switching = true;
+    _connection.stop();
+    _switching = false;
+    LOG_INFO("[MQTT] Disconnected\n");
+}
+
+void MQTT::send_message(const char* message) {
+    publish("esp32/test", message);
+}
+
+bool MQTT::publish(const char* topic, const char* payload, uint8_t qos) {
+    return publish(topic, (const uint8_t*)payload, strlen(payload), qos);
+}
+
+bool MQTT::publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+    if (qos > 1) {
+        qos = 1;  // QoS 2 не поддерживается, at-least-once достаточно
+    }
+    if (is_connected() && _queue.empty() && sendPublish(topic, payload, length, qos)) {
+        return true;
+    }
+    if (!_queue.push(topic, payload, length, qos)) {
+        LOG_WARN("[MQTT] Dropped message for %s (%u bytes)\n", topic, (unsigned)length);
+        dropped.add();
+        return false;
+    }
+    return true;
+}
+
+bool MQTT::publish(const char* topic, const JsonSchema& schema, const void* message, uint8_t qos) {
+    if (_arenaOwner && xTaskGetCurrentTaskHandle() != _arenaOwner) {
+        LOG_ERROR("[MQTT] publish(schema) for %s outside the MQTT task\n", topic);
+        return false;
+    }
+    ArenaScope scope(_arena);
+    const size_t capacity = MQTT_QUEUE_PAYLOAD_SIZE + 1;  // +1: JSON дописывает ноль
+    uint8_t* payload = (uint8_t*)_arena.allocate(capacity, 1);
+    if (!payload) {
+        LOG_WARN("[MQTT] No arena space to encode %s\n", topic);
+        return false;
+    }
+    size_t length = payload_encode(_formats.resolve(topic), schema, message, payload, capacity);
+    if (length == 0 || length > MQTT_QUEUE_PAYLOAD_SIZE) {
+        LOG_WARN("[MQTT] Message for %s does not fit in %u bytes\n", topic, MQTT_QUEUE_PAYLOAD_SIZE);
+        return false;
+    }
+    return publish(topic, payload, length, qos);
+}
+
+JsonError MQTT::decode(const char* topic, const uint8_t* payload, size_t length,
+                       const JsonSchema& schema, void* message) const {
+    return payload_decode(_formats.resolve(topic), schema, payload, length, message);
+}
+
+bool MQTT::beginSpill() {
+    if (!_spillStorage.begin(MQTT_SPILL_PATH, MQTT_SPILL_CAPACITY) || !_spillLog.begin()) {
+        LOG_WARN("[MQTT] Flash spill disabled\n");
+        return false;
+    }
+    _queue.setSpill(&_spillLog);
+    LOG_INFO("[MQTT] Flash spill ready, %u messages pending\n", (unsigned)_spillLog.count());
+    return true;
+}
+
+void MQTT::drain() {
+    for (uint8_t i = 0; i < _drainBudget; i++) {
+        const OutboundMessage* message = _queue.front();
+        if (!message || !sendPublish(message->topic, message->payload, message->length, message->qos)) {
+            break;
+        }
+        _queue.pop();
+    }
+}
+
+void MQTT::receive_message() {
+    _arenaOwner = xTaskGetCurrentTaskHandle();
+    MqttState before = _connection.state();
+    unsigned long spent = _connection.timeInState();
+
+    _connection.tick();
+
+    MqttState after = _connection.state();
+    if (after != before) {
+        LOG_INFO("[MQTT] %s -> %s after %lu ms\n",
+                 mqtt_state_name(before), mqtt_state_name(after), spent);
+        if (after == MqttState::Backoff) {
+            LOG_WARN("[MQTT] Retry in %lu ms, error=%d\n",
+                     _connection.backoffRemaining(), _lastError);
+        }
+        if (before == MqttState::Online) {
+            _offlineSince = millis();
+            _sessionLost = true;
+        } else if (after == MqttState::Online && _sessionLost) {
+            _sessionLost = false;
+            reconnects.add();
+            reconnect_duration.observe(millis() - _offlineSince);
+        }
+    }
+    queue_depth.set(_queue.depth());
+
+    if (millis() - _spillSyncAt >= MQTT_SPILL_SYNC_MS) {
+        _spillSyncAt = millis();
+        _queue.commit();
+    }
+}
+
+bool MQTT::on(const char* filter, TopicHandler handler, void* context) {
+    if (!_router.add(filter, handler, context)) {
+        LOG_WARN("[MQTT] Cannot register handler for %s\n", filter);
+        return false;
+    }
+    if (_session == Session::Connected) {
+        size_t length = mqtt_encode_subscribe(_tx, sizeof(_tx), nextPacketId(), filter, 1);
+        writePacket(_tx, length);
+    }
+    return true;
+}
+
+void MQTT::dispatch(const char* topic, const uint8_t* payload, size_t length) {
+    ArenaScope scope(_arena);
+    // Тело не выводится: в нём бывают учётные данные (esp32/wifi).
+    LOG_DEBUG("[MQTT] Message arrived [%s]: %u bytes\n", topic, (unsigned)length);
+
+    if (_router.dispatch(topic, payload, length) == 0) {
+        LOG_WARN("[MQTT] No handler for %s\n", topic);
+    }
+}
+
+bool MQTT::is_connected() const {
+    return _connection.state() == MqttState::Online;
+}
+
+MqttState MQTT::state() const {
+    return _connection.state();
+}
+
+unsigned long MQTT::timeInState() const {
+    return _connection.timeInState();
+}
+
+bool MQTT::networkReady() {
+    return _auth && _auth->is_connected();
+}
+
+LinkStatus MQTT::openSession() {
+    if (_session == Session::Closed) {
+        _broker = _brokers.select();
+        if (_broker < 0) {
+            return LinkStatus::Failed;
+        }
+        unsigned long started = millis();
+        _brokerOpen = true;
+        if (!_net.connect(_brokers.host(_broker), _brokers.port(_broker), mqtt_connect_timeout_ms)) {
+            _lastError = MQTT_ERROR_TCP;
+            return LinkStatus::Failed;
+        }
+        _connectRtt = millis() - started;
+        _net.setNoDelay(true);
+        _session = Session::Handshake;
+    }
+
+    if (_session == Session::Handshake) {
+        LinkStatus handshake = _net.handshake();
+        if (handshake == LinkStatus::Pending) {
+            return handshake;
+        }
+        if (handshake == LinkStatus::Failed) {
+            LOG_WARN("[MQTT] TLS handshake with %s failed: %d\n", _brokers.host(_broker),
+                     _net.tlsStats().lastError);
+            _lastError = MQTT_ERROR_TLS;
+            return LinkStatus::Failed;
+        }
+        if (_net.secure()) {
+            const TlsStats& stats = _net.tlsStats();
+            tls_handshake.observe(stats.lastMs);
+            if (stats.lastResumed) {
+                tls_resumed.add();
             }
-        } else {
-            Serial.println("Failed to parse WiFi credentials");
+            LOG_INFO("[MQTT] TLS %s in %u ms (%u ms CPU)\n", stats.lastResumed ? "resumed" : "full handshake",
+                     (unsigned)stats.lastMs, (unsigned)(stats.lastCpuUs / 1000));
         }
-    } else if (String(topic) == "esp32/test") {
-        Serial.println("Ping received!");
+
+        MqttConnectOptions options;
+        options.clientId = _clientId;
+        options.keepAliveS = MQTT_KEEPALIVE_S;
+        options.cleanSession = false;
+        size_t length = mqtt_encode_connect(_tx, sizeof(_tx), options);
+        if (!writePacket(_tx, length)) {
+            return LinkStatus::Failed;
+        }
+        _session = Session::AwaitConnack;
+        return LinkStatus::Pending;
+    }
+
+    pump();
+    switch (_session) {
+        case Session::Connected:
+            _brokers.succeeded(_broker, _connectRtt);
+            broker_rtt.set(_brokers.rtt(_broker));
+            if (_lastBroker >= 0 && _lastBroker != _broker) {
+                failovers.add();
+            }
+            _lastBroker = _broker;
+            LOG_INFO("[MQTT] Session with %s:%u (connect %u ms)\n", _brokers.host(_broker),
+                     (unsigned)_brokers.port(_broker), (unsigned)_connectRtt);
+            return LinkStatus::Ok;
+        case Session::Closed:    return LinkStatus::Failed;
+        default:                 return LinkStatus::Pending;
     }
 }
 
+LinkStatus MQTT::subscribe() {
+    if (!_subscribeSent) {
+        _subscribeSent = true;
+        _subscribeFailed = false;
+        _pendingSubacks = 0;
+        bool sent = _router.forEachFilter([this](const char* filter) {
+            uint16_t packetId = nextPacketId();
+            size_t length = mqtt_encode_subscribe(_tx, sizeof(_tx), packetId, filter, 1);
+            if (_pendingSubacks >= MQTT_MAX_ROUTES || !writePacket(_tx, length)) {
+                return false;
+            }
+            _subackIds[_pendingSubacks++] = packetId;
+            return true;
+        });
+        if (!sent) {
+            return LinkStatus::Failed;
+        }
+    }
 
+    pump();
+    if (_subscribeFailed || _session != Session::Connected) {
+        return LinkStatus::Failed;
+    }
+    return _pendingSubacks == 0 ? LinkStatus::Ok : LinkStatus::Pending;
+}
 
-void MQTT::setAuthInstance(Auth* auth) {
-    authInstance = auth;
+bool MQTT::sessionAlive() {
+    if (_session != Session::Connected || !_net.connected()) {
+        return false;
+    }
+    if (_pingOutstanding && millis() - _pingSentAt > MQTT_KEEPALIVE_S * 1000UL) {
+        _lastError = MQTT_ERROR_KEEPALIVE;
+        return false;
+    }
+    return true;
 }
 
-void MQTT::connect() {
-    if (!authInstance || !authInstance->is_connected()) {
-        Serial.println("[MQTT] WiFi not connected. Connect WiFi first.");
+void MQTT::closeSession() {
+    // Отказ засчитывается брокеру, только если WiFi в порядке и закрываем не сами.
+    if (_brokerOpen) {
+        _brokerOpen = false;
+        if (!_switching && networkReady()) {
+            _brokers.failed(_broker);
+        }
+    }
+    _net.stop();
+    _probe.stop();  // без сессии проба не нужна, а её таймаут записал бы брокеру отказ
+    _probing = -1;
+    _session = Session::Closed;
+    _rxLength = 0;
+    _rxSkip = MqttSkip();
+    _pingOutstanding = false;
+    _subscribeSent = false;
+    _pendingSubacks = 0;
+}
+
+void MQTT::service() {
+    pump();
+    if (_session != Session::Connected) {
         return;
     }
 
-    client.setServer(mqtt_server, mqtt_port);
-    client.setCallback(callback);
+    unsigned long now = millis();
+    if (!_pingOutstanding && now - _lastTx >= MQTT_KEEPALIVE_S * 1000UL) {
+        size_t length = mqtt_encode_empty(_tx, sizeof(_tx), MQTT_PINGREQ);
+        if (writePacket(_tx, length)) {
+            _pingOutstanding = true;
+            _pingSentAt = now;
+        }
+    }
 
-    while (!client.connected()) {
-        Serial.println("Connecting to MQTT...");
-        String clientId = "ESP32Client-";
-        clientId += String(random(0xffff), HEX);
+    drain();
+    probeBrokers();
+}
 
-        if (client.connect(clientId.c_str())) {
-            Serial.println("Connected to MQTT");
-            client.subscribe("esp32/wifi");
-            client.subscribe("esp32/test");
-        } else {
-            Serial.print("Failed to connect MQTT, state=");
-            Serial.println(client.state());
-            delay(2000);
+// Пока сессия есть, по одному брокеру за раз проверяется TCP connect; если
+// лучший брокер стабильно быстрее текущего, переходим на него без паузы.
+// Проба идёт в фоне: каждый вызов только проверяет её сокет.
+void MQTT::probeBrokers() {
+    if (_probing < 0) {
+        int8_t index = _brokers.probeDue();
+        if (index < 0 || !_probe.start(_brokers.host(index), _brokers.port(index), MQTT_PROBE_TIMEOUT_MS)) {
+            return;  // нет сокета или DNS ещё занят прошлой пробой: следующий раз через интервал
         }
+        _probing = index;
+    }
+    uint32_t rtt = 0;
+    ProbeStatus status = _probe.poll(rtt);
+    if (status == ProbeStatus::Pending) {
+        return;
+    }
+    int8_t index = _probing;
+    _probing = -1;
+    _brokers.probed(index, status == ProbeStatus::Reachable, rtt);
+    if (index == _broker) {
+        broker_rtt.set(_brokers.rtt(_broker));
+    }
+
+    int8_t target = _brokers.failbackTarget();
+    if (target < 0) {
+        return;
     }
+    LOG_INFO("[MQTT] Switching to %s:%u (%u ms vs %u ms)\n", _brokers.host(target),
+             (unsigned)_brokers.port(target), (unsigned)_brokers.rtt(target),
+             (unsigned)_brokers.rtt(_broker));
+    size_t length = mqtt_encode_empty(_tx, sizeof(_tx), MQTT_DISCONNECT);
+    writePacket(_tx, length);
+    _switching = true;
+    _connection.reconnect();
+    _switching = false;
 }
 
-void MQTT::disconnect() {
-    client.disconnect();
-    Serial.println("Disconnected from MQTT.");
+// Читает доступные байты в _rx и разбирает пакеты прямо в буфере.
+void MQTT::pump() {
+    int available = _net.available();
+    while (available > 0 && _rxSkip.remaining() > 0) {
+        uint8_t scratch[64];
+        size_t chunk = _rxSkip.remaining() < sizeof(scratch) ? _rxSkip.remaining() : sizeof(scratch);
+        int read = _net.read(scratch, chunk);
+        if (read <= 0) {
+            return;
+        }
+        _rxSkip.feed(scratch, read);
+        available -= read;
+        if (_rxSkip.remaining() == 0) {
+            skipped();
+        }
+    }
+
+    if (available > 0 && _rxLength < sizeof(_rx)) {
+        int read = _net.read(_rx + _rxLength, sizeof(_rx) - _rxLength);
+        if (read > 0) {
+            _rxLength += read;
+        }
+    }
+
+    size_t offset = 0;
+    while (offset < _rxLength) {
+        MqttPacket packet;
+        MqttDecode result = mqtt_decode(_rx + offset, _rxLength - offset, sizeof(_rx), packet);
+        if (result == MqttDecode::Incomplete) {
+            break;
+        }
+        if (result == MqttDecode::TooLarge) {
+            // Не помещается в буфер: пропускаем пакет целиком, соединение живо.
+            LOG_WARN("[MQTT] Skipping %u-byte packet\n", (unsigned)packet.size);
+            _rxSkip.begin(packet);
+            _rxSkip.feed(_rx + offset, _rxLength - offset);
+            offset = _rxLength;
+            break;
+        }
+        if (result == MqttDecode::Malformed) {
+            LOG_WARN("[MQTT] Malformed packet from broker\n");
+            _lastError = MQTT_ERROR_PROTOCOL;
+            closeSession();
+            return;
+        }
+
+        offset += packet.size;
+        handle(packet);
+        if (_session == Session::Closed) {
+            return;
+        }
+    }
+
+    if (offset > 0) {
+        memmove(_rx, _rx + offset, _rxLength - offset);
+        _rxLength -= offset;
+    }
 }
 
-void MQTT::send_message(const char* message) {
-    if (client.connected()) {
-        client.publish("esp32/test", message);
+// Пропущенный PUBLISH QoS 1/2 подтверждается, как доставленный: иначе брокер
+// повторяет его при каждом переподключении и сессия за ним не продвигается.
+void MQTT::skipped() {
+    MqttPacketType type;
+    uint16_t packetId;
+    if (_rxSkip.ack(type, packetId)) {
+        sendAck(type, packetId);
     }
 }
 
-void MQTT::receive_message() {
-    if (!client.connected()) {
-        Serial.println("[MQTT] Client disconnected, trying to reconnect...");
-        connect();
+void MQTT::handle(const MqttPacket& packet) {
+    switch (packet.type) {
+        case MQTT_CONNACK:
+            if (_session != Session::AwaitConnack) {
+                break;
+            }
+            if (packet.returnCode != 0) {
+                _lastError = packet.returnCode;
+                closeSession();
+                break;
+            }
+            _session = Session::Connected;
+            retransmit();
+            break;
+
+        case MQTT_PUBLISH:
+            dispatch(packet.topic, packet.payload, packet.payloadLength);
+            if (packet.qos == 1) {
+                sendAck(MQTT_PUBACK, packet.packetId);
+            } else if (packet.qos == 2) {
+                sendAck(MQTT_PUBREC, packet.packetId);
+            }
+            break;
+
+        case MQTT_PUBREL:
+            sendAck(MQTT_PUBCOMP, packet.packetId);
+            break;
+
+        case MQTT_PUBACK: {
+            unsigned long sentAt;
+            if (_inflight.ack(packet.packetId, &sentAt)) {
+                publish_latency.observe(millis() - sentAt);
+            }
+            break;
+        }
+
+        case MQTT_SUBACK:
+            // Засчитывается только ответ на свой SUBSCRIBE этой сессии:
+            // повтор или запоздавший SUBACK не завершает чужую подписку.
+            for (uint8_t i = 0; i < _pendingSubacks; i++) {
+                if (_subackIds[i] == packet.packetId) {
+                    _subackIds[i] = _subackIds[--_pendingSubacks];
+                    if (packet.returnCode == 0x80) {
+                        _subscribeFailed = true;
+                    }
+                    return;
+                }
+            }
+            if (packet.returnCode == 0x80) {
+                LOG_WARN("[MQTT] Subscription %u refused\n", (unsigned)packet.packetId);
+            }
+            break;
+
+        case MQTT_PINGRESP:
+            _pingOutstanding = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool MQTT::sendPublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+    if (_session != Session::Connected) {
+        return false;
+    }
+
+    if (qos == 0) {
+        size_t size = mqtt_encode_publish(_tx, sizeof(_tx), topic, payload, length, 0, false, 0);
+        return size > 0 && writePacket(_tx, size);
+    }
+
+    InflightWindow<MQTT_PACKET_SIZE>::Slot* slot = _inflight.reserve();
+    if (!slot) {
+        return false;
     }
-    client.loop();
+    uint16_t packetId = nextPacketId();
+    size_t size = mqtt_encode_publish(slot->packet, sizeof(slot->packet), topic, payload, length,
+                                      1, false, packetId);
+    if (size == 0) {
+        return false;
+    }
+    _inflight.commit(slot, packetId, size, millis());
+    // Если запись не удалась, пакет остаётся в окне и уйдёт после переподключения.
+    writePacket(slot->packet, size);
+    return true;
+}
+
+bool MQTT::sendAck(MqttPacketType type, uint16_t packetId) {
+    size_t length = mqtt_encode_ack(_tx, sizeof(_tx), type, packetId);
+    return writePacket(_tx, length);
+}
+
+bool MQTT::writePacket(const uint8_t* packet, size_t length) {
+    if (length == 0 || _net.write(packet, length) != length) {
+        _lastError = MQTT_ERROR_WRITE;
+        return false;
+    }
+    _lastTx = millis();
+    return true;
+}
+
+void MQTT::retransmit() {
+    _inflight.forEach([this](InflightWindow<MQTT_PACKET_SIZE>::Slot& slot) {
+        slot.packet[0] |= MQTT_PUBLISH_DUP;
+        slot.sentAt = millis();
+        writePacket(slot.packet, slot.length);
+        _retransmits++;
+    });
 }
 
+uint16_t MQTT::nextPacketId() {
+    do {
+        _packetId++;
+        if (_packetId == 0) {
+            _packetId = 1;
+        }
+    } while (_inflight.contains(_packetId));
+    return _packetId;
+}
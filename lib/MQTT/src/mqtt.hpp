@@ -1,15 +1,229 @@
 #ifndef MQTT_HPP
 #define MQTT_HPP
 
+#include <WiFi.h>
+#include "mqtt_codec.hpp"
+#include "mqtt_connection.hpp"
+#include "mqtt_transport.hpp"
+#include "broker_pool.hpp"
+#include "tcp_probe.hpp"
+#include "topic_router.hpp"
+#include "outbound_queue.hpp"
+#include "inflight_window.hpp"
+#include "ring_log.hpp"
+#include "littlefs_storage.hpp"
+#include "payload_format.hpp"
 #include "../../../src/shared/auth.hpp"  // включи здесь, чтобы 'Auth' был известен
+#include "../../../src/shared/arena.hpp"
 
-class MQTT {
+#ifndef MQTT_MAX_ROUTES
+#define MQTT_MAX_ROUTES 16
+#endif
+
+#ifndef MQTT_MAX_TOPIC_NODES
+#define MQTT_MAX_TOPIC_NODES 48
+#endif
+
+#ifndef MQTT_SPILL_PATH
+#define MQTT_SPILL_PATH "/mqtt_spill.log"
+#endif
+
+#ifndef MQTT_SPILL_CAPACITY
+#define MQTT_SPILL_CAPACITY (64 * 1024)
+#endif
+
+// Как часто позиции spill сохраняются на flash (кроме пачек по RING_LOG_SYNC_EVERY).
+#ifndef MQTT_SPILL_SYNC_MS
+#define MQTT_SPILL_SYNC_MS 5000
+#endif
+
+#ifndef MQTT_DRAIN_BUDGET
+#define MQTT_DRAIN_BUDGET 4
+#endif
+
+#ifndef MQTT_RX_BUFFER_SIZE
+#define MQTT_RX_BUFFER_SIZE 512
+#endif
+
+// Память на одно сообщение: разбор входящего в обработчике, кодирование исходящего.
+#ifndef MQTT_ARENA_SIZE
+#define MQTT_ARENA_SIZE 1024
+#endif
+
+// Брокер, если список не задан через addBroker().
+#ifndef MQTT_DEFAULT_BROKER_HOST
+#define MQTT_DEFAULT_BROKER_HOST "192.168.3.137"
+#endif
+
+#ifndef MQTT_DEFAULT_BROKER_PORT
+#define MQTT_DEFAULT_BROKER_PORT 1883
+#endif
+
+#ifndef MQTT_DEFAULT_BROKER_TLS_PORT
+#define MQTT_DEFAULT_BROKER_TLS_PORT 8883
+#endif
+
+// Как часто, пока сессия есть, проверяется один из брокеров списка.
+#ifndef MQTT_BROKER_PROBE_MS
+#define MQTT_BROKER_PROBE_MS 30000
+#endif
+
+// Сколько ждать ответа на пробное подключение (TcpProbe, без блокировки
+// loop()); не ответивший брокер считается недоступным.
+#ifndef MQTT_PROBE_TIMEOUT_MS
+#define MQTT_PROBE_TIMEOUT_MS 1000
+#endif
+
+// Пауза между попытками подключения растёт от BASE до MAX (см. Backoff);
+// подбираются по нагрузке на брокер симулятором парка (env:fleet).
+#ifndef MQTT_BACKOFF_BASE_MS
+#define MQTT_BACKOFF_BASE_MS 1000
+#endif
+
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 60000
+#endif
+
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S 15
+#endif
+
+// Самый большой исходящий PUBLISH: фиксированный заголовок, длина топика, packet id.
+#define MQTT_PACKET_SIZE (MQTT_QUEUE_TOPIC_SIZE + MQTT_QUEUE_PAYLOAD_SIZE + 8)
+
+class MQTT : private MqttLink {
 public:
+    MQTT();
     void connect();
     void disconnect();
     void send_message(const char *message);
     void receive_message();
     void setAuthInstance(Auth* auth);
+    // По умолчанию ESP32Client-<MAC>; задаётся до connect(), если устройств
+    // с одним MAC несколько (симулятор парка на хосте).
+    void setClientId(const char* clientId);
+
+    // Список брокеров (см. BrokerPool): подключение к лучшему доступному,
+    // переход на другой при отказе и возврат, когда лучший снова доступен.
+    bool addBroker(const char* host, uint16_t port = 1883, uint8_t weight = 1);
+    const BrokerPool& brokers() const { return _brokers; }
+
+    // TLS ко всем брокерам списка (порт брокера - TLS, обычно 8883); до connect().
+    // config - общий, разобранный один раз (см. TlsConfig); nullptr - без TLS.
+    bool setTls(TlsConfig* config);
+    // Рукопожатия: сколько возобновлено, время последнего.
+    const TlsStats& tlsStats() const { return _net.tlsStats(); }
+    // Брокер текущей или последней сессии, nullptr - ещё не подключались.
+    const char* brokerHost() const;
+
+    // Сообщение ставится в очередь и уходит, когда есть соединение с брокером.
+    // false - сообщение потеряно (слишком большое или очередь и flash заполнены).
+    // QoS 1: сообщение держится в окне до PUBACK и повторяется после переподключения.
+    bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos = 0);
+    bool publish(const char* topic, const char* payload, uint8_t qos = 0);
+    // Сообщение по схеме: JSON или CBOR в зависимости от топика (см. setPayloadFormat).
+    // Только из задачи receive_message(): кодируется в arena().
+    bool publish(const char* topic, const JsonSchema& schema, const void* message, uint8_t qos = 0);
+    JsonError decode(const char* topic, const uint8_t* payload, size_t length,
+                     const JsonSchema& schema, void* message) const;
+
+    // Топики под фильтром кодируются в format; суффикс MQTT_CBOR_SUFFIX работает без правил.
+    bool setPayloadFormat(const char* filter, PayloadFormat format) { return _formats.set(filter, format); }
+    PayloadFormat payloadFormat(const char* topic) const { return _formats.resolve(topic); }
+
+    // Регистрирует обработчик для фильтра (поддерживает '+' и '#').
+    // Подписка на брокере восстанавливается из таблицы при каждом подключении.
+    bool on(const char* filter, TopicHandler handler, void* context = nullptr);
+
+    // Включает запись переполнения очереди в кольцевой лог на LittleFS.
+    bool beginSpill();
+    // Сколько сообщений из очереди отправлять за один вызов receive_message().
+    void setDrainBudget(uint8_t messages) { _drainBudget = messages; }
+    size_t queueDepth() const { return _queue.depth(); }
+    const OutboundStats& outboundStats() const { return _queue.stats(); }
+    size_t inflight() const { return _inflight.count(); }
+    uint32_t retransmits() const { return _retransmits; }
+
+    // Арена текущего сообщения: обработчик из on() берёт в ней память под
+    // разобранное сообщение, после возврата из обработчика всё освобождается.
+    // Арена одна на экземпляр и без блокировок: ею пользуются только задача,
+    // вызывающая receive_message() (обработчики, RPC), и publish(schema) из
+    // неё же. publish(schema) из другой задачи отвергается - оттуда сообщение
+    // передаётся готовым payload в publish() или через очередь задач.
+    Arena& arena() { return _arena; }
+
+    bool is_connected() const;
+    MqttState state() const;
+    unsigned long timeInState() const;
+
+private:
+    enum class Session : uint8_t {
+        Closed,
+        Handshake,
+        AwaitConnack,
+        Connected
+    };
+
+    bool networkReady() override;
+    LinkStatus openSession() override;
+    LinkStatus subscribe() override;
+    bool sessionAlive() override;
+    void closeSession() override;
+    void service() override;
+
+    void dispatch(const char* topic, const uint8_t* payload, size_t length);
+    void drain();
+    void pump();
+    void skipped();
+    void handle(const MqttPacket& packet);
+    bool sendPublish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos);
+    bool sendAck(MqttPacketType type, uint16_t packetId);
+    bool writePacket(const uint8_t* packet, size_t length);
+    void retransmit();
+    uint16_t nextPacketId();
+    void probeBrokers();
+
+    Auth* _auth = nullptr;
+    MqttTransport _net;
+    MqttConnection _connection;
+    BrokerPool _brokers;
+    TcpProbe _probe;
+    int8_t _probing = -1;         // брокер, которого сейчас проверяет _probe
+    int8_t _broker = -1;          // брокер текущей сессии
+    int8_t _lastBroker = -1;      // брокер последней удачной сессии
+    bool _brokerOpen = false;     // сессия с _broker начата и ещё не закрыта
+    bool _switching = false;      // закрываем сами: брокер не виноват
+    uint32_t _connectRtt = 0;
+    TopicRouter<MQTT_MAX_ROUTES, MQTT_MAX_TOPIC_NODES> _router;
+    PayloadFormats _formats;
+
+    Session _session = Session::Closed;
+    char _clientId[24];
+    uint8_t _rx[MQTT_RX_BUFFER_SIZE];
+    size_t _rxLength = 0;
+    MqttSkip _rxSkip;             // пакет больше _rx, пропускается
+    uint8_t _tx[MQTT_PACKET_SIZE];
+    unsigned long _lastTx = 0;
+    unsigned long _pingSentAt = 0;
+    bool _pingOutstanding = false;
+    bool _subscribeSent = false;
+    bool _subscribeFailed = false;
+    uint16_t _subackIds[MQTT_MAX_ROUTES];  // SUBSCRIBE без ответа
+    uint8_t _pendingSubacks = 0;
+    uint16_t _packetId = 0;
+    int _lastError = 0;
+
+    OutboundQueue _queue;
+    InflightWindow<MQTT_PACKET_SIZE> _inflight;
+    uint32_t _retransmits = 0;
+    unsigned long _offlineSince = 0;
+    bool _sessionLost = false;
+    LittleFsStorage _spillStorage;
+    RingLog _spillLog;
+    unsigned long _spillSyncAt = 0;
+    uint8_t _drainBudget = MQTT_DRAIN_BUDGET;
+    StaticArena<MQTT_ARENA_SIZE> _arena;
+    TaskHandle_t _arenaOwner = nullptr;  // задача receive_message()
 };
 
 #endif
@@ -0,0 +1,283 @@
+#include "mqtt_codec.hpp"
+#include <string.h>
+
+namespace {
+
+struct Writer {
+    uint8_t* pos;
+    uint8_t* end;
+    bool ok;
+
+    Writer(uint8_t* buffer, size_t capacity) : pos(buffer), end(buffer + capacity), ok(true) {}
+
+    void u8(uint8_t value) {
+        if (pos >= end) {
+            ok = false;
+            return;
+        }
+        *pos++ = value;
+    }
+
+    void u16(uint16_t value) {
+        u8(value >> 8);
+        u8(value & 0xFF);
+    }
+
+    void bytes(const void* data, size_t length) {
+        if ((size_t)(end - pos) < length) {
+            ok = false;
+            return;
+        }
+        memcpy(pos, data, length);
+        pos += length;
+    }
+
+    void str(const char* value) {
+        size_t length = strlen(value);
+        if (length > 0xFFFF) {
+            ok = false;
+            return;
+        }
+        u16((uint16_t)length);
+        bytes(value, length);
+    }
+
+    void header(uint8_t first, size_t remaining) {
+        u8(first);
+        do {
+            uint8_t digit = remaining % 128;
+            remaining /= 128;
+            u8(remaining > 0 ? digit | 0x80 : digit);
+        } while (remaining > 0);
+    }
+
+    size_t finish(uint8_t* buffer) const {
+        return ok ? (size_t)(pos - buffer) : 0;
+    }
+};
+
+const size_t MQTT_MAX_REMAINING = 268435455;
+
+uint16_t read_u16(const uint8_t* data) {
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+}  // namespace
+
+size_t mqtt_encode_connect(uint8_t* buffer, size_t capacity, const MqttConnectOptions& options) {
+    size_t remaining = 10 + 2 + strlen(options.clientId);
+    uint8_t flags = options.cleanSession ? 0x02 : 0x00;
+    if (options.username) {
+        flags |= 0x80;
+        remaining += 2 + strlen(options.username);
+    }
+    if (options.password) {
+        flags |= 0x40;
+        remaining += 2 + strlen(options.password);
+    }
+
+    Writer out(buffer, capacity);
+    out.header(MQTT_CONNECT << 4, remaining);
+    out.str("MQTT");
+    out.u8(4);  // protocol level 3.1.1
+    out.u8(flags);
+    out.u16(options.keepAliveS);
+    out.str(options.clientId);
+    if (options.username) {
+        out.str(options.username);
+    }
+    if (options.password) {
+        out.str(options.password);
+    }
+    return out.finish(buffer);
+}
+
+size_t mqtt_encode_publish(uint8_t* buffer, size_t capacity, const char* topic,
+                           const uint8_t* payload, size_t length, uint8_t qos,
+                           bool retain, uint16_t packetId) {
+    size_t remaining = 2 + strlen(topic) + (qos > 0 ? 2 : 0) + length;
+    if (qos > 2 || remaining > MQTT_MAX_REMAINING) {
+        return 0;
+    }
+
+    Writer out(buffer, capacity);
+    out.header((MQTT_PUBLISH << 4) | (qos << 1) | (retain ? 1 : 0), remaining);
+    out.str(topic);
+    if (qos > 0) {
+        out.u16(packetId);
+    }
+    out.bytes(payload, length);
+    return out.finish(buffer);
+}
+
+size_t mqtt_encode_subscribe(uint8_t* buffer, size_t capacity, uint16_t packetId,
+                             const char* filter, uint8_t qos) {
+    Writer out(buffer, capacity);
+    out.header((MQTT_SUBSCRIBE << 4) | 0x02, 2 + 2 + strlen(filter) + 1);
+    out.u16(packetId);
+    out.str(filter);
+    out.u8(qos);
+    return out.finish(buffer);
+}
+
+size_t mqtt_encode_ack(uint8_t* buffer, size_t capacity, MqttPacketType type, uint16_t packetId) {
+    Writer out(buffer, capacity);
+    out.header((type << 4) | (type == MQTT_PUBREL ? 0x02 : 0x00), 2);
+    out.u16(packetId);
+    return out.finish(buffer);
+}
+
+size_t mqtt_encode_empty(uint8_t* buffer, size_t capacity, MqttPacketType type) {
+    Writer out(buffer, capacity);
+    out.header(type << 4, 0);
+    return out.finish(buffer);
+}
+
+MqttDecode mqtt_decode(uint8_t* buffer, size_t length, size_t maxPacket, MqttPacket& packet) {
+    if (length < 2) {
+        return MqttDecode::Incomplete;
+    }
+
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    size_t pos = 1;
+    while (true) {
+        if (pos >= length) {
+            return MqttDecode::Incomplete;
+        }
+        uint8_t digit = buffer[pos++];
+        remaining += (digit & 0x7F) * multiplier;
+        if ((digit & 0x80) == 0) {
+            break;
+        }
+        if (pos == 5) {
+            return MqttDecode::Malformed;
+        }
+        multiplier *= 128;
+    }
+
+    size_t size = pos + remaining;
+    if (size > maxPacket) {
+        memset(&packet, 0, sizeof(packet));
+        packet.type = buffer[0] >> 4;
+        packet.flags = buffer[0] & 0x0F;
+        packet.size = size;
+        packet.bodyLength = remaining;
+        return MqttDecode::TooLarge;
+    }
+    if (size > length) {
+        return MqttDecode::Incomplete;
+    }
+
+    memset(&packet, 0, sizeof(packet));
+    packet.type = buffer[0] >> 4;
+    packet.flags = buffer[0] & 0x0F;
+    packet.size = size;
+    packet.body = buffer + pos;
+    packet.bodyLength = remaining;
+
+    uint8_t* body = packet.body;
+    switch (packet.type) {
+        case MQTT_CONNACK:
+            if (remaining != 2) {
+                return MqttDecode::Malformed;
+            }
+            packet.sessionPresent = body[0] & 0x01;
+            packet.returnCode = body[1];
+            break;
+
+        case MQTT_PUBLISH: {
+            packet.qos = (packet.flags >> 1) & 0x03;
+            packet.retain = packet.flags & 0x01;
+            packet.dup = packet.flags & MQTT_PUBLISH_DUP;
+            if (packet.qos == 3 || remaining < 2) {
+                return MqttDecode::Malformed;
+            }
+            uint16_t topicLength = read_u16(body);
+            size_t header = 2 + topicLength + (packet.qos > 0 ? 2 : 0);
+            if (header > remaining) {
+                return MqttDecode::Malformed;
+            }
+            if (packet.qos > 0) {
+                packet.packetId = read_u16(body + 2 + topicLength);
+            }
+            // Имя топика сдвигается на место второго байта длины и получает '\0'.
+            memmove(body + 1, body + 2, topicLength);
+            body[1 + topicLength] = '\0';
+            packet.topic = (const char*)(body + 1);
+            packet.topicLength = topicLength;
+            packet.payload = body + header;
+            packet.payloadLength = remaining - header;
+            break;
+        }
+
+        case MQTT_PUBACK:
+        case MQTT_PUBREC:
+        case MQTT_PUBREL:
+        case MQTT_PUBCOMP:
+        case MQTT_UNSUBACK:
+            if (remaining != 2) {
+                return MqttDecode::Malformed;
+            }
+            packet.packetId = read_u16(body);
+            break;
+
+        case MQTT_SUBACK:
+            if (remaining < 3) {
+                return MqttDecode::Malformed;
+            }
+            packet.packetId = read_u16(body);
+            packet.returnCode = body[2];
+            break;
+
+        case MQTT_PINGRESP:
+            if (remaining != 0) {
+                return MqttDecode::Malformed;
+            }
+            break;
+
+        default:
+            break;
+    }
+    return MqttDecode::Ok;
+}
+
+void MqttSkip::begin(const MqttPacket& packet) {
+    _size = packet.size;
+    _position = 0;
+    _header = packet.size - packet.bodyLength;
+    _qos = packet.type == MQTT_PUBLISH ? (packet.flags >> 1) & 0x03 : 0;
+    _topicLength = 0;
+    _packetId = 0;
+}
+
+void MqttSkip::feed(const uint8_t* data, size_t length) {
+    if (length > remaining()) {
+        length = remaining();
+    }
+    // Нужны только длина топика и packet id; остальное просто отсчитывается.
+    size_t idEnd = _header + 2 + _topicLength + 2;
+    for (size_t i = 0; i < length && _qos > 0 && _position + i < idEnd; i++) {
+        size_t at = _position + i;
+        if (at == _header) {
+            _topicLength = data[i] << 8;
+        } else if (at == _header + 1) {
+            _topicLength |= data[i];
+            idEnd = _header + 2 + _topicLength + 2;
+        } else if (at == idEnd - 2) {
+            _packetId = data[i] << 8;
+        } else if (at == idEnd - 1) {
+            _packetId |= data[i];
+        }
+    }
+    _position += length;
+}
+
+bool MqttSkip::ack(MqttPacketType& type, uint16_t& packetId) const {
+    if (_qos == 0 || _qos == 3 || _position < _size || _size < _header + 2 + _topicLength + 2) {
+        return false;
+    }
+    type = _qos == 1 ? MQTT_PUBACK : MQTT_PUBREC;
+    packetId = _packetId;
+    return true;
+}
@@ -0,0 +1,106 @@
+#ifndef MQTT_CODEC_HPP
+#define MQTT_CODEC_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MQTT 3.1.1 packet encoder/decoder. No allocation: encoders write into a
+// caller buffer and return the packet size (0 if it does not fit), the
+// decoder parses a packet in place and hands out pointers into the buffer.
+
+enum MqttPacketType : uint8_t {
+    MQTT_CONNECT = 1,
+    MQTT_CONNACK = 2,
+    MQTT_PUBLISH = 3,
+    MQTT_PUBACK = 4,
+    MQTT_PUBREC = 5,
+    MQTT_PUBREL = 6,
+    MQTT_PUBCOMP = 7,
+    MQTT_SUBSCRIBE = 8,
+    MQTT_SUBACK = 9,
+    MQTT_UNSUBSCRIBE = 10,
+    MQTT_UNSUBACK = 11,
+    MQTT_PINGREQ = 12,
+    MQTT_PINGRESP = 13,
+    MQTT_DISCONNECT = 14
+};
+
+// Флаг DUP в первом байте PUBLISH - выставляется при повторной отправке.
+const uint8_t MQTT_PUBLISH_DUP = 0x08;
+
+struct MqttConnectOptions {
+    const char* clientId = "";
+    const char* username = nullptr;
+    const char* password = nullptr;
+    uint16_t keepAliveS = 15;
+    bool cleanSession = true;
+};
+
+struct MqttPacket {
+    uint8_t type;
+    uint8_t flags;
+    size_t size;             // весь пакет, включая фиксированный заголовок
+    uint8_t* body;           // variable header + payload
+    size_t bodyLength;
+
+    // CONNACK
+    bool sessionPresent;
+    uint8_t returnCode;
+
+    // PUBLISH, PUBACK, SUBACK
+    uint16_t packetId;
+
+    // PUBLISH: topic завершён нулём прямо в буфере
+    const char* topic;
+    uint16_t topicLength;
+    const uint8_t* payload;
+    size_t payloadLength;
+    uint8_t qos;
+    bool retain;
+    bool dup;
+};
+
+enum class MqttDecode : uint8_t {
+    Ok,
+    Incomplete,
+    TooLarge,   // пакет корректен, но больше maxPacket; заполнены type, flags, size и bodyLength
+    Malformed
+};
+
+// Пакет больше буфера приёма пропускается по мере прихода байтов. PUBLISH с
+// QoS 1/2 всё равно требует ответа, иначе брокер держит его в полёте и шлёт
+// снова после каждого переподключения; packet id вычитывается из
+// пропускаемых байтов, где бы он ни оказался (топик может быть длиннее буфера).
+class MqttSkip {
+public:
+    // packet - результат mqtt_decode() с MqttDecode::TooLarge.
+    void begin(const MqttPacket& packet);
+    // Очередные байты пакета, начиная с первого байта фиксированного заголовка.
+    void feed(const uint8_t* data, size_t length);
+    size_t remaining() const { return _size - _position; }
+    // Пакет пропущен целиком и на него нужен PUBACK (QoS 1) или PUBREC (QoS 2).
+    bool ack(MqttPacketType& type, uint16_t& packetId) const;
+
+private:
+    size_t _size = 0;
+    size_t _position = 0;
+    size_t _header = 0;       // длина фиксированного заголовка
+    uint8_t _qos = 0;         // 0 - ответ не нужен
+    uint16_t _topicLength = 0;
+    uint16_t _packetId = 0;
+};
+
+size_t mqtt_encode_connect(uint8_t* buffer, size_t capacity, const MqttConnectOptions& options);
+size_t mqtt_encode_publish(uint8_t* buffer, size_t capacity, const char* topic,
+                           const uint8_t* payload, size_t length, uint8_t qos,
+                           bool retain, uint16_t packetId);
+size_t mqtt_encode_subscribe(uint8_t* buffer, size_t capacity, uint16_t packetId,
+                             const char* filter, uint8_t qos);
+size_t mqtt_encode_ack(uint8_t* buffer, size_t capacity, MqttPacketType type, uint16_t packetId);
+size_t mqtt_encode_empty(uint8_t* buffer, size_t capacity, MqttPacketType type);
+
+// Разбирает один пакет в начале buffer. Для PUBLISH сдвигает имя топика на байт
+// влево, чтобы завершить его нулём, поэтому буфер должен быть изменяемым.
+MqttDecode mqtt_decode(uint8_t* buffer, size_t length, size_t maxPacket, MqttPacket& packet);
+
+#endif
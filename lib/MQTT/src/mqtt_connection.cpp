@@ -0,0 +1,160 @@
+#include "mqtt_connection.hpp"
+
+const char* mqtt_state_name(MqttState state) {
+    switch (state) {
+        case MqttState::Idle:        return "idle";
+        case MqttState::Connecting:  return "connecting";
+        case MqttState::Subscribing: return "subscribing";
+        case MqttState::Online:      return "online";
+        case MqttState::Backoff:     return "backoff";
+    }
+    return "unknown";
+}
+
+Backoff::Backoff(uint32_t baseMs, uint32_t maxMs)
+    : _baseMs(baseMs), _maxMs(maxMs) {}
+
+uint32_t Backoff::next(uint32_t randomValue) {
+    uint32_t window = _maxMs;
+    if (_attempts < 31 && (_baseMs << _attempts) >> _attempts == _baseMs) {
+        window = _baseMs << _attempts;
+        if (window > _maxMs) {
+            window = _maxMs;
+        }
+    }
+    if (_attempts < 255) {
+        _attempts++;
+    }
+
+    uint32_t half = window / 2;
+    return half + randomValue % (window - half + 1);
+}
+
+void Backoff::reset() {
+    _attempts = 0;
+}
+
+MqttConnection::MqttConnection(MqttLink& link, MqttClock clock, MqttRandom random,
+                               const MqttConnectionConfig& config)
+    : _link(link), _clock(clock), _random(random), _config(config),
+      _backoff(config.backoffBaseMs, config.backoffMaxMs) {}
+
+void MqttConnection::start() {
+    _enabled = true;
+}
+
+void MqttConnection::stop() {
+    _enabled = false;
+    if (_state != MqttState::Idle) {
+        _link.closeSession();
+        enter(MqttState::Idle);
+    }
+}
+
+void MqttConnection::reconnect() {
+    if (!_enabled || _state == MqttState::Idle) {
+        return;
+    }
+    if (_state != MqttState::Backoff) {
+        _link.closeSession();
+    }
+    enter(MqttState::Connecting);
+}
+
+unsigned long MqttConnection::timeInState() const {
+    return _clock() - _enteredAt;
+}
+
+unsigned long MqttConnection::backoffRemaining() const {
+    if (_state != MqttState::Backoff) {
+        return 0;
+    }
+    unsigned long elapsed = timeInState();
+    return elapsed >= _backoffMs ? 0 : _backoffMs - elapsed;
+}
+
+void MqttConnection::tick() {
+    if (!_enabled) {
+        return;
+    }
+
+    if (!_link.networkReady()) {
+        if (_state != MqttState::Idle) {
+            if (_state != MqttState::Backoff) {
+                _link.closeSession();
+            }
+            enter(MqttState::Idle);
+        }
+        return;
+    }
+
+    switch (_state) {
+        case MqttState::Idle:
+            enter(MqttState::Connecting);
+            break;
+
+        case MqttState::Connecting:
+            switch (_link.openSession()) {
+                case LinkStatus::Ok:
+                    enter(MqttState::Subscribing);
+                    break;
+                case LinkStatus::Failed:
+                    fail();
+                    break;
+                case LinkStatus::Pending:
+                    if (timeInState() > _config.stepTimeoutMs) {
+                        fail();
+                    }
+                    break;
+            }
+            break;
+
+        case MqttState::Subscribing:
+            switch (_link.subscribe()) {
+                case LinkStatus::Ok:
+                    if (_wasOnline) {
+                        _reconnects++;
+                    }
+                    _wasOnline = true;
+                    _backoff.reset();
+                    enter(MqttState::Online);
+                    break;
+                case LinkStatus::Failed:
+                    fail();
+                    break;
+                case LinkStatus::Pending:
+                    if (timeInState() > _config.stepTimeoutMs) {
+                        fail();
+                    }
+                    break;
+            }
+            break;
+
+        case MqttState::Online:
+            if (_link.sessionAlive()) {
+                _link.service();
+            } else {
+                // Брокер пропал: не переподключаемся сразу, иначе весь парк
+                // устройств придёт к перезапущенному брокеру одновременно.
+                fail();
+            }
+            break;
+
+        case MqttState::Backoff:
+            if (timeInState() >= _backoffMs) {
+                enter(MqttState::Connecting);
+            }
+            break;
+    }
+}
+
+void MqttConnection::enter(MqttState state) {
+    _state = state;
+    _enteredAt = _clock();
+}
+
+void MqttConnection::fail() {
+    _link.closeSession();
+    _backoffMs = _backoff.next(_random());
+    enter(MqttState::Backoff);
+}
@@ -0,0 +1,98 @@
+#ifndef MQTT_CONNECTION_HPP
+#define MQTT_CONNECTION_HPP
+
+#include <stdint.h>
+
+// Состояния соединения с брокером:
+// Idle -> Connecting -> Subscribing -> Online, при ошибке -> Backoff -> Connecting
+enum class MqttState : uint8_t {
+    Idle,
+    Connecting,
+    Subscribing,
+    Online,
+    Backoff
+};
+
+const char* mqtt_state_name(MqttState state);
+
+// Exponential backoff with "equal jitter": the delay is drawn from
+// [window / 2, window], where the window doubles on every failure up to maxMs.
+// Devices that lost the broker at the same moment spread their retries out.
+class Backoff {
+public:
+    Backoff(uint32_t baseMs, uint32_t maxMs);
+    uint32_t next(uint32_t randomValue);
+    void reset();
+    uint8_t attempts() const { return _attempts; }
+
+private:
+    uint32_t _baseMs;
+    uint32_t _maxMs;
+    uint8_t _attempts = 0;
+};
+
+enum class LinkStatus : uint8_t {
+    Pending,
+    Ok,
+    Failed
+};
+
+// Операции, которые state machine вызывает у транспорта.
+// Ни одна из них не должна ждать: если ответ ещё не пришёл, вернуть Pending.
+class MqttLink {
+public:
+    virtual ~MqttLink() {}
+    virtual bool networkReady() = 0;
+    virtual LinkStatus openSession() = 0;
+    virtual LinkStatus subscribe() = 0;
+    virtual bool sessionAlive() = 0;
+    virtual void closeSession() = 0;
+    virtual void service() = 0;
+};
+
+typedef unsigned long (*MqttClock)();
+typedef uint32_t (*MqttRandom)();
+
+struct MqttConnectionConfig {
+    uint32_t backoffBaseMs = 1000;
+    uint32_t backoffMaxMs = 60000;
+    uint32_t stepTimeoutMs = 5000;  // лимит на Connecting и Subscribing
+};
+
+// Tick-driven connection state machine. tick() never blocks; clock and
+// random source are injected so the machine can be driven on the host.
+class MqttConnection {
+public:
+    MqttConnection(MqttLink& link, MqttClock clock, MqttRandom random,
+                   const MqttConnectionConfig& config = MqttConnectionConfig());
+
+    void start();
+    void stop();
+    void tick();
+    // Закрыть сессию и сразу подключиться заново, без паузы: смена брокера.
+    void reconnect();
+
+    MqttState state() const { return _state; }
+    unsigned long timeInState() const;
+    unsigned long backoffRemaining() const;
+    uint32_t reconnects() const { return _reconnects; }
+
+private:
+    void enter(MqttState state);
+    void fail();
+
+    MqttLink& _link;
+    MqttClock _clock;
+    MqttRandom _random;
+    MqttConnectionConfig _config;
+    Backoff _backoff;
+
+    MqttState _state = MqttState::Idle;
+    bool _enabled = false;
+    bool _wasOnline = false;
+    unsigned long _enteredAt = 0;
+    unsigned long _backoffMs = 0;
+    uint32_t _reconnects = 0;
+};
+
+#endif
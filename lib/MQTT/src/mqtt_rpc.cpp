@@ -0,0 +1,281 @@
+#include "mqtt_rpc.hpp"
+#include "../../../src/shared/metrics.hpp"
+#include "../../../src/shared/binlog.hpp"
+
+static MetricCounter rpc_calls("mqtt_rpc_calls_total", "rq", "RPC requests executed");
+static MetricCounter rpc_rejected("mqtt_rpc_rejected_total", "rr", "RPC requests answered busy or timeout");
+
+const char* rpc_status_name(RpcStatus status) {
+    switch (status) {
+        case RpcStatus::Ok:         return "ok";
+        case RpcStatus::Deferred:   return "deferred";
+        case RpcStatus::BadRequest: return "bad_request";
+        case RpcStatus::NotFound:   return "not_found";
+        case RpcStatus::Busy:       return "busy";
+        case RpcStatus::Timeout:    return "timeout";
+        case RpcStatus::Failed:     return "failed";
+    }
+    return "unknown";
+}
+
+struct RpcError {
+    char error[16];
+};
+
+static const JsonField rpc_error_fields[] = {
+    JSON_STRING(RpcError, error, "error"),
+};
+static const JsonSchema RPC_ERROR_SCHEMA = JSON_SCHEMA(rpc_error_fields);
+
+const JsonSchema RPC_EMPTY_SCHEMA = { nullptr, 0 };
+
+RpcServer::RpcServer(MQTT& mqtt, MqttClock clock) : _mqtt(mqtt), _clock(clock) {
+    memset(_slots, 0, sizeof(_slots));
+    memset(_done, 0, sizeof(_done));
+    _filter[0] = '\0';
+}
+
+bool RpcServer::begin(const char* base) {
+    int length = snprintf(_filter, sizeof(_filter), "%s/req/#", base);
+    if (length <= 0 || (size_t)length >= sizeof(_filter)) {
+        LOG_WARN("[RPC] Base topic too long: %s\n", base);
+        return false;
+    }
+    // <base>/res/<id>/cbor
+    size_t reserved = strlen(base) + strlen("/res/") + strlen(MQTT_CBOR_SUFFIX);
+    if (reserved + 1 >= MQTT_QUEUE_TOPIC_SIZE) {
+        LOG_WARN("[RPC] No room for responses under %s\n", base);
+        return false;
+    }
+    if (reserved + MQTT_RPC_ID_SIZE > MQTT_QUEUE_TOPIC_SIZE) {
+        LOG_WARN("[RPC] Ids under %s limited to %u chars\n", base,
+                 (unsigned)(MQTT_QUEUE_TOPIC_SIZE - 1 - reserved));
+    }
+    _base = base;
+    return _mqtt.on(_filter, onRequest, this);
+}
+
+bool RpcServer::add(const char* method, const JsonSchema& requestSchema, const JsonSchema& responseSchema,
+                    uint16_t requestSize, uint16_t responseSize, Invoker invoke, void (*handler)(),
+                    void* context) {
+    if (_methodCount >= MQTT_RPC_MAX_METHODS || strlen(method) >= MQTT_RPC_METHOD_SIZE ||
+        strpbrk(method, "/+#")) {
+        LOG_WARN("[RPC] Cannot register method %s\n", method);
+        return false;
+    }
+    Method& entry = _methods[_methodCount++];
+    entry.name = method;
+    entry.requestSchema = &requestSchema;
+    entry.responseSchema = &responseSchema;
+    entry.requestSize = requestSize;
+    entry.responseSize = responseSize;
+    entry.invoke = invoke;
+    entry.handler = handler;
+    entry.context = context;
+    return true;
+}
+
+uint8_t RpcServer::pending() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MQTT_RPC_MAX_PENDING; i++) {
+        count += _slots[i].state != SlotState::Free;
+    }
+    return count;
+}
+
+void RpcServer::onRequest(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    ((RpcServer*)context)->accept(topic, payload, length);
+}
+
+bool RpcServer::done(const char* id) const {
+    for (uint8_t i = 0; i < MQTT_RPC_DONE_HISTORY; i++) {
+        if (strcmp(_done[i], id) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Ответ отправлен: слот свободен, id запоминается от повторов доставки.
+void RpcServer::finish(Slot& slot) {
+    memcpy(_done[_doneNext], slot.id, sizeof(slot.id));
+    _doneNext = (_doneNext + 1) % MQTT_RPC_DONE_HISTORY;
+    slot.state = SlotState::Free;
+}
+
+// <base>/req/<method>/<id>[/<timeout ms>][/cbor]
+void RpcServer::accept(const char* topic, const uint8_t* payload, size_t length) {
+    // Фильтр "<base>/req/#" совпадает и с самим "<base>/req".
+    size_t prefix = strlen(_filter) - 1;
+    if (strlen(topic) <= prefix) {
+        return;
+    }
+    const char* cursor = topic + prefix;  // после "<base>/req/"
+    const char* slash = strchr(cursor, '/');
+    if (!slash || slash == cursor || (size_t)(slash - cursor) >= MQTT_RPC_METHOD_SIZE) {
+        return;  // без id ответить некуда
+    }
+    char method[MQTT_RPC_METHOD_SIZE];
+    memcpy(method, cursor, slash - cursor);
+    method[slash - cursor] = '\0';
+
+    cursor = slash + 1;
+    slash = strchr(cursor, '/');
+    size_t idLength = slash ? (size_t)(slash - cursor) : strlen(cursor);
+    if (idLength == 0 || idLength >= MQTT_RPC_ID_SIZE) {
+        return;
+    }
+    char id[MQTT_RPC_ID_SIZE];
+    memcpy(id, cursor, idLength);
+    id[idLength] = '\0';
+
+    PayloadFormat format = _mqtt.payloadFormat(topic);
+    size_t responseTopic = strlen(_base) + strlen("/res/") + idLength +
+                           (format == PayloadFormat::Cbor ? strlen(MQTT_CBOR_SUFFIX) : 0);
+    if (responseTopic >= MQTT_QUEUE_TOPIC_SIZE) {
+        LOG_WARN("[RPC] %s %s: response topic too long, request dropped\n", method, id);
+        return;
+    }
+    unsigned long timeout = MQTT_RPC_DEFAULT_TIMEOUT_MS;
+    if (slash && strcmp(slash, MQTT_CBOR_SUFFIX) != 0) {
+        char* end = nullptr;
+        timeout = strtoul(slash + 1, &end, 10);
+        if (end == slash + 1 || (*end != '\0' && strcmp(end, MQTT_CBOR_SUFFIX) != 0)) {
+            respond(id, format, 0xFF, RpcStatus::BadRequest, nullptr);
+            return;
+        }
+        if (timeout == 0 || timeout > MQTT_RPC_MAX_TIMEOUT_MS) {
+            timeout = MQTT_RPC_MAX_TIMEOUT_MS;
+        }
+    }
+
+    uint8_t index = 0;
+    while (index < _methodCount && strcmp(_methods[index].name, method) != 0) {
+        index++;
+    }
+    if (index == _methodCount) {
+        respond(id, format, 0xFF, RpcStatus::NotFound, nullptr);
+        return;
+    }
+    if (length > MQTT_QUEUE_PAYLOAD_SIZE) {
+        respond(id, format, index, RpcStatus::BadRequest, nullptr);
+        return;
+    }
+
+    if (done(id)) {
+        return;  // повтор доставки QoS 1 уже выполненного запроса
+    }
+    Slot* free = nullptr;
+    for (uint8_t i = 0; i < MQTT_RPC_MAX_PENDING; i++) {
+        Slot& slot = _slots[i];
+        if (slot.state == SlotState::Free) {
+            free = free ? free : &slot;
+        } else if (strcmp(slot.id, id) == 0) {
+            return;  // повтор доставки QoS 1
+        }
+    }
+    if (!free) {
+        rpc_rejected.add();
+        respond(id, format, index, RpcStatus::Busy, nullptr);
+        return;
+    }
+    free->state = SlotState::Queued;
+    free->method = index;
+    free->format = format;
+    memcpy(free->id, id, idLength + 1);
+    free->deadline = _clock() + timeout;
+    free->order = _order++;
+    free->length = length;
+    memcpy(free->payload, payload, length);
+}
+
+void RpcServer::loop() {
+    unsigned long now = _clock();
+    for (uint8_t i = 0; i < MQTT_RPC_MAX_PENDING; i++) {
+        Slot& slot = _slots[i];
+        if (slot.state != SlotState::Free && (long)(now - slot.deadline) >= 0) {
+            rpc_rejected.add();
+            respond(slot.id, slot.format, slot.method, RpcStatus::Timeout, nullptr);
+            finish(slot);
+        }
+    }
+
+    for (uint8_t budget = 0; budget < MQTT_RPC_BUDGET; budget++) {
+        Slot* oldest = nullptr;
+        for (uint8_t i = 0; i < MQTT_RPC_MAX_PENDING; i++) {
+            Slot& slot = _slots[i];
+            if (slot.state == SlotState::Queued && (!oldest || (int32_t)(slot.order - oldest->order) < 0)) {
+                oldest = &slot;
+            }
+        }
+        if (!oldest) {
+            return;
+        }
+        run(*oldest);
+    }
+}
+
+void RpcServer::run(Slot& slot) {
+    const Method& method = _methods[slot.method];
+    ArenaScope scope(_mqtt.arena());
+    void* request = _mqtt.arena().allocate(method.requestSize);
+    void* response = _mqtt.arena().allocate(method.responseSize);
+    if (!request || !response) {
+        respond(slot.id, slot.format, slot.method, RpcStatus::Failed, nullptr);
+        finish(slot);
+        return;
+    }
+    // Поля, которых нет в запросе, остаются нулевыми.
+    memset(request, 0, method.requestSize);
+    memset(response, 0, method.responseSize);
+
+    JsonError error = JsonError::Ok;
+    if (slot.length > 0 || method.requestSchema->count > 0) {
+        error = payload_decode(slot.format, *method.requestSchema, slot.payload, slot.length, request);
+    }
+    if (error != JsonError::Ok) {
+        LOG_WARN("[RPC] %s %s: %s\n", method.name, slot.id, json_error_name(error));
+        respond(slot.id, slot.format, slot.method, RpcStatus::BadRequest, nullptr);
+        finish(slot);
+        return;
+    }
+
+    rpc_calls.add();
+    RpcCall call = { (uint8_t)(&slot - _slots), slot.id, slot.deadline };
+    RpcStatus status = method.invoke(method, request, response, call);
+    if (status == RpcStatus::Deferred) {
+        slot.state = SlotState::Running;
+        return;
+    }
+    respond(slot.id, slot.format, slot.method, status, status == RpcStatus::Ok ? response : nullptr);
+    finish(slot);
+}
+
+bool RpcServer::complete(uint8_t index, RpcStatus status, const void* response) {
+    if (index >= MQTT_RPC_MAX_PENDING || _slots[index].state != SlotState::Running) {
+        return false;
+    }
+    Slot& slot = _slots[index];
+    respond(slot.id, slot.format, slot.method, status, status == RpcStatus::Ok ? response : nullptr);
+    finish(slot);
+    return true;
+}
+
+// Ответ в том же формате, что и запрос: на CBOR-запрос - в <base>/res/<id>/cbor.
+void RpcServer::respond(const char* id, PayloadFormat format, uint8_t method, RpcStatus status,
+                        const void* response) {
+    char topic[MQTT_QUEUE_TOPIC_SIZE];
+    int length = snprintf(topic, sizeof(topic), "%s/res/%s%s", _base, id,
+                          format == PayloadFormat::Cbor ? MQTT_CBOR_SUFFIX : "");
+    if (length <= 0 || (size_t)length >= sizeof(topic)) {
+        LOG_WARN("[RPC] Response topic too long for %s\n", id);
+        return;
+    }
+    if (response && method < _methodCount) {
+        _mqtt.publish(topic, *_methods[method].responseSchema, response, 1);
+        return;
+    }
+    RpcError error;
+    snprintf(error.error, sizeof(error.error), "%s", rpc_status_name(status));
+    _mqtt.publish(topic, RPC_ERROR_SCHEMA, &error, 1);
+}
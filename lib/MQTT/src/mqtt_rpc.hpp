@@ -0,0 +1,168 @@
+#ifndef MQTT_RPC_HPP
+#define MQTT_RPC_HPP
+
+#include <stdint.h>
+#include "mqtt.hpp"
+
+// Вызовы одновременно в работе; лишние сразу получают "busy".
+#ifndef MQTT_RPC_MAX_PENDING
+#define MQTT_RPC_MAX_PENDING 4
+#endif
+
+#ifndef MQTT_RPC_MAX_METHODS
+#define MQTT_RPC_MAX_METHODS 8
+#endif
+
+// Сколько вызовов выполняется за один loop(): остальное время сетевой
+// задачи остаётся телеметрии.
+#ifndef MQTT_RPC_BUDGET
+#define MQTT_RPC_BUDGET 1
+#endif
+
+// Срок вызова, если запрос его не задал.
+#ifndef MQTT_RPC_DEFAULT_TIMEOUT_MS
+#define MQTT_RPC_DEFAULT_TIMEOUT_MS 5000
+#endif
+
+// Предел срока из запроса: 0 (без срока) и сроки длиннее заменяются им -
+// сравнение сроков по millis() верно только в пределах полуоборота счётчика.
+#ifndef MQTT_RPC_MAX_TIMEOUT_MS
+#define MQTT_RPC_MAX_TIMEOUT_MS 600000
+#endif
+
+// Сколько id завершённых вызовов помнить: повтор доставки QoS 1 уже
+// выполненного запроса не выполняется второй раз.
+#ifndef MQTT_RPC_DONE_HISTORY
+#define MQTT_RPC_DONE_HISTORY 8
+#endif
+
+#define MQTT_RPC_ID_SIZE 17
+#define MQTT_RPC_METHOD_SIZE 24
+
+enum class RpcStatus : uint8_t {
+    Ok,
+    Deferred,    // ответ придёт позже через complete()
+    BadRequest,  // запрос не разобрался по схеме
+    NotFound,    // нет такого метода
+    Busy,        // все MQTT_RPC_MAX_PENDING слотов заняты
+    Timeout,     // срок вышел до выполнения или до complete()
+    Failed       // обработчик не смог выполнить
+};
+
+const char* rpc_status_name(RpcStatus status);
+
+// Для методов без параметров или без результата; тело запроса можно не слать.
+struct RpcEmpty {};
+extern const JsonSchema RPC_EMPTY_SCHEMA;
+
+// Вызов в работе; slot передаётся в complete() для отложенного ответа.
+struct RpcCall {
+    uint8_t slot;
+    const char* id;
+    unsigned long deadline;
+};
+
+// Вызовы методов устройства поверх MQTT 3.1.1 (без свойств v5, поэтому
+// метод, id и срок - в топике):
+//   запрос  <base>/req/<method>/<id>[/<timeout ms>]   тело - Request по схеме
+//   ответ   <base>/res/<id>                           тело - Response по схеме
+//                                                    или {"error":"<status>"}
+// Суффикс MQTT_CBOR_SUFFIX у запроса - тело и ответ в CBOR.
+// Запросы с разными id можно слать не дожидаясь ответов. Принятый запрос
+// копируется в слот и выполняется в loop() не больше MQTT_RPC_BUDGET за раз;
+// запрос, чей срок истёк в очереди, не выполняется и получает "timeout".
+// Повтор запроса с тем же id (QoS 1 после переподключения), пока он в работе
+// или среди MQTT_RPC_DONE_HISTORY последних завершённых, отбрасывается.
+// Запрос, ответ на который не влезет в MQTT_QUEUE_TOPIC_SIZE (длинное имя
+// устройства и id), отбрасывается с предупреждением в логе.
+// Иначе формат тела - по правилам MQTT::setPayloadFormat.
+class RpcServer {
+public:
+    template <typename Request, typename Response>
+    using Handler = RpcStatus (*)(const Request& request, Response& response, const RpcCall& call, void* context);
+
+    RpcServer(MQTT& mqtt, MqttClock clock);
+
+    // base - например "esp32/<имя устройства>"; строка должна жить всё время работы.
+    // false - под ответ не остаётся места даже для id в один символ.
+    bool begin(const char* base);
+
+    // Request и Response - простые структуры, разбираемые по схемам. Память под
+    // них берётся в арене MQTT на время вызова. При RpcStatus::Deferred Response
+    // не отправляется: ответ уходит позже через complete().
+    template <typename Request, typename Response>
+    bool on(const char* method, const JsonSchema& requestSchema, const JsonSchema& responseSchema,
+            Handler<Request, Response> handler, void* context = nullptr) {
+        return add(method, requestSchema, responseSchema, sizeof(Request), sizeof(Response),
+                   invoke<Request, Response>, (void (*)())handler, context);
+    }
+
+    // Ответ на отложенный вызов; response - по схеме метода, nullptr при ошибке.
+    // false - вызова уже нет (истёк срок).
+    bool complete(uint8_t slot, RpcStatus status, const void* response = nullptr);
+
+    // Выполняет очередь и отвечает "timeout" на просроченные вызовы.
+    void loop();
+
+    uint8_t pending() const;
+
+private:
+    struct Method;
+    typedef RpcStatus (*Invoker)(const Method& method, const void* request, void* response, const RpcCall& call);
+
+    struct Method {
+        const char* name;
+        const JsonSchema* requestSchema;
+        const JsonSchema* responseSchema;
+        uint16_t requestSize;
+        uint16_t responseSize;
+        Invoker invoke;
+        void (*handler)();
+        void* context;
+    };
+
+    enum class SlotState : uint8_t {
+        Free,
+        Queued,
+        Running   // Deferred: ждёт complete()
+    };
+
+    struct Slot {
+        SlotState state;
+        uint8_t method;
+        PayloadFormat format;
+        char id[MQTT_RPC_ID_SIZE];
+        unsigned long deadline;
+        uint32_t order;  // очередь выполняется в порядке прихода
+        uint16_t length;
+        uint8_t payload[MQTT_QUEUE_PAYLOAD_SIZE];
+    };
+
+    template <typename Request, typename Response>
+    static RpcStatus invoke(const Method& method, const void* request, void* response, const RpcCall& call) {
+        Handler<Request, Response> handler = (Handler<Request, Response>)method.handler;
+        return handler(*(const Request*)request, *(Response*)response, call, method.context);
+    }
+
+    bool add(const char* method, const JsonSchema& requestSchema, const JsonSchema& responseSchema,
+             uint16_t requestSize, uint16_t responseSize, Invoker invoke, void (*handler)(), void* context);
+    static void onRequest(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+    void accept(const char* topic, const uint8_t* payload, size_t length);
+    void run(Slot& slot);
+    void finish(Slot& slot);
+    bool done(const char* id) const;
+    void respond(const char* id, PayloadFormat format, uint8_t method, RpcStatus status, const void* response);
+
+    MQTT& _mqtt;
+    MqttClock _clock;
+    const char* _base = nullptr;
+    char _filter[MQTT_QUEUE_TOPIC_SIZE];
+    Method _methods[MQTT_RPC_MAX_METHODS];
+    uint8_t _methodCount = 0;
+    Slot _slots[MQTT_RPC_MAX_PENDING];
+    uint32_t _order = 0;
+    char _done[MQTT_RPC_DONE_HISTORY][MQTT_RPC_ID_SIZE];  // кольцо id завершённых
+    uint8_t _doneNext = 0;
+};
+
+#endif
@@ -0,0 +1,242 @@
+// TLS на плате через mbedTLS из ESP-IDF.
+#ifdef ESP_PLATFORM
+
+#include "mqtt_transport.hpp"
+#include <lwip/sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <string.h>
+
+struct TlsConfigState {
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context random;
+    mbedtls_x509_crt ca;
+    mbedtls_x509_crt certificate;
+    mbedtls_pk_context key;
+    mbedtls_ssl_config config;
+};
+
+struct TlsSessionState {
+    mbedtls_ssl_context ssl;
+    mbedtls_net_context net;
+    mbedtls_ssl_session session;  // последняя сессия брокера
+    bool haveSession;
+    unsigned char sentId[32];     // session ID из нашего ClientHello
+    size_t sentIdLength;
+};
+
+static void release_config(TlsConfigState* state) {
+    mbedtls_ssl_config_free(&state->config);
+    mbedtls_pk_free(&state->key);
+    mbedtls_x509_crt_free(&state->certificate);
+    mbedtls_x509_crt_free(&state->ca);
+    mbedtls_ctr_drbg_free(&state->random);
+    mbedtls_entropy_free(&state->entropy);
+    delete state;
+}
+
+static bool wait_socket(int fd, bool write, uint32_t timeoutMs) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval timeout = { (time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000) };
+    return select(fd + 1, write ? nullptr : &set, write ? &set : nullptr, nullptr, &timeout) > 0;
+}
+
+TlsConfig::~TlsConfig() {
+    if (_state) {
+        release_config(_state);
+    }
+}
+
+bool TlsConfig::begin(const TlsCredentials& credentials) {
+    if (_state || !credentials.caCert) {
+        return false;
+    }
+    TlsConfigState* state = new TlsConfigState;
+    mbedtls_entropy_init(&state->entropy);
+    mbedtls_ctr_drbg_init(&state->random);
+    mbedtls_x509_crt_init(&state->ca);
+    mbedtls_x509_crt_init(&state->certificate);
+    mbedtls_pk_init(&state->key);
+    mbedtls_ssl_config_init(&state->config);
+
+    static const unsigned char personalization[] = "mqtt";
+    // _nocopy: сертификаты остаются во flash, в RAM - только разобранные поля.
+    int result = mbedtls_ctr_drbg_seed(&state->random, mbedtls_entropy_func, &state->entropy,
+                                       personalization, sizeof(personalization) - 1);
+    if (result == 0) {
+        result = mbedtls_x509_crt_parse_der_nocopy(&state->ca, credentials.caCert, credentials.caCertLength);
+    }
+    if (result == 0 && credentials.clientCert) {
+        result = mbedtls_x509_crt_parse_der_nocopy(&state->certificate, credentials.clientCert,
+                                                   credentials.clientCertLength);
+        if (result == 0) {
+            result = credentials.clientKey
+                         ? mbedtls_pk_parse_key(&state->key, credentials.clientKey, credentials.clientKeyLength,
+                                                nullptr, 0)
+                         : MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+        }
+    }
+    if (result == 0) {
+        result = mbedtls_ssl_config_defaults(&state->config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                             MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (result == 0) {
+        mbedtls_ssl_conf_authmode(&state->config, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&state->config, &state->ca, nullptr);
+        mbedtls_ssl_conf_rng(&state->config, mbedtls_ctr_drbg_random, &state->random);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets(&state->config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+        if (credentials.clientCert) {
+            result = mbedtls_ssl_conf_own_cert(&state->config, &state->certificate, &state->key);
+        }
+    }
+    if (result != 0) {
+        release_config(state);
+        return false;
+    }
+
+    _state = state;
+    _serverName = credentials.serverName;
+    return true;
+}
+
+// mbedtls_ssl_setup() выделяет буферы записей (MBEDTLS_SSL_IN/OUT_CONTENT_LEN)
+// один раз; переподключение - mbedtls_ssl_session_reset() на них же.
+bool MqttTransport::tlsSetup() {
+    TlsSessionState* state = new TlsSessionState;
+    mbedtls_ssl_init(&state->ssl);
+    mbedtls_net_init(&state->net);
+    mbedtls_ssl_session_init(&state->session);
+    state->haveSession = false;
+    state->sentIdLength = 0;
+    if (mbedtls_ssl_setup(&state->ssl, &_config->_state->config) != 0) {
+        mbedtls_ssl_free(&state->ssl);
+        delete state;
+        return false;
+    }
+    mbedtls_ssl_set_bio(&state->ssl, &state->net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+    _tls = state;
+    return true;
+}
+
+void MqttTransport::tlsRelease() {
+    mbedtls_ssl_session_free(&_tls->session);
+    mbedtls_ssl_free(&_tls->ssl);
+    delete _tls;
+    _tls = nullptr;
+}
+
+void MqttTransport::tlsForget() {
+    mbedtls_ssl_session_free(&_tls->session);
+    mbedtls_ssl_session_init(&_tls->session);
+    _tls->haveSession = false;
+}
+
+bool MqttTransport::tlsStart(const char* serverName) {
+    if (mbedtls_ssl_session_reset(&_tls->ssl) != 0) {
+        return false;
+    }
+    // Сокет - от WiFiClient; закрывает его тоже WiFiClient.
+    _tls->net.fd = _tcp.fd();
+    if (mbedtls_net_set_nonblock(&_tls->net) != 0 || mbedtls_ssl_set_hostname(&_tls->ssl, serverName) != 0) {
+        return false;
+    }
+    if (_tls->haveSession && mbedtls_ssl_set_session(&_tls->ssl, &_tls->session) != 0) {
+        tlsForget();
+    }
+    _tls->sentIdLength = 0;
+    return true;
+}
+
+// Рукопожатие по шагам: после ClientHello запоминается отправленный session ID.
+// С ticket это не ID сохранённой сессии, а случайный, сгенерированный для
+// ClientHello; брокер, принявший сессию, повторяет именно его.
+LinkStatus MqttTransport::tlsStep(bool& resumed) {
+    mbedtls_ssl_context& ssl = _tls->ssl;
+    while (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        bool clientHello = ssl.state == MBEDTLS_SSL_CLIENT_HELLO;
+        int result = mbedtls_ssl_handshake_step(&ssl);
+        // ClientHello собран (и ID выбран), даже если отправка ещё ждёт сокета.
+        if (clientHello && ssl.state != MBEDTLS_SSL_CLIENT_HELLO && ssl.session_negotiate) {
+            _tls->sentIdLength = ssl.session_negotiate->id_len;
+            memcpy(_tls->sentId, ssl.session_negotiate->id, _tls->sentIdLength);
+        }
+        if (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return LinkStatus::Pending;
+        }
+        if (result != 0) {
+            _stats.lastError = result;
+            return LinkStatus::Failed;
+        }
+    }
+
+    const mbedtls_ssl_session* current = ssl.session;
+    resumed = _tls->haveSession && current && _tls->sentIdLength > 0 && current->id_len == _tls->sentIdLength &&
+              memcmp(current->id, _tls->sentId, _tls->sentIdLength) == 0;
+    // Брокер мог выдать новый ticket и при возобновлении.
+    tlsForget();
+    _tls->haveSession = mbedtls_ssl_get_session(&_tls->ssl, &_tls->session) == 0;
+    return LinkStatus::Ok;
+}
+
+int MqttTransport::tlsWrite(const uint8_t* data, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        int result = mbedtls_ssl_write(&_tls->ssl, data + sent, length - sent);
+        if (result > 0) {
+            sent += result;
+        } else if (result == MBEDTLS_ERR_SSL_WANT_WRITE || result == MBEDTLS_ERR_SSL_WANT_READ) {
+            if (!wait_socket(_tls->net.fd, result == MBEDTLS_ERR_SSL_WANT_WRITE, 1000)) {
+                break;
+            }
+        } else {
+            _stats.lastError = result;
+            return -1;
+        }
+    }
+    return (int)sent;
+}
+
+int MqttTransport::tlsAvailable() {
+    size_t pending = mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+    if (pending > 0) {
+        return (int)pending;
+    }
+    // Чтение нуля байт разбирает пришедшую запись, не забирая данные.
+    int result = mbedtls_ssl_read(&_tls->ssl, nullptr, 0);
+    if (result < 0 && result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        _stats.lastError = result;
+        return -1;
+    }
+    return (int)mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+}
+
+int MqttTransport::tlsRead(uint8_t* buffer, size_t size) {
+    int result = mbedtls_ssl_read(&_tls->ssl, buffer, size);
+    if (result > 0) {
+        return result;
+    }
+    if (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return -1;
+    }
+    if (result != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+        _stats.lastError = result;
+    }
+    return 0;
+}
+
+void MqttTransport::tlsClose(bool notify) {
+    if (notify) {
+        mbedtls_ssl_close_notify(&_tls->ssl);
+    }
+    _tls->net.fd = -1;
+}
+
+#endif
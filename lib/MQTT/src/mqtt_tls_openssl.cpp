@@ -0,0 +1,215 @@
+// TLS на хосте (env:native, env:fleet) через OpenSSL: те же сертификаты DER,
+// та же схема переиспользования контекста и сессии, что на плате.
+#ifndef ESP_PLATFORM
+
+#include "mqtt_transport.hpp"
+#include <arpa/inet.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <poll.h>
+#include <signal.h>
+
+struct TlsConfigState {
+    SSL_CTX* context;
+};
+
+struct TlsSessionState {
+    SSL* ssl;
+    SSL_SESSION* session;  // последняя сессия брокера, nullptr - нет
+};
+
+// TLS 1.3 присылает ticket уже после рукопожатия, поэтому сессия берётся
+// из колбэка, а не сразу после SSL_connect.
+static int on_new_session(SSL* ssl, SSL_SESSION* session) {
+    TlsSessionState* state = (TlsSessionState*)SSL_get_app_data(ssl);
+    if (!state) {
+        return 0;
+    }
+    if (state->session) {
+        SSL_SESSION_free(state->session);
+    }
+    state->session = session;
+    return 1;  // ссылка теперь наша
+}
+
+static bool is_ip_address(const char* host) {
+    in_addr address;
+    return inet_pton(AF_INET, host, &address) == 1;
+}
+
+TlsConfig::~TlsConfig() {
+    if (_state) {
+        SSL_CTX_free(_state->context);
+        delete _state;
+    }
+}
+
+bool TlsConfig::begin(const TlsCredentials& credentials) {
+    if (_state || !credentials.caCert) {
+        return false;
+    }
+    // OpenSSL пишет в сокет через write(): без MSG_NOSIGNAL, как в WiFiClient,
+    // запись в оборванное соединение завершила бы процесс.
+    signal(SIGPIPE, SIG_IGN);
+
+    SSL_CTX* context = SSL_CTX_new(TLS_client_method());
+    if (!context) {
+        return false;
+    }
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, on_new_session);
+
+    const unsigned char* cursor = credentials.caCert;
+    X509* ca = d2i_X509(nullptr, &cursor, credentials.caCertLength);
+    bool ok = ca && X509_STORE_add_cert(SSL_CTX_get_cert_store(context), ca) == 1;
+    X509_free(ca);
+
+    if (ok && credentials.clientCert) {
+        cursor = credentials.clientCert;
+        X509* certificate = d2i_X509(nullptr, &cursor, credentials.clientCertLength);
+        cursor = credentials.clientKey;
+        EVP_PKEY* key = credentials.clientKey ? d2i_AutoPrivateKey(nullptr, &cursor, credentials.clientKeyLength)
+                                              : nullptr;
+        ok = certificate && key && SSL_CTX_use_certificate(context, certificate) == 1 &&
+             SSL_CTX_use_PrivateKey(context, key) == 1 && SSL_CTX_check_private_key(context) == 1;
+        X509_free(certificate);
+        EVP_PKEY_free(key);
+    }
+    if (!ok) {
+        SSL_CTX_free(context);
+        ERR_clear_error();
+        return false;
+    }
+
+    _state = new TlsConfigState{ context };
+    _serverName = credentials.serverName;
+    return true;
+}
+
+bool MqttTransport::tlsSetup() {
+    SSL* ssl = SSL_new(_config->_state->context);
+    if (!ssl) {
+        return false;
+    }
+    _tls = new TlsSessionState{ ssl, nullptr };
+    SSL_set_app_data(ssl, _tls);
+    return true;
+}
+
+void MqttTransport::tlsRelease() {
+    tlsForget();
+    SSL_free(_tls->ssl);
+    delete _tls;
+    _tls = nullptr;
+}
+
+void MqttTransport::tlsForget() {
+    if (_tls->session) {
+        SSL_SESSION_free(_tls->session);
+        _tls->session = nullptr;
+    }
+}
+
+bool MqttTransport::tlsStart(const char* serverName) {
+    SSL* ssl = _tls->ssl;
+    // SSL_clear оставляет буферы записей: новое соединение без выделений.
+    if (!SSL_clear(ssl) || !SSL_set_fd(ssl, _tcp.fd())) {
+        return false;
+    }
+    X509_VERIFY_PARAM* param = SSL_get0_param(ssl);
+    if (is_ip_address(serverName)) {
+        X509_VERIFY_PARAM_set1_host(param, nullptr, 0);
+        X509_VERIFY_PARAM_set1_ip_asc(param, serverName);
+    } else {
+        SSL_set_tlsext_host_name(ssl, serverName);
+        X509_VERIFY_PARAM_set1_host(param, serverName, 0);
+    }
+    if (_tls->session) {
+        SSL_set_session(ssl, _tls->session);
+    }
+    SSL_set_connect_state(ssl);
+    return true;
+}
+
+LinkStatus MqttTransport::tlsStep(bool& resumed) {
+    int result = SSL_do_handshake(_tls->ssl);
+    if (result == 1) {
+        resumed = SSL_session_reused(_tls->ssl);
+        return LinkStatus::Ok;
+    }
+    int error = SSL_get_error(_tls->ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        return LinkStatus::Pending;
+    }
+    _stats.lastError = (int)ERR_get_error();
+    ERR_clear_error();
+    return LinkStatus::Failed;
+}
+
+int MqttTransport::tlsWrite(const uint8_t* data, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        int result = SSL_write(_tls->ssl, data + sent, (int)(length - sent));
+        if (result > 0) {
+            sent += result;
+            continue;
+        }
+        int error = SSL_get_error(_tls->ssl, result);
+        if (error != SSL_ERROR_WANT_WRITE && error != SSL_ERROR_WANT_READ) {
+            ERR_clear_error();
+            return -1;
+        }
+        struct pollfd waiter = { _tcp.fd(), (short)(error == SSL_ERROR_WANT_WRITE ? POLLOUT : POLLIN), 0 };
+        if (poll(&waiter, 1, 1000) <= 0) {
+            break;
+        }
+    }
+    return (int)sent;
+}
+
+int MqttTransport::tlsAvailable() {
+    int pending = SSL_pending(_tls->ssl);
+    if (pending > 0) {
+        return pending;
+    }
+    // Разбирает пришедшие записи (и служебные: ticket, close_notify).
+    uint8_t probe;
+    int result = SSL_peek(_tls->ssl, &probe, 1);
+    if (result > 0) {
+        return SSL_pending(_tls->ssl);
+    }
+    int error = SSL_get_error(_tls->ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        return 0;
+    }
+    ERR_clear_error();
+    return -1;
+}
+
+int MqttTransport::tlsRead(uint8_t* buffer, size_t size) {
+    int result = SSL_read(_tls->ssl, buffer, (int)size);
+    if (result > 0) {
+        return result;
+    }
+    int error = SSL_get_error(_tls->ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        return -1;
+    }
+    ERR_clear_error();
+    return 0;
+}
+
+void MqttTransport::tlsClose(bool notify) {
+    if (notify) {
+        SSL_shutdown(_tls->ssl);
+    }
+    // Обрыв TCP - не повод выбрасывать сессию: помечаем соединение закрытым
+    // штатно, иначе SSL_clear() сделает сессию невозобновляемой.
+    SSL_set_shutdown(_tls->ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    ERR_clear_error();
+}
+
+#endif
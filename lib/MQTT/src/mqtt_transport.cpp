@@ -0,0 +1,159 @@
+#include "mqtt_transport.hpp"
+
+MqttTransport::~MqttTransport() {
+    stop();
+    if (_tls) {
+        tlsRelease();
+    }
+}
+
+bool MqttTransport::setTls(TlsConfig* config) {
+    stop();
+    if (_tls) {
+        tlsRelease();
+    }
+    _config = nullptr;
+    _sessionHost[0] = '\0';
+    _sessionPort = 0;
+    if (!config) {
+        return true;
+    }
+    if (!config->ready()) {
+        return false;
+    }
+    _config = config;
+    if (!tlsSetup()) {
+        _config = nullptr;
+        return false;
+    }
+    return true;
+}
+
+int MqttTransport::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    if (!_tcp.connect(host, port, timeoutMs)) {
+        return 0;
+    }
+    if (!_tls) {
+        return 1;
+    }
+
+    // Сессия годится только для того же брокера.
+    if (_sessionPort != port || strcmp(_sessionHost, host) != 0) {
+        tlsForget();
+        snprintf(_sessionHost, sizeof(_sessionHost), "%s", host);
+        _sessionPort = port;
+    }
+    if (!tlsStart(_config->_serverName ? _config->_serverName : host)) {
+        _stats.failures++;
+        _tcp.stop();
+        return 0;
+    }
+    _open = true;
+    _handshaking = true;
+    _startedAt = millis();
+    _cpuUs = 0;
+    return 1;
+}
+
+LinkStatus MqttTransport::handshake() {
+    if (!_tls) {
+        return LinkStatus::Ok;
+    }
+    if (!_handshaking) {
+        return _closed ? LinkStatus::Failed : LinkStatus::Ok;
+    }
+
+    unsigned long started = micros();
+    bool resumed = false;
+    LinkStatus status = tlsStep(resumed);
+    _cpuUs += micros() - started;
+    if (status == LinkStatus::Pending) {
+        return status;
+    }
+
+    _handshaking = false;
+    if (status == LinkStatus::Failed) {
+        // Возможно, брокер не принимает сохранённую сессию: следующая попытка - полная.
+        _stats.failures++;
+        tlsForget();
+        _closed = true;
+        return status;
+    }
+    _stats.handshakes++;
+    _stats.lastMs = millis() - _startedAt;
+    _stats.lastCpuUs = _cpuUs;
+    _stats.lastResumed = resumed;
+    if (resumed) {
+        _stats.resumed++;
+        _stats.resumedCpuUs += _cpuUs;
+    } else {
+        _stats.fullCpuUs += _cpuUs;
+    }
+    return status;
+}
+
+size_t MqttTransport::write(const uint8_t* data, size_t length) {
+    if (!_tls) {
+        return _tcp.write(data, length);
+    }
+    if (_handshaking || _closed) {
+        return 0;
+    }
+    int written = tlsWrite(data, length);
+    if (written < 0) {
+        _closed = true;
+        return 0;
+    }
+    return written;
+}
+
+int MqttTransport::available() {
+    if (!_tls) {
+        return _tcp.available();
+    }
+    if (_handshaking || _closed) {
+        return 0;
+    }
+    int count = tlsAvailable();
+    if (count < 0) {
+        _closed = true;
+        return 0;
+    }
+    return count;
+}
+
+int MqttTransport::read(uint8_t* buffer, size_t size) {
+    if (!_tls) {
+        return _tcp.read(buffer, size);
+    }
+    if (_handshaking || _closed) {
+        return -1;
+    }
+    int count = tlsRead(buffer, size);
+    if (count == 0) {
+        _closed = true;
+        return -1;
+    }
+    return count;
+}
+
+uint8_t MqttTransport::connected() {
+    return !_closed && _tcp.connected();
+}
+
+void MqttTransport::stop() {
+    if (_open) {
+        tlsClose(!_handshaking && !_closed && _tcp.connected());
+        _open = false;
+    }
+    _tcp.stop();
+    _handshaking = false;
+    _closed = false;
+}
+
+void MqttTransport::forgetSession() {
+    if (_tls) {
+        tlsForget();
+    }
+}
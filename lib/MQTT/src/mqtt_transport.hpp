@@ -0,0 +1,121 @@
+#ifndef MQTT_TRANSPORT_HPP
+#define MQTT_TRANSPORT_HPP
+
+#include <WiFi.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mqtt_connection.hpp"
+
+// Сертификаты в DER: массивы const uint8_t лежат во flash, разбираются один
+// раз в TlsConfig::begin() и дальше не копируются и не разбираются заново.
+//   openssl x509 -in ca.crt -outform der | xxd -i
+//   openssl pkey -in client.key -outform der | xxd -i
+struct TlsCredentials {
+    const uint8_t* caCert = nullptr;      // обязателен: брокер проверяется всегда
+    size_t caCertLength = 0;
+    const uint8_t* clientCert = nullptr;  // с ключом - взаимная аутентификация
+    size_t clientCertLength = 0;
+    const uint8_t* clientKey = nullptr;
+    size_t clientKeyLength = 0;
+    // Имя в сертификате брокера, если подключаемся не по нему (по IP).
+    const char* serverName = nullptr;
+};
+
+struct TlsStats {
+    uint32_t handshakes;    // удачные рукопожатия
+    uint32_t resumed;       // из них по сохранённой сессии
+    uint32_t failures;
+    uint32_t lastMs;        // последнее: от TCP connect до готовности, с ожиданием брокера
+    uint32_t lastCpuUs;     // последнее: только вычисления на нашей стороне
+    bool lastResumed;
+    uint64_t fullCpuUs;     // суммы для средних по видам рукопожатий
+    uint64_t resumedCpuUs;
+    int lastError;          // код ошибки библиотеки TLS
+};
+
+struct TlsConfigState;
+struct TlsSessionState;
+
+// Разобранные сертификаты и настройки TLS, общие для всех соединений.
+class TlsConfig {
+public:
+    TlsConfig() {}
+    ~TlsConfig();
+    TlsConfig(const TlsConfig&) = delete;
+    TlsConfig& operator=(const TlsConfig&) = delete;
+
+    // Массивы credentials должны жить, пока жив TlsConfig (во flash - всегда).
+    bool begin(const TlsCredentials& credentials);
+    bool ready() const { return _state != nullptr; }
+
+private:
+    friend class MqttTransport;
+
+    TlsConfigState* _state = nullptr;
+    const char* _serverName = nullptr;
+};
+
+// Соединение MQTT с брокером: TCP или, после setTls(), TLS поверх него.
+//
+// Контекст TLS с буферами записей выделяется один раз в setTls() и
+// переиспользуется при каждом переподключении. Сессия последнего рукопожатия
+// (session ID или ticket) сохраняется, и следующее подключение к тому же
+// брокеру её возобновляет: без обмена ключами и проверки цепочки
+// сертификатов. Другой брокер - полное рукопожатие.
+class MqttTransport {
+public:
+    MqttTransport() {}
+    ~MqttTransport();
+    MqttTransport(const MqttTransport&) = delete;
+    MqttTransport& operator=(const MqttTransport&) = delete;
+
+    // nullptr - снова без TLS. Только между сессиями.
+    bool setTls(TlsConfig* config);
+    bool secure() const { return _tls != nullptr; }
+
+    // TCP connect синхронный; рукопожатие TLS - в handshake().
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    // Шаг рукопожатия без ожидания; Pending - ждём ответа брокера.
+    // Без TLS сразу Ok.
+    LinkStatus handshake();
+
+    size_t write(const uint8_t* data, size_t length);
+    int available();
+    int read(uint8_t* buffer, size_t size);
+    uint8_t connected();
+    void stop();
+    int setNoDelay(bool noDelay) { return _tcp.setNoDelay(noDelay); }
+
+    // Следующее рукопожатие - полное.
+    void forgetSession();
+    const TlsStats& tlsStats() const { return _stats; }
+
+private:
+    // Реализация - mqtt_tls_mbedtls.cpp на плате, mqtt_tls_openssl.cpp на хосте.
+    // tlsRead: > 0 - данные, -1 - данных пока нет, 0 - соединение закрыто.
+    // tlsAvailable и tlsWrite: -1 - соединение закрыто.
+    bool tlsSetup();
+    void tlsRelease();
+    bool tlsStart(const char* serverName);
+    LinkStatus tlsStep(bool& resumed);
+    int tlsWrite(const uint8_t* data, size_t length);
+    int tlsAvailable();
+    int tlsRead(uint8_t* buffer, size_t size);
+    // notify - соединение живо, брокеру отправляется close_notify.
+    void tlsClose(bool notify);
+    void tlsForget();
+
+    WiFiClient _tcp;
+    TlsConfig* _config = nullptr;
+    TlsSessionState* _tls = nullptr;
+    bool _open = false;         // TLS начат на текущем TCP
+    bool _handshaking = false;
+    bool _closed = false;       // TLS закрыт брокером или ошибкой, TCP ещё нет
+    unsigned long _startedAt = 0;
+    uint32_t _cpuUs = 0;
+    char _sessionHost[64] = "";  // брокер сохранённой сессии
+    uint16_t _sessionPort = 0;
+    TlsStats _stats = {};
+};
+
+#endif
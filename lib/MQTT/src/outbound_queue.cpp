@@ -0,0 +1,83 @@
+#include "outbound_queue.hpp"
+#include <string.h>
+
+bool OutboundMessage::set(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+    size_t topicLength = strlen(topic);
+    if (topicLength >= sizeof(this->topic) || length > sizeof(this->payload)) {
+        return false;
+    }
+    memcpy(this->topic, topic, topicLength + 1);
+    memcpy(this->payload, payload, length);
+    this->length = (uint16_t)length;
+    this->qos = qos;
+    return true;
+}
+
+bool OutboundQueue::push(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+    bool spillPending = _spill && _spill->count() > 0;
+
+    if (_count < MQTT_QUEUE_SLOTS && !spillPending) {
+        OutboundMessage& slot = _slots[(_head + _count) % MQTT_QUEUE_SLOTS];
+        if (!slot.set(topic, payload, length, qos)) {
+            _stats.dropped++;
+            return false;
+        }
+        _count++;
+        _stats.queued++;
+        return true;
+    }
+
+    // RAM заполнена (или во flash уже лежат более старые сообщения) - пишем во flash.
+    if (!_spill || !_staging.set(topic, payload, length, qos) || !_spill->push(_staging)) {
+        _stats.dropped++;
+        return false;
+    }
+    _stats.queued++;
+    _stats.spilled++;
+    _spillDirty = true;
+    return true;
+}
+
+const OutboundMessage* OutboundQueue::front() {
+    if (_count > 0) {
+        return &_slots[_head];
+    }
+    if (!_spill || _spill->count() == 0) {
+        return nullptr;
+    }
+    if (!_spilledLoaded) {
+        if (!_spill->peek(_spilled)) {
+            return nullptr;
+        }
+        _spilledLoaded = true;
+    }
+    return &_spilled;
+}
+
+void OutboundQueue::pop() {
+    if (_count > 0) {
+        _head = (_head + 1) % MQTT_QUEUE_SLOTS;
+        _count--;
+        _stats.sent++;
+    } else if (_spilledLoaded) {
+        _spill->pop();
+        _spilledLoaded = false;
+        _spillDirty = true;
+        _stats.sent++;
+    }
+}
+
+void OutboundQueue::commit() {
+    if (_spillDirty) {
+        _spill->commit();
+        _spillDirty = false;
+    }
+}
+
+size_t OutboundQueue::depth() const {
+    return _count + spillDepth();
+}
+
+size_t OutboundQueue::spillDepth() const {
+    return _spill ? _spill->count() : 0;
+}
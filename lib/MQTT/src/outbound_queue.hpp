@@ -0,0 +1,80 @@
+#ifndef OUTBOUND_QUEUE_HPP
+#define OUTBOUND_QUEUE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MQTT_QUEUE_SLOTS
+#define MQTT_QUEUE_SLOTS 8
+#endif
+
+#ifndef MQTT_QUEUE_TOPIC_SIZE
+#define MQTT_QUEUE_TOPIC_SIZE 64
+#endif
+
+#ifndef MQTT_QUEUE_PAYLOAD_SIZE
+#define MQTT_QUEUE_PAYLOAD_SIZE 256
+#endif
+
+struct OutboundMessage {
+    char topic[MQTT_QUEUE_TOPIC_SIZE];
+    uint16_t length;
+    uint8_t qos;
+    uint8_t payload[MQTT_QUEUE_PAYLOAD_SIZE];
+
+    bool set(const char* topic, const uint8_t* payload, size_t length, uint8_t qos);
+};
+
+// Куда уходят сообщения, не поместившиеся в RAM. Хранилище FIFO.
+class MessageSpill {
+public:
+    virtual ~MessageSpill() {}
+    virtual bool push(const OutboundMessage& message) = 0;
+    virtual bool peek(OutboundMessage& message) = 0;
+    virtual void pop() = 0;
+    virtual void commit() {}
+    virtual size_t count() const = 0;
+};
+
+struct OutboundStats {
+    uint32_t queued = 0;    // принято в очередь
+    uint32_t sent = 0;      // отдано брокеру
+    uint32_t spilled = 0;   // RAM переполнена, записано во flash
+    uint32_t dropped = 0;   // потеряно: слишком большое или некуда положить
+};
+
+// Bounded FIFO of messages waiting for the broker. Keeps up to
+// MQTT_QUEUE_SLOTS messages in RAM; once RAM is full (or older messages are
+// already on flash) new messages go to the spill store, so order is kept.
+class OutboundQueue {
+public:
+    void setSpill(MessageSpill* spill) { _spill = spill; }
+
+    bool push(const char* topic, const uint8_t* payload, size_t length, uint8_t qos = 0);
+
+    // Самое старое сообщение или nullptr. Остаётся в очереди до pop().
+    const OutboundMessage* front();
+    void pop();
+    // Сохраняет позиции spill-хранилища после пачки push() и pop().
+    void commit();
+
+    bool empty() const { return depth() == 0; }
+    size_t depth() const;
+    size_t spillDepth() const;
+    const OutboundStats& stats() const { return _stats; }
+
+private:
+    OutboundMessage _slots[MQTT_QUEUE_SLOTS];
+    size_t _head = 0;
+    size_t _count = 0;
+
+    MessageSpill* _spill = nullptr;
+    OutboundMessage _spilled;
+    OutboundMessage _staging;
+    bool _spilledLoaded = false;
+    bool _spillDirty = false;
+
+    OutboundStats _stats;
+};
+
+#endif
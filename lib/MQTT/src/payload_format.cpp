@@ -0,0 +1,59 @@
+#include "payload_format.hpp"
+#include <string.h>
+#include "topic_router.hpp"
+#include "../../../src/shared/cbor_schema.hpp"
+
+const char* payload_format_name(PayloadFormat format) {
+    switch (format) {
+        case PayloadFormat::Json: return "json";
+        case PayloadFormat::Cbor: return "cbor";
+    }
+    return "unknown";
+}
+
+bool PayloadFormats::set(const char* filter, PayloadFormat format) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (strcmp(_rules[i].filter, filter) == 0) {
+            _rules[i].format = format;
+            return true;
+        }
+    }
+    if (_count >= MQTT_MAX_FORMAT_RULES || strlen(filter) >= sizeof(_rules[0].filter)) {
+        return false;
+    }
+    strcpy(_rules[_count].filter, filter);
+    _rules[_count].format = format;
+    _count++;
+    return true;
+}
+
+PayloadFormat PayloadFormats::resolve(const char* topic) const {
+    size_t length = strlen(topic);
+    size_t suffix = sizeof(MQTT_CBOR_SUFFIX) - 1;
+    if (length >= suffix && strcmp(topic + length - suffix, MQTT_CBOR_SUFFIX) == 0) {
+        return PayloadFormat::Cbor;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        if (topic_matches(_rules[i].filter, topic)) {
+            return _rules[i].format;
+        }
+    }
+    return PayloadFormat::Json;
+}
+
+size_t payload_encode(PayloadFormat format, const JsonSchema& schema, const void* message,
+                      uint8_t* output, size_t capacity) {
+    if (format == PayloadFormat::Cbor) {
+        return cbor_serialize(schema, message, output, capacity);
+    }
+    // JSON дописывает ноль: ему нужен лишний байт, в публикацию он не идёт.
+    return json_serialize(schema, message, (char*)output, capacity);
+}
+
+JsonError payload_decode(PayloadFormat format, const JsonSchema& schema, const uint8_t* payload,
+                         size_t length, void* message) {
+    if (format == PayloadFormat::Cbor) {
+        return cbor_parse(schema, payload, length, message);
+    }
+    return json_parse(schema, (const char*)payload, length, message);
+}
@@ -0,0 +1,46 @@
+#ifndef PAYLOAD_FORMAT_HPP
+#define PAYLOAD_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "outbound_queue.hpp"
+#include "../../../src/shared/json_schema.hpp"
+
+#ifndef MQTT_MAX_FORMAT_RULES
+#define MQTT_MAX_FORMAT_RULES 8
+#endif
+
+// Топик с таким окончанием всегда в CBOR, без правил: site/1/status/cbor.
+#define MQTT_CBOR_SUFFIX "/cbor"
+
+enum class PayloadFormat : uint8_t {
+    Json,
+    Cbor
+};
+
+const char* payload_format_name(PayloadFormat format);
+
+// Формат полезной нагрузки по топику: суффикс MQTT_CBOR_SUFFIX, затем правила
+// в порядке добавления (topic_matches() из topic_router.hpp), по умолчанию JSON.
+class PayloadFormats {
+public:
+    bool set(const char* filter, PayloadFormat format);
+    PayloadFormat resolve(const char* topic) const;
+
+private:
+    struct Rule {
+        char filter[MQTT_QUEUE_TOPIC_SIZE];
+        PayloadFormat format;
+    };
+
+    Rule _rules[MQTT_MAX_FORMAT_RULES];
+    uint8_t _count = 0;
+};
+
+// Сообщение по схеме в выбранном формате. 0 - не поместилось.
+size_t payload_encode(PayloadFormat format, const JsonSchema& schema, const void* message,
+                      uint8_t* output, size_t capacity);
+JsonError payload_decode(PayloadFormat format, const JsonSchema& schema, const uint8_t* payload,
+                         size_t length, void* message);
+
+#endif
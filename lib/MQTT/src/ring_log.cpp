@@ -0,0 +1,181 @@
+#include "ring_log.hpp"
+#include <string.h>
+#include "../../../src/shared/crc32.hpp"
+
+RingLog::RingLog(LogStorage& storage, uint32_t capacity)
+    : _storage(storage), _capacity(capacity) {
+    memset(&_header, 0, sizeof(_header));
+}
+
+bool RingLog::begin() {
+    if (_capacity <= sizeof(Header) + sizeof(RecordHeader)) {
+        return false;
+    }
+    if (_storage.read(0, &_header, sizeof(_header)) && validHeader()) {
+        return true;
+    }
+    reset();
+    return writeHeader();
+}
+
+bool RingLog::validHeader() const {
+    return _header.magic == MAGIC &&
+           _header.crc == crc32(&_header, offsetof(Header, crc)) &&
+           _header.head >= dataStart() && _header.head <= _capacity &&
+           _header.tail >= dataStart() && _header.tail <= _capacity &&
+           _header.used <= dataSize() &&
+           _header.count <= _header.used;
+}
+
+bool RingLog::writeHeader() {
+    _header.magic = MAGIC;
+    _header.crc = crc32(&_header, offsetof(Header, crc));
+    bool ok = _storage.write(0, &_header, sizeof(_header));
+    _storage.flush();
+    _changes = 0;
+    _released = 0;
+    return ok;
+}
+
+bool RingLog::changed() {
+    _changes++;
+    return _changes < RING_LOG_SYNC_EVERY || writeHeader();
+}
+
+void RingLog::reset() {
+    _header.head = dataStart();
+    _header.tail = dataStart();
+    _header.used = 0;
+    _header.count = 0;
+    _peekedSize = 0;
+}
+
+uint32_t RingLog::recordCrc(const RecordHeader& record, const OutboundMessage& message) {
+    uint32_t crc = crc32_update(0, &record, offsetof(RecordHeader, crc));
+    crc = crc32_update(crc, message.topic, record.topicLength);
+    return crc32_update(crc, message.payload, record.payloadLength);
+}
+
+bool RingLog::push(const OutboundMessage& message) {
+    RecordHeader record;
+    record.topicLength = (uint16_t)strlen(message.topic);
+    record.payloadLength = message.length;
+    record.qos = message.qos;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    record.crc = recordCrc(record, message);
+
+    uint32_t size = sizeof(record) + record.topicLength + record.payloadLength;
+    uint32_t tail = _header.tail;
+    uint32_t used = _header.used;
+    uint32_t gap = tail + size > _capacity ? _capacity - tail : 0;
+    if (used + gap + size > dataSize()) {
+        return false;
+    }
+    // Место освобождено pop, но заголовок на flash ещё считает его занятым.
+    if (_released > 0 && used + gap + size + _released > dataSize() && !writeHeader()) {
+        return false;
+    }
+
+    if (gap > 0) {
+        // Запись не влезает до конца области: помечаем остаток как пропуск.
+        if (gap >= sizeof(RecordHeader)) {
+            RecordHeader wrap = { WRAP, 0, 0, {0, 0, 0}, 0 };
+            if (!_storage.write(tail, &wrap, sizeof(wrap))) {
+                return false;
+            }
+        }
+        tail = dataStart();
+        used += gap;
+    }
+
+    if (!_storage.write(tail, &record, sizeof(record)) ||
+        !_storage.write(tail + sizeof(record), message.topic, record.topicLength) ||
+        !_storage.write(tail + sizeof(record) + record.topicLength, message.payload,
+                        record.payloadLength)) {
+        return false;
+    }
+
+    _header.tail = tail + size;
+    _header.used = used + size;
+    _header.count++;
+    return changed();
+}
+
+bool RingLog::skipWrap() {
+    uint32_t gap = _capacity - _header.head;
+    if (gap >= sizeof(RecordHeader)) {
+        RecordHeader record;
+        if (!_storage.read(_header.head, &record, sizeof(record))) {
+            return false;
+        }
+        if (record.topicLength != WRAP) {
+            return true;
+        }
+    }
+    _header.head = dataStart();
+    _header.used -= gap;
+    _released += gap;
+    return true;
+}
+
+bool RingLog::peek(OutboundMessage& message) {
+    if (_header.count == 0) {
+        return false;
+    }
+
+    RecordHeader record;
+    bool ok = skipWrap() && _storage.read(_header.head, &record, sizeof(record)) &&
+              record.topicLength < sizeof(message.topic) &&
+              record.payloadLength <= sizeof(message.payload);
+
+    uint32_t size = sizeof(record) + record.topicLength + record.payloadLength;
+    ok = ok && _header.head + size <= _capacity &&
+         _storage.read(_header.head + sizeof(record), message.topic, record.topicLength) &&
+         _storage.read(_header.head + sizeof(record) + record.topicLength, message.payload,
+                       record.payloadLength);
+
+    if (ok) {
+        message.topic[record.topicLength] = '\0';
+        message.length = record.payloadLength;
+        message.qos = record.qos;
+        ok = recordCrc(record, message) == record.crc;
+    }
+
+    if (!ok) {
+        // Порванная запись (например, питание пропало во время записи):
+        // дальше читать нельзя, начинаем лог заново.
+        _corrupted++;
+        reset();
+        writeHeader();
+        return false;
+    }
+
+    _peekedSize = size;
+    return true;
+}
+
+void RingLog::pop() {
+    if (_peekedSize == 0) {
+        return;
+    }
+    _header.head += _peekedSize;
+    _header.used -= _peekedSize;
+    _header.count--;
+    _released += _peekedSize;
+    _peekedSize = 0;
+
+    if (_header.count == 0) {
+        // Следующие записи пойдут с начала области: заголовок на flash
+        // не должен указывать на старые.
+        reset();
+        writeHeader();
+        return;
+    }
+    changed();
+}
+
+void RingLog::commit() {
+    if (_changes > 0) {
+        writeHeader();
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef RING_LOG_HPP
+#define RING_LOG_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "outbound_queue.hpp"
+
+// Сколько push/pop копится в RAM до записи заголовка на flash.
+#ifndef RING_LOG_SYNC_EVERY
+#define RING_LOG_SYNC_EVERY 16
+#endif
+
+// Произвольный доступ к области фиксированного размера (файл, раздел flash).
+class LogStorage {
+public:
+    virtual ~LogStorage() {}
+    virtual bool read(uint32_t offset, void* data, size_t length) = 0;
+    virtual bool write(uint32_t offset, const void* data, size_t length) = 0;
+    virtual void flush() {}
+};
+
+// Circular log of OutboundMessage records on top of LogStorage.
+//
+// Layout: a header with the read/write positions followed by the record area.
+// Every record carries a CRC-32 over its lengths, topic and payload; a record
+// that fails the check means the log was torn, and the whole log is reset.
+//
+// Records and the header reach flash together, in batches: every
+// RING_LOG_SYNC_EVERY push/pop, on commit(), and when the log runs empty. A
+// reboot before the next sync loses the messages pushed since the last one
+// and replays the ones popped since then (at-least-once). A push that would
+// overwrite records the header on flash still counts syncs first, so the log
+// on flash never points at overwritten data.
+class RingLog : public MessageSpill {
+public:
+    RingLog(LogStorage& storage, uint32_t capacity);
+
+    bool begin();
+
+    bool push(const OutboundMessage& message) override;
+    bool peek(OutboundMessage& message) override;
+    void pop() override;
+    void commit() override;
+    size_t count() const override { return _header.count; }
+
+    uint32_t corrupted() const { return _corrupted; }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t head;
+        uint32_t tail;
+        uint32_t used;
+        uint32_t count;
+        uint32_t crc;
+    };
+
+    struct RecordHeader {
+        uint16_t topicLength;
+        uint16_t payloadLength;
+        uint8_t qos;
+        uint8_t reserved[3];
+        uint32_t crc;
+    };
+
+    static const uint32_t MAGIC = 0x4D514C32;  // "MQL2"
+    static const uint16_t WRAP = 0xFFFF;
+
+    uint32_t dataStart() const { return sizeof(Header); }
+    uint32_t dataSize() const { return _capacity - sizeof(Header); }
+    bool validHeader() const;
+    bool writeHeader();
+    bool changed();
+    void reset();
+    bool skipWrap();
+    static uint32_t recordCrc(const RecordHeader& record, const OutboundMessage& message);
+
+    LogStorage& _storage;
+    uint32_t _capacity;
+    Header _header;
+    uint32_t _peekedSize = 0;
+    uint32_t _corrupted = 0;
+    uint32_t _changes = 0;   // push/pop после последней записи заголовка
+    uint32_t _released = 0;  // байт, освобождённых pop после неё же
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "tcp_probe.hpp"
+#include <errno.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <fcntl.h>
+#include <unistd.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+
+// Колбэк lwIP: вызывается в его задаче, когда ответ DNS пришёл или истёк.
+struct TcpProbeResolver {
+    static void resolved(const char*, const ip_addr_t* address, void* context) {
+        TcpProbe* probe = (TcpProbe*)context;
+        probe->_dnsAddress = address && IP_IS_V4(address) ? ip_2_ip4(address)->addr : 0;
+        probe->_dnsPending = false;
+    }
+};
+
+// true - адрес уже есть (IP в строке или кэш lwIP); failed - имя не
+// разрешить, иначе ответ придёт в колбэк.
+static bool resolve(const char* host, TcpProbe* probe, uint32_t& address, bool& failed) {
+    ip_addr_t resolved;
+    err_t result = dns_gethostbyname(host, &resolved, TcpProbeResolver::resolved, probe);
+    if (result == ERR_INPROGRESS) {
+        failed = false;
+        return false;
+    }
+    failed = result != ERR_OK || !IP_IS_V4(&resolved);
+    if (failed) {
+        return false;
+    }
+    address = ip_2_ip4(&resolved)->addr;
+    return true;
+}
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static bool resolve(const char* host, TcpProbe*, uint32_t& address, bool& failed) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    failed = getaddrinfo(host, nullptr, &hints, &result) != 0 || !result;
+    if (failed) {
+        return false;
+    }
+    address = ((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+    return true;
+}
+#endif
+
+bool TcpProbe::start(const char* host, uint16_t port, uint32_t timeoutMs) {
+    stop();
+    if (_dnsPending) {
+        return false;  // колбэк ещё может записать старый адрес
+    }
+    _port = port;
+    _timeoutMs = timeoutMs;
+    _startedAt = _clock();
+
+    uint32_t address = 0;
+    bool failed = false;
+    _dnsPending = true;
+    if (resolve(host, this, address, failed)) {
+        _dnsPending = false;
+        return connectTo(address);
+    }
+    if (failed) {
+        _dnsPending = false;
+        _state = State::Failed;
+        return true;
+    }
+    _state = State::Resolving;
+    return true;
+}
+
+bool TcpProbe::connectTo(uint32_t address) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(_port);
+    target.sin_addr.s_addr = address;
+    _connectAt = _clock();
+    if (connect(fd, (struct sockaddr*)&target, sizeof(target)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        _state = State::Failed;  // сеть недоступна, отказ и т.п.
+        return true;
+    }
+    _fd = fd;
+    _state = State::Connecting;
+    return true;
+}
+
+ProbeStatus TcpProbe::finish(ProbeStatus status, uint32_t& rttMs) {
+    rttMs = _clock() - _connectAt;
+    stop();
+    return status;
+}
+
+ProbeStatus TcpProbe::poll(uint32_t& rttMs) {
+    rttMs = 0;
+    if (_state == State::Idle || _state == State::Failed) {
+        stop();
+        return ProbeStatus::Unreachable;
+    }
+    bool expired = _clock() - _startedAt >= _timeoutMs;
+
+    if (_state == State::Resolving) {
+        if (_dnsPending) {
+            if (expired) {
+                stop();
+                return ProbeStatus::Unreachable;
+            }
+            return ProbeStatus::Pending;
+        }
+        uint32_t address = _dnsAddress;
+        if (address == 0 || !connectTo(address) || _state == State::Failed) {
+            stop();
+            return ProbeStatus::Unreachable;
+        }
+    }
+
+    // Сокет готов к записи - connect завершился, удачно или нет.
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(_fd, &writable);
+    struct timeval now = { 0, 0 };
+    int ready = select(_fd + 1, nullptr, &writable, nullptr, &now);
+    if (ready > 0) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        bool connected = getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+        return finish(connected ? ProbeStatus::Reachable : ProbeStatus::Unreachable, rttMs);
+    }
+    if (ready < 0 || expired) {
+        return finish(ProbeStatus::Unreachable, rttMs);
+    }
+    return ProbeStatus::Pending;
+}
+
+void TcpProbe::stop() {
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    _state = State::Idle;
+}
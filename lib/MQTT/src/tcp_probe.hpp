@@ -0,0 +1,59 @@
+#ifndef TCP_PROBE_HPP
+#define TCP_PROBE_HPP
+
+#include <atomic>
+#include <stdint.h>
+#include "mqtt_connection.hpp"
+
+enum class ProbeStatus : uint8_t {
+    Pending,
+    Reachable,
+    Unreachable
+};
+
+// Пробное TCP-подключение без ожидания: start() только отправляет SYN (или
+// запрос DNS), poll() из того же цикла проверяет результат. Задача,
+// обслуживающая сессию MQTT, не стоит, пока брокер отвечает или молчит.
+// На плате имя разрешается асинхронно через lwIP; на хосте - getaddrinfo()
+// (локальные имена, ждать нечего).
+class TcpProbe {
+public:
+    explicit TcpProbe(MqttClock clock) : _clock(clock) {}
+    ~TcpProbe() { stop(); }
+    TcpProbe(const TcpProbe&) = delete;
+    TcpProbe& operator=(const TcpProbe&) = delete;
+
+    // false - предыдущий запрос DNS ещё не вернулся (после таймаута) или
+    // нет сокета; пробу можно повторить позже. Неразрешимое имя или отказ
+    // connect() сразу - это Unreachable из poll().
+    bool start(const char* host, uint16_t port, uint32_t timeoutMs);
+    // Reachable/Unreachable - один раз на start(), rttMs - время connect.
+    ProbeStatus poll(uint32_t& rttMs);
+    bool active() const { return _state != State::Idle; }
+    void stop();
+
+private:
+    enum class State : uint8_t {
+        Idle,
+        Resolving,
+        Connecting,
+        Failed
+    };
+
+    bool connectTo(uint32_t address);
+    ProbeStatus finish(ProbeStatus status, uint32_t& rttMs);
+    friend struct TcpProbeResolver;
+
+    MqttClock _clock;
+    State _state = State::Idle;
+    int _fd = -1;
+    uint16_t _port = 0;
+    uint32_t _timeoutMs = 0;
+    unsigned long _startedAt = 0;    // start(): отсчёт таймаута
+    unsigned long _connectAt = 0;    // отправка SYN: отсчёт rtt
+    // Ответ DNS приходит из задачи lwIP.
+    std::atomic<bool> _dnsPending{ false };
+    std::atomic<uint32_t> _dnsAddress{ 0 };  // 0 - имя не разрешилось
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef TOPIC_ROUTER_HPP
+#define TOPIC_ROUTER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef void (*TopicHandler)(const char* topic, const uint8_t* payload,
+                             unsigned int length, void* context);
+
+enum class TopicLevelMatch : uint8_t {
+    None,
+    Level,  // уровень совпал, сравнение продолжается со следующего
+    Rest    // '#': совпал весь остаток топика, в том числе пустой ("a/#" и "a")
+};
+
+// Правила MQTT для одного уровня фильтра против одного уровня топика - общие
+// для TopicRouter и topic_matches(). consumed - уровней в топике не осталось;
+// system - первый уровень топика '$...', шаблоны его не покрывают.
+inline TopicLevelMatch topic_level_match(const char* filter, size_t filterLength, const char* level,
+                                         size_t length, bool consumed, bool system) {
+    if (filterLength == 1 && filter[0] == '#') {
+        return system ? TopicLevelMatch::None : TopicLevelMatch::Rest;
+    }
+    if (consumed) {
+        return TopicLevelMatch::None;
+    }
+    if (filterLength == 1 && filter[0] == '+') {
+        return system ? TopicLevelMatch::None : TopicLevelMatch::Level;
+    }
+    return filterLength == length && memcmp(filter, level, length) == 0 ? TopicLevelMatch::Level
+                                                                         : TopicLevelMatch::None;
+}
+
+// Совпадение одного фильтра с топиком без дерева - для разовых проверок.
+inline bool topic_matches(const char* filter, const char* topic) {
+    bool system = topic[0] == '$';
+    bool consumed = false;
+    for (;;) {
+        const char* filterSlash = strchr(filter, '/');
+        size_t filterLength = filterSlash ? (size_t)(filterSlash - filter) : strlen(filter);
+        const char* slash = consumed ? nullptr : strchr(topic, '/');
+        size_t length = consumed ? 0 : (slash ? (size_t)(slash - topic) : strlen(topic));
+
+        TopicLevelMatch result = topic_level_match(filter, filterLength, topic, length, consumed, system);
+        if (result != TopicLevelMatch::Level) {
+            return result == TopicLevelMatch::Rest;
+        }
+        if (!filterSlash) {
+            return !slash;
+        }
+        filter = filterSlash + 1;
+        if (slash) {
+            topic = slash + 1;
+        } else {
+            consumed = true;
+        }
+        system = false;
+    }
+}
+
+// Routes incoming topics to handlers registered against MQTT topic filters
+// ("+" matches one level, "#" the rest). Filters are split into a level trie
+// kept in fixed arrays sized at compile time: registering and dispatching
+// never touch the heap and the topic is matched in place, level by level.
+//
+// The router stores pointers into the filter strings, so filters must outlive
+// it (string literals are the intended use).
+template <size_t MaxRoutes, size_t MaxNodes>
+class TopicRouter {
+public:
+    TopicRouter() {
+        _nodes[0] = Node();
+        _nodeCount = 1;
+    }
+
+    bool add(const char* filter, TopicHandler handler, void* context = nullptr) {
+        if (!handler || !valid(filter) || _routeCount >= MaxRoutes) {
+            return false;
+        }
+
+        int16_t node = 0;
+        const char* level = filter;
+        size_t nodeCount = _nodeCount;
+        int16_t attached = -1;  // существующий узел, к которому подвешена новая цепочка
+        while (true) {
+            const char* slash = strchr(level, '/');
+            size_t len = slash ? (size_t)(slash - level) : strlen(level);
+
+            int16_t child = findChild(node, level, len);
+            if (child < 0) {
+                if (_nodeCount >= MaxNodes) {
+                    // Недостроенная цепочка без маршрута занимала бы узлы навсегда.
+                    if (attached >= 0) {
+                        _nodes[attached].child = _nodes[nodeCount].sibling;
+                    }
+                    _nodeCount = nodeCount;
+                    return false;
+                }
+                if (attached < 0) {
+                    attached = node;
+                }
+                child = (int16_t)_nodeCount++;
+                Node& created = _nodes[child];
+                created = Node();
+                created.level = level;
+                created.length = (uint8_t)len;
+                created.sibling = _nodes[node].child;
+                _nodes[node].child = child;
+            }
+            node = child;
+
+            if (!slash) {
+                break;
+            }
+            level = slash + 1;
+        }
+
+        Route& route = _routes[_routeCount];
+        route.filter = filter;
+        route.handler = handler;
+        route.context = context;
+        route.next = _nodes[node].route;
+        _nodes[node].route = (int16_t)_routeCount++;
+        return true;
+    }
+
+    // Вызывает все подходящие обработчики, возвращает их количество.
+    unsigned dispatch(const char* topic, const uint8_t* payload, unsigned int length) const {
+        Delivery delivery = { topic, payload, length, 0 };
+        const char* end = topic + strlen(topic);
+        match(0, topic, end, false, topic[0] == '$', delivery);
+        return delivery.handled;
+    }
+
+    // Один вызов на каждый уникальный фильтр - для (пере)подписки.
+    template <typename Fn>
+    bool forEachFilter(Fn fn) const {
+        for (size_t i = 1; i < _nodeCount; i++) {
+            if (_nodes[i].route >= 0 && !fn(_routes[_nodes[i].route].filter)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t routes() const { return _routeCount; }
+
+private:
+    struct Node {
+        const char* level = nullptr;
+        uint8_t length = 0;
+        int16_t child = -1;
+        int16_t sibling = -1;
+        int16_t route = -1;
+    };
+
+    struct Route {
+        const char* filter;
+        TopicHandler handler;
+        void* context;
+        int16_t next;
+    };
+
+    struct Delivery {
+        const char* topic;
+        const uint8_t* payload;
+        unsigned int length;
+        unsigned handled;
+    };
+
+    static bool valid(const char* filter) {
+        if (!filter || !*filter) {
+            return false;
+        }
+        for (const char* p = filter; *p; p++) {
+            bool levelStart = p == filter || p[-1] == '/';
+            bool levelEnd = p[1] == '\0' || p[1] == '/';
+            if (*p == '+' && !(levelStart && levelEnd)) {
+                return false;
+            }
+            if (*p == '#' && !(levelStart && p[1] == '\0')) {
+                return false;
+            }
+            if (levelStart) {
+                const char* slash = strchr(p, '/');
+                size_t len = slash ? (size_t)(slash - p) : strlen(p);
+                if (len > UINT8_MAX) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    int16_t findChild(int16_t parent, const char* level, size_t len) const {
+        for (int16_t i = _nodes[parent].child; i >= 0; i = _nodes[i].sibling) {
+            if (_nodes[i].length == len && memcmp(_nodes[i].level, level, len) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void deliver(int16_t node, Delivery& delivery) const {
+        for (int16_t i = _nodes[node].route; i >= 0; i = _routes[i].next) {
+            _routes[i].handler(delivery.topic, delivery.payload, delivery.length,
+                               _routes[i].context);
+            delivery.handled++;
+        }
+    }
+
+    // level указывает на начало текущего уровня топика; consumed = уровней не осталось.
+    // Топики, начинающиеся с '$', не совпадают с wildcard на первом уровне.
+    void match(int16_t parent, const char* level, const char* end, bool consumed,
+               bool system, Delivery& delivery) const {
+        const char* slash = consumed ? end : (const char*)memchr(level, '/', end - level);
+        size_t len = consumed ? 0 : (slash ? (size_t)(slash - level) : (size_t)(end - level));
+
+        for (int16_t i = _nodes[parent].child; i >= 0; i = _nodes[i].sibling) {
+            const Node& node = _nodes[i];
+            TopicLevelMatch result = topic_level_match(node.level, node.length, level, len, consumed, system);
+            if (result == TopicLevelMatch::Rest) {
+                deliver(i, delivery);
+                continue;
+            }
+            if (result == TopicLevelMatch::None) {
+                continue;
+            }
+
+            if (slash) {
+                match(i, slash + 1, end, false, false, delivery);
+            } else {
+                deliver(i, delivery);
+                match(i, end, end, true, false, delivery);
+            }
+        }
+    }
+
+    Node _nodes[MaxNodes];
+    Route _routes[MaxRoutes];
+    size_t _nodeCount = 0;
+    size_t _routeCount = 0;
+};
+
+#endif
@@ -0,0 +1,694 @@
+// Микробенчмарки горячих путей для env:native:
+//   pio run -e native -t exec
+// Для каждого случая печатает ns/op и количество выделений памяти на операцию.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <new>
+#include "../../../lib/MQTT/src/mqtt_codec.hpp"
+#include "../../../lib/MQTT/src/topic_router.hpp"
+#include "../../../lib/MQTT/src/payload_format.hpp"
+#include "../../shared/payloads.hpp"
+#include "../../shared/dns_reply.hpp"
+#include "../../shared/sample_aggregator.hpp"
+#include "../../shared/scheduler.hpp"
+#include "../../shared/metrics.hpp"
+#include "../../shared/fixed_string.hpp"
+#include "../../shared/arena.hpp"
+#include "../../shared/frame_parser.hpp"
+#include "../../shared/delta_patch.hpp"
+#include "../../shared/sha256.hpp"
+#include "../../shared/crc32.hpp"
+#include "../../shared/gateway.hpp"
+#include "../../shared/binlog.hpp"
+#include "../../shared/timeseries.hpp"
+#include <math.h>
+
+// --- Подсчёт выделений памяти ---
+
+static unsigned long allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocations++;
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+#else
+void* operator new(size_t size) {
+    allocations++;
+    void* pointer = malloc(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+#endif
+
+// --- Харнесс ---
+
+static volatile uint32_t sink;
+
+template <typename Fn>
+static void bench(const char* name, Fn fn) {
+    for (int i = 0; i < 1000; i++) {
+        fn();
+    }
+
+    using Clock = std::chrono::steady_clock;
+    unsigned long iterations = 0;
+    unsigned long allocationsBefore = allocations;
+    Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do {
+        for (int i = 0; i < 1000; i++) {
+            fn();
+        }
+        iterations += 1000;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(300));
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    double perOp = (double)(allocations - allocationsBefore) / iterations;
+    Serial.printf("%-34s %10.1f ns/op %8.2f allocs/op\n", name, ns, perOp);
+}
+
+// --- Случаи ---
+
+static void noop_handler(const char*, const uint8_t* payload, unsigned int length, void*) {
+    sink += length + payload[0];
+}
+
+static const char* const hub_filters[] = {
+    "esp32/wifi", "esp32/test", "esp32/ota/+", "esp32/rpc/#",
+    "site/+/sensors/temperature", "site/+/sensors/humidity", "site/+/sensors/moisture",
+    "site/+/sensors/flow", "site/+/actuators/valve", "site/+/actuators/pump",
+    "site/+/config", "site/+/status", "fleet/broadcast", "fleet/+/command",
+    "gateway/+/batch", "$SYS/broker/uptime"
+};
+
+static void bench_mqtt() {
+    uint8_t payload[64];
+    memset(payload, 'x', sizeof(payload));
+
+    uint8_t packet[160];
+    size_t packetSize = mqtt_encode_publish(packet, sizeof(packet), "site/42/sensors/moisture",
+                                            payload, sizeof(payload), 1, false, 7);
+
+    bench("mqtt/encode_publish_qos1", [&]() {
+        uint8_t out[160];
+        sink += mqtt_encode_publish(out, sizeof(out), "site/42/sensors/moisture",
+                                    payload, sizeof(payload), 1, false, 7);
+    });
+
+    bench("mqtt/decode_publish_qos1", [&]() {
+        uint8_t in[160];
+        memcpy(in, packet, packetSize);
+        MqttPacket decoded;
+        if (mqtt_decode(in, packetSize, sizeof(in), decoded) == MqttDecode::Ok) {
+            sink += decoded.payloadLength;
+        }
+    });
+}
+
+static void bench_router() {
+    static TopicRouter<32, 96> router;
+    for (size_t i = 0; i < sizeof(hub_filters) / sizeof(hub_filters[0]); i++) {
+        router.add(hub_filters[i], noop_handler);
+    }
+
+    static const uint8_t payload[] = "{\"ping\":1}";
+    bench("router/dispatch_exact", [&]() {
+        sink += router.dispatch("esp32/test", payload, sizeof(payload) - 1);
+    });
+    bench("router/dispatch_wildcard", [&]() {
+        sink += router.dispatch("site/42/sensors/moisture", payload, sizeof(payload) - 1);
+    });
+    bench("router/dispatch_miss", [&]() {
+        sink += router.dispatch("other/topic/entirely", payload, sizeof(payload) - 1);
+    });
+}
+
+static void bench_json() {
+    static const char credentials[] = "{\"ssid\":\"Router-5G\",\"password\":\"correct horse battery\"}";
+    bench("json/parse_wifi_credentials", [&]() {
+        WiFiCredentials parsed;
+        if (parse_wifi_credentials(credentials, sizeof(credentials) - 1, parsed) == JsonError::Ok) {
+            sink += parsed.ssid[0] + parsed.password[0];
+        }
+    });
+
+    DeviceStatus status = { true, false, "192.168.3.41" };
+    bench("json/serialize_status", [&]() {
+        char output[96];
+        sink += serialize_status(status, output, sizeof(output));
+    });
+
+    // Прежний путь через DynamicJsonDocument - для сравнения.
+    bench("arduinojson/parse_wifi_credentials", [&]() {
+        DynamicJsonDocument doc(256);
+        if (!deserializeJson(doc, credentials, sizeof(credentials) - 1)) {
+            String ssid = doc["ssid"].as<String>();
+            String password = doc["password"].as<String>();
+            sink += ssid.length() + password.length();
+        }
+    });
+
+    bench("arduinojson/serialize_status", [&]() {
+        DynamicJsonDocument doc(256);
+        doc["wifi_connected"] = status.wifiConnected;
+        doc["config_mode"] = status.configMode;
+        doc["ip_address"] = String(status.ipAddress);
+        String output;
+        serializeJson(doc, output);
+        sink += output.length();
+    });
+}
+
+// Размер и цена одних и тех же сообщений в JSON и CBOR.
+static void bench_formats() {
+    WiFiCredentials credentials = { "Router-5G", "correct horse battery" };
+    DeviceStatus status = { true, false, "192.168.3.41" };
+    BridgePublish bridge = { "esp32/test", "Hello from ESP32!" };
+
+    struct Sample {
+        const char* name;
+        const JsonSchema& schema;
+        const void* message;
+    };
+    const Sample samples[] = {
+        { "wifi_credentials", WIFI_CREDENTIALS_SCHEMA, &credentials },
+        { "device_status", DEVICE_STATUS_SCHEMA, &status },
+        { "bridge_publish", BRIDGE_PUBLISH_SCHEMA, &bridge }
+    };
+
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        uint8_t buffer[MQTT_QUEUE_PAYLOAD_SIZE + 1];
+        size_t json = payload_encode(PayloadFormat::Json, samples[i].schema, samples[i].message, buffer, sizeof(buffer));
+        size_t cbor = payload_encode(PayloadFormat::Cbor, samples[i].schema, samples[i].message, buffer, sizeof(buffer));
+        Serial.printf("bytes/%-28s %10u json %8u cbor\n", samples[i].name, (unsigned)json, (unsigned)cbor);
+    }
+
+    uint8_t encoded[64];
+    size_t encodedSize = payload_encode(PayloadFormat::Cbor, DEVICE_STATUS_SCHEMA, &status, encoded, sizeof(encoded));
+    bench("cbor/serialize_status", [&]() {
+        uint8_t output[64];
+        sink += payload_encode(PayloadFormat::Cbor, DEVICE_STATUS_SCHEMA, &status, output, sizeof(output));
+    });
+    bench("cbor/parse_status", [&]() {
+        DeviceStatus parsed;
+        if (payload_decode(PayloadFormat::Cbor, DEVICE_STATUS_SCHEMA, encoded, encodedSize, &parsed) == JsonError::Ok) {
+            sink += parsed.ipAddress[0];
+        }
+    });
+
+    char text[96];
+    size_t textSize = serialize_status(status, text, sizeof(text));
+    bench("json/parse_status", [&]() {
+        DeviceStatus parsed;
+        if (payload_decode(PayloadFormat::Json, DEVICE_STATUS_SCHEMA, (const uint8_t*)text, textSize, &parsed) == JsonError::Ok) {
+            sink += parsed.ipAddress[0];
+        }
+    });
+
+    PayloadFormats formats;
+    formats.set("site/+/telemetry/#", PayloadFormat::Cbor);
+    bench("format/resolve_rule", [&]() {
+        sink += (uint32_t)formats.resolve("site/42/telemetry/moisture");
+    });
+}
+
+// Синтетические сигналы АЦП: пила по всей шкале и шумная синусоида с выбросами.
+static void bench_aggregate() {
+    static uint16_t ramp[4096];
+    for (size_t i = 0; i < 4096; i++) {
+        ramp[i] = (uint16_t)i;
+    }
+    static uint16_t moisture[1024];
+    for (size_t i = 0; i < 1024; i++) {
+        double value = 1300 + 80 * sin(i * 2 * M_PI / 256) + (int)(i * 7919 % 17) - 8;
+        moisture[i] = (uint16_t)(i % 200 == 0 ? 4000 : value);
+    }
+
+    SampleAggregator<> aggregator;
+    const uint16_t* signals[] = { ramp, moisture };
+    const size_t lengths[] = { 4096, 1024 };
+    const char* const names[] = { "ramp", "moisture" };
+    for (size_t s = 0; s < 2; s++) {
+        aggregator.reset();
+        aggregator.add(signals[s], lengths[s]);
+        SampleStats stats = {};
+        aggregator.snapshot(stats);
+        Serial.printf("stats/%-29s n=%u min=%u max=%u mean=%u p50=%u p90=%u p99=%u\n", names[s],
+                      (unsigned)stats.count, stats.min, stats.max, stats.mean, stats.p50, stats.p90, stats.p99);
+    }
+
+    bench("aggregate/add_1024", [&]() {
+        aggregator.add(moisture, 1024);
+        sink += aggregator.count();
+    });
+    bench("aggregate/snapshot", [&]() {
+        SampleStats stats = {};
+        aggregator.snapshot(stats);
+        sink += stats.p99;
+    });
+}
+
+// Часы планировщика двигает сам тест: сравнивается работа колеса, а не сон.
+static uint32_t bench_clock_ms = 0;
+static unsigned long bench_clock() {
+    return bench_clock_ms;
+}
+
+static void count_job(void* context) {
+    (*(uint32_t*)context)++;
+}
+
+static void bench_scheduler() {
+    Scheduler<32> jobs(bench_clock);
+    uint32_t fired = 0;
+    // Типичный набор: пара частых задач, таймауты в секунды и редкие отчёты.
+    const uint32_t periods[] = { 10, 50, 1000, 5000, 10000, 30000, 60000, 3600000 };
+    for (size_t i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+        jobs.every(periods[i], count_job, &fired);
+    }
+
+    bench("scheduler/after_cancel", [&]() {
+        JobId id = jobs.after(3000, count_job, &fired);
+        sink += jobs.cancel(id);
+    });
+    bench("scheduler/run_1ms", [&]() {
+        bench_clock_ms++;
+        sink += jobs.run();
+    });
+    bench("scheduler/run_sleep_1s", [&]() {
+        bench_clock_ms += 1000;
+        sink += jobs.run();
+    });
+    bench("scheduler/until_next", [&]() {
+        sink += jobs.untilNext();
+    });
+    Serial.printf("scheduler: %u callbacks fired\n", (unsigned)fired);
+}
+
+static const uint32_t bench_latency_bounds[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+static MetricHistogram bench_latency("bench_latency_ms", "bl", "Bench histogram", bench_latency_bounds, 9);
+static MetricCounter bench_events("bench_events_total", "be", "Bench counter");
+
+// Сколько байт выдаёт /metrics, без самого вывода.
+class CountingPrint : public Print {
+public:
+    size_t write(const uint8_t* buffer, size_t size) override {
+        written += size;
+        return size;
+    }
+    size_t written = 0;
+};
+
+static void bench_metrics() {
+    uint32_t value = 0;
+    bench("metrics/counter_add", [&]() {
+        bench_events.add();
+    });
+    bench("metrics/histogram_observe", [&]() {
+        bench_latency.observe(value);
+        value = (value + 37) % 6000;
+    });
+
+    char compact[MQTT_QUEUE_PAYLOAD_SIZE];
+    bench("metrics/compact", [&]() {
+        sink += metrics_write_compact(compact, sizeof(compact));
+    });
+    CountingPrint prometheus;
+    metrics_write_prometheus(prometheus);
+    Serial.printf("metrics: prometheus %u bytes, mqtt %u bytes: %s\n", (unsigned)prometheus.written,
+                  (unsigned)strlen(compact), compact);
+}
+
+// Обработка входящего сообщения так, как это делают приложения: разбор в
+// арене сообщения, ответ по схеме, топик в FixedString.
+static StaticArena<1024> steady_arena;
+static uint32_t steady_handled = 0;
+
+static void steady_handler(const char* topic, const uint8_t* payload, unsigned int length, void*) {
+    ArenaScope scope(steady_arena);
+    WiFiCredentials* credentials = steady_arena.create<WiFiCredentials>();
+    if (!credentials || parse_wifi_credentials((const char*)payload, length, *credentials) != JsonError::Ok) {
+        return;
+    }
+    FixedString<48> reply;
+    reply.appendf("esp32/stats/%s", credentials->ssid);
+    DeviceStatus status = { true, false, "10.0.0.7" };
+    char* out = (char*)steady_arena.allocate(PAYLOAD_MESSAGE_SIZE, 1);
+    if (out && serialize_status(status, out, PAYLOAD_MESSAGE_SIZE) > 0 && !reply.truncated()) {
+        steady_handled++;
+    }
+}
+
+// Куча в установившемся режиме: после разогрева горячий путь (маршрутизация,
+// разбор, ответ, метрики, таймеры) не должен выделять память вообще.
+static bool check_steady_state() {
+    static TopicRouter<8, 16> router;
+    router.add("esp32/wifi", steady_handler);
+    Scheduler<8> jobs(bench_clock);
+    uint32_t fired = 0;
+    jobs.every(5, count_job, &fired);
+    static const char message[] = "{\"ssid\":\"Router-5G\",\"password\":\"correct horse battery\"}";
+
+    const int iterations = 100000;
+    unsigned long before = 0;
+    for (int i = 0; i < iterations * 2; i++) {
+        if (i == iterations) {
+            before = allocations;  // первая половина - разогрев
+        }
+        router.dispatch("esp32/wifi", (const uint8_t*)message, sizeof(message) - 1);
+        bench_latency.observe(i & 1023);
+        bench_clock_ms++;
+        jobs.run();
+    }
+    unsigned long steady = allocations - before;
+    Serial.printf("heap/steady_state: %lu allocations in %d messages, arena high water %u of %u bytes\n",
+                  steady, iterations, (unsigned)steady_arena.highWater(), (unsigned)steady_arena.capacity());
+    return steady == 0 && steady_handled == (uint32_t)iterations * 2;
+}
+
+static void bench_dns() {
+    // A connectivitycheck.gstatic.com с EDNS, как шлёт Android при входе в сеть.
+    static const uint8_t query[] = {
+        0x5a, 0x17, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        17, 'c', 'o', 'n', 'n', 'e', 'c', 't', 'i', 'v', 'i', 't', 'y', 'c', 'h', 'e', 'c', 'k',
+        7, 'g', 's', 't', 'a', 't', 'i', 'c', 3, 'c', 'o', 'm', 0, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    static const uint8_t address[4] = { 192, 168, 4, 1 };
+    DnsAnswer answer;
+    dns_prepare_answer(answer, address);
+
+    bench("dns/build_reply", [&]() {
+        uint8_t reply[DNS_MAX_PACKET];
+        sink += dns_build_reply(query, sizeof(query), answer, reply, sizeof(reply));
+    });
+}
+
+// Сессия провижининга одной пачкой, как её шлёт клиент, приходит кусками
+// по 20 байт (типичный MTU SPP на телефонах).
+static void bench_frames() {
+    static const char* const commands[] = {
+        "{\"ssid\":\"HomeNetwork\",\"password\":\"correct horse battery staple\"}",
+        "{\"host\":\"broker.local\",\"port\":1883}",
+        "greenhouse-01",
+        ""
+    };
+    uint8_t session[512];
+    size_t sessionLength = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        sessionLength += frame_encode(i + 1, i, (const uint8_t*)commands[i], strlen(commands[i]),
+                                      session + sessionLength, sizeof(session) - sessionLength);
+    }
+
+    StaticFrameParser<256> parser;
+    uint32_t frames = 0;
+    bench("frames/session_4_cmds", [&]() {
+        for (size_t offset = 0; offset < sessionLength;) {
+            size_t chunk = sessionLength - offset < 20 ? sessionLength - offset : 20;
+            size_t end = offset + chunk;
+            while (offset < end) {
+                offset += parser.feed(session + offset, end - offset);
+                frames += parser.ready();
+            }
+        }
+    });
+    bench("frames/encode_reply", [&]() {
+        uint8_t result = 0;
+        uint8_t reply[FRAME_OVERHEAD + 1];
+        sink += frame_encode(0x81, 7, &result, 1, reply, sizeof(reply));
+    });
+
+    // Шум без синхробайтов пролистывается memchr.
+    uint8_t noise[256];
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        noise[i] = (uint8_t)(i * 31 + 7) == FRAME_SYNC0 ? 0 : (uint8_t)(i * 31 + 7);
+    }
+    bench("frames/skip_noise_256", [&]() {
+        sink += parser.feed(noise, sizeof(noise));
+    });
+    Serial.printf("frames: session %u bytes, %u frames, %u errors\n", (unsigned)sessionLength,
+                  (unsigned)frames, (unsigned)parser.errors());
+}
+
+// Патч как у небольшой правки кода: вставка в середину сдвигает хвост образа.
+static uint8_t ota_source[65536];
+static uint32_t ota_written = 0;
+
+static bool ota_read(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    memcpy(out, ota_source + offset, length);
+    return true;
+}
+
+static bool ota_write(const uint8_t* data, size_t length, void* context) {
+    ((Sha256*)context)->update(data, length);
+    ota_written += length;
+    return true;
+}
+
+static void put_le32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static void bench_ota() {
+    for (size_t i = 0; i < sizeof(ota_source); i++) {
+        ota_source[i] = (uint8_t)(i * 2654435761u >> 13);
+    }
+
+    uint8_t patch[16 + 9 + 5 + 128 + 9];
+    memcpy(patch, "ODP1", 4);
+    put_le32(patch + 4, sizeof(ota_source));
+    put_le32(patch + 8, crc32(ota_source, sizeof(ota_source)));
+    put_le32(patch + 12, sizeof(ota_source) + 128);
+    uint8_t* op = patch + 16;
+    *op++ = DELTA_OP_COPY;
+    put_le32(op, 0);
+    put_le32(op + 4, 30000);
+    op += 8;
+    *op++ = DELTA_OP_INSERT;
+    put_le32(op, 128);
+    memset(op + 4, 0x5A, 128);
+    op += 4 + 128;
+    *op++ = DELTA_OP_COPY;
+    put_le32(op, 30000);
+    put_le32(op + 4, sizeof(ota_source) - 30000);
+
+    Sha256 sha;
+    uint8_t digest[SHA256_SIZE];
+    bench("ota/sha256_4k", [&]() {
+        sha.reset();
+        sha.update(ota_source, 4096);
+        sha.finish(digest);
+        sink += digest[0];
+    });
+
+    DeltaPatcher patcher(ota_read, ota_write, &sha);
+    bool complete = true;
+    bench("ota/patch_64k", [&]() {
+        patcher.reset();
+        sha.reset();
+        // Кусками по 64 байта, как из чанков MQTT.
+        for (size_t offset = 0; offset < sizeof(patch); offset += 64) {
+            size_t chunk = sizeof(patch) - offset < 64 ? sizeof(patch) - offset : 64;
+            patcher.feed(patch + offset, chunk);
+        }
+        // Остаток проверки исходного образа, как в OtaUpdate::finish().
+        while (!patcher.sourceChecked() && patcher.checkSource() == PatchError::None) {
+        }
+        complete = complete && patcher.complete();
+        sha.finish(digest);
+    });
+    char hex[SHA256_SIZE * 2 + 1];
+    sha256_to_hex(digest, hex);
+    Serial.printf("ota: patch %u bytes -> image %u bytes, %s, sha256 %.16s...\n", (unsigned)sizeof(patch),
+                  (unsigned)patcher.written(), complete ? "complete" : "INCOMPLETE", hex);
+}
+
+// Хаб с 16 узлами по 3 датчика, окно - по 4 пакета от узла.
+static bool gateway_emit(const char* payload, size_t length, void* context) {
+    sink += length;
+    return true;
+}
+
+static void bench_gateway() {
+    uint8_t packets[64][GATEWAY_HEADER_SIZE + 3 * GATEWAY_READING_SIZE];
+    size_t packetLength = 0;
+    for (uint8_t i = 0; i < 64; i++) {
+        uint8_t node[6] = { 0xa4, 0xcf, 0x12, 0x00, 0x00, (uint8_t)(i % 16) };
+        GatewayReading readings[3] = { { 1, 2150 + i }, { 2, 4800 - i }, { 3, 101325 } };
+        packetLength = gateway_encode(node, 1, i / 16, readings, 3, packets[i], sizeof(packets[i]));
+    }
+
+    Gateway gateway(bench_clock);
+    char payload[256];
+    size_t messages = 0;
+    uint16_t round = 0;
+    bench("gateway/ingest_64_flush", [&]() {
+        // Новый seq на каждый круг, иначе всё уйдёт в повторы.
+        for (uint8_t i = 0; i < 64; i++) {
+            packets[i][10] = (uint8_t)(round * 4 + i / 16);
+            packets[i][11] = (uint8_t)((round * 4 + i / 16) >> 8);
+            gateway.ingest(packets[i], packetLength);
+        }
+        round++;
+        messages = gateway.flush(payload, sizeof(payload), gateway_emit, nullptr);
+    });
+    bench("gateway/duplicate", [&]() {
+        sink += (uint32_t)gateway.ingest(packets[0], packetLength);
+    });
+    const GatewayStats& stats = gateway.stats();
+    Serial.printf("gateway: %u nodes, %u messages per window, accepted %u, duplicates %u, dropped %u\n",
+                  (unsigned)gateway.nodes(), (unsigned)messages, (unsigned)stats.accepted,
+                  (unsigned)stats.duplicates, (unsigned)stats.dropped);
+}
+
+// Запись лога с типичными аргументами против того же текста через printf.
+// На плате время уходит не на форматирование, а на UART: 115200 бод -
+// около 87 мкс на символ, поэтому в итог выводится и оценка времени линии.
+static void bench_log() {
+    static const char format[] = "[MQTT] Session with %s:%u (connect %u ms)\n";
+    const uint32_t id = log_hash(format);
+    uint8_t frame[LOG_FRAME_SIZE];
+    unsigned long drained = 0;
+    uint32_t records = 0;
+    bench("log/record_3_args", [&]() {
+        log_write(LOG_LEVEL_INFO, id, "broker.local", 1883u, 42u);
+        if (++records % 16 == 0) {
+            while (size_t length = log_drain(frame, sizeof(frame))) {
+                drained += length;
+            }
+        }
+    });
+    char text[128];
+    int textLength = 0;
+    bench("log/snprintf_3_args", [&]() {
+        textLength = snprintf(text, sizeof(text), format, "broker.local", 1883u, 42u);
+        sink += textLength;
+    });
+    double recordBytes = (double)drained / (records / 16 * 16);
+    Serial.printf("log: %.1f bytes per record vs %d chars, UART %.0f us vs %.0f us, dropped %u\n",
+                  recordBytes, textLength, recordBytes * 86.8, textLength * 86.8, (unsigned)log_dropped());
+}
+
+// Сутки показаний с шагом 10 с (окно публикации watering), метки в секундах
+// с редким сдвигом на секунду: температура с точностью 0.1 (десятичные дроби
+// в float сжимаются хуже всего), средние АЦП влажности (высыхание и полив),
+// расход - нули с редкими всплесками. Блоки по 240 байт, как публикации истории.
+static const size_t TRACE_SAMPLES = 8640;
+static uint32_t trace_time[TRACE_SAMPLES];
+static float trace_values[3][TRACE_SAMPLES];
+
+static void make_traces() {
+    uint32_t time = 1234;
+    float moisture = 1850;
+    for (size_t i = 0; i < TRACE_SAMPLES; i++) {
+        time += i % 47 == 0 ? 11 : 10;
+        trace_time[i] = time;
+        double hour = i / 360.0;
+        trace_values[0][i] = roundf((float)(18 + 6 * sin((hour - 9) * M_PI / 12) + (i * 31 % 5 - 2) * 0.1) * 10) / 10;
+        moisture = i % 2160 == 0 ? 2400 : moisture - 0.12f;
+        trace_values[1][i] = (float)(int)(moisture + (i * 17 % 7) - 3);
+        trace_values[2][i] = i % 2160 < 30 ? (float)(120 + i % 3) : 0;
+    }
+}
+
+static void bench_timeseries() {
+    make_traces();
+    const char* const names[] = { "temperature", "moisture", "flow" };
+    StaticTimeSeriesBlock<240> block;
+    for (size_t s = 0; s < 3; s++) {
+        size_t compressed = 0;
+        size_t json = 0;
+        size_t blocks = 0;
+        block.reset();
+        for (size_t i = 0; i < TRACE_SAMPLES; i++) {
+            if (!block.append(trace_time[i], trace_values[s][i])) {
+                compressed += block.seal();
+                blocks++;
+                block.reset();
+                block.append(trace_time[i], trace_values[s][i]);
+            }
+            char text[48];
+            json += snprintf(text, sizeof(text), "{\"t\":%u,\"v\":%g},", (unsigned)trace_time[i],
+                             trace_values[s][i]);
+        }
+        compressed += block.seal();
+        blocks++;
+        Serial.printf("timeseries/%-12s %u samples: %u bytes in %u blocks (%.2f bytes/sample), "
+                      "raw %u (%.1fx), JSON %u (%.1fx), %.1f h per KB\n",
+                      names[s], (unsigned)TRACE_SAMPLES, (unsigned)compressed, (unsigned)blocks,
+                      (double)compressed / TRACE_SAMPLES, (unsigned)(TRACE_SAMPLES * 8),
+                      TRACE_SAMPLES * 8.0 / compressed, (unsigned)json, (double)json / compressed,
+                      1024.0 / compressed * TRACE_SAMPLES * 10 / 3600);
+    }
+
+    size_t index = 0;
+    bench("timeseries/append", [&]() {
+        if (!block.append(trace_time[index], trace_values[1][index])) {
+            block.reset();
+            block.append(trace_time[index], trace_values[1][index]);
+        }
+        index = (index + 1) % TRACE_SAMPLES;
+    });
+
+    block.reset();
+    for (size_t i = 0; block.append(trace_time[i], trace_values[1][i]); i++) {
+    }
+    size_t length = block.seal();
+    uint16_t count = block.count();
+    bench("timeseries/decode_block", [&]() {
+        TimeSeriesReader reader(block.data(), length);
+        uint32_t time;
+        float value;
+        while (reader.next(time, value)) {
+            sink += time;
+        }
+    });
+    Serial.printf("timeseries: %u samples per %u-byte block\n", (unsigned)count, (unsigned)length);
+}
+
+int main() {
+    Serial.printf("%-34s %16s %18s\n", "benchmark", "time", "allocations");
+    bench_mqtt();
+    bench_router();
+    bench_json();
+    bench_formats();
+    bench_aggregate();
+    bench_scheduler();
+    bench_metrics();
+    bench_dns();
+    bench_frames();
+    bench_ota();
+    bench_gateway();
+    bench_log();
+    bench_timeseries();
+    return check_steady_state() ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include "broker_proxy.hpp"
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+bool BrokerProxy::start(uint16_t listenPort, const char* brokerHost, uint16_t brokerPort) {
+    _listenPort = listenPort;
+    snprintf(_brokerHost, sizeof(_brokerHost), "%s", brokerHost);
+    _brokerPort = brokerPort;
+    for (uint16_t i = 0; i < BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+    for (size_t i = 0; i < FLEET_PROXY_MAX_SESSIONS; i++) {
+        _pairs[i].device = -1;
+        _pairs[i].broker = -1;
+    }
+    if (!listen()) {
+        return false;
+    }
+    _running = true;
+    _thread = std::thread(&BrokerProxy::run, this);
+    return true;
+}
+
+void BrokerProxy::stop() {
+    if (_running.exchange(false)) {
+        _thread.join();
+    }
+    closeAll();
+    if (_listener >= 0) {
+        close(_listener);
+        _listener = -1;
+    }
+}
+
+void BrokerProxy::outage(uint32_t durationMs) {
+    _outageUntil = millis() + durationMs;
+    _outageRequested = true;
+}
+
+uint32_t BrokerProxy::peakPerSecond(unsigned long fromMs, unsigned long toMs) const {
+    const uint16_t window = 1000 / BUCKET_MS;
+    size_t first = fromMs / BUCKET_MS;
+    size_t last = toMs / BUCKET_MS + 1;
+    if (last > BUCKETS) {
+        last = BUCKETS;
+    }
+    uint32_t peak = 0;
+    uint32_t sum = 0;
+    for (size_t i = first; i < last; i++) {
+        sum += _buckets[i];
+        if (i >= first + window) {
+            sum -= _buckets[i - window];
+        }
+        if (sum > peak) {
+            peak = sum;
+        }
+    }
+    return peak;
+}
+
+bool BrokerProxy::listen() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(_listenPort);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || ::listen(fd, 1024) < 0) {
+        close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    _listener = fd;
+    return true;
+}
+
+void BrokerProxy::closeAll() {
+    for (size_t i = 0; i < FLEET_PROXY_MAX_SESSIONS; i++) {
+        if (_pairs[i].device >= 0) {
+            close(_pairs[i].device);
+            close(_pairs[i].broker);
+            _pairs[i].device = -1;
+            _pairs[i].broker = -1;
+        }
+    }
+    _sessions = 0;
+}
+
+// Подключение к брокеру синхронное: брокер локальный, это доли миллисекунды.
+static int connect_broker(const char* host, uint16_t port) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) {
+        return -1;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+    return fd;
+}
+
+// Пишет всё: сокеты блокирующие, брокер и устройства читают без задержек.
+static bool forward(int from, int to) {
+    uint8_t buffer[4096];
+    ssize_t length = recv(from, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return false;
+    }
+    for (ssize_t sent = 0; sent < length;) {
+        ssize_t rc = send(to, buffer + sent, length - sent, MSG_NOSIGNAL);
+        if (rc <= 0) {
+            return false;
+        }
+        sent += rc;
+    }
+    return true;
+}
+
+void BrokerProxy::run() {
+    std::vector<struct pollfd> fds;
+    std::vector<size_t> owners;
+    while (_running) {
+        if (_outageRequested.exchange(false)) {
+            // Как при перезапуске брокера: сессии рвутся, порт закрыт.
+            closeAll();
+            close(_listener);
+            _listener = -1;
+        }
+        if (_listener < 0 && (long)(millis() - _outageUntil) >= 0 && !listen()) {
+            delay(10);
+            continue;
+        }
+
+        fds.clear();
+        owners.clear();
+        if (_listener >= 0) {
+            fds.push_back({ _listener, POLLIN, 0 });
+            owners.push_back(SIZE_MAX);
+        }
+        for (size_t i = 0; i < FLEET_PROXY_MAX_SESSIONS; i++) {
+            if (_pairs[i].device >= 0) {
+                fds.push_back({ _pairs[i].device, POLLIN, 0 });
+                owners.push_back(i);
+                fds.push_back({ _pairs[i].broker, POLLIN, 0 });
+                owners.push_back(i);
+            }
+        }
+        if (poll(fds.data(), fds.size(), 10) <= 0) {
+            continue;
+        }
+
+        for (size_t f = 0; f < fds.size(); f++) {
+            if (!fds[f].revents) {
+                continue;
+            }
+            if (owners[f] == SIZE_MAX) {
+                int device;
+                while ((device = accept(_listener, nullptr, nullptr)) >= 0) {
+                    size_t bucket = millis() / BUCKET_MS;
+                    if (bucket < BUCKETS) {
+                        _buckets[bucket]++;
+                    }
+                    _accepted++;
+                    Pair* slot = nullptr;
+                    for (size_t i = 0; i < FLEET_PROXY_MAX_SESSIONS && !slot; i++) {
+                        slot = _pairs[i].device < 0 ? &_pairs[i] : nullptr;
+                    }
+                    int broker = slot ? connect_broker(_brokerHost, _brokerPort) : -1;
+                    if (broker < 0) {
+                        close(device);
+                        continue;
+                    }
+                    int flag = 1;
+                    setsockopt(device, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+                    slot->device = device;
+                    slot->broker = broker;
+                    _sessions++;
+                }
+                continue;
+            }
+            Pair& pair = _pairs[owners[f]];
+            if (pair.device < 0) {
+                continue;  // закрыта при разборе второго сокета пары
+            }
+            bool fromDevice = fds[f].fd == pair.device;
+            if (!forward(fds[f].fd, fromDevice ? pair.broker : pair.device)) {
+                close(pair.device);
+                close(pair.broker);
+                pair.device = -1;
+                pair.broker = -1;
+                _sessions--;
+            }
+        }
+    }
+}
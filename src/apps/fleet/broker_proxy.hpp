@@ -0,0 +1,58 @@
+#ifndef BROKER_PROXY_HPP
+#define BROKER_PROXY_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#ifndef FLEET_PROXY_MAX_SESSIONS
+#define FLEET_PROXY_MAX_SESSIONS 1024
+#endif
+
+// TCP-прокси между виртуальными устройствами и брокером. Через него
+// имитируется перезапуск брокера: все сессии рвутся, новые подключения
+// отклоняются, пока не кончится простой. Заодно считает принятые
+// подключения по 100 мс - это нагрузка, которую видит брокер.
+class BrokerProxy {
+public:
+    static const uint16_t BUCKETS = 6000;  // 10 минут по 100 мс
+    static const uint16_t BUCKET_MS = 100;
+
+    ~BrokerProxy() { stop(); }
+
+    bool start(uint16_t listenPort, const char* brokerHost, uint16_t brokerPort);
+    void stop();
+
+    // Разорвать все сессии и не принимать подключения durationMs.
+    void outage(uint32_t durationMs);
+
+    // Наибольшее число подключений за скользящую секунду в [fromMs, toMs].
+    uint32_t peakPerSecond(unsigned long fromMs, unsigned long toMs) const;
+    uint32_t accepted() const { return _accepted; }
+    uint32_t sessions() const { return _sessions; }
+
+private:
+    void run();
+    bool listen();
+    void closeAll();
+
+    struct Pair {
+        int device;
+        int broker;
+    };
+
+    uint16_t _listenPort = 0;
+    char _brokerHost[64];
+    uint16_t _brokerPort = 0;
+    int _listener = -1;
+    Pair _pairs[FLEET_PROXY_MAX_SESSIONS];
+    std::atomic<uint32_t> _sessions{0};
+    std::atomic<uint32_t> _accepted{0};
+    std::atomic<uint32_t> _buckets[BUCKETS];
+    std::atomic<unsigned long> _outageUntil{0};
+    std::atomic<bool> _outageRequested{false};
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+};
+
+#endif
@@ -0,0 +1,403 @@
+// Симулятор парка для env:fleet: N виртуальных устройств с настоящими Auth и
+// MQTT работают против локального брокера (mosquitto) через BrokerProxy.
+//   pio run -e fleet -t exec
+//   .pio/build/fleet/program --devices 500 --broker 127.0.0.1 --port 1883
+// С --tls-ca - по TLS к листенеру mosquitto на 8883 (сертификаты в DER):
+//   .pio/build/fleet/program --devices 200 --port 8883 --tls-ca ca.der --tls-name localhost
+//
+// Сценарий: холодный старт всего парка, ровная нагрузка с обрывами WiFi,
+// перезапуск брокера. Печатает пик подключений в секунду, процентили времени
+// восстановления и поток сообщений, дошедших до брокера.
+//
+// Что не моделируется: код приложений (watering, messaging, web_config) не
+// запускается - он построен на глобальных объектах и setup()/loop() и в одном
+// процессе существует в одном экземпляре. Виртуальное устройство - это Auth,
+// MQTT и телеметрия по таймеру; все устройства обслуживает один поток по
+// кругу (свой поток только у прокси), а не задачи FreeRTOS на двух ядрах.
+// Поэтому цифры говорят о брокере, backoff и переподключениях, а не о
+// нагрузке на loop() приложения.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../../../lib/MQTT/src/mqtt.hpp"
+#include "../../shared/auth.hpp"
+#include "broker_proxy.hpp"
+
+struct FleetOptions {
+    unsigned devices = 100;
+    const char* broker = "127.0.0.1";
+    uint16_t port = 1883;
+    uint16_t proxyPort = 18830;
+    uint32_t publishMs = 1000;      // телеметрия с каждого устройства
+    uint8_t qos = 1;
+    uint32_t steadyS = 20;
+    uint32_t outageMs = 5000;       // простой брокера при перезапуске
+    uint32_t flapsPerHour = 6;      // обрывов WiFi на устройство в час
+    uint32_t recoverS = 180;        // сколько ждать восстановления всех
+    const char* tlsCa = nullptr;    // DER; задан - все сессии по TLS
+    const char* tlsCert = nullptr;
+    const char* tlsKey = nullptr;
+    const char* tlsName = nullptr;  // имя в сертификате брокера
+};
+
+enum class Cause : uint8_t {
+    Boot,
+    WiFi,
+    Broker
+};
+
+struct VirtualDevice {
+    WiFiStation station;
+    Auth auth{"fleet", "fleet-password"};
+    MQTT mqtt;
+    char clientId[24];
+    char telemetryTopic[40];
+    char commandFilter[40];
+    bool online = false;
+    Cause cause = Cause::Boot;
+    unsigned long lostAt = 0;
+    unsigned long nextPublish = 0;
+    unsigned long linkDownUntil = 0;
+    unsigned long nextFlapCheck = 0;
+    uint32_t sequence = 0;
+};
+
+static FleetOptions options;
+static TlsConfig tls;
+static std::vector<std::unique_ptr<VirtualDevice>> fleet;
+static std::vector<uint32_t> recovery[3];  // по Cause, мс
+static uint32_t delivered = 0;
+static uint32_t published = 0;
+static std::mt19937 flapRandom(12345);
+
+static void on_command(const char*, const uint8_t*, unsigned int, void*) {}
+
+static void on_telemetry(const char*, const uint8_t*, unsigned int, void*) {
+    delivered++;
+}
+
+static void start_device(VirtualDevice& device, unsigned index) {
+    snprintf(device.clientId, sizeof(device.clientId), "fleet-%05u", index);
+    snprintf(device.telemetryTopic, sizeof(device.telemetryTopic), "fleet/%s/telemetry", device.clientId);
+    snprintf(device.commandFilter, sizeof(device.commandFilter), "fleet/%s/cmd", device.clientId);
+    WiFi.select(&device.station);
+    device.mqtt.setClientId(device.clientId);
+    if (tls.ready()) {
+        device.mqtt.setTls(&tls);
+    }
+    device.mqtt.addBroker("127.0.0.1", options.proxyPort);
+    device.mqtt.on(device.commandFilter, on_command);
+    device.mqtt.setAuthInstance(&device.auth);
+    device.auth.connect_wifi();
+    device.mqtt.connect();
+    // Устройства включаются в разное время в пределах публикации.
+    device.nextPublish = millis() + esp_random() % options.publishMs;
+}
+
+static void step_device(VirtualDevice& device, unsigned long now, bool outage, uint32_t flapChance) {
+    WiFi.select(&device.station);
+
+    if (device.linkDownUntil && (long)(now - device.linkDownUntil) >= 0) {
+        device.linkDownUntil = 0;
+        WiFi.setLinkUp(true);
+    } else if (flapChance && device.online && (long)(now - device.nextFlapCheck) >= 0) {
+        device.nextFlapCheck = now + 1000;
+        if (flapRandom() % flapChance == 0) {
+            device.linkDownUntil = now + 2000 + flapRandom() % 8000;
+            WiFi.setLinkUp(false);
+        }
+    }
+
+    device.auth.loop_wifi();
+    device.mqtt.receive_message();
+
+    bool online = device.mqtt.is_connected();
+    if (online != device.online) {
+        if (online) {
+            recovery[(uint8_t)device.cause].push_back(now - device.lostAt);
+        } else {
+            device.lostAt = now;
+            device.cause = device.linkDownUntil ? Cause::WiFi : outage ? Cause::Broker : Cause::WiFi;
+        }
+        device.online = online;
+    }
+
+    if (online && (long)(now - device.nextPublish) >= 0) {
+        char payload[48];
+        int length = snprintf(payload, sizeof(payload), "{\"seq\":%u,\"t\":%lu}", (unsigned)device.sequence++, now);
+        if (device.mqtt.publish(device.telemetryTopic, (const uint8_t*)payload, length, options.qos)) {
+            published++;
+        }
+        device.nextPublish += options.publishMs;
+    }
+}
+
+static unsigned count_online() {
+    unsigned online = 0;
+    for (auto& device : fleet) {
+        online += device->online;
+    }
+    return online;
+}
+
+// Все устройства по кругу; монитор тикает чаще, чтобы не стать узким местом.
+static void run_for(MQTT& monitor, Auth& monitorAuth, WiFiStation& monitorStation, uint32_t durationMs,
+                    bool outage, uint32_t flapChance, bool untilAllOnline) {
+    unsigned long until = millis() + durationMs;
+    while ((long)(millis() - until) < 0) {
+        unsigned long now = millis();
+        for (auto& device : fleet) {
+            step_device(*device, now, outage, flapChance);
+        }
+        WiFi.select(&monitorStation);
+        monitorAuth.loop_wifi();
+        for (int i = 0; i < 8; i++) {
+            monitor.receive_message();
+        }
+        if (untilAllOnline && count_online() == fleet.size()) {
+            return;
+        }
+        delay(1);
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, unsigned pct) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() - 1) * pct / 100;
+    return values[index];
+}
+
+static void report_recovery(const char* name, std::vector<uint32_t>& values) {
+    printf("  %-22s n=%-5u p50 %6u ms  p90 %6u ms  p99 %6u ms  max %6u ms\n", name, (unsigned)values.size(),
+           (unsigned)percentile(values, 50), (unsigned)percentile(values, 90), (unsigned)percentile(values, 99),
+           (unsigned)percentile(values, 100));
+}
+
+static void report_tls() {
+    TlsStats total = {};
+    for (auto& device : fleet) {
+        const TlsStats& stats = device->mqtt.tlsStats();
+        total.handshakes += stats.handshakes;
+        total.resumed += stats.resumed;
+        total.failures += stats.failures;
+        total.fullCpuUs += stats.fullCpuUs;
+        total.resumedCpuUs += stats.resumedCpuUs;
+    }
+    uint32_t full = total.handshakes - total.resumed;
+    printf("TLS: %u full handshakes, %.2f ms CPU each; %u resumed, %.2f ms CPU each; %u failed\n",
+           (unsigned)full, full ? total.fullCpuUs / 1000.0 / full : 0.0, (unsigned)total.resumed,
+           total.resumed ? total.resumedCpuUs / 1000.0 / total.resumed : 0.0, (unsigned)total.failures);
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + length);
+    }
+    fclose(file);
+    return !data.empty();
+}
+
+// Сертификаты на хосте - из файлов DER, на плате те же байты лежат во flash.
+static bool setup_tls() {
+    static std::vector<uint8_t> ca, certificate, key;
+    TlsCredentials credentials;
+    if (!read_file(options.tlsCa, ca)) {
+        return false;
+    }
+    credentials.caCert = ca.data();
+    credentials.caCertLength = ca.size();
+    if (options.tlsCert) {
+        if (!options.tlsKey || !read_file(options.tlsCert, certificate) || !read_file(options.tlsKey, key)) {
+            return false;
+        }
+        credentials.clientCert = certificate.data();
+        credentials.clientCertLength = certificate.size();
+        credentials.clientKey = key.data();
+        credentials.clientKeyLength = key.size();
+    }
+    credentials.serverName = options.tlsName;
+    return tls.begin(credentials);
+}
+
+static void usage() {
+    printf("usage: fleet [--devices N] [--broker HOST] [--port P] [--proxy-port P] [--publish-ms MS]\n"
+           "             [--qos 0|1] [--steady S] [--outage-ms MS] [--flaps-per-hour N] [--recover S]\n"
+           "             [--tls-ca CA.der [--tls-cert CERT.der --tls-key KEY.der] [--tls-name NAME]]\n");
+}
+
+static bool parse_options(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        unsigned long number = strtoul(value, nullptr, 10);
+        if (strcmp(name, "--devices") == 0) {
+            options.devices = number;
+        } else if (strcmp(name, "--broker") == 0) {
+            options.broker = value;
+        } else if (strcmp(name, "--port") == 0) {
+            options.port = number;
+        } else if (strcmp(name, "--proxy-port") == 0) {
+            options.proxyPort = number;
+        } else if (strcmp(name, "--publish-ms") == 0) {
+            options.publishMs = number ? number : 1;
+        } else if (strcmp(name, "--qos") == 0) {
+            options.qos = number ? 1 : 0;
+        } else if (strcmp(name, "--steady") == 0) {
+            options.steadyS = number;
+        } else if (strcmp(name, "--outage-ms") == 0) {
+            options.outageMs = number;
+        } else if (strcmp(name, "--flaps-per-hour") == 0) {
+            options.flapsPerHour = number;
+        } else if (strcmp(name, "--recover") == 0) {
+            options.recoverS = number;
+        } else if (strcmp(name, "--tls-ca") == 0) {
+            options.tlsCa = value;
+        } else if (strcmp(name, "--tls-cert") == 0) {
+            options.tlsCert = value;
+        } else if (strcmp(name, "--tls-key") == 0) {
+            options.tlsKey = value;
+        } else if (strcmp(name, "--tls-name") == 0) {
+            options.tlsName = value;
+        } else {
+            return false;
+        }
+    }
+    return options.devices > 0 && options.devices <= FLEET_PROXY_MAX_SESSIONS;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_options(argc, argv)) {
+        usage();
+        return 2;
+    }
+
+    if (options.tlsCa && !setup_tls()) {
+        printf("Cannot load TLS credentials\n");
+        return 1;
+    }
+
+    BrokerProxy proxy;
+    if (!proxy.start(options.proxyPort, options.broker, options.port)) {
+        printf("Cannot listen on 127.0.0.1:%u\n", (unsigned)options.proxyPort);
+        return 1;
+    }
+
+    // Сотни устройств пишут в Serial: на хосте это только шум.
+    Serial.setOutput(nullptr);
+
+    // Монитор подключён к брокеру напрямую и считает дошедшую телеметрию.
+    WiFiStation monitorStation;
+    WiFi.select(&monitorStation);
+    Auth monitorAuth("fleet", "fleet-password");
+    MQTT monitor;
+    char monitorId[24];
+    snprintf(monitorId, sizeof(monitorId), "fleet-monitor-%u", (unsigned)(esp_random() % 100000));
+    monitor.setClientId(monitorId);
+    if (tls.ready()) {
+        monitor.setTls(&tls);
+    }
+    monitor.addBroker(options.broker, options.port);
+    monitor.on("fleet/+/telemetry", on_telemetry);
+    monitor.setAuthInstance(&monitorAuth);
+    monitorAuth.connect_wifi();
+    monitor.connect();
+    for (unsigned long until = millis() + 5000; !monitor.is_connected() && (long)(millis() - until) < 0;) {
+        monitorAuth.loop_wifi();
+        monitor.receive_message();
+        delay(1);
+    }
+    if (!monitor.is_connected()) {
+        printf("Broker %s:%u is not reachable\n", options.broker, (unsigned)options.port);
+        return 1;
+    }
+
+    printf("fleet: %u devices -> proxy :%u -> broker %s:%u%s, publish every %u ms, QoS %u, backoff %u..%u ms\n",
+           options.devices, (unsigned)options.proxyPort, options.broker, (unsigned)options.port,
+           tls.ready() ? " (TLS)" : "",
+           (unsigned)options.publishMs, (unsigned)options.qos, (unsigned)MQTT_BACKOFF_BASE_MS,
+           (unsigned)MQTT_BACKOFF_MAX_MS);
+
+    // 1. Холодный старт: весь парк включается одновременно.
+    unsigned long phaseStart = millis();
+    fleet.reserve(options.devices);
+    for (unsigned i = 0; i < options.devices; i++) {
+        fleet.emplace_back(new VirtualDevice());
+        start_device(*fleet.back(), i);
+        fleet.back()->lostAt = phaseStart;
+    }
+    run_for(monitor, monitorAuth, monitorStation, options.recoverS * 1000, false, 0, true);
+    unsigned long phaseEnd = millis();
+    printf("\ncold start: %u/%u online after %lu ms, peak %u connects/s\n", count_online(), options.devices,
+           phaseEnd - phaseStart, (unsigned)proxy.peakPerSecond(phaseStart, phaseEnd));
+    report_recovery("time to first session", recovery[(uint8_t)Cause::Boot]);
+
+    // 2. Ровная нагрузка с обрывами WiFi: раз в секунду каждое устройство
+    // теряет связь с шансом 1/flapChance, в среднем flapsPerHour раз в час.
+    uint32_t flapChance = 0;
+    if (options.flapsPerHour) {
+        flapChance = 3600 / std::min<uint32_t>(options.flapsPerHour, 3600);
+    }
+    uint32_t deliveredBefore = delivered;
+    uint32_t publishedBefore = published;
+    phaseStart = millis();
+    run_for(monitor, monitorAuth, monitorStation, options.steadyS * 1000, false, flapChance, false);
+    phaseEnd = millis();
+    double seconds = (phaseEnd - phaseStart) / 1000.0;
+    printf("\nsteady %u s: published %.0f msg/s, delivered %.0f msg/s (expected %.0f), %u/%u online\n",
+           (unsigned)options.steadyS, (published - publishedBefore) / seconds,
+           (delivered - deliveredBefore) / seconds, options.devices * 1000.0 / options.publishMs,
+           count_online(), options.devices);
+    report_recovery("WiFi drop", recovery[(uint8_t)Cause::WiFi]);
+
+    // 3. Перезапуск брокера: все сессии рвутся, устройства возвращаются по backoff.
+    // Дожидаемся и устройств, у которых в этот момент ещё лежит WiFi.
+    for (auto& device : fleet) {
+        if (device->linkDownUntil) {
+            WiFi.select(&device->station);
+            WiFi.setLinkUp(true);
+            device->linkDownUntil = 0;
+        }
+    }
+    phaseStart = millis();
+    proxy.outage(options.outageMs);
+    run_for(monitor, monitorAuth, monitorStation, options.outageMs, true, 0, false);
+    run_for(monitor, monitorAuth, monitorStation, options.recoverS * 1000, true, 0, true);
+    phaseEnd = millis();
+    printf("\nbroker restart (%u ms down): %u/%u online after %lu ms, peak %u connects/s\n",
+           (unsigned)options.outageMs, count_online(), options.devices, phaseEnd - phaseStart,
+           (unsigned)proxy.peakPerSecond(phaseStart, phaseEnd));
+    report_recovery("broker restart", recovery[(uint8_t)Cause::Broker]);
+
+    uint32_t queued = 0;
+    uint32_t inflight = 0;
+    uint32_t dropped = 0;
+    for (auto& device : fleet) {
+        queued += device->mqtt.queueDepth();
+        inflight += device->mqtt.inflight();
+        dropped += device->mqtt.outboundStats().dropped;
+    }
+    printf("\ntotals: %u TCP connects, %u published, %u delivered, %u queued, %u unacked, %u dropped\n",
+           (unsigned)proxy.accepted(), (unsigned)published, (unsigned)delivered, (unsigned)queued,
+           (unsigned)inflight, (unsigned)dropped);
+    if (tls.ready()) {
+        report_tls();
+    }
+
+    proxy.stop();
+    return count_online() == fleet.size() ? 0 : 1;
+}
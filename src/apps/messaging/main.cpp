@@ -1,12 +1,47 @@
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include <WiFi.h>
 #include "BluetoothSerial.h"
+#include "../../shared/auth.hpp"
+#include "../../shared/binlog.hpp"
+#include "../../shared/payloads.hpp"
+#include "../../shared/scheduler.hpp"
+#include "../../shared/frame_parser.hpp"
+#include "../../shared/device_config.hpp"
+#include "../../shared/fixed_string.hpp"
+
+// Имя Bluetooth, пока его не задали командой DeviceName.
+#ifndef MESSAGING_DEVICE_NAME
+#define MESSAGING_DEVICE_NAME "ESP32_Config"
+#endif
 
 BluetoothSerial SerialBT;
+Auth auth("", "");
+Scheduler<4> jobs(millis);
+TaskHandle_t loopTask = nullptr;
+
+// Сеть, имя и брокер переживают перезагрузку; брокер пока только
+// запоминается: в этом приложении MQTT нет.
+DeviceConfigStore config(DEVICE_CONFIG_SCHEMA, DEVICE_CONFIG_DEFAULTS, millis);
+
+// Кадры провижининга копятся между вызовами loop(), см. ProvisionCommand;
+// недописанный кадр отбрасывается через FRAME_TIMEOUT_MS.
+StaticFrameParser<PROVISION_MAX_PAYLOAD> btFrames(millis);
+uint32_t btFrameErrors = 0;
+
+// Старые клиенты шлют строку JSON с учётными данными до '\n'. Сессия, чей
+// первый значащий байт '{', разбирается построчно, иначе - кадрами.
+#ifndef BT_LINE_SIZE
+#define BT_LINE_SIZE 160
+#endif
+
+enum BtProtocol {
+  BT_DETECT,
+  BT_FRAMES,
+  BT_LINES
+};
 
-String ssid = "";
-String password = "";
+BtProtocol btProtocol = BT_DETECT;
+FixedString<BT_LINE_SIZE> btLine; // копится между вызовами loop() до '\n'
 
 enum SystemState {
   STATE_WIFI_CONNECTING,
@@ -16,13 +51,43 @@ enum SystemState {
 };
 
 SystemState currentState = STATE_WIFI_CONNECTING;
-unsigned long lastStateChange = 0;
-unsigned long lastWiFiCheck = 0;
+JobId stateJob = NO_JOB; // периодическая задача текущего состояния
 bool btInitialized = false;
 
+void runMainWork(void* context) {
+  // WiFi is connected - do your main work here
+  LOG_INFO("[MAIN] WiFi OK - Running main code...\n");
+
+  // YOUR MQTT CODE GOES HERE
+  // Example: mqtt.loop(); mqtt.publish(); etc.
+}
+
+void remindWaiting(void* context) {
+  LOG_INFO("[BT] Still waiting for client...\n");
+}
+
+// Смена состояния заменяет его периодическую задачу.
+void setState(SystemState state) {
+  currentState = state;
+  jobs.cancel(stateJob);
+  stateJob = NO_JOB;
+  if (state == STATE_WIFI_CONNECTED) {
+    stateJob = jobs.every(5000, runMainWork, nullptr, 1);
+  } else if (state == STATE_BT_WAITING) {
+    stateJob = jobs.every(10000, remindWaiting);
+  }
+}
+
+// События SPP (подключение, данные, отключение) будят loop().
+void onBluetoothEvent(esp_spp_cb_event_t event, esp_spp_cb_param_t* param) {
+  if (loopTask) {
+    xTaskNotifyGive(loopTask);
+  }
+}
+
 void stopBluetooth() {
   if (btInitialized) {
-    Serial.println("[BT] Stopping Bluetooth...");
+    LOG_INFO("[BT] Stopping Bluetooth...\n");
     SerialBT.end();
     btInitialized = false;
     delay(1000); // Give time to properly stop
@@ -31,69 +96,149 @@ void stopBluetooth() {
 
 void startBluetooth() {
   if (!btInitialized) {
-    Serial.println("[BT] Starting Bluetooth...");
+    LOG_INFO("[BT] Starting Bluetooth...\n");
     WiFi.mode(WIFI_OFF); // Ensure WiFi is off
     delay(500);
     
-    if (SerialBT.begin("ESP32_Config")) {
-      Serial.println("[BT] Bluetooth started successfully");
+    const char* name = config->deviceName[0] ? config->deviceName : MESSAGING_DEVICE_NAME;
+    if (SerialBT.begin(name)) {
+      LOG_INFO("[BT] Bluetooth started successfully\n");
       btInitialized = true;
-      currentState = STATE_BT_WAITING;
-      lastStateChange = millis();
+      setState(STATE_BT_WAITING);
     } else {
-      Serial.println("[BT] Failed to start Bluetooth");
+      LOG_WARN("[BT] Failed to start Bluetooth\n");
       delay(2000);
     }
   }
 }
 
+// Только запускает подключение: результат разбирается в loop() по auth.state().
 bool connectWiFi() {
-  if (ssid.length() == 0) {
-    Serial.println("[WiFi] No SSID provided");
+  if (config->wifiSsid[0] == '\0') {
+    LOG_WARN("[WiFi] No SSID provided\n");
     return false;
   }
 
   stopBluetooth(); // Ensure Bluetooth is stopped
   
-  Serial.println("[WiFi] Starting WiFi connection...");
-  Serial.print("[WiFi] SSID: ");
-  Serial.println(ssid);
-  
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid.c_str(), password.c_str());
-  
-  currentState = STATE_WIFI_CONNECTING;
-  lastStateChange = millis();
+  LOG_INFO("[WiFi] Starting WiFi connection...\n");
+  auth.setCredentials(config->wifiSsid, config->wifiPassword);
+  auth.connect_wifi();
   
-  unsigned long start = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - start < 15000) {
-    delay(500);
-    Serial.print(".");
-    
-    // Feed watchdog
-    yield();
-    
-    // Check for timeout
-    if (millis() - start > 15000) {
-      break;
+  setState(STATE_WIFI_CONNECTING);
+  return true;
+}
+
+void sendProvisionReply(uint8_t type, uint8_t sequence, ProvisionResult result) {
+  uint8_t payload = (uint8_t)result;
+  uint8_t frame[FRAME_OVERHEAD + 1];
+  size_t length = frame_encode(type | PROVISION_REPLY, sequence, &payload, 1, frame, sizeof(frame));
+  SerialBT.write(frame, length);
+}
+
+ProvisionResult applyCredentials(const char* json, size_t length) {
+  WiFiCredentials credentials;
+  JsonError error = parse_wifi_credentials(json, length, credentials);
+  if (error != JsonError::Ok) {
+    LOG_WARN("[BT] Credentials rejected: %s\n", json_error_name(error));
+    return ProvisionResult::BadPayload;
+  }
+  if (credentials.ssid[0] == '\0') {
+    LOG_WARN("[BT] Credentials rejected: empty SSID\n");
+    return ProvisionResult::BadPayload;
+  }
+  config.setString(CONFIG_WIFI_SSID, credentials.ssid);
+  config.setString(CONFIG_WIFI_PASSWORD, credentials.password);
+  LOG_INFO("[BT] SSID: %s, password: [HIDDEN]\n", config->wifiSsid);
+  return ProvisionResult::Ok;
+}
+
+ProvisionResult applyBrokerConfig(const char* json, size_t length) {
+  BrokerConfig broker;
+  JsonError error = parse_broker_config(json, length, broker);
+  if (error != JsonError::Ok || broker.host[0] == '\0') {
+    LOG_WARN("[BT] Broker config rejected: %s\n", json_error_name(error));
+    return ProvisionResult::BadPayload;
+  }
+  config.setString(CONFIG_BROKER_HOST, broker.host);
+  config.setUint(CONFIG_BROKER_PORT, broker.port);
+  LOG_INFO("[BT] Broker: %s:%u\n", broker.host, (unsigned)broker.port);
+  return ProvisionResult::Ok;
+}
+
+// Имя применяется при следующем запуске Bluetooth.
+ProvisionResult applyDeviceName(const uint8_t* name, size_t length) {
+  char deviceName[PAYLOAD_DEVICE_NAME_SIZE];
+  if (length == 0 || length >= sizeof(deviceName)) {
+    return ProvisionResult::BadPayload;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] < 0x20 || name[i] > 0x7E) {
+      return ProvisionResult::BadPayload;
     }
   }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println();
-    Serial.println("[WiFi] Connected successfully!");
-    Serial.print("[WiFi] IP: ");
-    Serial.println(WiFi.localIP());
-    currentState = STATE_WIFI_CONNECTED;
-    lastStateChange = millis();
-    return true;
-  } else {
-    Serial.println();
-    Serial.println("[WiFi] Connection failed");
-    WiFi.disconnect(true);
-    WiFi.mode(WIFI_OFF);
-    delay(1000);
-    return false;
+  memcpy(deviceName, name, length);
+  deviceName[length] = '\0';
+  config.setString(CONFIG_DEVICE_NAME, deviceName);
+  LOG_INFO("[BT] Device name: %s\n", deviceName);
+  return ProvisionResult::Ok;
+}
+
+// Строка старого протокола: только учётные данные, сразу с подключением.
+void handleBluetoothLine() {
+  btLine.trim();
+  if (btLine.empty()) {
+    return;
+  }
+  if (btLine.truncated()) {
+    LOG_WARN("[BT] Line too long, ignored\n");
+    SerialBT.println("ERROR: Message too long");
+    return;
+  }
+  if (applyCredentials(btLine.c_str(), btLine.length()) != ProvisionResult::Ok) {
+    SerialBT.println("ERROR: Expected {\"ssid\":\"YourWiFi\",\"password\":\"YourPassword\"}");
+    return;
+  }
+  SerialBT.println("Credentials received! Attempting WiFi connection...");
+  SerialBT.flush();
+  config.commit();
+  connectWiFi();
+}
+
+// Один собранный кадр. Команды независимы: клиент шлёт их пачкой и
+// сопоставляет ответы по seq.
+void handleProvisionFrame() {
+  uint8_t type = btFrames.type();
+  const uint8_t* payload = btFrames.payload();
+  size_t length = btFrames.length();
+  ProvisionResult result;
+
+  switch ((ProvisionCommand)type) {
+    case ProvisionCommand::WiFiCredentials:
+      result = applyCredentials((const char*)payload, length);
+      break;
+    case ProvisionCommand::BrokerConfig:
+      result = applyBrokerConfig((const char*)payload, length);
+      break;
+    case ProvisionCommand::DeviceName:
+      result = applyDeviceName(payload, length);
+      break;
+    case ProvisionCommand::Apply:
+      result = config->wifiSsid[0] == '\0' ? ProvisionResult::NotReady : ProvisionResult::Ok;
+      break;
+    default:
+      LOG_WARN("[BT] Unknown command 0x%02X\n", type);
+      result = ProvisionResult::Unsupported;
+      break;
+  }
+  sendProvisionReply(type, btFrames.sequence(), result);
+
+  if ((ProvisionCommand)type == ProvisionCommand::Apply && result == ProvisionResult::Ok) {
+    LOG_INFO("[BT] Applying settings, attempting WiFi connection...\n");
+    SerialBT.flush();
+    config.commit(); // настройки на flash до подключения, не дожидаясь паузы
+    // Bluetooth will be stopped in connectWiFi(), the result arrives in STATE_WIFI_CONNECTING
+    connectWiFi();
   }
 }
 
@@ -101,161 +246,152 @@ void setup() {
   Serial.begin(115200);
   delay(2000); // Give serial monitor time to connect
   
-  Serial.println();
-  Serial.println("=== ESP32 Starting ===");
-  Serial.println("Free heap: " + String(ESP.getFreeHeap()));
-  
-  // Set default credentials (change these to your router)
-  ssid = "Router";
-  password = "defaultPassword";
+  LOG_INFO("=== ESP32 Starting ===\n");
+  LOG_INFO("Free heap: %u\n", (unsigned)ESP.getFreeHeap());
   
+  // Сохранённые при провижининге настройки; без них сразу Bluetooth.
+  config.begin();
+  auth.setReconnectInterval(config->wifiReconnectMs);
+
+  // loop() спит до ближайшего таймера или до события WiFi/Bluetooth
+  loopTask = xTaskGetCurrentTaskHandle();
+  auth.wakeOnEvent(loopTask);
+  SerialBT.register_callback(onBluetoothEvent);
+
   // Try to connect to WiFi first
+  auth.setConnectTimeout(15000);
   if (!connectWiFi()) {
-    Serial.println("[MAIN] WiFi connection failed, starting Bluetooth...");
+    LOG_INFO("[MAIN] No WiFi credentials, starting Bluetooth...\n");
     startBluetooth();
   }
   
-  Serial.println("=== Setup Complete ===");
+  LOG_INFO("=== Setup Complete ===\n");
 }
 
 void loop() {
-  // Essential: Feed the watchdog timer
-  yield();
-  delay(50); // Minimum delay to prevent tight loops
-  
-  unsigned long now = millis();
-  
   switch (currentState) {
     case STATE_WIFI_CONNECTING:
-      // This state is handled in connectWiFi() function
-      // If we're here, connection failed
-      Serial.println("[MAIN] WiFi connection timeout, switching to Bluetooth");
-      startBluetooth();
+      auth.loop_wifi();
+      if (auth.state() == WiFiState::Connected) {
+        LOG_INFO("[WiFi] Connected successfully!\n");
+        setState(STATE_WIFI_CONNECTED);
+      } else if (auth.state() == WiFiState::Failed) {
+        LOG_WARN("[MAIN] WiFi connection failed, switching to Bluetooth\n");
+        auth.disconnect_wifi();
+        startBluetooth();
+      }
       break;
       
     case STATE_WIFI_CONNECTED:
-      // Check WiFi connection every 5 seconds
-      if (now - lastWiFiCheck > 5000) {
-        lastWiFiCheck = now;
+      auth.loop_wifi();
+      if (auth.state() != WiFiState::Connected) {
+        LOG_WARN("[WiFi] Connection lost!\n");
+        LOG_INFO("Free heap: %u\n", (unsigned)ESP.getFreeHeap());
         
-        if (WiFi.status() != WL_CONNECTED) {
-          Serial.println("[WiFi] Connection lost!");
-          Serial.println("Free heap: " + String(ESP.getFreeHeap()));
-          
-          WiFi.disconnect(true);
-          WiFi.mode(WIFI_OFF);
-          delay(1000);
-          
-          startBluetooth();
-        } else {
-          // WiFi is connected - do your main work here
-          Serial.println("[MAIN] WiFi OK - Running main code...");
-          
-          // YOUR MQTT CODE GOES HERE
-          // Example: mqtt.loop(); mqtt.publish(); etc.
-          
-          delay(1000); // Adjust based on your needs
-        }
+        auth.disconnect_wifi();
+        startBluetooth();
       }
       break;
       
     case STATE_BT_WAITING:
       if (!btInitialized) {
-        Serial.println("[BT] Bluetooth not initialized, restarting...");
+        LOG_WARN("[BT] Bluetooth not initialized, restarting...\n");
         startBluetooth();
         break;
       }
       
       if (SerialBT.hasClient()) {
-        Serial.println("[BT] Client connected");
-        SerialBT.println("Connected! Send WiFi credentials as JSON: {\"ssid\":\"YourWiFi\",\"password\":\"YourPassword\"}");
-        currentState = STATE_BT_RECEIVING;
-        lastStateChange = now;
-      } else {
-        // Print waiting message every 10 seconds
-        if (now - lastStateChange > 10000) {
-          Serial.println("[BT] Still waiting for client...");
-          lastStateChange = now;
-        }
+        LOG_INFO("[BT] Client connected\n");
+        btFrames.reset();
+        btProtocol = BT_DETECT;
+        btLine.clear();
+        setState(STATE_BT_RECEIVING);
       }
       break;
       
     case STATE_BT_RECEIVING:
       if (!SerialBT.hasClient()) {
-        Serial.println("[BT] Client disconnected");
-        currentState = STATE_BT_WAITING;
-        lastStateChange = now;
+        LOG_INFO("[BT] Client disconnected\n");
+        setState(STATE_BT_WAITING);
         break;
       }
       
-      if (SerialBT.available()) {
-        String receivedData = "";
-        
-        // Read all available data
-        while (SerialBT.available()) {
-          char c = SerialBT.read();
-          if (c == '\n' || c == '\r') {
-            break;
-          }
-          receivedData += c;
-          delay(1); // Small delay between characters
+      // Всё, что пришло, читается кусками и сразу разбирается: парсер
+      // помнит незаконченный кадр до следующего события SPP.
+      while (currentState == STATE_BT_RECEIVING && SerialBT.available()) {
+        uint8_t chunk[64];
+        size_t count = SerialBT.available();
+        if (count > sizeof(chunk)) {
+          count = sizeof(chunk);
         }
-        
-        receivedData.trim();
-        
-        if (receivedData.length() > 0) {
-          Serial.println("[BT] Received: " + receivedData);
-          
-          // Parse JSON
-          DynamicJsonDocument doc(512);
-          DeserializationError error = deserializeJson(doc, receivedData);
-          
-          if (error) {
-            Serial.println("[BT] JSON parse error: " + String(error.c_str()));
-            SerialBT.println("ERROR: Invalid JSON format");
-            SerialBT.println("Expected: {\"ssid\":\"YourWiFi\",\"password\":\"YourPassword\"}");
+        count = SerialBT.readBytes(chunk, count);
+        size_t offset = 0;
+        // Пробелы перед первым байтом не решают, какой это протокол.
+        while (btProtocol == BT_DETECT && offset < count) {
+          char c = (char)chunk[offset];
+          if (c == '{') {
+            btProtocol = BT_LINES;
+            LOG_INFO("[BT] Legacy line protocol\n");
+          } else if (c == ' ' || c == '\r' || c == '\n') {
+            offset++;
           } else {
-            if (doc.containsKey("ssid") && doc.containsKey("password")) {
-              String newSsid = doc["ssid"].as<String>();
-              String newPassword = doc["password"].as<String>();
-              
-              if (newSsid.length() > 0) {
-                ssid = newSsid;
-                password = newPassword;
-                
-                Serial.println("[BT] New credentials received:");
-                Serial.println("SSID: " + ssid);
-                Serial.println("Password: [HIDDEN]");
-                
-                SerialBT.println("Credentials received! Attempting WiFi connection...");
-                SerialBT.flush();
-                delay(500);
-                
-                // Try to connect with new credentials
-                if (connectWiFi()) {
-                  Serial.println("[MAIN] WiFi connected with new credentials!");
-                  // Bluetooth will be stopped in connectWiFi()
-                } else {
-                  Serial.println("[MAIN] WiFi connection failed with new credentials");
-                  startBluetooth();
-                  if (btInitialized) {
-                    SerialBT.println("WiFi connection failed. Please check credentials and try again.");
-                  }
-                }
-              } else {
-                SerialBT.println("ERROR: SSID cannot be empty");
-              }
-            } else {
-              SerialBT.println("ERROR: Missing 'ssid' or 'password' in JSON");
+            btProtocol = BT_FRAMES;
+          }
+        }
+        while (btProtocol == BT_LINES && offset < count) {
+          char c = (char)chunk[offset++];
+          if (c != '\n' && c != '\r') {
+            btLine.append(c);
+            continue;
+          }
+          handleBluetoothLine();
+          btLine.clear();
+          if (currentState != STATE_BT_RECEIVING) {
+            break; // Bluetooth остановлен в connectWiFi()
+          }
+        }
+        while (btProtocol == BT_FRAMES && offset < count) {
+          offset += btFrames.feed(chunk + offset, count - offset);
+          if (btFrames.ready()) {
+            handleProvisionFrame();
+            if (currentState != STATE_BT_RECEIVING) {
+              break; // Bluetooth остановлен в connectWiFi()
             }
           }
         }
       }
+      // Таймаут недописанного кадра и кадры из байтов отброшенного.
+      while (currentState == STATE_BT_RECEIVING && btFrames.poll()) {
+        handleProvisionFrame();
+      }
+      if (btFrames.errors() != btFrameErrors) {
+        LOG_WARN("[BT] Dropped %u bad frames (last: %s)\n",
+                 (unsigned)(btFrames.errors() - btFrameErrors),
+                 frame_error_name(btFrames.lastError()));
+        btFrameErrors = btFrames.errors();
+      }
       break;
   }
   
-  // Additional watchdog feeding
-  if (now % 1000 == 0) {
-    yield();
+  // Вместо delay(50): спим до ближайшего таймера (свои задачи и таймауты Auth)
+  // или до события WiFi/Bluetooth.
+  uint32_t wait = jobs.run();
+  uint32_t configWait = config.loop();
+  if (configWait < wait) {
+    wait = configWait;
+  }
+  if (currentState == STATE_WIFI_CONNECTING || currentState == STATE_WIFI_CONNECTED) {
+    uint32_t authWait = auth.untilNext();
+    if (authWait < wait) {
+      wait = authWait;
+    }
+  } else if (!btInitialized) {
+    wait = 0; // повторный запуск Bluetooth
+  } else if (currentState == STATE_BT_RECEIVING) {
+    uint32_t frameWait = btFrames.untilNext();
+    if (frameWait < wait) {
+      wait = frameWait;
+    }
   }
+  ulTaskNotifyTake(pdTRUE, wait == SCHEDULER_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(wait));
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "adc_sampler.hpp"
+#include "../../shared/binlog.hpp"
+
+bool AdcSampler::begin(const adc1_channel_t* channels, uint8_t count, uint32_t sampleRateHz) {
+    if (count == 0 || count > ADC_SAMPLER_MAX_CHANNELS || count > SOC_ADC_PATT_LEN_MAX) {
+        return false;
+    }
+    _count = count;
+
+    adc_digi_init_config_t init;
+    memset(&init, 0, sizeof(init));
+    init.max_store_buf_size = sizeof(_frame) * 8;  // запас на 8 кадров, пока задача занята
+    init.conv_num_each_intr = sizeof(_frame);
+    for (uint8_t i = 0; i < count; i++) {
+        _channels[i] = channels[i];
+        init.adc1_chan_mask |= BIT(channels[i]);
+    }
+    esp_err_t error = adc_digi_initialize(&init);
+    if (error != ESP_OK) {
+        LOG_WARN("[ADC] DMA init failed: %s\n", esp_err_to_name(error));
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX];
+    memset(pattern, 0, sizeof(pattern));
+    for (uint8_t i = 0; i < count; i++) {
+        pattern[i].atten = ADC_ATTEN_DB_11;
+        pattern[i].channel = channels[i];
+        pattern[i].unit = 0;  // ADC1
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_configuration_t config;
+    memset(&config, 0, sizeof(config));
+    config.conv_limit_en = 1;  // обязательно для ESP32
+    config.conv_limit_num = 250;
+    config.pattern_num = count;
+    config.adc_pattern = pattern;
+    config.sample_freq_hz = sampleRateHz;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    error = adc_digi_controller_configure(&config);
+    if (error == ESP_OK) {
+        error = adc_digi_start();
+    }
+    if (error != ESP_OK) {
+        LOG_WARN("[ADC] DMA start failed: %s\n", esp_err_to_name(error));
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    _running = true;
+    LOG_INFO("[ADC] Sampling %u channels at %u Hz\n", (unsigned)count, (unsigned)sampleRateHz);
+    return true;
+}
+
+void AdcSampler::end() {
+    if (_running) {
+        adc_digi_stop();
+        adc_digi_deinitialize();
+        _running = false;
+    }
+}
+
+size_t AdcSampler::poll(uint32_t timeoutMs, SampleBlockHandler handler, void* context) {
+    if (!_running) {
+        return 0;
+    }
+
+    size_t total = 0;
+    uint32_t timeout = timeoutMs;
+    for (;;) {
+        uint32_t length = 0;
+        esp_err_t error = adc_digi_read_bytes(_frame, sizeof(_frame), &length, timeout);
+        if (error == ESP_ERR_INVALID_STATE) {
+            _overruns++;  // данные есть, но часть потеряна
+        } else if (error != ESP_OK) {
+            break;  // ESP_ERR_TIMEOUT: всё забрали
+        }
+
+        size_t counts[ADC_SAMPLER_MAX_CHANNELS] = {0};
+        for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&_frame[offset];
+            for (uint8_t i = 0; i < _count; i++) {
+                if (result->type1.channel == _channels[i]) {
+                    _split[i][counts[i]++] = result->type1.data;
+                    break;
+                }
+            }
+        }
+        for (uint8_t i = 0; i < _count; i++) {
+            if (counts[i] > 0) {
+                handler(i, _split[i], counts[i], context);
+                total += counts[i];
+            }
+        }
+
+        if (length < sizeof(_frame)) {
+            break;
+        }
+        timeout = 0;  // дальше только то, что уже накоплено
+    }
+    return total;
+}
@@ -0,0 +1,46 @@
+#ifndef ADC_SAMPLER_HPP
+#define ADC_SAMPLER_HPP
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <atomic>
+
+#ifndef ADC_SAMPLER_MAX_CHANNELS
+#define ADC_SAMPLER_MAX_CHANNELS 4
+#endif
+
+// Выборок за одно чтение из DMA (по всем каналам вместе).
+#ifndef ADC_SAMPLER_FRAME
+#define ADC_SAMPLER_FRAME 256
+#endif
+
+// Блок выборок одного канала; index - позиция канала в begin().
+typedef void (*SampleBlockHandler)(uint8_t index, const uint16_t* values, size_t count, void* context);
+
+// Непрерывное чтение ADC1 через DMA (continuous mode драйвера ADC, на ESP32 - через I2S0):
+// контроллер сам обходит каналы с заданной частотой и складывает результаты
+// в кольцевой буфер драйвера, процессор только забирает готовые кадры.
+class AdcSampler {
+public:
+    // sampleRateHz - суммарная частота по всем каналам (на ESP32 от 20 кГц).
+    bool begin(const adc1_channel_t* channels, uint8_t count, uint32_t sampleRateHz);
+    void end();
+
+    // Забирает готовые кадры, ждёт первый не дольше timeoutMs, раскладывает по каналам.
+    // Возвращает число выборок.
+    size_t poll(uint32_t timeoutMs, SampleBlockHandler handler, void* context = nullptr);
+
+    // Сколько раз кольцевой буфер драйвера переполнялся (выборки потеряны).
+    uint32_t overruns() const { return _overruns; }
+
+private:
+    uint8_t _count = 0;
+    adc1_channel_t _channels[ADC_SAMPLER_MAX_CHANNELS];
+    bool _running = false;
+    std::atomic<uint32_t> _overruns{0};
+
+    uint8_t _frame[ADC_SAMPLER_FRAME * SOC_ADC_DIGI_RESULT_BYTES];
+    uint16_t _split[ADC_SAMPLER_MAX_CHANNELS][ADC_SAMPLER_FRAME];
+};
+
+#endif
@@ -1,22 +1,316 @@
 #include <Arduino.h>
-#include "auth.hpp"
+#include <atomic>
+#include <time.h>
+#include "../../../lib/MQTT/src/mqtt.hpp"
+#include "../../shared/auth.hpp"
+#include "../../shared/binlog.hpp"
+#include "../../shared/dual_core.hpp"
+#include "../../shared/payloads.hpp"
+#include "../../shared/sample_aggregator.hpp"
+#include "../../shared/spsc_queue.hpp"
+#include "../../shared/timeseries.hpp"
+#include "../../shared/ota_update.hpp"
+#include "adc_sampler.hpp"
 
 #ifndef LED_BUILTIN
 #define LED_BUILTIN 2
 #endif
 
-void setup()
-{
+// Сеть узла; кэш подключения (Auth::connect_cached()) ускоряет повторный вход в неё.
+#ifndef WATERING_WIFI_SSID
+#define WATERING_WIFI_SSID ""
+#endif
+
+#ifndef WATERING_WIFI_PASSWORD
+#define WATERING_WIFI_PASSWORD ""
+#endif
+
+// Суммарная частота АЦП по всем каналам.
+#ifndef WATERING_SAMPLE_RATE_HZ
+#define WATERING_SAMPLE_RATE_HZ 20000
+#endif
+
+// Как часто публикуются агрегаты; меняется через watering/config/interval.
+#ifndef WATERING_PUBLISH_INTERVAL_MS
+#define WATERING_PUBLISH_INTERVAL_MS 10000
+#endif
+
+// Блок истории без связи: не больше MQTT_QUEUE_PAYLOAD_SIZE, чтобы полный
+// блок уходил одной публикацией (и в flash, пока брокера нет).
+#ifndef WATERING_HISTORY_BLOCK_SIZE
+#define WATERING_HISTORY_BLOCK_SIZE 240
+#endif
+
+// Заголовок сообщения истории: секунды с загрузки и unix-время в момент публикации.
+#define WATERING_HISTORY_ANCHOR_SIZE 8
+
+static_assert(WATERING_HISTORY_ANCHOR_SIZE + WATERING_HISTORY_BLOCK_SIZE <= MQTT_QUEUE_PAYLOAD_SIZE,
+              "History message must fit in one MQTT publish");
+
+// Часы с NTP: до синхронизации time() считает от 1970 года.
+#ifndef WATERING_EPOCH_VALID_AFTER
+#define WATERING_EPOCH_VALID_AFTER 1577836800  // 2020-01-01
+#endif
+
+// --- Датчики ---
+const adc1_channel_t sensorChannels[] = {
+  ADC1_CHANNEL_6,  // GPIO34: влажность почвы
+  ADC1_CHANNEL_7   // GPIO35: расход воды
+};
+const char* const sensorNames[] = { "moisture", "flow" };
+const uint8_t SENSOR_COUNT = sizeof(sensorChannels) / sizeof(sensorChannels[0]);
+
+Auth auth("", "");
+MQTT mqtt;
+AdcSampler sampler;
+OtaUpdate ota;
+bool otaTrial = false;        // новый образ ещё не подтверждён связью с брокером
+unsigned long restartAt = 0;  // перезагрузка в новый образ после ответа брокеру
+
+// --- Обмен между задачами ---
+// Выборка и агрегация - в задаче "sampler" на ядре 1, WiFi, MQTT и публикация -
+// в задаче "network" на ядре 0, рядом со стеком WiFi.
+SampleAggregator<> aggregators[SENSOR_COUNT];
+SpscQueue<SensorAggregate, 8> aggregates;  // sampler -> network: готовые окна
+std::atomic<uint32_t> publishInterval(WATERING_PUBLISH_INTERVAL_MS);
+unsigned long windowStart = 0;
+TaskHandle_t networkTask = nullptr;  // будится, когда готовы агрегаты
+
+// Без брокера окна копятся сжатыми: среднее и секунды с загрузки, см. timeseries.hpp.
+StaticTimeSeriesBlock<WATERING_HISTORY_BLOCK_SIZE> history[SENSOR_COUNT];
+
+static void put_le32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = (value >> 24) & 0xFF;
+}
+
+// watering/<датчик>/history:
+//   uptime (LE32, с) | unix-время (LE32, 0 - часы не заданы) | блок истории (с CRC)
+// Метки блока - секунды с загрузки; uptime и unix-время сняты в один момент,
+// так что время выборки t = unix-время - (uptime - t). Без часов получатель
+// берёт за опору момент приёма, если сообщение не лежало в очереди.
+void publishHistory(uint8_t index) {
+  size_t length = history[index].seal();
+  if (length > 0) {
+    uint8_t payload[WATERING_HISTORY_ANCHOR_SIZE + WATERING_HISTORY_BLOCK_SIZE];
+    time_t epoch = time(nullptr);
+    put_le32(payload, millis() / 1000);
+    put_le32(payload + 4, epoch > WATERING_EPOCH_VALID_AFTER ? (uint32_t)epoch : 0);
+    memcpy(payload + WATERING_HISTORY_ANCHOR_SIZE, history[index].data(), length);
+
+    char topic[40];
+    snprintf(topic, sizeof(topic), "watering/%s/history", sensorNames[index]);
+    if (!mqtt.publish(topic, payload, WATERING_HISTORY_ANCHOR_SIZE + length)) {
+      LOG_WARN("[SENSOR] History of %s lost: %u samples\n", sensorNames[index],
+               (unsigned)history[index].count());
+    }
+  }
+  history[index].reset();
+}
+
+void recordHistory(uint8_t index, const SensorAggregate& aggregate) {
+  uint32_t time = millis() / 1000;
+  if (!history[index].append(time, (float)aggregate.mean)) {
+    publishHistory(index);
+    history[index].append(time, (float)aggregate.mean);
+  }
+}
+
+void onSamples(uint8_t index, const uint16_t* values, size_t count, void* context) {
+  aggregators[index].add(values, count);
+}
+
+// Задача выборки: ждёт кадры DMA (процессор свободен, пока их нет)
+// и по окончании окна отдаёт агрегаты сетевой задаче.
+void samplerStep() {
+  sampler.poll(50, onSamples);
+
+  unsigned long now = millis();
+  uint32_t window = now - windowStart;
+  if (window < publishInterval) {
+    return;
+  }
+  windowStart = now;
+
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    SampleStats stats;
+    if (!aggregators[i].snapshot(stats)) {
+      continue;
+    }
+    aggregators[i].reset();
+
+    SensorAggregate* slot = aggregates.reserve();
+    if (!slot) {
+      LOG_WARN("[SENSOR] Aggregate queue full, window dropped\n");
+      continue;
+    }
+    strncpy(slot->sensor, sensorNames[i], sizeof(slot->sensor) - 1);
+    slot->sensor[sizeof(slot->sensor) - 1] = '\0';
+    slot->windowMs = window;
+    slot->count = stats.count;
+    slot->min = stats.min;
+    slot->max = stats.max;
+    slot->mean = stats.mean;
+    slot->p50 = stats.p50;
+    slot->p90 = stats.p90;
+    slot->p99 = stats.p99;
+    aggregates.commit();
+  }
+  if (networkTask) {
+    xTaskNotifyGive(networkTask);
+  }
+}
+
+// --- MQTT ---
+void onInterval(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+  uint32_t interval = 0;
+  for (unsigned int i = 0; i < length; i++) {
+    if (payload[i] < '0' || payload[i] > '9' || interval > 86400000UL / 10) {
+      LOG_WARN("[SENSOR] Invalid publish interval\n");
+      return;
+    }
+    interval = interval * 10 + (payload[i] - '0');
+  }
+  if (interval < 1000) {
+    LOG_WARN("[SENSOR] Publish interval must be at least 1000 ms\n");
+    return;
+  }
+  publishInterval = interval;
+  LOG_INFO("[SENSOR] Publish interval set to %u ms\n", (unsigned)interval);
+}
+
+// OTA: watering/ota/begin (OtaBegin в JSON), watering/ota/chunk (смещение LE32 +
+// данные), watering/ota/end. Состояние - в watering/ota, см. OtaUpdate.
+void onOta(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+  const char* command = strrchr(topic, '/') + 1;
+  OtaError error;
+  if (strcmp(command, "chunk") == 0) {
+    error = ota.writeChunk(OtaTransport::Mqtt, payload, length);
+    if (error == OtaError::None && !ota.progressDue()) {
+      return;
+    }
+  } else if (strcmp(command, "begin") == 0) {
+    OtaBegin* request = mqtt.arena().create<OtaBegin>();
+    uint8_t digest[SHA256_SIZE];
+    uint8_t signature[SHA256_SIZE];
+    if (!request || parse_ota_begin((const char*)payload, length, *request) != JsonError::Ok ||
+        !sha256_from_hex(request->sha256, digest) || !sha256_from_hex(request->signature, signature)) {
+      LOG_WARN("[OTA] Invalid begin request\n");
+      return;
+    }
+    error = ota.begin(OtaTransport::Mqtt, request->size, digest, request->delta, signature);
+  } else if (strcmp(command, "end") == 0) {
+    error = ota.finish(OtaTransport::Mqtt);
+    if (error == OtaError::None) {
+      restartAt = millis() + 1000;
+    }
+  } else {
+    return;
+  }
+
+  char status[128];
+  size_t statusLength = ota.writeStatus(error, status, sizeof(status));
+  mqtt.publish("watering/ota", (const uint8_t*)status, statusLength);
+}
+
+void onWiFiState(WiFiState previous, WiFiState current, void* context) {
+  digitalWrite(LED_BUILTIN, current == WiFiState::Connected ? HIGH : LOW);
+  if (current == WiFiState::Connected) {
+    mqtt.setAuthInstance(&auth);
+    mqtt.connect();
+  }
+}
+
+// Сетевая задача: WiFi, MQTT, OTA и публикация агрегатов.
+void networkStep() {
+  auth.loop_wifi();
+  if (auth.is_connected()) {
+    mqtt.receive_message();
+    if (otaTrial && mqtt.is_connected()) {
+      otaTrial = false;
+      ota_confirm_boot();
+    }
+  }
+  if (otaTrial && millis() > OTA_CONFIRM_TIMEOUT_MS) {
+    ota_rollback();
+  }
+  if (restartAt != 0 && (long)(millis() - restartAt) >= 0) {
+    LOG_INFO("[OTA] Restarting into the new image...\n");
+    ESP.restart();
+  }
+
+  // С брокером агрегаты публикуются целиком, без него в историю идёт только
+  // среднее: часы окон в паре сотен байт вместо очереди JSON. Полный блок
+  // уходит в MQTT сразу (очередь и flash), недописанный - после подключения.
+  bool online = mqtt.is_connected();
+  if (online) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+      if (!history[i].empty()) {
+        publishHistory(i);
+      }
+    }
+  }
+  while (SensorAggregate* aggregate = aggregates.front()) {
+    if (online) {
+      char topic[32];
+      snprintf(topic, sizeof(topic), "watering/%s", aggregate->sensor);
+      mqtt.publish(topic, SENSOR_AGGREGATE_SCHEMA, aggregate);
+    } else {
+      for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (strcmp(aggregate->sensor, sensorNames[i]) == 0) {
+          recordHistory(i, *aggregate);
+        }
+      }
+    }
+    aggregates.release();
+  }
+
+  static uint32_t reportedOverruns = 0;
+  if (sampler.overruns() != reportedOverruns) {
+    reportedOverruns = sampler.overruns();
+    LOG_WARN("[ADC] DMA buffer overruns: %u\n", (unsigned)reportedOverruns);
+  }
+
+  // С подключением MQTT читает сокет раз в 10 мс, без него спим до таймера
+  // Auth; события WiFi и готовые агрегаты будят раньше.
+  uint32_t wait = auth.is_connected() ? 10 : auth.untilNext();
+  if (otaTrial && wait > 1000) {
+    wait = 1000; // срок подтверждения нового образа
+  }
+  ulTaskNotifyTake(pdTRUE, wait == SCHEDULER_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+}
+
+void setup() {
+  Serial.begin(115200);
+  LOG_INFO("=== Watering node starting ===\n");
+  otaTrial = ota_check_boot();
   pinMode(LED_BUILTIN, OUTPUT);
-  Auth auth;
-  auth.scan_bluetooth();
-  auth.connect_bluetooth();
+
+  mqtt.on("watering/config/interval", onInterval);
+  mqtt.on("watering/ota/+", onOta);
+  mqtt.beginSpill();
+  auth.onStateChange(onWiFiState);
+  if (strlen(WATERING_WIFI_SSID) == 0) {
+    LOG_INFO("[MAIN] No WiFi configured, aggregates stay in the queue\n");
+  } else {
+    auth.setCredentials(WATERING_WIFI_SSID, WATERING_WIFI_PASSWORD);
+    if (!auth.connect_cached()) {
+      auth.connect_wifi();
+    }
+  }
+
+  // Сетевая задача стартует первой: sampler будит её по готовым окнам.
+  start_pinned_task("network", networkStep, NETWORK_CORE, 8192, 2, &networkTask);
+  auth.wakeOnEvent(networkTask);
+  if (sampler.begin(sensorChannels, SENSOR_COUNT, WATERING_SAMPLE_RATE_HZ)) {
+    windowStart = millis();
+    start_pinned_task("sampler", samplerStep, APPLICATION_CORE);
+  }
 }
 
-void loop()
-{
-  digitalWrite(LED_BUILTIN, HIGH);
-  delay(1000);
-  digitalWrite(LED_BUILTIN, LOW);
-  delay(1000);
+// Вся работа - в задачах network и sampler.
+void loop() {
+  vTaskDelay(portMAX_DELAY);
 }
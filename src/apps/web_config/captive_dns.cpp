@@ -0,0 +1,33 @@
+#include "captive_dns.hpp"
+#include "../../shared/binlog.hpp"
+
+bool CaptiveDns::start(const IPAddress& address, uint16_t port) {
+    uint8_t bytes[4] = { address[0], address[1], address[2], address[3] };
+    dns_prepare_answer(_answer, bytes);
+
+    if (_listening) {
+        return true;
+    }
+    if (!_udp.listen(port)) {
+        LOG_WARN("[DNS] Cannot listen on port %u\n", port);
+        return false;
+    }
+    _udp.onPacket([this](AsyncUDPPacket& packet) { onPacket(packet); });
+    _listening = true;
+    return true;
+}
+
+void CaptiveDns::stop() {
+    if (_listening) {
+        _udp.close();
+        _listening = false;
+    }
+}
+
+void CaptiveDns::onPacket(AsyncUDPPacket& packet) {
+    size_t size = dns_build_reply(packet.data(), packet.length(), _answer, _reply, sizeof(_reply));
+    if (size > 0) {
+        packet.write(_reply, size);
+        _answered++;
+    }
+}
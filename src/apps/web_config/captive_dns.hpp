@@ -0,0 +1,28 @@
+#ifndef CAPTIVE_DNS_HPP
+#define CAPTIVE_DNS_HPP
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <atomic>
+#include "../../shared/dns_reply.hpp"
+
+// DNS captive-портала на AsyncUDP: ответ уходит прямо из обработчика пакета,
+// без опроса из цикла. Любое имя разрешается в адрес точки доступа.
+class CaptiveDns {
+public:
+    bool start(const IPAddress& address, uint16_t port = 53);
+    void stop();
+    uint32_t answered() const { return _answered; }
+
+private:
+    void onPacket(AsyncUDPPacket& packet);
+
+    AsyncUDP _udp;
+    DnsAnswer _answer;
+    // Пакеты обрабатываются по одному в задаче AsyncUDP, буфер можно не делить.
+    uint8_t _reply[DNS_MAX_PACKET];
+    std::atomic<uint32_t> _answered{0};
+    bool _listening = false;
+};
+
+#endif
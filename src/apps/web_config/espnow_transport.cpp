@@ -0,0 +1,40 @@
+#include "espnow_transport.hpp"
+#include <esp_now.h>
+
+EspNowTransport* EspNowTransport::_instance = nullptr;
+
+bool EspNowTransport::begin() {
+    if (esp_now_init() != ESP_OK) {
+        return false;
+    }
+    _instance = this;
+    return esp_now_register_recv_cb(onReceive) == ESP_OK;
+}
+
+void EspNowTransport::onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+    EspNowTransport* self = _instance;
+    if (!self || length <= 0 || length > GATEWAY_MAX_PACKET) {
+        return;
+    }
+    GatewayPacket* slot = self->_queue.reserve();
+    if (!slot) {
+        self->_overflows++;
+        return;
+    }
+    slot->length = length;
+    memcpy(slot->data, data, length);
+    self->_queue.commit();
+    if (*self->_notify) {
+        xTaskNotifyGive(*self->_notify);
+    }
+}
+
+size_t EspNowTransport::poll(Gateway& gateway) {
+    size_t count = 0;
+    while (GatewayPacket* packet = _queue.front()) {
+        gateway.ingest(packet->data, packet->length);
+        _queue.release();
+        count++;
+    }
+    return count;
+}
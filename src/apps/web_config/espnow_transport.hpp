@@ -0,0 +1,30 @@
+#ifndef ESPNOW_TRANSPORT_HPP
+#define ESPNOW_TRANSPORT_HPP
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "../../shared/gateway.hpp"
+
+// Пакеты узлов по ESP-NOW. Колбэк приёма работает в задаче WiFi: он только
+// кладёт пакет в очередь и будит сетевую задачу, разбор - в poll().
+// ESP-NOW слушает на канале текущей сети, узлы должны быть на нём же.
+class EspNowTransport : public GatewayTransport {
+public:
+    explicit EspNowTransport(TaskHandle_t* notify) : _notify(notify) {}
+
+    bool begin() override;
+    size_t poll(Gateway& gateway) override;
+    uint32_t overflows() const { return _overflows; }
+
+private:
+    static void onReceive(const uint8_t* mac, const uint8_t* data, int length);
+
+    static EspNowTransport* _instance;  // у колбэка ESP-NOW нет контекста
+    TaskHandle_t* _notify;
+    SpscQueue<GatewayPacket, 16> _queue;
+    std::atomic<uint32_t> _overflows{0};
+};
+
+#endif
@@ -1,104 +1,230 @@
 #include "../../../lib/MQTT/src/mqtt.hpp"
+#include "../../../lib/MQTT/src/mqtt_rpc.hpp"
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
-#include <DNSServer.h>
-#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
 #include <esp_mac.h> // Явно подключим для esp_read_mac
 #include "../../shared/auth.hpp"
+#include "../../shared/payloads.hpp"
+#include "../../shared/dual_core.hpp"
+#include "../../shared/boot_profile.hpp"
+#include "../../shared/spsc_queue.hpp"
+#include "../../shared/scheduler.hpp"
+#include "../../shared/metrics.hpp"
+#include "../../shared/fixed_string.hpp"
+#include "../../shared/ota_update.hpp"
+#include "../../shared/device_config.hpp"
+#include "../../shared/binlog.hpp"
+#include "captive_dns.hpp"
+#include <atomic>
+
+// Как часто статистика уходит в esp32/stats/<имя устройства>.
+#ifndef WEB_CONFIG_STATS_INTERVAL_MS
+#define WEB_CONFIG_STATS_INTERVAL_MS 60000
+#endif
+
+// Режим шлюза (env web_config_gateway): показания дочерних узлов по ESP-NOW
+// и UDP уходят пачкой раз в окно в esp32/gateway/<имя>/batch.
+#ifndef WEB_CONFIG_GATEWAY
+#define WEB_CONFIG_GATEWAY 0
+#endif
+
+// Пользователь HTTP по адресу станции, пароль - http_password из настроек.
+#ifndef WEB_CONFIG_HTTP_USER
+#define WEB_CONFIG_HTTP_USER "admin"
+#endif
+
+#ifndef GATEWAY_WINDOW_MS
+#define GATEWAY_WINDOW_MS 5000
+#endif
+
+#if WEB_CONFIG_GATEWAY
+#include "../../shared/gateway_udp.hpp"
+#include "espnow_transport.hpp"
+#endif
 
 // --- ГЛОБАЛЬНЫЕ ПЕРЕМЕННЫЕ ---
-WebServer server(80);
-DNSServer dnsServer;
-const char* ap_password = "12345678"; // Пароль к точке доступа
-String deviceName = ""; // Будем хранить уникальное имя устройства здесь
+// HTTP и DNS портала работают по событиям (задачи AsyncTCP/AsyncUDP),
+// из сетевой задачи их опрашивать не нужно.
+AsyncWebServer server(80);
+CaptiveDns dnsServer;
+FixedString<PAYLOAD_DEVICE_NAME_SIZE - 1> deviceName; // Будем хранить уникальное имя устройства здесь
+FixedString<80> redirectUrl; // Location для 302, собирается один раз в setup()
+FixedString<48> statsTopic;
+FixedString<48> otaFilter;  // esp32/ota/<имя>/+ : begin, chunk, end
+FixedString<48> otaTopic;   // esp32/ota/<имя> : состояние для отправителя
+FixedString<40> rpcBase;    // esp32/<имя>: RPC в <base>/req/..., ответы в <base>/res/<id>
+std::atomic<uint32_t> portalRedirects(0);
+#if WEB_CONFIG_GATEWAY
+FixedString<56> gatewayTopic; // esp32/gateway/<имя>/batch
+#endif
 
 // --- Экземпляры твоих классов ---
 Auth auth("", ""); 
 MQTT mqtt;
+RpcServer rpc(mqtt, millis);
+OtaUpdate ota;
+OtaError httpOtaBegin = OtaError::None;  // итог begin() для ответа /update, только задача AsyncTCP
+// Пароль точки доступа, сеть, имя и брокер; меняет и записывает только сетевая задача.
+DeviceConfigStore config(DEVICE_CONFIG_SCHEMA, DEVICE_CONFIG_DEFAULTS, millis);
 bool wifiCredentialsUpdated = false;
-bool configMode = true;
+std::atomic<bool> configMode(true); // читается и из обработчиков HTTP
+
+// --- Обмен между задачами ---
+// Сеть (WiFi, MQTT, DNS/HTTP) работает в задаче на ядре 0, loop() - на ядре 1.
+// Объекты сетевой части трогает только сетевая задача.
+SpscQueue<OutboundMessage, 8> toNetwork;      // loop() -> сеть: на публикацию
+SpscQueue<OutboundMessage, 8> toApplication;  // сеть -> loop(): входящие сообщения
+SpscQueue<OutboundMessage, 8> fromPortal;     // HTTP /mqtt -> сеть
+std::atomic<bool> mqttOnline(false);
+std::atomic<bool> otaRestart(false);          // HTTP /update -> сеть: перезагрузка
+// Обе задачи спят до своего ближайшего таймера; тот, кто кладёт сообщение
+// в очередь, будит получателя через xTaskNotifyGive().
+TaskHandle_t networkTask = nullptr;
+TaskHandle_t applicationTask = nullptr;
+
+static const uint32_t network_step_bounds[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 };
+MetricHistogram networkStepTime("loop_iteration_us", "li", "Network task iteration time, without sleep",
+                                network_step_bounds, 10);
+Scheduler<8> networkJobs(millis);
+Scheduler<4> applicationJobs(millis);
+
+#if WEB_CONFIG_GATEWAY
+Gateway gateway(millis);
+EspNowTransport espNow(&networkTask);
+UdpTransport gatewayUdp;
+GatewayTransport* gatewayTransports[] = { &espNow, &gatewayUdp };
+bool gatewayStarted = false;
+#endif
 
 // --- ОБЪЯВЛЕНИЕ ФУНКЦИЙ ---
 void startAPMode();
 void connectToWiFi();
-void handleCaptivePortal(); // ИЗМЕНЕНО: Новая функция для редиректа
-void handleStatus();
-void handleMQTT();
+void setupPortal();
+void handleCaptivePortal(AsyncWebServerRequest* request); // ИЗМЕНЕНО: Новая функция для редиректа
+void handleStatus(AsyncWebServerRequest* request);
+void handleMetrics(AsyncWebServerRequest* request);
+void handleMQTT(AsyncWebServerRequest* request);
+void handleMQTTBody(AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index, size_t total);
+void handleUpdate(AsyncWebServerRequest* request);
+void handleUpdateBody(AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index, size_t total);
+void onOta(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+void restartDevice(void* context);
+void rollbackUnconfirmed(void* context);
+void onWiFiCredentials(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+void onPing(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+RpcStatus rpcStatus(const RpcEmpty& request, DeviceStatus& response, const RpcCall& call, void* context);
+RpcStatus rpcWiFi(const WiFiCredentials& request, RpcEmpty& response, const RpcCall& call, void* context);
+RpcStatus rpcBroker(const BrokerConfig& request, RpcEmpty& response, const RpcCall& call, void* context);
+RpcStatus rpcRestart(const RpcEmpty& request, RpcEmpty& response, const RpcCall& call, void* context);
+void onConfigChange(uint8_t id, void* context);
+void onWiFiState(WiFiState previous, WiFiState current, void* context);
+void networkStep();
+void wakeTask(TaskHandle_t task);
+void logPortalStatus(void* context);
+void sampleMetrics(void* context);
+void publishStats(void* context);
+void sendTestMessage(void* context);
+void startGateway();
+void pollGateway();
+void flushGateway(void* context);
+bool publishFromApplication(const char* topic, const char* message);
 // handleRoot и handleSave удалены
 
 // --- РЕАЛИЗАЦИЯ ФУНКЦИЙ ---
 
-// Генерирует уникальное имя на основе MAC-адреса
-String generateDeviceName() {
+// Генерирует уникальное имя на основе MAC-адреса, если имя не задано в настройках
+void generateDeviceName() {
+    if (config->deviceName[0] != '\0') {
+        deviceName = config->deviceName;
+        return;
+    }
     uint8_t mac[6];
-    char macStr[18] = {0};
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    snprintf(macStr, sizeof(macStr), "%02X%02X%02X", mac[3], mac[4], mac[5]);
-    return "Hub-Device-" + String(macStr);
+    deviceName.clear();
+    deviceName.appendf("Hub-Device-%02X%02X%02X", mac[3], mac[4], mac[5]);
 }
 
+// Только запускает подключение: портал продолжает работать (AP+STA),
+// дальше всё решает onWiFiState().
 void connectToWiFi() {
-    Serial.println("[MAIN] Attempting WiFi connection...");
-
-    if (configMode) {
-        server.stop();
-        dnsServer.stop();
-        WiFi.softAPdisconnect(true);
-        delay(1000);
-    }
-
+    LOG_INFO("[MAIN] Attempting WiFi connection...\n");
     auth.connect_wifi();
+}
 
-    if (auth.is_connected()) {
-        Serial.println("[MAIN] WiFi connected! Starting normal operation...");
+// Вызывается из auth.loop_wifi() в сетевой задаче.
+void onWiFiState(WiFiState previous, WiFiState current, void* context) {
+    if (current == WiFiState::Connected) {
+        LOG_INFO("[MAIN] WiFi connected! Starting normal operation...\n");
+        if (configMode) {
+            // HTTP остаётся для /metrics; остальное по адресу станции - с паролем (httpAllowed).
+            dnsServer.stop();
+            WiFi.mode(WIFI_STA); // гасим точку доступа, станция остаётся
+        }
         configMode = false;
         mqtt.setAuthInstance(&auth);
         mqtt.connect();
-    } else {
-        Serial.println("[MAIN] WiFi connection failed. Returning to AP mode...");
-        delay(2000);
+        startGateway();
+    } else if (previous == WiFiState::Connected && current != WiFiState::Connecting) {
+        LOG_WARN("[MAIN] WiFi connection lost. Starting AP mode...\n");
+        startAPMode();
+    } else if (current == WiFiState::Failed && !configMode) {
+        LOG_WARN("[MAIN] WiFi connection failed. Returning to AP mode...\n");
         startAPMode();
     }
 }
 
 // ⭐️ ИЗМЕНЕНО: Эта функция теперь отвечает за редирект в приложение
-void handleCaptivePortal() {
-    // Формируем специальную ссылку (deep link) для твоего приложения
-    String redirectUrl = "anj-iot://configure?device_name=" + deviceName;
-    
+// Ссылка (deep link) для приложения собрана заранее; при проверках связи телефон
+// шлёт пачку запросов, поэтому здесь ни сборки строк, ни вывода в Serial.
+void handleCaptivePortal(AsyncWebServerRequest* request) {
     // Отправляем HTTP-ответ 302, который говорит браузеру перейти по новой ссылке
-    server.sendHeader("Location", redirectUrl, true);
-    server.send(302, "text/plain", ""); // Тело ответа может быть пустым
-    Serial.println("[WEB] Captive Portal: Redirecting to mobile app via " + redirectUrl);
+    AsyncWebServerResponse* response = request->beginResponse(302, "text/plain", ""); // Тело ответа может быть пустым
+    response->addHeader("Location", redirectUrl.c_str()); // копию в String делает сама библиотека
+    request->send(response);
+    portalRedirects++;
+}
+
+// Обработчики регистрируются один раз, сервер запускается в setup().
+void setupPortal() {
+    // ⭐️ ИЗМЕНЕНО: Генерируем имя один раз и сохраняем в глобальную переменную
+    generateDeviceName();
+    redirectUrl.clear();
+    redirectUrl.appendf("anj-iot://configure?device_name=%s", deviceName.c_str());
+    statsTopic.clear();
+    statsTopic.appendf("esp32/stats/%s", deviceName.c_str());
+    otaTopic.clear();
+    otaTopic.appendf("esp32/ota/%s", deviceName.c_str());
+    otaFilter.clear();
+    otaFilter.appendf("%s/+", otaTopic.c_str());
+    rpcBase.clear();
+    rpcBase.appendf("esp32/%s", deviceName.c_str());
+#if WEB_CONFIG_GATEWAY
+    gatewayTopic.clear();
+    gatewayTopic.appendf("esp32/gateway/%s/batch", deviceName.c_str());
+#endif
+
+    // ⭐️ ИЗМЕНЕНО: Настраиваем сервер на редирект
+    server.on("/", HTTP_ANY, handleCaptivePortal);   // При заходе на главную страницу
+    server.on("/status", HTTP_GET, handleStatus);    // Оставим для отладки
+    server.on("/metrics", HTTP_GET, handleMetrics);  // Prometheus
+    server.on("/mqtt", HTTP_POST, handleMQTT, nullptr, handleMQTTBody); // Оставим для отладки
+    server.on("/update", HTTP_POST, handleUpdate, nullptr, handleUpdateBody); // OTA: образ или патч в теле
+    server.onNotFound(handleCaptivePortal);          // Для всех остальных запросов (это ключ к работе Captive Portal)
 }
 
 
 void startAPMode() {
-    Serial.println("[WEB] Starting Access Point mode...");
-    
-    // ⭐️ ИЗМЕНЕНО: Генерируем имя один раз и сохраняем в глобальную переменную
-    deviceName = generateDeviceName();
+    LOG_INFO("[WEB] Starting Access Point mode...\n");
 
     WiFi.mode(WIFI_AP);
-    WiFi.softAP(deviceName.c_str(), ap_password); // Используем .c_str() для String
+    WiFi.softAP(deviceName.c_str(), config->apPassword);
 
-    Serial.println("[WEB] Access Point started:");
-    Serial.println("Network: " + deviceName);
-    Serial.println("Password: " + String(ap_password));
-    Serial.println("IP: " + WiFi.softAPIP().toString());
+    IPAddress ip = WiFi.softAPIP();
+    LOG_INFO("[WEB] Access Point started: network %s, password %s, IP %u.%u.%u.%u\n",
+             deviceName.c_str(), log_secret(config->apPassword), ip[0], ip[1], ip[2], ip[3]);
     
-    dnsServer.start(53, "*", WiFi.softAPIP());
-
-    // ⭐️ ИЗМЕНЕНО: Настраиваем сервер на редирект
-    server.on("/", handleCaptivePortal);            // При заходе на главную страницу
-    server.on("/status", handleStatus);             // Оставим для отладки
-    server.on("/mqtt", HTTP_POST, handleMQTT);      // Оставим для отладки
-    server.onNotFound(handleCaptivePortal);         // Для всех остальных запросов (это ключ к работе Captive Portal)
-    // server.on("/save", ...) удален
-
-    server.begin();
-    Serial.println("[WEB] Web server started");
+    dnsServer.start(WiFi.softAPIP());
 
     configMode = true;
 }
@@ -106,80 +232,452 @@ void startAPMode() {
 // ⭐️ УДАЛЕНО: handleRoot() и config_html больше не нужны
 // ⭐️ УДАЛЕНО: handleSave() больше не нужен
 
-void handleStatus() {
-    DynamicJsonDocument doc(256);
-    doc["wifi_connected"] = auth.is_connected();
-    doc["config_mode"] = configMode;
-    doc["ip_address"] = WiFi.localIP().toString();
+void fillStatus(DeviceStatus& status) {
+    status.wifiConnected = auth.is_connected();
+    status.configMode = configMode;
+    IPAddress ip = WiFi.localIP();
+    snprintf(status.ipAddress, sizeof(status.ipAddress), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
 
-    String output;
-    serializeJson(doc, output);
-    server.send(200, "application/json", output);
+// По адресу станции сервер виден всей сети: всё, кроме /metrics и редиректа,
+// требует http_password. В портале клиент уже прошёл пароль точки доступа.
+// http_password меняется только провижинингом при сборке, поэтому читается
+// из задачи AsyncTCP без синхронизации.
+bool httpAllowed(AsyncWebServerRequest* request) {
+    return configMode || (config->httpPassword[0] != '\0' &&
+                          request->authenticate(WEB_CONFIG_HTTP_USER, config->httpPassword));
 }
 
-void handleMQTT() {
-    if (server.hasArg("plain") == false) {
-        server.send(400, "text/plain", "Body not received");
+// false - ответ (401 или 403) уже отправлен.
+bool httpAuthorize(AsyncWebServerRequest* request) {
+    if (httpAllowed(request)) {
+        return true;
+    }
+    if (config->httpPassword[0] == '\0') {
+        request->send(403, "text/plain", "Not available on the station address");
+    } else {
+        request->requestAuthentication();
+    }
+    return false;
+}
+
+void handleStatus(AsyncWebServerRequest* request) {
+    if (!httpAuthorize(request)) {
         return;
     }
-    String body = server.arg("plain");
-    server.send(200, "text/plain", "Message received");
-    
-    DynamicJsonDocument doc(256);
-    if (deserializeJson(doc, body)) return;
+    DeviceStatus status;
+    fillStatus(status);
+
+    char output[96];
+    if (serialize_status(status, output, sizeof(output)) == 0) {
+        request->send(500, "text/plain", "Status too large");
+        return;
+    }
+    request->send(200, "application/json", output);
+}
 
-    String topic = doc["topic"];
-    String mqttMessage = doc["message"];
+// Метрики атомарные, поэтому их можно читать прямо из задачи AsyncTCP.
+void handleMetrics(AsyncWebServerRequest* request) {
+    AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+    metrics_write_prometheus(*response);
+    request->send(response);
+}
 
-    if (topic == "esp32/test") {
-        mqtt.send_message(mqttMessage.c_str());
+void handleMQTT(AsyncWebServerRequest* request) {
+    if (!httpAuthorize(request)) {
+        return;
     }
+    if (request->contentLength() == 0) {
+        request->send(400, "text/plain", "Body not received");
+        return;
+    }
+    request->send(200, "text/plain", "Message received");
 }
 
+// Тело приходит в задаче AsyncTCP: MQTT трогает только сетевая задача,
+// поэтому сообщение передаётся ей через очередь.
+void handleMQTTBody(AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index, size_t total) {
+    if (index != 0 || length != total) return; // тело должно прийти одним куском
+    if (!httpAllowed(request)) return;         // handleMQTT() ответит 401/403
 
-// --- ОСНОВНЫЕ ФУНКЦИИ ---
-void setup() {
-    Serial.begin(115200);
-    delay(2000);
-    Serial.println("=== ESP32 Starting ===");
-    startAPMode();
+    BridgePublish publish;
+    if (parse_bridge_publish((const char*)data, length, publish) != JsonError::Ok) return;
+
+    if (strcmp(publish.topic, "esp32/test") == 0) {
+        OutboundMessage* slot = fromPortal.reserve();
+        if (slot && slot->set(publish.topic, (const uint8_t*)publish.message, strlen(publish.message), 0)) {
+            fromPortal.commit();
+            wakeTask(networkTask);
+        }
+    }
 }
 
-void loop() {
-    delay(100); 
-    yield();
+// curl --data-binary @update.odp "http://<адрес>/update?sha256=<hex>&sig=<hex>&delta=1"
+// sig печатает tools/ota_delta.cpp с ключом устройства (OTA_KEY).
+// Тело приходит кусками в задаче AsyncTCP и сразу пишется во flash.
+void handleUpdateBody(AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index, size_t total) {
+    if (!httpAllowed(request)) {
+        return; // handleUpdate() ответит 401/403
+    }
+    if (index == 0) {
+        uint8_t digest[SHA256_SIZE];
+        uint8_t signature[SHA256_SIZE];
+        AsyncWebParameter* sha = request->getParam("sha256");
+        AsyncWebParameter* sig = request->getParam("sig");
+        if (!sha || !sha256_from_hex(sha->value().c_str(), digest) ||
+            !sig || !sha256_from_hex(sig->value().c_str(), signature)) {
+            httpOtaBegin = OtaError::Auth;
+        } else {
+            httpOtaBegin = ota.begin(OtaTransport::Http, total, digest, request->hasParam("delta"), signature);
+        }
+    }
+    if (httpOtaBegin != OtaError::None) {
+        return; // handleUpdate() ответит ошибкой
+    }
+    ota.write(OtaTransport::Http, index, data, length);
+}
+
+void handleUpdate(AsyncWebServerRequest* request) {
+    if (!httpAuthorize(request)) {
+        return;
+    }
+    OtaError error = httpOtaBegin != OtaError::None ? httpOtaBegin : ota.finish(OtaTransport::Http);
+    httpOtaBegin = OtaError::None;
+    char status[128];
+    ota.writeStatus(error, status, sizeof(status));
+    request->send(error == OtaError::None ? 200 : 400, "application/json", status);
+    if (error == OtaError::None) {
+        otaRestart = true;
+        wakeTask(networkTask);
+    }
+}
+
+
+// --- MQTT ОБРАБОТЧИКИ ---
+// Новая сеть применяется сразу и сохраняется: после перезагрузки
+// провижининг не нужен.
+bool storeWiFiCredentials(const WiFiCredentials& credentials) {
+    if (!auth.setCredentials(credentials.ssid, credentials.password)) {
+        return false;
+    }
+    config.setString(CONFIG_WIFI_SSID, credentials.ssid);
+    config.setString(CONFIG_WIFI_PASSWORD, credentials.password);
+    wifiCredentialsUpdated = true;  // флаг для переподключения
+    return true;
+}
+
+void onWiFiCredentials(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    WiFiCredentials* credentials = mqtt.arena().create<WiFiCredentials>();
+    JsonError error = credentials ? mqtt.decode(topic, payload, length, WIFI_CREDENTIALS_SCHEMA, credentials)
+                                  : JsonError::Oversize;
+    if (error != JsonError::Ok) {
+        LOG_WARN("Failed to parse WiFi credentials: %s\n", json_error_name(error));
+        return;
+    }
+
+    LOG_INFO("Received new WiFi credentials.\n");
+    storeWiFiCredentials(*credentials);
+}
+
+// RPC выполняются в сетевой задаче из rpc.loop(), по одному за итерацию.
+RpcStatus rpcStatus(const RpcEmpty& request, DeviceStatus& response, const RpcCall& call, void* context) {
+    fillStatus(response);
+    return RpcStatus::Ok;
+}
+
+RpcStatus rpcWiFi(const WiFiCredentials& request, RpcEmpty& response, const RpcCall& call, void* context) {
+    return storeWiFiCredentials(request) ? RpcStatus::Ok : RpcStatus::BadRequest;
+}
+
+// Брокер сохраняется и применяется после перезагрузки (rpc restart).
+RpcStatus rpcBroker(const BrokerConfig& request, RpcEmpty& response, const RpcCall& call, void* context) {
+    if (request.host[0] == '\0' || request.port == 0 || request.port > 65535) {
+        return RpcStatus::BadRequest;
+    }
+    config.setString(CONFIG_BROKER_HOST, request.host);
+    config.setUint(CONFIG_BROKER_PORT, request.port);
+    return RpcStatus::Ok;
+}
+
+// Вызывается из сеттеров config в сетевой задаче.
+void onConfigChange(uint8_t id, void* context) {
+    if (id == CONFIG_WIFI_RECONNECT_MS) {
+        auth.setReconnectInterval(config->wifiReconnectMs);
+    } else if (id == CONFIG_BROKER_HOST || id == CONFIG_BROKER_PORT) {
+        LOG_INFO("[CFG] Broker %s:%u after restart\n",
+                 config->brokerHost, (unsigned)config->brokerPort);
+    }
+}
+
+RpcStatus rpcRestart(const RpcEmpty& request, RpcEmpty& response, const RpcCall& call, void* context) {
+    networkJobs.after(1000, restartDevice); // ответ успеет уйти брокеру
+    return RpcStatus::Ok;
+}
+
+// Пинг обрабатывает прикладная часть: передаём сообщение в loop().
+void onPing(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    OutboundMessage* slot = toApplication.reserve();
+    if (!slot || !slot->set(topic, payload, length, 0)) {
+        LOG_WARN("[MAIN] Application queue full, ping dropped\n");
+        return;
+    }
+    toApplication.commit();
+    wakeTask(applicationTask);
+}
+
+// OTA по MQTT: begin (OtaBegin в JSON), chunk (смещение LE32 + данные), end.
+// Состояние уходит в otaTopic после begin/end, при ошибке и раз в
+// OTA_PROGRESS_INTERVAL байт: по нему отправитель продолжает с нужного места.
+void onOta(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    const char* command = strrchr(topic, '/') + 1;
+    OtaError error;
+    if (strcmp(command, "chunk") == 0) {
+        error = ota.writeChunk(OtaTransport::Mqtt, payload, length);
+        if (error == OtaError::None && !ota.progressDue()) {
+            return;
+        }
+    } else if (strcmp(command, "begin") == 0) {
+        OtaBegin* request = mqtt.arena().create<OtaBegin>();
+        uint8_t digest[SHA256_SIZE];
+        uint8_t signature[SHA256_SIZE];
+        if (!request || parse_ota_begin((const char*)payload, length, *request) != JsonError::Ok ||
+            !sha256_from_hex(request->sha256, digest) || !sha256_from_hex(request->signature, signature)) {
+            LOG_INFO("[OTA] Invalid begin request\n");
+            return;
+        }
+        error = ota.begin(OtaTransport::Mqtt, request->size, digest, request->delta, signature);
+    } else if (strcmp(command, "end") == 0) {
+        error = ota.finish(OtaTransport::Mqtt);
+        if (error == OtaError::None) {
+            networkJobs.after(1000, restartDevice); // ответ успеет уйти брокеру
+        }
+    } else {
+        return;
+    }
+
+    char status[128];
+    size_t statusLength = ota.writeStatus(error, status, sizeof(status));
+    mqtt.publish(otaTopic.c_str(), (const uint8_t*)status, statusLength);
+}
+
+
+// --- СЕТЕВАЯ ЗАДАЧА (ядро 0) ---
+void wakeTask(TaskHandle_t task) {
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
 
+void logPortalStatus(void* context) {
     if (configMode) {
-        dnsServer.processNextRequest();
-        server.handleClient();
-        
-        static unsigned long lastStatus = 0;
-        if (millis() - lastStatus > 30000) {
-            lastStatus = millis();
-            // ⭐️ ИЗМЕНЕНО: Используем глобальную переменную deviceName
-            Serial.println("[WEB] Waiting for configuration... Connect to: " + deviceName);
+        // ⭐️ ИЗМЕНЕНО: Используем глобальную переменную deviceName
+        LOG_INFO("[WEB] Waiting for configuration... Connect to: %s (dns %u, redirects %u)\n",
+                 deviceName.c_str(), (unsigned)dnsServer.answered(), (unsigned)portalRedirects);
+    }
+}
+
+void restartDevice(void* context) {
+    config.commit(); // несохранённые изменения не должны пропасть
+    LOG_INFO("[OTA] Restarting into the new image...\n");
+    log_flush();
+    ESP.restart();
+}
+
+void rollbackUnconfirmed(void* context) {
+    ota_rollback();
+}
+
+void sampleMetrics(void* context) {
+    metrics_sample_system();
+}
+
+void publishStats(void* context) {
+    if (!mqtt.is_connected()) {
+        return; // устаревшая статистика в очереди не нужна
+    }
+    char payload[MQTT_QUEUE_PAYLOAD_SIZE];
+    size_t length = metrics_write_compact(payload, sizeof(payload));
+    if (length == 0) {
+        LOG_WARN("[MAIN] Stats do not fit in an MQTT message\n");
+        return;
+    }
+    mqtt.publish(statsTopic.c_str(), (const uint8_t*)payload, length);
+}
+
+#if WEB_CONFIG_GATEWAY
+// Узлы шлют на канале сети хаба, поэтому приём начинается после подключения.
+void startGateway() {
+    if (gatewayStarted) {
+        return;
+    }
+    gatewayStarted = true;
+    for (GatewayTransport* transport : gatewayTransports) {
+        if (!transport->begin()) {
+            LOG_WARN("[GW] Transport failed to start\n");
         }
+    }
+}
+
+void pollGateway() {
+    for (GatewayTransport* transport : gatewayTransports) {
+        transport->poll(gateway);
+    }
+}
+
+bool emitGatewayBatch(const char* payload, size_t length, void* context) {
+    return mqtt.publish(gatewayTopic.c_str(), (const uint8_t*)payload, length, 1);
+}
 
+void flushGateway(void* context) {
+    if (!mqtt.is_connected()) {
+        return; // окно копится дальше: min/max/count сохранятся до подключения
+    }
+    char payload[MQTT_QUEUE_PAYLOAD_SIZE];
+    gateway.flush(payload, sizeof(payload), emitGatewayBatch, nullptr);
+}
+#else
+void startGateway() {}
+void pollGateway() {}
+void flushGateway(void* context) {}
+#endif
+
+void publishQueued(SpscQueue<OutboundMessage, 8>& queue) {
+    while (OutboundMessage* message = queue.front()) {
+        mqtt.publish(message->topic, message->payload, message->length, message->qos);
+        queue.release();
+    }
+}
+
+void networkStep() {
+    // События WiFi разбираются в любом режиме: подключение идёт в фоне,
+    // пока портал обслуживает клиентов.
+    unsigned long started = micros();
+    auth.loop_wifi();
+    uint32_t wait = networkJobs.run();
+    uint32_t configWait = config.loop();
+    if (configWait < wait) {
+        wait = configWait;
+    }
+
+    if (!configMode && auth.is_connected()) {
+        mqtt.receive_message();
+        rpc.loop();
+
+        if (!boot_reached(BootPhase::MqttOnline) && mqtt.state() == MqttState::Online) {
+            boot_mark(BootPhase::MqttOnline);
+            boot_report(auth.usedCache() ? "cached" : "full");
+            ota_confirm_boot();
+        }
+
+        if (wifiCredentialsUpdated) {
+            wifiCredentialsUpdated = false;
+            LOG_INFO("[MAIN] Credentials updated via MQTT, reconnecting...\n");
+            connectToWiFi();
+        }
+    }
+
+    // Сообщения от прикладной части уходят в очередь MQTT в любом режиме:
+    // там они дождутся брокера, а при переполнении уйдут во flash.
+    publishQueued(toNetwork);
+    publishQueued(fromPortal);
+    pollGateway();
+
+    if (otaRestart.exchange(false)) {
+        networkJobs.after(1000, restartDevice); // ответ HTTP успеет уйти
+    }
+
+    mqttOnline = !configMode && mqtt.is_connected();
+    networkStepTime.observe(micros() - started);
+
+    // Без станции опрашивать нечего (портал и DNS работают по событиям):
+    // спим до таймера Auth или своего либо до уведомления. С подключением
+    // MQTT читает сокет каждый тик.
+    if (!auth.is_connected()) {
+        uint32_t authWait = auth.untilNext();
+        if (authWait < wait) {
+            wait = authWait;
+        }
+        ulTaskNotifyTake(pdTRUE, wait == SCHEDULER_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+    }
+}
+
+bool publishFromApplication(const char* topic, const char* message) {
+    OutboundMessage* slot = toNetwork.reserve();
+    if (!slot || !slot->set(topic, (const uint8_t*)message, strlen(message), 0)) {
+        return false;
+    }
+    toNetwork.commit();
+    wakeTask(networkTask);
+    return true;
+}
+
+
+// --- ОСНОВНЫЕ ФУНКЦИИ ---
+void setup() {
+    Serial.begin(115200);
+    LOG_INFO("=== ESP32 Starting ===\n");
+    bool otaTrial = ota_check_boot();
+    config.begin();
+    config.subscribe(onConfigChange);
+    auth.setReconnectInterval(config->wifiReconnectMs);
+    if (config->brokerHost[0] != '\0') {
+        mqtt.addBroker(config->brokerHost, (uint16_t)config->brokerPort);
+    }
+    mqtt.on("esp32/wifi", onWiFiCredentials);
+    mqtt.on("esp32/wifi" MQTT_CBOR_SUFFIX, onWiFiCredentials);
+    mqtt.on("esp32/test", onPing);
+    mqtt.beginSpill();
+    auth.onStateChange(onWiFiState);
+    setupPortal();
+    mqtt.on(otaFilter.c_str(), onOta);
+    rpc.begin(rpcBase.c_str());
+    rpc.on("status", RPC_EMPTY_SCHEMA, DEVICE_STATUS_SCHEMA, rpcStatus);
+    rpc.on("wifi", WIFI_CREDENTIALS_SCHEMA, RPC_EMPTY_SCHEMA, rpcWiFi);
+    rpc.on("broker", BROKER_CONFIG_SCHEMA, RPC_EMPTY_SCHEMA, rpcBroker);
+    rpc.on("restart", RPC_EMPTY_SCHEMA, RPC_EMPTY_SCHEMA, rpcRestart);
+    // Уже настроенное устройство сразу подключается к известной сети,
+    // портал поднимется, только если не выйдет и обычное подключение.
+    bool configured = config->wifiSsid[0] != '\0' && auth.setCredentials(config->wifiSsid, config->wifiPassword);
+    if (configured && auth.connect_cached()) {
+        configMode = false;
     } else {
-        auth.loop_wifi();
-        if (auth.is_connected()) {
-            mqtt.receive_message();
-
-            if (wifiCredentialsUpdated) {
-                wifiCredentialsUpdated = false;
-                Serial.println("[MAIN] Credentials updated via MQTT, reconnecting...");
-                connectToWiFi();
-            }
-
-            static unsigned long lastMessage = 0;
-            if (millis() - lastMessage > 10000) {
-                lastMessage = millis();
-                mqtt.send_message("Hello from ESP32!");
-                Serial.println("[MAIN] Sent test message");
-            }
-        } else {
-            Serial.println("[MAIN] WiFi connection lost. Starting AP mode...");
-            startAPMode();
+        startAPMode();
+        if (configured) {
+            connectToWiFi(); // AP+STA: портал остаётся, пока сеть не ответит
         }
     }
-}
\ No newline at end of file
+    // После WiFi.mode(): сервер работает всё время, портал в AP, /status и /metrics в STA.
+    server.begin();
+    applicationTask = xTaskGetCurrentTaskHandle();
+    applicationJobs.every(10000, sendTestMessage);
+    networkJobs.every(30000, logPortalStatus);
+    networkJobs.every(1000, sampleMetrics, nullptr, 1);
+    networkJobs.every(WEB_CONFIG_STATS_INTERVAL_MS, publishStats);
+    if (WEB_CONFIG_GATEWAY) {
+        networkJobs.every(GATEWAY_WINDOW_MS, flushGateway);
+    }
+    if (otaTrial) {
+        networkJobs.after(OTA_CONFIRM_TIMEOUT_MS, rollbackUnconfirmed);
+    }
+    start_pinned_task("network", networkStep, NETWORK_CORE, 8192, 2, &networkTask);
+    auth.wakeOnEvent(networkTask);
+}
+
+void sendTestMessage(void* context) {
+    if (mqttOnline && publishFromApplication("esp32/test", "Hello from ESP32!")) {
+        LOG_INFO("[MAIN] Sent test message\n");
+    }
+}
+
+// Прикладная задача (ядро 1): не ждёт сеть и не трогает её объекты напрямую.
+void loop() {
+    while (OutboundMessage* message = toApplication.front()) {
+        if (strcmp(message->topic, "esp32/test") == 0) {
+            LOG_INFO("Ping received!\n");
+        }
+        toApplication.release();
+    }
+
+    uint32_t wait = applicationJobs.run();
+    ulTaskNotifyTake(pdTRUE, wait == SCHEDULER_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+}
@@ -0,0 +1,16 @@
+#include "arena.hpp"
+
+void* Arena::allocate(size_t size, size_t align) {
+    uintptr_t base = (uintptr_t)_buffer;
+    uintptr_t start = (base + _used + align - 1) & ~(uintptr_t)(align - 1);
+    size_t offset = start - base;
+    if (offset > _capacity || size > _capacity - offset) {
+        _failures++;
+        return nullptr;
+    }
+    _used = offset + size;
+    if (_used > _highWater) {
+        _highWater = _used;
+    }
+    return _buffer + offset;
+}
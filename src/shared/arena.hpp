@@ -0,0 +1,66 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// Bump-аллокатор поверх заранее выделенного буфера: память на время одного
+// сообщения или запроса берётся сдвигом указателя и возвращается целиком
+// (ArenaScope или reset()). Освобождать по одному объекту нельзя, деструкторы
+// не вызываются - только для простых структур и буферов.
+class Arena {
+public:
+    Arena(uint8_t* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {}
+
+    // nullptr, если не хватает места.
+    void* allocate(size_t size, size_t align = alignof(max_align_t));
+
+    template <typename T>
+    T* create() {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return memory ? new (memory) T() : nullptr;
+    }
+
+    void reset() { _used = 0; }
+    size_t used() const { return _used; }
+    size_t capacity() const { return _capacity; }
+    // Наибольшее заполнение с запуска: по нему подбирается размер арены.
+    size_t highWater() const { return _highWater; }
+    size_t failures() const { return _failures; }
+
+private:
+    friend class ArenaScope;
+
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _used = 0;
+    size_t _highWater = 0;
+    size_t _failures = 0;
+};
+
+template <size_t Capacity>
+class StaticArena : public Arena {
+public:
+    StaticArena() : Arena(_storage, Capacity) {}
+
+private:
+    alignas(max_align_t) uint8_t _storage[Capacity];
+};
+
+// Всё, что выделено в арене за время жизни scope, освобождается при выходе.
+// Вложенные scope работают как стек.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : _arena(arena), _mark(arena._used) {}
+    ~ArenaScope() { _arena._used = _mark; }
+
+private:
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+
+    Arena& _arena;
+    size_t _mark;
+};
+
+#endif
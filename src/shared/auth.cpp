@@ -1,81 +1,265 @@
 #include "auth.hpp"
-#include <ArduinoJson.h>
+#include "boot_profile.hpp"
+#include "wifi_cache.hpp"
+#include "binlog.hpp"
 #include <WiFi.h>
 
-Auth::Auth(const String& ssid, const String& password)
+const char* wifi_state_name(WiFiState state) {
+    switch (state) {
+        case WiFiState::Idle:       return "idle";
+        case WiFiState::Connecting: return "connecting";
+        case WiFiState::Connected:  return "connected";
+        case WiFiState::Failed:     return "failed";
+    }
+    return "unknown";
+}
+
+Auth::Auth(const char* ssid, const char* password)
     : _ssid(ssid), _password(password) {}
 
-void Auth::setCredentials(const String& ssid, const String& password) {
-    Serial.printf("Setting new credentials: SSID=%s, PASS=%s\n", ssid.c_str(), password.c_str());
+bool Auth::setCredentials(const char* ssid, const char* password) {
+    if (strlen(ssid) > _ssid.capacity() || strlen(password) > _password.capacity()) {
+        LOG_WARN("[WiFi] Credentials too long, ignored\n");
+        return false;
+    }
+    LOG_INFO("[WiFi] Setting new credentials: SSID=%s, PASS=%s\n", ssid, log_secret(password));
     _ssid = ssid;
     _password = password;
+    return true;
+}
+
+void Auth::onStateChange(WiFiStateCallback callback, void* context) {
+    _callback = callback;
+    _callbackContext = context;
+}
+
+void Auth::registerEvents() {
+    if (_eventsRegistered) {
+        return;
+    }
+    _eventsRegistered = true;
+
+    // Обработчик работает в задаче событий WiFi: только выставляет флаги.
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+            boot_mark(BootPhase::WiFiUp);
+        } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+            boot_mark(BootPhase::IpAcquired);
+            _events.fetch_and((uint8_t)~EVENT_DOWN_LAST);
+            _events.fetch_or(EVENT_GOT_IP);
+        } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+            _disconnectReason = info.wifi_sta_disconnected.reason;
+            _events.fetch_or(EVENT_DISCONNECTED | EVENT_DOWN_LAST);
+        } else if (event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+            _events.fetch_or(EVENT_DISCONNECTED | EVENT_DOWN_LAST);
+        } else {
+            return;
+        }
+        if (_wakeTask) {
+            xTaskNotifyGive(_wakeTask);
+        }
+    });
 }
 
 void Auth::connect_wifi() {
-    Serial.printf("[WiFi] Connecting to SSID: %s\n", _ssid.c_str());
-    Serial.printf("[WiFi] Using password: %s\n", _password.c_str());
-WiFi.disconnect(true);  // true - удалить старую конфигурацию
-delay(1000);
-    WiFi.begin(_ssid.c_str(), _password.c_str());
+    LOG_INFO("[WiFi] Connecting to SSID: %s\n", _ssid.c_str());
+
+    _fastPath = false;
+    _usedCache = false;
+    if (_staticIp) {
+        // Нули возвращают DHCP вместо сохранённого адреса.
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+        _staticIp = false;
+    }
+    beginStation(0, nullptr);
+}
 
-    unsigned long startAttemptTime = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 10000) {
-        delay(500);
-        Serial.print(".");
+bool Auth::connect_cached() {
+    WiFiCache cache;
+    if (_ssid.empty() || !wifi_cache_load(cache) || _ssid != cache.ssid) {
+        return false;
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\n[WiFi] Connected!");
-        Serial.print("[WiFi] IP Address: ");
-        Serial.println(WiFi.localIP());
-    } else {
-        Serial.println("\n[WiFi] Failed to connect!");
-        print_wifi_status();
+    _fastPath = true;
+    _usedCache = true;
+    LOG_INFO("[WiFi] Fast connect to SSID: %s, channel %u\n", cache.ssid, cache.channel);
+
+    if (cache.ip != 0) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet),
+                    IPAddress(cache.dns));
+        _staticIp = true;
     }
+    beginStation(cache.channel, cache.bssid);
+    return true;
 }
 
+void Auth::beginStation(int32_t channel, const uint8_t* bssid) {
+    registerEvents();
 
+    // Точку доступа не гасим: портал работает, пока идёт ассоциация.
+    wifi_mode_t mode = WiFi.getMode();
+    if (mode == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+    } else if (mode == WIFI_AP) {
+        WiFi.mode(WIFI_AP_STA);
+    }
+    WiFi.persistent(false);
 
+    _events = 0;
+    _autoReconnect = true;
+    _connectStarted = millis();
+    _timers.cancel(_reconnectJob);
+    _timers.cancel(_timeoutJob);
+    _timeoutJob = _timers.after(_fastPath ? _fastConnectTimeout : _connectTimeout, connectTimedOut, this);
+    setState(WiFiState::Connecting);
+    WiFi.begin(_ssid.c_str(), _password.c_str(), channel, bssid);
+}
 
-void Auth::loop_wifi() {
-    if (WiFi.status() != WL_CONNECTED && millis() - _lastReconnectAttempt > _reconnectInterval) {
-        Serial.println("[WiFi] Lost connection or credentials changed, reconnecting...");
-        _lastReconnectAttempt = millis();
+// Неудачный быстрый путь не считается ошибкой: сразу пробуем обычный.
+void Auth::connectFailed() {
+    _timers.cancel(_timeoutJob);
+    print_wifi_status();
+    if (_fastPath) {
+        LOG_WARN("[WiFi] Cached connection failed, falling back to full scan\n");
         connect_wifi();
-        Serial.print("[WiFi] After connect_wifi status: ");
-        Serial.println(WiFi.status());
+        return;
+    }
+    // Повтор не чаще, чем раз в _reconnectInterval от начала прошлой попытки.
+    unsigned long elapsed = millis() - _connectStarted;
+    scheduleReconnect(elapsed < _reconnectInterval ? _reconnectInterval - elapsed : 0);
+    setState(WiFiState::Failed);
+}
+
+void Auth::scheduleReconnect(unsigned long delayMs) {
+    _timers.cancel(_reconnectJob);
+    if (_autoReconnect) {
+        _reconnectJob = _timers.after(delayMs, reconnect, this);
+    }
+}
+
+void Auth::connectTimedOut(void* context) {
+    Auth* auth = (Auth*)context;
+    if (auth->_state != WiFiState::Connecting) {
+        return;
+    }
+    LOG_WARN("[WiFi] Connection timed out\n");
+    WiFi.disconnect();
+    auth->_events = 0;
+    auth->connectFailed();
+}
+
+void Auth::reconnect(void* context) {
+    Auth* auth = (Auth*)context;
+    if (auth->_state == WiFiState::Connected || auth->_state == WiFiState::Connecting) {
+        return;
     }
+    LOG_WARN("[WiFi] Lost connection or credentials changed, reconnecting...\n");
+    auth->connect_wifi();
+}
+
+void Auth::storeCache() {
+    WiFiCache cache;
+    memset(&cache, 0, sizeof(cache));
+    memcpy(cache.ssid, _ssid.c_str(), _ssid.length());  // не длиннее 32, ноль - от memset
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) {
+        memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    }
+    cache.channel = (uint8_t)WiFi.channel();
+    cache.ip = (uint32_t)WiFi.localIP();
+    cache.gateway = (uint32_t)WiFi.gatewayIP();
+    cache.subnet = (uint32_t)WiFi.subnetMask();
+    cache.dns = (uint32_t)WiFi.dnsIP(0);
+    if (!wifi_cache_store(cache)) {
+        LOG_WARN("[WiFi] Failed to save connection cache\n");
+    }
+}
+
+void Auth::handleGotIp() {
+    if (WiFi.status() == WL_CONNECTED && _state != WiFiState::Connected) {
+        _timers.cancel(_timeoutJob);
+        IPAddress ip = WiFi.localIP();
+        LOG_INFO("[WiFi] Connected! IP Address: %u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
+        storeCache();
+        setState(WiFiState::Connected);
+    }
+}
+
+void Auth::handleDisconnected() {
+    if (_state == WiFiState::Connected) {
+        LOG_WARN("[WiFi] Lost connection, reason=%u\n", (unsigned)_disconnectReason);
+        scheduleReconnect(_reconnectInterval);
+        setState(WiFiState::Idle);
+    } else if (_state == WiFiState::Connecting &&
+               _disconnectReason != WIFI_REASON_ASSOC_LEAVE) {
+        // ASSOC_LEAVE - это разрыв старой ассоциации при новом begin(), не ошибка.
+        LOG_WARN("[WiFi] Failed to connect, reason=%u\n", (unsigned)_disconnectReason);
+        connectFailed();
+    }
+}
+
+void Auth::loop_wifi() {
+    uint8_t events = _events.exchange(0);
+
+    // За один проход могут прийти оба события: разбираем в порядке прихода.
+    if ((events & EVENT_DISCONNECTED) && !(events & EVENT_DOWN_LAST)) {
+        handleDisconnected();
+    }
+    if (events & EVENT_GOT_IP) {
+        handleGotIp();
+    }
+    if ((events & EVENT_DISCONNECTED) && (events & EVENT_DOWN_LAST)) {
+        handleDisconnected();
+    }
+
+    _timers.run();
 }
 
 bool Auth::is_connected() {
-    return WiFi.status() == WL_CONNECTED;
+    return _state == WiFiState::Connected && WiFi.status() == WL_CONNECTED;
 }
 
 void Auth::disconnect_wifi() {
+    _autoReconnect = false;
+    _timers.cancel(_timeoutJob);
+    _timers.cancel(_reconnectJob);
     WiFi.disconnect(true, true); // отключить и очистить
-    Serial.println("[WiFi] Disconnected.");
-    delay(1000); // пауза для стабилизации
+    _events = 0;
+    setState(WiFiState::Idle);
+    LOG_INFO("[WiFi] Disconnected.\n");
 }
+
+void Auth::setState(WiFiState state) {
+    if (state == _state) {
+        return;
+    }
+    WiFiState previous = _state;
+    _state = state;
+    if (_callback) {
+        _callback(previous, state, _callbackContext);
+    }
+}
+
 void Auth::print_wifi_status() {
     wl_status_t status = WiFi.status();
     switch (status) {
         case WL_NO_SSID_AVAIL:
-            Serial.println("[WiFi] No SSID available");
+            LOG_WARN("[WiFi] No SSID available\n");
             break;
         case WL_CONNECT_FAILED:
-            Serial.println("[WiFi] Connection failed (wrong password?)");
+            LOG_WARN("[WiFi] Connection failed (wrong password?)\n");
+            break;
+        case WL_CONNECTION_LOST:
+            LOG_WARN("[WiFi] Connection lost\n");
             break;
         case WL_IDLE_STATUS:
-            Serial.println("[WiFi] Idle");
+            LOG_INFO("[WiFi] Idle\n");
             break;
         case WL_DISCONNECTED:
-            Serial.println("[WiFi] Disconnected");
+            LOG_INFO("[WiFi] Disconnected\n");
             break;
         default:
-            Serial.print("[WiFi] Unknown status: ");
-            Serial.println(status);
+            LOG_WARN("[WiFi] Unknown status: %d\n", (int)status);
             break;
     }
 }
-
-
@@ -4,22 +4,94 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "scheduler.hpp"
+#include "fixed_string.hpp"
 
+enum class WiFiState : uint8_t {
+    Idle,
+    Connecting,
+    Connected,
+    Failed
+};
+
+const char* wifi_state_name(WiFiState state);
+
+typedef void (*WiFiStateCallback)(WiFiState previous, WiFiState current, void* context);
+
+// Подключение к WiFi по системным событиям: connect_wifi() только запускает
+// ассоциацию, loop_wifi() разбирает пришедшие события и выполняет таймеры
+// (таймаут, переподключение). Ничего не ждёт через delay(): вызывающий цикл
+// может спать untilNext() мс или до уведомления от wakeOnEvent().
 class Auth {
 public:
-    Auth(const String& ssid, const String& password);
+    Auth(const char* ssid, const char* password);
     void connect_wifi();
     void loop_wifi();
     bool is_connected();
     void disconnect_wifi();
-    String _ssid;
+    FixedString<32> _ssid;
+
+    // false - SSID длиннее 32 или пароль длиннее 64 символов, учётные данные не меняются.
+    bool setCredentials(const char* ssid, const char* password);
 
-    void setCredentials(const String& ssid, const String& password);
+    WiFiState state() const { return _state; }
+    // Вызывается из loop_wifi() при каждой смене состояния.
+    void onStateChange(WiFiStateCallback callback, void* context = nullptr);
+    void setConnectTimeout(unsigned long ms) { _connectTimeout = ms; }
+    void setReconnectInterval(unsigned long ms) { _reconnectInterval = ms; }
+    // Мс до ближайшего таймера Auth, SCHEDULER_IDLE - таймеров нет.
+    uint32_t untilNext() const { return _timers.untilNext(); }
+    // Задача, которую будит xTaskNotifyGive() при событии WiFi.
+    void wakeOnEvent(TaskHandle_t task) { _wakeTask = task; }
+
+    // Быстрый старт по сохранённому подключению (BSSID, канал, адрес) к сети,
+    // заданной setCredentials(). false - сохранено подключение к другой сети
+    // или нет никакого. Если быстрый путь не сработал, Auth сам переходит
+    // к обычному подключению со сканированием и DHCP.
+    bool connect_cached();
+    bool usedCache() const { return _usedCache; }
 
 private:
-    String _password;
-    unsigned long _lastReconnectAttempt = 0;
+    FixedString<64> _password;
     unsigned long _reconnectInterval = 5000;
+    unsigned long _connectTimeout = 10000;
+    unsigned long _connectStarted = 0;
+    bool _autoReconnect = false;
+    bool _eventsRegistered = false;
+    unsigned long _fastConnectTimeout = 3000;
+    bool _fastPath = false;
+    bool _usedCache = false;
+    bool _staticIp = false;
+
+    WiFiState _state = WiFiState::Idle;
+    WiFiStateCallback _callback = nullptr;
+    void* _callbackContext = nullptr;
+
+    // Флаги из задачи событий WiFi, разбираются в loop_wifi().
+    static const uint8_t EVENT_GOT_IP = 0x01;
+    static const uint8_t EVENT_DISCONNECTED = 0x02;
+    static const uint8_t EVENT_DOWN_LAST = 0x04;  // DISCONNECTED пришёл позже GOT_IP
+    std::atomic<uint8_t> _events{0};
+    std::atomic<uint8_t> _disconnectReason{0};
+    TaskHandle_t _wakeTask = nullptr;
+
+    Scheduler<2> _timers{millis};
+    JobId _timeoutJob = NO_JOB;
+    JobId _reconnectJob = NO_JOB;
+    static void connectTimedOut(void* context);
+    static void reconnect(void* context);
+    void scheduleReconnect(unsigned long delayMs);
+
+    void registerEvents();
+    void beginStation(int32_t channel, const uint8_t* bssid);
+    void connectFailed();
+    void handleGotIp();
+    void handleDisconnected();
+    void storeCache();
+    void setState(WiFiState state);
     void print_wifi_status();
 };
 
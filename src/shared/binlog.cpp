@@ -0,0 +1,234 @@
+#include "binlog.hpp"
+#include "frame_parser.hpp"
+#include "dual_core.hpp"
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+static_assert(LOG_MAX_RECORD <= 255, "Record length is stored in one byte");
+static_assert(LOG_MAX_RECORD + FRAME_OVERHEAD <= LOG_FRAME_SIZE, "A record must fit in one frame");
+
+static const size_t HEADER_SIZE = 10; // длина, уровень, время LE32, id LE32
+static const uint32_t MASK = LOG_BUFFER_SIZE - 1;
+
+// Несколько производителей без блокировок: место занимается CAS по _head,
+// запись копируется, последним пишется её первый байт (длина) - до этого
+// потребитель видит 0 и ждёт. Прочитанное потребитель обнуляет.
+static std::atomic<uint8_t> ring[LOG_BUFFER_SIZE];
+static std::atomic<uint32_t> ringHead(0);
+static std::atomic<uint32_t> ringTail(0);
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> draining(false);
+static std::atomic<bool> drainStarted(false);
+static std::atomic<TaskHandle_t> drainTask(nullptr);
+static uint32_t reportedDropped = 0;
+static uint8_t frameSequence = 0;
+
+static void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+LogRecord::LogRecord(uint8_t level, uint32_t id) : _length(HEADER_SIZE) {
+    _data[1] = level;
+    put_le32(_data + 2, (uint32_t)millis());
+    put_le32(_data + 6, id);
+}
+
+bool LogRecord::putArg(LogArg type) {
+    if (_truncated || _length >= LOG_MAX_RECORD) {
+        _truncated = true;
+        return false;
+    }
+    _data[_length++] = (uint8_t)type;
+    return true;
+}
+
+void LogRecord::putVarint(unsigned long long value) {
+    uint8_t bytes[10];
+    size_t count = 0;
+    do {
+        bytes[count] = value & 0x7F;
+        value >>= 7;
+        if (value) {
+            bytes[count] |= 0x80;
+        }
+        count++;
+    } while (value);
+    if (_length + count > LOG_MAX_RECORD) {
+        _length--; // без значения не нужен и тип
+        _truncated = true;
+        return;
+    }
+    memcpy(_data + _length, bytes, count);
+    _length += count;
+}
+
+void LogRecord::putSigned(long long value) {
+    if (putArg(LogArg::Signed)) {
+        putVarint(((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+    }
+}
+
+void LogRecord::putUnsigned(unsigned long long value) {
+    if (putArg(LogArg::Unsigned)) {
+        putVarint(value);
+    }
+}
+
+void LogRecord::putFloat(float value) {
+    if (!putArg(LogArg::Float)) {
+        return;
+    }
+    if (_length + 4 > LOG_MAX_RECORD) {
+        _length--;
+        _truncated = true;
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_le32(_data + _length, bits);
+    _length += 4;
+}
+
+void LogRecord::putString(const char* value) {
+    if (!putArg(LogArg::String)) {
+        return;
+    }
+    if (!value) {
+        value = "(null)";
+    }
+    size_t length = strnlen(value, LOG_MAX_STRING);
+    if (_length + 1 + length > LOG_MAX_RECORD) {
+        length = _length + 1 < LOG_MAX_RECORD ? LOG_MAX_RECORD - _length - 1 : 0;
+        _truncated = true;
+    }
+    _data[_length++] = (uint8_t)length;
+    memcpy(_data + _length, value, length);
+    _length += length;
+}
+
+static void start_drain();
+
+bool LogRecord::commit() {
+    _data[0] = (uint8_t)_length;
+    uint32_t length = _length;
+    uint32_t head = ringHead.load(std::memory_order_relaxed);
+    uint32_t used;
+    do {
+        used = head - ringTail.load(std::memory_order_acquire);
+        if (used + length > LOG_BUFFER_SIZE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!ringHead.compare_exchange_weak(head, head + length, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed));
+
+    for (uint32_t i = 1; i < length; i++) {
+        ring[(head + i) & MASK].store(_data[i], std::memory_order_relaxed);
+    }
+    ring[head & MASK].store(_data[0], std::memory_order_release);
+
+    // Текстовый режим пишет в Serial сам; в буфер тогда пишут только
+    // явные вызовы log_write(), и выводит их тот, кто зовёт log_drain().
+    if (LOG_BINARY && LOG_DRAIN_TASK) {
+        if (!drainStarted.load(std::memory_order_acquire)) {
+            start_drain();
+        } else if (used + length > LOG_BUFFER_SIZE / 2) {
+            TaskHandle_t task = drainTask.load(std::memory_order_acquire);
+            if (task) {
+                xTaskNotifyGive(task);
+            }
+        }
+    }
+    return true;
+}
+
+size_t log_drain(uint8_t* out, size_t capacity) {
+    if (capacity < LOG_FRAME_SIZE || draining.exchange(true, std::memory_order_acquire)) {
+        return 0;
+    }
+
+    uint8_t payload[LOG_FRAME_SIZE - FRAME_OVERHEAD];
+    size_t length = 0;
+
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reportedDropped) {
+        LogRecord record(LOG_LEVEL_WARN, LOG_ID_DROPPED);
+        record.put((unsigned long)(lost - reportedDropped));
+        record._data[0] = (uint8_t)record._length;
+        memcpy(payload, record._data, record._length);
+        length = record._length;
+        reportedDropped = lost;
+    }
+
+    uint32_t tail = ringTail.load(std::memory_order_relaxed);
+    for (;;) {
+        uint8_t size = ring[tail & MASK].load(std::memory_order_acquire);
+        if (size == 0 || length + size > sizeof(payload)) {
+            break;
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            payload[length + i] = ring[(tail + i) & MASK].load(std::memory_order_relaxed);
+            ring[(tail + i) & MASK].store(0, std::memory_order_relaxed);
+        }
+        length += size;
+        tail += size;
+        ringTail.store(tail, std::memory_order_release);
+    }
+
+    size_t frame = 0;
+    if (length > 0) {
+        frame = frame_encode(LOG_FRAME_TYPE, frameSequence++, payload, length, out, capacity);
+    }
+    draining.store(false, std::memory_order_release);
+    return frame;
+}
+
+void log_flush() {
+    uint8_t frame[LOG_FRAME_SIZE];
+    size_t length;
+    while ((length = log_drain(frame, sizeof(frame))) > 0) {
+        Serial.write(frame, length);
+    }
+    Serial.flush();
+}
+
+void log_text(const char* format, ...) {
+    char text[LOG_TEXT_SIZE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length <= 0) {
+        return;
+    }
+    Serial.write((const uint8_t*)text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+}
+
+uint32_t log_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+static void drain_step() {
+    uint8_t frame[LOG_FRAME_SIZE];
+    size_t length;
+    while ((length = log_drain(frame, sizeof(frame))) > 0) {
+        Serial.write(frame, length);
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+}
+
+// Ниже сетевой задачи, наравне с loop(): вывод в UART не отнимает время у сети.
+static void start_drain() {
+    if (drainStarted.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    TaskHandle_t task = nullptr;
+    start_pinned_task("log", drain_step, APPLICATION_CORE, 3072, 1, &task);
+    drainTask.store(task, std::memory_order_release);
+}
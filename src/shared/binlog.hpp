@@ -0,0 +1,196 @@
+#ifndef BINLOG_HPP
+#define BINLOG_HPP
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Вызовы выше этого уровня не попадают в прошивку вместе с аргументами.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 1 - двоичные записи через буфер (на плате), 0 - сразу текстом через
+// Serial.printf (хост: симулятор, бенчмарки).
+#ifndef LOG_BINARY
+#ifdef ESP_PLATFORM
+#define LOG_BINARY 1
+#else
+#define LOG_BINARY 0
+#endif
+#endif
+
+// Кольцевой буфер записей, степень двойки.
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096
+#endif
+
+// Запись с аргументами; строки длиннее LOG_MAX_STRING обрезаются.
+#ifndef LOG_MAX_RECORD
+#define LOG_MAX_RECORD 160
+#endif
+
+#ifndef LOG_MAX_STRING
+#define LOG_MAX_STRING 64
+#endif
+
+// 1 - первая запись запускает фоновую задачу, которая выводит кадры в Serial;
+// 0 - приложение само зовёт log_drain() и решает, куда слать кадры.
+#ifndef LOG_DRAIN_TASK
+#define LOG_DRAIN_TASK 1
+#endif
+
+// Как часто фоновая задача выводит накопленное; при заполнении буфера
+// наполовину задачу будят раньше.
+#ifndef LOG_DRAIN_INTERVAL_MS
+#define LOG_DRAIN_INTERVAL_MS 50
+#endif
+
+// Кадры frame_parser.hpp с этим type несут записи лога.
+const uint8_t LOG_FRAME_TYPE = 0x4C; // 'L'
+const uint32_t LOG_ID_DROPPED = 0;   // служебная запись: сколько записей не влезло
+
+// Типы аргументов в записи.
+enum class LogArg : uint8_t {
+    Signed = 1,    // zigzag varint
+    Unsigned = 2,  // varint
+    Float = 3,     // float LE32
+    String = 4,    // длина u8 + байты
+    Secret = 5     // только отметка, значение не пишется
+};
+
+// id записи - FNV-1a строки формата, считается при компиляции; сама строка
+// в прошивку не попадает. tools/log_decode находит её по тем же хэшам в исходниках.
+constexpr uint32_t log_hash(const char* text, uint32_t hash = 2166136261u) {
+    return *text ? log_hash(text + 1, (hash ^ (uint8_t)*text) * 16777619u) : hash;
+}
+
+// Секреты (пароли, ключи) не выводятся ни в каком режиме:
+//   LOG_INFO("[WiFi] PASS=%s\n", log_secret(password));
+struct LogSecret {
+    const char* value;
+};
+
+#if LOG_BINARY
+inline LogSecret log_secret(const char* value) {
+    return LogSecret{value};
+}
+#else
+// Текстом отметка подставляется сразу: аргументы log_text() - обычные
+// типы printf, и формат проверяет компилятор.
+inline const char* log_secret(const char*) {
+    return "[redacted]";
+}
+#endif
+
+// Сборка одной записи на стеке вызывающего; commit() копирует её в буфер.
+class LogRecord {
+public:
+    LogRecord(uint8_t level, uint32_t id);
+
+    void put(char value) { putSigned(value); }
+    void put(signed char value) { putSigned(value); }
+    void put(short value) { putSigned(value); }
+    void put(int value) { putSigned(value); }
+    void put(long value) { putSigned(value); }
+    void put(long long value) { putSigned(value); }
+    void put(bool value) { putUnsigned(value); }
+    void put(unsigned char value) { putUnsigned(value); }
+    void put(unsigned short value) { putUnsigned(value); }
+    void put(unsigned value) { putUnsigned(value); }
+    void put(unsigned long value) { putUnsigned(value); }
+    void put(unsigned long long value) { putUnsigned(value); }
+    void put(float value) { putFloat(value); }
+    void put(double value) { putFloat((float)value); }
+    void put(const char* value) { putString(value); }
+    void put(const void* value) { putUnsigned((uintptr_t)value); }
+    void put(const LogSecret&) { putArg(LogArg::Secret); }
+
+    // false - буфер полон, запись потеряна (учтётся в log_dropped()).
+    bool commit();
+
+private:
+    friend size_t log_drain(uint8_t* out, size_t capacity);
+
+    void putSigned(long long value);
+    void putUnsigned(unsigned long long value);
+    void putFloat(float value);
+    void putString(const char* value);
+    bool putArg(LogArg type);
+    void putVarint(unsigned long long value);
+
+    uint8_t _data[LOG_MAX_RECORD];
+    size_t _length;
+    bool _truncated = false;
+};
+
+inline void log_put_all(LogRecord&) {}
+
+template <typename T, typename... Args>
+void log_put_all(LogRecord& record, const T& value, const Args&... rest) {
+    record.put(value);
+    log_put_all(record, rest...);
+}
+
+template <typename... Args>
+void log_write(uint8_t level, uint32_t id, const Args&... args) {
+    LogRecord record(level, id);
+    log_put_all(record, args...);
+    record.commit();
+}
+
+// Текстовый режим: строка сразу в Serial, длиннее LOG_TEXT_SIZE обрезается.
+// Формат и аргументы проверяет компилятор (-Wformat) - на хосте так
+// собираются все LOG_*, в том числе те, что на плате уходят записями.
+#ifndef LOG_TEXT_SIZE
+#define LOG_TEXT_SIZE 256
+#endif
+void log_text(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Кадр с очередными записями в out, 0 - выводить нечего. capacity - не меньше
+// LOG_FRAME_SIZE. Потребитель один: параллельный вызов сразу возвращает 0.
+const size_t LOG_FRAME_SIZE = 256;
+size_t log_drain(uint8_t* out, size_t capacity);
+// Вывести всё накопленное сейчас (перед перезагрузкой).
+void log_flush();
+uint32_t log_dropped();
+
+#if LOG_BINARY
+#define LOG_AT(level, format, ...) \
+    log_write(level, std::integral_constant<uint32_t, log_hash(format)>::value, ##__VA_ARGS__)
+#else
+#define LOG_AT(level, format, ...) log_text(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) LOG_AT(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) LOG_AT(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) LOG_AT(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) LOG_AT(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#include "boot_profile.hpp"
+#include "binlog.hpp"
+#include <atomic>
+
+static const uint8_t PHASES = (uint8_t)BootPhase::Count;
+static std::atomic<unsigned long> phaseAt[PHASES];
+static std::atomic<bool> phaseReached[PHASES];
+
+static const char* const phaseNames[PHASES] = { "wifi", "ip", "mqtt" };
+
+void boot_mark(BootPhase phase) {
+    uint8_t index = (uint8_t)phase;
+    if (index >= PHASES || phaseReached[index]) {
+        return;
+    }
+    phaseAt[index] = millis();
+    phaseReached[index] = true;
+}
+
+bool boot_reached(BootPhase phase) {
+    return (uint8_t)phase < PHASES && phaseReached[(uint8_t)phase];
+}
+
+unsigned long boot_phase_ms(BootPhase phase) {
+    return boot_reached(phase) ? phaseAt[(uint8_t)phase].load() : 0;
+}
+
+// По записи на этап: в двоичном логе - числа, а не собранная строка.
+void boot_report(const char* path) {
+    unsigned long previous = 0;
+    for (uint8_t i = 0; i < PHASES; i++) {
+        if (!phaseReached[i]) {
+            LOG_INFO("[BOOT] %s: %s -\n", path, phaseNames[i]);
+            continue;
+        }
+        unsigned long at = phaseAt[i];
+        LOG_INFO("[BOOT] %s: %s %lu ms (+%lu)\n", path, phaseNames[i], at, at - previous);
+        previous = at;
+    }
+}
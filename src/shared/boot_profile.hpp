@@ -0,0 +1,25 @@
+#ifndef BOOT_PROFILE_HPP
+#define BOOT_PROFILE_HPP
+
+#include <Arduino.h>
+
+// Время от старта до ключевых этапов подключения (millis() с момента загрузки).
+enum class BootPhase : uint8_t {
+    WiFiUp,      // ассоциация с точкой доступа
+    IpAcquired,  // есть адрес (DHCP или сохранённый)
+    MqttOnline,  // брокер принял сессию и подписки
+    Count
+};
+
+// Запоминает только первое достижение этапа; можно вызывать из обработчиков событий WiFi.
+void boot_mark(BootPhase phase);
+bool boot_reached(BootPhase phase);
+unsigned long boot_phase_ms(BootPhase phase);
+
+// По строке на этап:
+//   [BOOT] cached: wifi 412 ms (+412)
+//   [BOOT] cached: ip 418 ms (+6)
+//   [BOOT] cached: mqtt 596 ms (+178)
+void boot_report(const char* path);
+
+#endif
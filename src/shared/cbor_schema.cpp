@@ -0,0 +1,292 @@
+#include "cbor_schema.hpp"
+#include <string.h>
+
+namespace {
+
+const uint8_t MAJOR_UNSIGNED = 0;
+const uint8_t MAJOR_NEGATIVE = 1;
+const uint8_t MAJOR_BYTES = 2;
+const uint8_t MAJOR_TEXT = 3;
+const uint8_t MAJOR_ARRAY = 4;
+const uint8_t MAJOR_MAP = 5;
+const uint8_t MAJOR_TAG = 6;
+const uint8_t MAJOR_SIMPLE = 7;
+
+const uint8_t SIMPLE_FALSE = 20;
+const uint8_t SIMPLE_TRUE = 21;
+const uint8_t INDEFINITE = 31;
+const uint8_t MAX_DEPTH = 16;
+
+// --- Запись ---
+
+struct Writer {
+    uint8_t* out;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    void put(const void* data, size_t size) {
+        if (length + size > capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + length, data, size);
+        length += size;
+    }
+
+    void head(uint8_t major, uint32_t value) {
+        uint8_t bytes[5];
+        size_t size;
+        if (value < 24) {
+            bytes[0] = (uint8_t)(major << 5 | value);
+            size = 1;
+        } else if (value <= 0xFF) {
+            bytes[0] = (uint8_t)(major << 5 | 24);
+            bytes[1] = (uint8_t)value;
+            size = 2;
+        } else if (value <= 0xFFFF) {
+            bytes[0] = (uint8_t)(major << 5 | 25);
+            bytes[1] = (uint8_t)(value >> 8);
+            bytes[2] = (uint8_t)value;
+            size = 3;
+        } else {
+            bytes[0] = (uint8_t)(major << 5 | 26);
+            bytes[1] = (uint8_t)(value >> 24);
+            bytes[2] = (uint8_t)(value >> 16);
+            bytes[3] = (uint8_t)(value >> 8);
+            bytes[4] = (uint8_t)value;
+            size = 5;
+        }
+        put(bytes, size);
+    }
+};
+
+// --- Чтение ---
+
+struct Reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+
+    // Заголовок элемента: major type и аргумент (длина или значение).
+    bool head(uint8_t& major, uint64_t& value) {
+        if (pos >= end) {
+            return false;
+        }
+        uint8_t initial = *pos++;
+        major = initial >> 5;
+        uint8_t info = initial & 0x1F;
+        if (info < 24) {
+            value = info;
+            return true;
+        }
+        if (info > 27) {
+            return false;  // неопределённая длина и зарезервированные значения
+        }
+        size_t size = (size_t)1 << (info - 24);
+        if ((size_t)(end - pos) < size) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value = value << 8 | *pos++;
+        }
+        return true;
+    }
+
+    bool skip(uint8_t depth) {
+        uint8_t major;
+        uint64_t value;
+        if (depth >= MAX_DEPTH || !head(major, value)) {
+            return false;
+        }
+        switch (major) {
+            case MAJOR_BYTES:
+            case MAJOR_TEXT:
+                if ((uint64_t)(end - pos) < value) {
+                    return false;
+                }
+                pos += value;
+                return true;
+            case MAJOR_ARRAY:
+            case MAJOR_MAP: {
+                uint64_t items = major == MAJOR_MAP ? value * 2 : value;
+                for (uint64_t i = 0; i < items; i++) {
+                    if (!skip(depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case MAJOR_TAG:
+                return skip(depth + 1);
+            default:
+                return true;  // числа и simple/float - целиком в заголовке
+        }
+    }
+};
+
+JsonError read_field(Reader& in, const JsonField& field, uint8_t* message) {
+    void* target = message + field.offset;
+    uint8_t major;
+    uint64_t value;
+    if (!in.head(major, value)) {
+        return JsonError::Syntax;
+    }
+
+    switch (field.type) {
+        case JsonType::String:
+            if (major != MAJOR_TEXT) {
+                return JsonError::Type;
+            }
+            if ((uint64_t)(in.end - in.pos) < value) {
+                return JsonError::Syntax;
+            }
+            if (value >= field.size) {
+                return JsonError::Oversize;
+            }
+            memcpy(target, in.pos, (size_t)value);
+            ((char*)target)[value] = '\0';
+            in.pos += value;
+            return JsonError::Ok;
+        case JsonType::Bool:
+            if (major != MAJOR_SIMPLE || (value != SIMPLE_FALSE && value != SIMPLE_TRUE)) {
+                return JsonError::Type;
+            }
+            *(bool*)target = value == SIMPLE_TRUE;
+            return JsonError::Ok;
+        case JsonType::Int:
+            if (major == MAJOR_UNSIGNED) {
+                if (value > INT32_MAX) {
+                    return JsonError::Oversize;
+                }
+                *(int32_t*)target = (int32_t)value;
+                return JsonError::Ok;
+            }
+            if (major == MAJOR_NEGATIVE) {
+                // -1 - value
+                if (value > INT32_MAX) {
+                    return JsonError::Oversize;
+                }
+                *(int32_t*)target = -1 - (int32_t)value;
+                return JsonError::Ok;
+            }
+            return JsonError::Type;
+        case JsonType::Uint:
+            if (major == MAJOR_NEGATIVE) {
+                return JsonError::Oversize;
+            }
+            if (major != MAJOR_UNSIGNED) {
+                return JsonError::Type;
+            }
+            if (value > UINT32_MAX) {
+                return JsonError::Oversize;
+            }
+            *(uint32_t*)target = (uint32_t)value;
+            return JsonError::Ok;
+    }
+    return JsonError::Type;
+}
+
+}  // namespace
+
+JsonError cbor_parse(const JsonSchema& schema, const uint8_t* data, size_t length, void* message) {
+    Reader in = { data, data + length };
+    uint32_t seen = 0;
+
+    uint8_t major;
+    uint64_t pairs;
+    if (!in.head(major, pairs) || major != MAJOR_MAP) {
+        return JsonError::Syntax;
+    }
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        const uint8_t* keyStart = in.pos;
+        uint64_t key;
+        if (!in.head(major, key)) {
+            return JsonError::Syntax;
+        }
+
+        int index = -1;
+        if (major == MAJOR_UNSIGNED) {
+            index = key < schema.count ? (int)key : -1;
+        } else if (major == MAJOR_TEXT) {
+            if ((uint64_t)(in.end - in.pos) < key) {
+                return JsonError::Syntax;
+            }
+            for (uint8_t f = 0; f < schema.count; f++) {
+                const char* name = schema.fields[f].name;
+                if (strlen(name) == key && memcmp(name, in.pos, (size_t)key) == 0) {
+                    index = f;
+                    break;
+                }
+            }
+            in.pos += key;
+        } else {
+            in.pos = keyStart;  // ключ другого типа пропускаем целиком
+            if (!in.skip(0)) {
+                return JsonError::Syntax;
+            }
+        }
+
+        if (index < 0) {
+            if (!in.skip(0)) {
+                return JsonError::Syntax;
+            }
+            continue;
+        }
+        JsonError error = read_field(in, schema.fields[index], (uint8_t*)message);
+        if (error != JsonError::Ok) {
+            return error;
+        }
+        if (index < 32) {
+            seen |= 1UL << index;
+        }
+    }
+
+    if (in.pos != in.end) {
+        return JsonError::Syntax;
+    }
+    for (uint8_t i = 0; i < schema.count && i < 32; i++) {
+        if (schema.fields[i].required && !(seen & (1UL << i))) {
+            return JsonError::Missing;
+        }
+    }
+    return JsonError::Ok;
+}
+
+size_t cbor_serialize(const JsonSchema& schema, const void* message, uint8_t* output, size_t capacity) {
+    Writer out = { output, capacity, 0, false };
+    const uint8_t* base = (const uint8_t*)message;
+
+    out.head(MAJOR_MAP, schema.count);
+    for (uint8_t i = 0; i < schema.count; i++) {
+        const JsonField& field = schema.fields[i];
+        const void* source = base + field.offset;
+        out.head(MAJOR_UNSIGNED, i);
+        switch (field.type) {
+            case JsonType::String: {
+                const char* text = (const char*)source;
+                size_t length = strnlen(text, field.size);
+                out.head(MAJOR_TEXT, (uint32_t)length);
+                out.put(text, length);
+                break;
+            }
+            case JsonType::Bool:
+                out.head(MAJOR_SIMPLE, *(const bool*)source ? SIMPLE_TRUE : SIMPLE_FALSE);
+                break;
+            case JsonType::Int: {
+                int32_t value = *(const int32_t*)source;
+                if (value < 0) {
+                    out.head(MAJOR_NEGATIVE, (uint32_t)(-1 - value));
+                } else {
+                    out.head(MAJOR_UNSIGNED, (uint32_t)value);
+                }
+                break;
+            }
+            case JsonType::Uint:
+                out.head(MAJOR_UNSIGNED, *(const uint32_t*)source);
+                break;
+        }
+    }
+    return out.overflow ? 0 : out.length;
+}
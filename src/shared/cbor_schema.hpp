@@ -0,0 +1,16 @@
+#ifndef CBOR_SCHEMA_HPP
+#define CBOR_SCHEMA_HPP
+
+#include "json_schema.hpp"
+
+// CBOR (RFC 8949) по тем же схемам, что и JSON. Сообщение - map, ключ поля -
+// его номер в схеме (0, 1, ...), а не имя: так статус занимает ~20 байт вместо ~70.
+// При разборе принимаются и номера, и текстовые имена полей.
+// Типы: String - text string, Bool - simple true/false, Int/Uint - major 0/1.
+
+JsonError cbor_parse(const JsonSchema& schema, const uint8_t* data, size_t length, void* message);
+
+// Длина в output; 0 - не поместилось.
+size_t cbor_serialize(const JsonSchema& schema, const void* message, uint8_t* output, size_t capacity);
+
+#endif
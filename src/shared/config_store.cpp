@@ -0,0 +1,388 @@
+#include "config_store.hpp"
+#include "crc32.hpp"
+#include "binlog.hpp"
+#include "flash_fs.hpp"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <string.h>
+
+static const uint32_t CONFIG_MAGIC = 0x31474643; // "CFG1"
+static const size_t CONFIG_HEADER_SIZE = 12;     // magic, версия, длина, поколение
+static const size_t CONFIG_CRC_SIZE = 4;
+static const uint8_t CONFIG_ENCRYPTED = 0x80;    // бит id записи: значение зашифровано
+static_assert(CONFIG_HEADER_SIZE + CONFIG_CRC_SIZE == CONFIG_IMAGE_OVERHEAD, "config header layout");
+
+static void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+static void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+static uint16_t get_le16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+ConfigStore::ConfigStore(const ConfigSchema& schema, void* values, const void* defaults, size_t size,
+                         SchedulerClock clock, const char* path)
+    : _schema(schema), _values((uint8_t*)values), _defaults((const uint8_t*)defaults),
+      _size(size), _clock(clock), _path(path) {}
+
+void ConfigStore::slotPath(uint8_t slot, char* out, size_t capacity) const {
+    snprintf(out, capacity, "%s.%u", _path, (unsigned)slot);
+}
+
+const ConfigField* ConfigStore::find(uint8_t id, ConfigType type) const {
+    for (uint8_t i = 0; i < _schema.count; i++) {
+        const ConfigField& field = _schema.fields[i];
+        if (field.id == id) {
+            bool secret = type == ConfigType::String && field.type == ConfigType::Secret;
+            return field.type == type || secret ? &field : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// Только записи, без заголовка и CRC, значения открытые: по ним же видно,
+// изменилось ли что-то. false - значения не влезают в CONFIG_MAX_IMAGE.
+bool ConfigStore::encode(uint8_t* out, size_t& length) const {
+    length = 0;
+    for (uint8_t i = 0; i < _schema.count; i++) {
+        const ConfigField& field = _schema.fields[i];
+        const uint8_t* value = _values + field.offset;
+        size_t size;
+        switch (field.type) {
+            case ConfigType::String:
+            case ConfigType::Secret: size = strnlen((const char*)value, field.size - 1); break;
+            case ConfigType::Uint:   size = 4; break;
+            default:                 size = 1; break;
+        }
+        if (length + 2 + size > CONFIG_MAX_IMAGE - CONFIG_IMAGE_OVERHEAD) {
+            LOG_ERROR("[CFG] Field %s does not fit CONFIG_MAX_IMAGE\n", field.name);
+            return false;
+        }
+        out[length++] = field.type == ConfigType::Secret ? (uint8_t)(field.id | CONFIG_ENCRYPTED) : field.id;
+        out[length++] = (uint8_t)size;
+        if (field.type == ConfigType::Uint) {
+            uint32_t number;
+            memcpy(&number, value, sizeof(number));
+            put_le32(out + length, number);
+        } else if (field.type == ConfigType::Bool) {
+            out[length] = *(const bool*)value ? 1 : 0;
+        } else {
+            memcpy(out + length, value, size);
+        }
+        length += size;
+    }
+    return true;
+}
+
+// XOR значений записей с битом CONFIG_ENCRYPTED: шифрует и расшифровывает.
+void ConfigStore::crypt(uint8_t* entries, size_t length, uint32_t generation) const {
+    size_t offset = 0;
+    while (offset + 2 <= length) {
+        uint8_t id = entries[offset];
+        uint8_t size = entries[offset + 1];
+        uint8_t* data = entries + offset + 2;
+        offset += 2 + size;
+        if (offset > length) {
+            return;
+        }
+        if (!(id & CONFIG_ENCRYPTED)) {
+            continue;
+        }
+        uint8_t nonce[6];
+        put_le32(nonce, generation);
+        nonce[4] = id & ~CONFIG_ENCRYPTED;
+        uint8_t block[SHA256_SIZE];
+        for (size_t i = 0; i < size; i++) {
+            if (i % SHA256_SIZE == 0) {
+                nonce[5] = (uint8_t)(i / SHA256_SIZE);
+                hmac_sha256(_key, sizeof(_key), nonce, sizeof(nonce), block);
+            }
+            data[i] ^= block[i % SHA256_SIZE];
+        }
+    }
+}
+
+bool ConfigStore::decode(uint8_t* entries, size_t length, uint32_t generation) {
+    crypt(entries, length, generation);
+    size_t offset = 0;
+    while (offset + 2 <= length) {
+        bool encrypted = (entries[offset] & CONFIG_ENCRYPTED) != 0;
+        uint8_t id = entries[offset] & ~CONFIG_ENCRYPTED;
+        uint8_t size = entries[offset + 1];
+        const uint8_t* data = entries + offset + 2;
+        offset += 2 + size;
+        if (offset > length) {
+            return false;
+        }
+
+        const ConfigField* field = nullptr;
+        for (uint8_t i = 0; i < _schema.count; i++) {
+            if (_schema.fields[i].id == id) {
+                field = &_schema.fields[i];
+                break;
+            }
+        }
+        if (!field) {
+            continue; // поле из другой версии прошивки
+        }
+        uint8_t* value = _values + field->offset;
+        bool text = field->type == ConfigType::String || field->type == ConfigType::Secret;
+        if (text && size < field->size) {
+            memcpy(value, data, size);
+            value[size] = '\0';
+            if (field->type == ConfigType::Secret && !encrypted) {
+                _rewrite = true; // файл прошивки, где поле ещё было String
+            }
+        } else if (field->type == ConfigType::Uint && size == 4) {
+            uint32_t number = get_le32(data);
+            memcpy(value, &number, sizeof(number));
+        } else if (field->type == ConfigType::Bool && size == 1) {
+            *(bool*)value = data[0] != 0;
+        }
+        // Другой размер - поле поменяло тип, остаётся значение по умолчанию.
+    }
+    return offset == length;
+}
+
+bool ConfigStore::readSlot(uint8_t slot, uint8_t* image, size_t& length, uint32_t& generation) const {
+    char path[48];
+    slotPath(slot, path, sizeof(path));
+    if (!LittleFS.exists(path)) {
+        return false;
+    }
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return false;
+    }
+    size_t read = file.read(image, CONFIG_MAX_IMAGE);
+    file.close();
+    if (read < CONFIG_HEADER_SIZE + CONFIG_CRC_SIZE || get_le32(image) != CONFIG_MAGIC) {
+        return false;
+    }
+    length = get_le16(image + 6);
+    if (CONFIG_HEADER_SIZE + length + CONFIG_CRC_SIZE != read) {
+        return false;
+    }
+    if (get_le32(image + CONFIG_HEADER_SIZE + length) != crc32(image, CONFIG_HEADER_SIZE + length)) {
+        return false;
+    }
+    generation = get_le32(image + 8);
+    return true;
+}
+
+bool ConfigStore::begin() {
+    memcpy(_values, _defaults, _size);
+    _dirty = false;
+    _rewrite = false;
+    // Ключ полей Secret: у каждого устройства свой.
+    uint64_t mac = ESP.getEfuseMac();
+    hmac_sha256(CONFIG_KEY, strlen(CONFIG_KEY), &mac, sizeof(mac), _key);
+
+    // Сначала только выбор самой новой целой копии, потом её разбор: один
+    // буфер на стеке вместо двух.
+    uint8_t image[CONFIG_MAX_IMAGE];
+    size_t length = 0;
+    uint32_t generation = 0;
+    int8_t newest = -1;
+    uint32_t newestGeneration = 0;
+    if (flash_fs_mount()) {
+        for (uint8_t slot = 0; slot < 2; slot++) {
+            if (readSlot(slot, image, length, generation) &&
+                (newest < 0 || (int32_t)(generation - newestGeneration) > 0)) {
+                newest = slot;
+                newestGeneration = generation;
+            }
+        }
+    }
+
+    bool loaded = false;
+    if (newest >= 0 && readSlot(newest, image, length, generation)) {
+        if (decode(image + CONFIG_HEADER_SIZE, length, generation)) {
+            _slot = newest;
+            _generation = generation;
+            loaded = true;
+        } else {
+            memcpy(_values, _defaults, _size);
+            _rewrite = false;
+        }
+    }
+    if (!loaded) {
+        _slot = 1;
+        _generation = 0;
+    }
+
+    size_t entries = 0;
+    encode(image, entries);
+    _storedCrc = crc32(image, entries);
+    LOG_INFO("[CFG] %s (generation %u)\n", loaded ? "Loaded" : "Defaults", (unsigned)_generation);
+    if (_rewrite) {
+        // Секреты лежат открытыми: переписать зашифрованными при ближайшей записи.
+        _dirty = true;
+        _firstChange = _lastChange = _clock();
+    }
+    return loaded;
+}
+
+bool ConfigStore::update(const ConfigField& field, const void* value, size_t length) {
+    uint8_t* target = _values + field.offset;
+    bool text = field.type == ConfigType::String || field.type == ConfigType::Secret;
+    if (memcmp(target, value, length) == 0 && (!text || target[length] == '\0')) {
+        return true;
+    }
+    memcpy(target, value, length);
+    if (text) {
+        target[length] = '\0';
+    }
+
+    unsigned long now = _clock();
+    if (_dirty) {
+        _coalesced++;
+    } else {
+        _dirty = true;
+        _firstChange = now;
+    }
+    _lastChange = now;
+
+    for (uint8_t i = 0; i < _listenerCount; i++) {
+        _listeners[i](field.id, _listenerContexts[i]);
+    }
+    return true;
+}
+
+bool ConfigStore::setString(uint8_t id, const char* value) {
+    const ConfigField* field = find(id, ConfigType::String);
+    if (!field || !value) {
+        return false;
+    }
+    size_t length = strlen(value);
+    if (length >= field->size) {
+        return false;
+    }
+    return update(*field, value, length);
+}
+
+bool ConfigStore::setUint(uint8_t id, uint32_t value) {
+    const ConfigField* field = find(id, ConfigType::Uint);
+    return field && update(*field, &value, sizeof(value));
+}
+
+bool ConfigStore::setBool(uint8_t id, bool value) {
+    const ConfigField* field = find(id, ConfigType::Bool);
+    return field && update(*field, &value, sizeof(value));
+}
+
+bool ConfigStore::subscribe(ConfigListener listener, void* context) {
+    if (_listenerCount >= CONFIG_MAX_LISTENERS) {
+        return false;
+    }
+    _listeners[_listenerCount] = listener;
+    _listenerContexts[_listenerCount] = context;
+    _listenerCount++;
+    return true;
+}
+
+uint32_t ConfigStore::loop() {
+    if (!_dirty) {
+        return SCHEDULER_IDLE;
+    }
+    unsigned long now = _clock();
+    unsigned long quiet = now - _lastChange;
+    unsigned long pending = now - _firstChange;
+    if (quiet >= CONFIG_COMMIT_DELAY_MS || pending >= CONFIG_COMMIT_MAX_DELAY_MS) {
+        return commit() ? SCHEDULER_IDLE : CONFIG_COMMIT_DELAY_MS;
+    }
+    uint32_t wait = CONFIG_COMMIT_DELAY_MS - quiet;
+    if (CONFIG_COMMIT_MAX_DELAY_MS - pending < wait) {
+        wait = CONFIG_COMMIT_MAX_DELAY_MS - pending;
+    }
+    return wait;
+}
+
+bool ConfigStore::commit() {
+    if (!_dirty) {
+        return true;
+    }
+    uint8_t image[CONFIG_MAX_IMAGE];
+    size_t length = 0;
+    if (!encode(image + CONFIG_HEADER_SIZE, length)) {
+        _firstChange = _lastChange = _clock();
+        return false;
+    }
+    uint32_t crc = crc32(image + CONFIG_HEADER_SIZE, length);
+    if (crc == _storedCrc && !_rewrite) {
+        // Значения вернулись к записанным: flash не трогаем.
+        _dirty = false;
+        return true;
+    }
+
+    uint8_t slot = _slot ^ 1;
+    put_le32(image, CONFIG_MAGIC);
+    put_le16(image + 4, _schema.version);
+    put_le16(image + 6, (uint16_t)length);
+    put_le32(image + 8, _generation + 1);
+    crypt(image + CONFIG_HEADER_SIZE, length, _generation + 1);
+    put_le32(image + CONFIG_HEADER_SIZE + length, crc32(image, CONFIG_HEADER_SIZE + length));
+    size_t total = CONFIG_HEADER_SIZE + length + CONFIG_CRC_SIZE;
+
+    char path[48];
+    slotPath(slot, path, sizeof(path));
+    File file = flash_fs_mount() ? LittleFS.open(path, "w") : File();
+    if (!file) {
+        LOG_WARN("[CFG] Cannot create %s\n", path);
+        _firstChange = _lastChange = _clock(); // повтор через CONFIG_COMMIT_DELAY_MS
+        return false;
+    }
+    bool written = file.write(image, total) == total;
+    file.close();
+    if (!written) {
+        LOG_WARN("[CFG] Write to %s failed\n", path);
+        _firstChange = _lastChange = _clock();
+        return false;
+    }
+
+    _slot = slot;
+    _generation++;
+    _storedCrc = crc;
+    _dirty = false;
+    _rewrite = false;
+    _commits++;
+    return true;
+}
+
+void ConfigStore::reset() {
+    memcpy(_values, _defaults, _size);
+    _dirty = false;
+    _generation = 0;
+    _slot = 1;
+    _rewrite = false;
+    uint8_t entries[CONFIG_MAX_IMAGE];
+    size_t length = 0;
+    encode(entries, length);
+    _storedCrc = crc32(entries, length);
+    if (flash_fs_mount()) {
+        char path[48];
+        for (uint8_t slot = 0; slot < 2; slot++) {
+            slotPath(slot, path, sizeof(path));
+            if (LittleFS.exists(path)) {
+                LittleFS.remove(path);
+            }
+        }
+    }
+    for (uint8_t i = 0; i < _listenerCount; i++) {
+        for (uint8_t f = 0; f < _schema.count; f++) {
+            _listeners[i](_schema.fields[f].id, _listenerContexts[i]);
+        }
+    }
+}
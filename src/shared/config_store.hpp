@@ -0,0 +1,181 @@
+#ifndef CONFIG_STORE_HPP
+#define CONFIG_STORE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scheduler.hpp"
+#include "sha256.hpp"
+
+// Файлы двух копий: <CONFIG_PATH>.0 и <CONFIG_PATH>.1.
+#ifndef CONFIG_PATH
+#define CONFIG_PATH "/config"
+#endif
+
+// Запись после CONFIG_COMMIT_DELAY_MS без изменений, но не позже
+// CONFIG_COMMIT_MAX_DELAY_MS после первого незаписанного изменения.
+#ifndef CONFIG_COMMIT_DELAY_MS
+#define CONFIG_COMMIT_DELAY_MS 2000
+#endif
+
+#ifndef CONFIG_COMMIT_MAX_DELAY_MS
+#define CONFIG_COMMIT_MAX_DELAY_MS 15000
+#endif
+
+#ifndef CONFIG_MAX_IMAGE
+#define CONFIG_MAX_IMAGE 512
+#endif
+
+#ifndef CONFIG_MAX_LISTENERS
+#define CONFIG_MAX_LISTENERS 4
+#endif
+
+// Секрет прошивки для ключа полей Secret: ключ устройства - HMAC-SHA256
+// (CONFIG_KEY, eFuse MAC). Без CONFIG_KEY ключ выводится из одного MAC и
+// прячет пароли только от беглого взгляда на дамп flash.
+#ifndef CONFIG_KEY
+#define CONFIG_KEY ""
+#endif
+
+// Заголовок и CRC файла.
+const size_t CONFIG_IMAGE_OVERHEAD = 16;
+
+enum class ConfigType : uint8_t {
+    String,  // char[size], в файле без завершающего нуля
+    Uint,    // uint32_t
+    Bool,    // bool
+    Secret   // как String, на flash зашифрован ключом устройства
+};
+
+// id хранится в файле и не меняется между версиями прошивки; новые поля
+// получают новые id (до 127), удалённые не переиспользуются. String и
+// Secret взаимозаменяемы: поле, ставшее Secret, читается из старого файла
+// и при следующей записи шифруется.
+struct ConfigField {
+    uint8_t id;
+    const char* name;
+    ConfigType type;
+    uint16_t offset;
+    uint16_t size;
+};
+
+struct ConfigSchema {
+    const ConfigField* fields;
+    uint8_t count;
+    uint16_t version;
+};
+
+#define CONFIG_FIELD(Type, member, id, name, configType) \
+    { id, name, configType, (uint16_t)offsetof(Type, member), (uint16_t)sizeof(((Type*)0)->member) }
+
+#define CONFIG_STRING(Type, member, id, name) CONFIG_FIELD(Type, member, id, name, ConfigType::String)
+#define CONFIG_UINT(Type, member, id, name) CONFIG_FIELD(Type, member, id, name, ConfigType::Uint)
+#define CONFIG_BOOL(Type, member, id, name) CONFIG_FIELD(Type, member, id, name, ConfigType::Bool)
+#define CONFIG_SECRET(Type, member, id, name) CONFIG_FIELD(Type, member, id, name, ConfigType::Secret)
+
+#define CONFIG_SCHEMA(fields, version) { fields, (uint8_t)(sizeof(fields) / sizeof(fields[0])), version }
+
+// Схема с заполненными до предела строками влезает в CONFIG_MAX_IMAGE: на
+// запись id | len и не больше sizeof(поля) значения.
+#define CONFIG_ASSERT_FITS(Type, fields)                                                          \
+    static_assert(sizeof(Type) + 2 * (sizeof(fields) / sizeof(fields[0])) + CONFIG_IMAGE_OVERHEAD <= \
+                      CONFIG_MAX_IMAGE,                                                           \
+                  "config schema does not fit CONFIG_MAX_IMAGE")
+
+typedef void (*ConfigListener)(uint8_t id, void* context);
+
+// Настройки устройства: структура в RAM, читается из flash один раз в begin().
+// Сеттеры меняют только RAM и сообщают подписчикам; на flash изменения
+// уходят одной записью из loop(), когда правки затихли. Запись идёт
+// по очереди в две копии (A/B) с номером поколения и CRC, поэтому сбой
+// питания посреди записи оставляет предыдущую целой, а износ делится
+// между файлами (внутри LittleFS - ещё и между блоками). Запись с тем же
+// содержимым, что уже на flash, пропускается.
+// Формат: заголовок (magic, версия схемы, длина, поколение), записи
+// id | len | значение, CRC-32. Незнакомые id пропускаются, отсутствующие
+// поля берутся из defaults - старый файл читается новой прошивкой и наоборот.
+// Значения полей Secret в файле XOR с потоком HMAC-SHA256(ключ устройства,
+// поколение | id | номер блока): у каждой записи свой поток; id такой записи
+// в файле - с битом 0x80. Изменения ищутся по CRC открытых значений.
+class ConfigStore {
+public:
+    // values и defaults - структуры размера size, описанные schema.
+    ConfigStore(const ConfigSchema& schema, void* values, const void* defaults, size_t size,
+                SchedulerClock clock, const char* path = CONFIG_PATH);
+
+    // Загружает самую новую целую копию; false - копий нет, действуют defaults.
+    bool begin();
+
+    // false - нет поля с таким id, не тот тип или строка не помещается.
+    // setString пишет и поля String, и поля Secret.
+    // Значение, равное текущему, ничего не меняет и не будит подписчиков.
+    bool setString(uint8_t id, const char* value);
+    bool setUint(uint8_t id, uint32_t value);
+    bool setBool(uint8_t id, bool value);
+
+    // Вызывается синхронно из сеттера после изменения значения.
+    bool subscribe(ConfigListener listener, void* context = nullptr);
+
+    // Записывает накопленные изменения, когда подошёл срок. Возвращает мс до
+    // следующего срока или SCHEDULER_IDLE, если записывать нечего.
+    uint32_t loop();
+    // Записать сейчас (перед перезагрузкой, после провижининга). false - не
+    // записалось; в том числе если значения не влезают в CONFIG_MAX_IMAGE.
+    bool commit();
+    // Вернуть defaults и стереть обе копии.
+    void reset();
+
+    bool dirty() const { return _dirty; }
+    uint32_t generation() const { return _generation; }
+    // Записей на flash и изменений, объединённых с другими в одну запись.
+    uint32_t commits() const { return _commits; }
+    uint32_t coalesced() const { return _coalesced; }
+
+    const ConfigSchema& schema() const { return _schema; }
+
+private:
+    const ConfigField* find(uint8_t id, ConfigType type) const;
+    bool update(const ConfigField& field, const void* value, size_t length);
+    bool encode(uint8_t* out, size_t& length) const;
+    bool decode(uint8_t* entries, size_t length, uint32_t generation);
+    void crypt(uint8_t* entries, size_t length, uint32_t generation) const;
+    bool readSlot(uint8_t slot, uint8_t* image, size_t& length, uint32_t& generation) const;
+    void slotPath(uint8_t slot, char* out, size_t capacity) const;
+
+    const ConfigSchema& _schema;
+    uint8_t* _values;
+    const uint8_t* _defaults;
+    size_t _size;
+    SchedulerClock _clock;
+    const char* _path;
+
+    uint32_t _generation = 0;
+    uint8_t _slot = 1;        // копия с последней записью; следующая - в другую
+    uint32_t _storedCrc = 0;  // CRC значений в последней записанной копии
+    bool _dirty = false;
+    bool _rewrite = false;    // в копии есть Secret в открытом виде
+    uint8_t _key[SHA256_SIZE] = {};
+    unsigned long _firstChange = 0;
+    unsigned long _lastChange = 0;
+    uint32_t _commits = 0;
+    uint32_t _coalesced = 0;
+
+    ConfigListener _listeners[CONFIG_MAX_LISTENERS];
+    void* _listenerContexts[CONFIG_MAX_LISTENERS];
+    uint8_t _listenerCount = 0;
+};
+
+// Хранилище вместе со своей структурой: config->brokerPort, config.setUint(...).
+template <typename T>
+class Config : public ConfigStore {
+public:
+    Config(const ConfigSchema& schema, const T& defaults, SchedulerClock clock, const char* path = CONFIG_PATH)
+        : ConfigStore(schema, &_values, &defaults, sizeof(T), clock, path), _values(defaults) {}
+
+    const T& get() const { return _values; }
+    const T* operator->() const { return &_values; }
+
+private:
+    T _values;
+};
+
+#endif
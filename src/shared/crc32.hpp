@@ -0,0 +1,15 @@
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, как в zlib). crc32_update позволяет считать по частям:
+// crc32_update(crc32_update(0, a, n), b, m) == crc32(a + b).
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
+inline uint32_t crc32(const void* data, size_t length) {
+    return crc32_update(0, data, length);
+}
+
+#endif
@@ -0,0 +1,189 @@
+#include "delta_patch.hpp"
+#include "crc32.hpp"
+#include <string.h>
+
+static const uint8_t DELTA_MAGIC[4] = { 'O', 'D', 'P', '1' };
+
+const char* patch_error_name(PatchError error) {
+    switch (error) {
+        case PatchError::None:   return "none";
+        case PatchError::Format: return "format";
+        case PatchError::Source: return "source";
+        case PatchError::Range:  return "range";
+        case PatchError::Read:   return "read";
+        case PatchError::Write:  return "write";
+    }
+    return "unknown";
+}
+
+static uint32_t get_le32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+DeltaPatcher::DeltaPatcher(PatchRead read, PatchWrite write, void* context)
+    : _read(read), _write(write), _context(context) {
+    reset();
+}
+
+void DeltaPatcher::reset() {
+    _state = State::Header;
+    _error = PatchError::None;
+    _fieldsWanted = DELTA_HEADER_SIZE;
+    _fieldsHave = 0;
+    _opcode = 0;
+    _remaining = 0;
+    _sourceSize = 0;
+    _sourceCrc = 0;
+    _checked = 0;
+    _crc = 0;
+    _targetSize = 0;
+    _written = 0;
+}
+
+bool DeltaPatcher::complete() const {
+    return _state == State::Opcode && _written == _targetSize && sourceChecked();
+}
+
+PatchError DeltaPatcher::fail(PatchError error) {
+    _state = State::Failed;
+    _error = error;
+    return error;
+}
+
+PatchError DeltaPatcher::emit(const uint8_t* data, size_t length) {
+    if (length > _targetSize - _written) {
+        return fail(PatchError::Range);
+    }
+    if (!_write(data, length, _context)) {
+        return fail(PatchError::Write);
+    }
+    _written += length;
+    return PatchError::None;
+}
+
+PatchError DeltaPatcher::startPatch() {
+    if (memcmp(_fields, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0) {
+        return fail(PatchError::Format);
+    }
+    _sourceSize = get_le32(_fields + 4);
+    _sourceCrc = get_le32(_fields + 8);
+    _targetSize = get_le32(_fields + 12);
+    _state = State::Opcode;
+    if (_sourceSize == 0) {
+        return _sourceCrc == 0 ? PatchError::None : fail(PatchError::Source);  // CRC пустого образа
+    }
+    return checkSource();
+}
+
+PatchError DeltaPatcher::checkSource() {
+    if (_state == State::Failed) {
+        return _error;
+    }
+    if (_state == State::Header || sourceChecked()) {
+        return PatchError::None;  // размер и CRC ещё не пришли или уже сошлись
+    }
+    uint32_t end = _sourceSize - _checked > DELTA_CHECK_CHUNK ? _checked + DELTA_CHECK_CHUNK : _sourceSize;
+    while (_checked < end) {
+        size_t chunk = end - _checked < sizeof(_copy) ? end - _checked : sizeof(_copy);
+        if (!_read(_checked, _copy, chunk, _context)) {
+            return fail(PatchError::Read);
+        }
+        _crc = crc32_update(_crc, _copy, chunk);
+        _checked += chunk;
+    }
+    if (_checked == _sourceSize && _crc != _sourceCrc) {
+        return fail(PatchError::Source);
+    }
+    return PatchError::None;
+}
+
+PatchError DeltaPatcher::startOperation() {
+    if (_opcode == DELTA_OP_INSERT) {
+        _remaining = get_le32(_fields);
+        if (_remaining > _targetSize - _written) {
+            return fail(PatchError::Range);
+        }
+        _state = _remaining > 0 ? State::Insert : State::Opcode;
+        return PatchError::None;
+    }
+
+    uint32_t offset = get_le32(_fields);
+    uint32_t length = get_le32(_fields + 4);
+    if (offset > _sourceSize || length > _sourceSize - offset || length > _targetSize - _written) {
+        return fail(PatchError::Range);
+    }
+    // COPY выполняется сразу: источник - flash, его не нужно ждать.
+    while (length > 0) {
+        size_t chunk = length < sizeof(_copy) ? length : sizeof(_copy);
+        if (!_read(offset, _copy, chunk, _context)) {
+            return fail(PatchError::Read);
+        }
+        if (emit(_copy, chunk) != PatchError::None) {
+            return _error;
+        }
+        offset += chunk;
+        length -= chunk;
+    }
+    _state = State::Opcode;
+    return PatchError::None;
+}
+
+PatchError DeltaPatcher::feed(const uint8_t* data, size_t length) {
+    // Заголовок запускает проверку сам, дальше - по куску за вызов.
+    if (_state != State::Header && checkSource() != PatchError::None) {
+        return _error;
+    }
+    size_t used = 0;
+    while (used < length) {
+        switch (_state) {
+            case State::Failed:
+                return _error;
+
+            case State::Header:
+            case State::Arguments: {
+                size_t take = _fieldsWanted - _fieldsHave;
+                if (take > length - used) {
+                    take = length - used;
+                }
+                memcpy(_fields + _fieldsHave, data + used, take);
+                _fieldsHave += take;
+                used += take;
+                if (_fieldsHave < _fieldsWanted) {
+                    break;
+                }
+                PatchError error = _state == State::Header ? startPatch() : startOperation();
+                if (error != PatchError::None) {
+                    return error;
+                }
+                break;
+            }
+
+            case State::Opcode:
+                _opcode = data[used++];
+                if (_opcode != DELTA_OP_COPY && _opcode != DELTA_OP_INSERT) {
+                    return fail(PatchError::Format);
+                }
+                if (_written == _targetSize) {
+                    return fail(PatchError::Format);  // операции после конца образа
+                }
+                _fieldsWanted = _opcode == DELTA_OP_COPY ? 8 : 4;
+                _fieldsHave = 0;
+                _state = State::Arguments;
+                break;
+
+            case State::Insert: {
+                size_t take = _remaining < length - used ? _remaining : length - used;
+                if (emit(data + used, take) != PatchError::None) {
+                    return _error;
+                }
+                used += take;
+                _remaining -= take;
+                if (_remaining == 0) {
+                    _state = State::Opcode;
+                }
+                break;
+            }
+        }
+    }
+    return _error;
+}
@@ -0,0 +1,100 @@
+#ifndef DELTA_PATCH_HPP
+#define DELTA_PATCH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Патч прошивки относительно текущего образа, применяется потоком: новый
+// образ пишется по мере прихода патча, целиком в памяти не нужен ни патч,
+// ни образ.
+//
+//   "ODP1" | source size (LE32) | source CRC-32 (LE32) | target size (LE32)
+//   0x01 COPY   | offset (LE32) | length (LE32)    - байты текущего образа
+//   0x02 INSERT | length (LE32) | bytes            - новые байты
+//
+// CRC исходного образа считается по DELTA_CHECK_CHUNK байт за вызов feed():
+// чтение всего слота разом на первом куске надолго заняло бы задачу, которая
+// принимает патч. Патч для другой прошивки отвергается, как только проверка
+// дойдёт до конца; что не успело провериться вместе с патчем, дочитывает
+// checkSource() перед выбором образа. Патчи готовит tools/ota_delta.cpp.
+// Не зависит от Arduino: собирается и проверяется на хосте.
+
+#ifndef DELTA_COPY_CHUNK
+#define DELTA_COPY_CHUNK 256
+#endif
+
+#ifndef DELTA_CHECK_CHUNK
+#define DELTA_CHECK_CHUNK 4096
+#endif
+
+const size_t DELTA_HEADER_SIZE = 16;
+const uint8_t DELTA_OP_COPY = 0x01;
+const uint8_t DELTA_OP_INSERT = 0x02;
+
+enum class PatchError : uint8_t {
+    None,
+    Format,  // не патч, неизвестная операция или данные после конца образа
+    Source,  // патч сделан для другого образа
+    Range,   // COPY за пределами исходного образа или запись больше target size
+    Read,    // не удалось прочитать исходный образ
+    Write    // приёмник отказал
+};
+
+const char* patch_error_name(PatchError error);
+
+typedef bool (*PatchRead)(uint32_t offset, uint8_t* out, size_t length, void* context);
+typedef bool (*PatchWrite)(const uint8_t* data, size_t length, void* context);
+
+class DeltaPatcher {
+public:
+    DeltaPatcher(PatchRead read, PatchWrite write, void* context = nullptr);
+
+    void reset();
+    // Кусок патча любой длины. После первой ошибки всё отвергается до reset().
+    PatchError feed(const uint8_t* data, size_t length);
+    // Следующие DELTA_CHECK_CHUNK байт проверки исходного образа.
+    PatchError checkSource();
+    bool sourceChecked() const { return _state != State::Header && _checked == _sourceSize; }
+    // Весь образ записан, последняя операция закончена и исходный образ проверен.
+    bool complete() const;
+
+    PatchError error() const { return _error; }
+    uint32_t sourceSize() const { return _sourceSize; }
+    uint32_t targetSize() const { return _targetSize; }
+    uint32_t written() const { return _written; }
+
+private:
+    enum class State : uint8_t {
+        Header,
+        Opcode,
+        Arguments,
+        Insert,
+        Failed
+    };
+
+    PatchError fail(PatchError error);
+    PatchError startPatch();
+    PatchError startOperation();
+    PatchError emit(const uint8_t* data, size_t length);
+
+    PatchRead _read;
+    PatchWrite _write;
+    void* _context;
+
+    State _state;
+    PatchError _error;
+    uint8_t _fields[DELTA_HEADER_SIZE];  // заголовок или аргументы операции
+    uint8_t _fieldsWanted;
+    uint8_t _fieldsHave;
+    uint8_t _opcode;
+    uint32_t _remaining;  // байт INSERT до конца операции
+    uint32_t _sourceSize;
+    uint32_t _sourceCrc;   // ожидаемый CRC исходного образа
+    uint32_t _checked;     // байт исходного образа в _crc
+    uint32_t _crc;
+    uint32_t _targetSize;
+    uint32_t _written;
+    uint8_t _copy[DELTA_COPY_CHUNK];
+};
+
+#endif
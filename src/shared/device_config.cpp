@@ -0,0 +1,25 @@
+#include "device_config.hpp"
+
+static const ConfigField deviceConfigFields[] = {
+    CONFIG_STRING(DeviceConfig, wifiSsid, CONFIG_WIFI_SSID, "wifi_ssid"),
+    CONFIG_SECRET(DeviceConfig, wifiPassword, CONFIG_WIFI_PASSWORD, "wifi_password"),
+    CONFIG_STRING(DeviceConfig, deviceName, CONFIG_DEVICE_NAME, "device_name"),
+    CONFIG_SECRET(DeviceConfig, apPassword, CONFIG_AP_PASSWORD, "ap_password"),
+    CONFIG_STRING(DeviceConfig, brokerHost, CONFIG_BROKER_HOST, "broker_host"),
+    CONFIG_UINT(DeviceConfig, brokerPort, CONFIG_BROKER_PORT, "broker_port"),
+    CONFIG_UINT(DeviceConfig, wifiReconnectMs, CONFIG_WIFI_RECONNECT_MS, "wifi_reconnect_ms"),
+    CONFIG_SECRET(DeviceConfig, httpPassword, CONFIG_HTTP_PASSWORD, "http_password")
+};
+CONFIG_ASSERT_FITS(DeviceConfig, deviceConfigFields);
+const ConfigSchema DEVICE_CONFIG_SCHEMA = CONFIG_SCHEMA(deviceConfigFields, 1);
+
+const DeviceConfig DEVICE_CONFIG_DEFAULTS = {
+    DEVICE_CONFIG_WIFI_SSID,
+    DEVICE_CONFIG_WIFI_PASSWORD,
+    "",
+    DEVICE_CONFIG_AP_PASSWORD,
+    "",
+    DEVICE_CONFIG_BROKER_PORT,
+    DEVICE_CONFIG_WIFI_RECONNECT_MS,
+    DEVICE_CONFIG_HTTP_PASSWORD
+};
@@ -0,0 +1,64 @@
+#ifndef DEVICE_CONFIG_HPP
+#define DEVICE_CONFIG_HPP
+
+#include "config_store.hpp"
+#include "payloads.hpp"
+
+// Значения до первого провижининга; задаются через build_flags.
+#ifndef DEVICE_CONFIG_WIFI_SSID
+#define DEVICE_CONFIG_WIFI_SSID ""
+#endif
+
+#ifndef DEVICE_CONFIG_WIFI_PASSWORD
+#define DEVICE_CONFIG_WIFI_PASSWORD ""
+#endif
+
+#ifndef DEVICE_CONFIG_AP_PASSWORD
+#define DEVICE_CONFIG_AP_PASSWORD "12345678"
+#endif
+
+// Пароль HTTP по адресу станции (пользователь admin). Пустой - по адресу
+// станции доступны только /metrics.
+#ifndef DEVICE_CONFIG_HTTP_PASSWORD
+#define DEVICE_CONFIG_HTTP_PASSWORD ""
+#endif
+
+#ifndef DEVICE_CONFIG_BROKER_PORT
+#define DEVICE_CONFIG_BROKER_PORT 1883
+#endif
+
+#ifndef DEVICE_CONFIG_WIFI_RECONNECT_MS
+#define DEVICE_CONFIG_WIFI_RECONNECT_MS 5000
+#endif
+
+// Настройки, общие для приложений. Пустая строка - приложение берёт своё
+// значение по умолчанию (имя по MAC, брокер MQTT_DEFAULT_BROKER_HOST).
+struct DeviceConfig {
+    char wifiSsid[PAYLOAD_SSID_SIZE];
+    char wifiPassword[PAYLOAD_PASSWORD_SIZE];
+    char deviceName[PAYLOAD_DEVICE_NAME_SIZE];
+    char apPassword[PAYLOAD_PASSWORD_SIZE];
+    char brokerHost[PAYLOAD_HOST_SIZE];
+    uint32_t brokerPort;
+    uint32_t wifiReconnectMs;
+    char httpPassword[PAYLOAD_PASSWORD_SIZE];
+};
+
+// id полей в файле настроек: только добавлять, не менять и не переиспользовать.
+enum DeviceConfigId : uint8_t {
+    CONFIG_WIFI_SSID = 1,
+    CONFIG_WIFI_PASSWORD = 2,
+    CONFIG_DEVICE_NAME = 3,
+    CONFIG_AP_PASSWORD = 4,
+    CONFIG_BROKER_HOST = 5,
+    CONFIG_BROKER_PORT = 6,
+    CONFIG_WIFI_RECONNECT_MS = 7,
+    CONFIG_HTTP_PASSWORD = 8
+};
+
+extern const ConfigSchema DEVICE_CONFIG_SCHEMA;
+extern const DeviceConfig DEVICE_CONFIG_DEFAULTS;
+
+typedef Config<DeviceConfig> DeviceConfigStore;
+
+#endif
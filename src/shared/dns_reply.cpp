@@ -0,0 +1,69 @@
+#include "dns_reply.hpp"
+#include <string.h>
+
+static const size_t DNS_HEADER_SIZE = 12;
+static const uint16_t DNS_TYPE_A = 1;
+static const uint16_t DNS_TYPE_ANY = 255;
+static const size_t DNS_MAX_NAME = 255;  // RFC 1035, вместе с нулевой меткой
+
+void dns_prepare_answer(DnsAnswer& answer, const uint8_t address[4], uint32_t ttl) {
+    uint8_t* r = answer.record;
+    r[0] = 0xC0;  // имя - ссылка на вопрос (смещение 12)
+    r[1] = DNS_HEADER_SIZE;
+    r[2] = 0x00;  // TYPE A
+    r[3] = 0x01;
+    r[4] = 0x00;  // CLASS IN
+    r[5] = 0x01;
+    r[6] = (uint8_t)(ttl >> 24);
+    r[7] = (uint8_t)(ttl >> 16);
+    r[8] = (uint8_t)(ttl >> 8);
+    r[9] = (uint8_t)ttl;
+    r[10] = 0x00; // RDLENGTH 4
+    r[11] = 0x04;
+    memcpy(r + 12, address, 4);
+}
+
+size_t dns_build_reply(const uint8_t* query, size_t length, const DnsAnswer& answer,
+                       uint8_t* reply, size_t capacity) {
+    if (length < DNS_HEADER_SIZE) {
+        return 0;
+    }
+    // Только стандартный запрос (QR = 0, OPCODE = 0) с одним вопросом.
+    if ((query[2] & 0xF8) != 0 || query[4] != 0 || query[5] != 1) {
+        return 0;
+    }
+
+    size_t pos = DNS_HEADER_SIZE;
+    while (pos < length && query[pos] != 0) {
+        if (query[pos] & 0xC0) {
+            return 0;
+        }
+        pos += query[pos] + 1;
+    }
+    if (pos + 1 - DNS_HEADER_SIZE > DNS_MAX_NAME) {
+        return 0;
+    }
+    pos += 1 + 4; // нулевая метка, QTYPE, QCLASS
+    if (pos > length) {
+        return 0;
+    }
+
+    uint16_t type = (uint16_t)((query[pos - 4] << 8) | query[pos - 3]);
+    bool withAnswer = type == DNS_TYPE_A || type == DNS_TYPE_ANY;
+    size_t size = pos + (withAnswer ? DNS_ANSWER_SIZE : 0);
+    if (size > capacity) {
+        return 0;
+    }
+
+    // Дополнительные записи запроса (EDNS) отбрасываются вместе с ARCOUNT.
+    memcpy(reply, query, pos);
+    reply[2] = (uint8_t)(0x84 | (query[2] & 0x01)); // QR, AA, RD из запроса
+    reply[3] = 0x80;                                  // RA, RCODE = 0
+    reply[6] = 0;
+    reply[7] = withAnswer ? 1 : 0;
+    memset(reply + 8, 0, 4);
+    if (withAnswer) {
+        memcpy(reply + pos, answer.record, DNS_ANSWER_SIZE);
+    }
+    return size;
+}
@@ -0,0 +1,24 @@
+#ifndef DNS_REPLY_HPP
+#define DNS_REPLY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DNS_ANSWER_SIZE 16
+#define DNS_MAX_PACKET 512
+
+// Ответ captive-портала на любое имя - один и тот же адрес. Запись ответа
+// собирается один раз, на каждый запрос остаётся скопировать заголовок и вопрос.
+struct DnsAnswer {
+    uint8_t record[DNS_ANSWER_SIZE];
+};
+
+// address - четыре байта IPv4 в порядке записи (192, 168, 4, 1).
+void dns_prepare_answer(DnsAnswer& answer, const uint8_t address[4], uint32_t ttl = 60);
+
+// Строит ответ на запрос в reply. На A/ANY отвечает адресом, на остальные типы -
+// пустым NOERROR (телефоны иначе ждут таймаута AAAA). 0 - запрос не разобран, не отвечать.
+size_t dns_build_reply(const uint8_t* query, size_t length, const DnsAnswer& answer,
+                       uint8_t* reply, size_t capacity);
+
+#endif
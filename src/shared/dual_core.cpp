@@ -0,0 +1,22 @@
+#include "dual_core.hpp"
+#include "binlog.hpp"
+
+static void run_task(void* parameter) {
+    TaskStep step = (TaskStep)parameter;
+    for (;;) {
+        step();
+        vTaskDelay(1);
+    }
+}
+
+bool start_pinned_task(const char* name, TaskStep step, BaseType_t core,
+                       uint32_t stackSize, UBaseType_t priority, TaskHandle_t* handle) {
+    BaseType_t created = xTaskCreatePinnedToCore(run_task, name, stackSize, (void*)step,
+                                                 priority, handle, core);
+    if (created != pdPASS) {
+        LOG_WARN("[TASK] Failed to start %s on core %d\n", name, (int)core);
+        return false;
+    }
+    LOG_INFO("[TASK] %s running on core %d\n", name, (int)core);
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef DUAL_CORE_HPP
+#define DUAL_CORE_HPP
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Разделение работы по ядрам ESP32: сеть (WiFi, MQTT, DNS/HTTP) в отдельной
+// задаче на ядре 0, где работает стек WiFi, прикладная логика остаётся в loop()
+// на ядре 1. Обмен между ними - через SpscQueue.
+const BaseType_t NETWORK_CORE = 0;
+const BaseType_t APPLICATION_CORE = 1;
+
+typedef void (*TaskStep)();
+
+// Запускает задачу, которая вызывает step() в цикле и между вызовами
+// отдаёт процессор на один тик, чтобы не голодал idle-таск (watchdog).
+// step() может и сам спать в ulTaskNotifyTake(); handle нужен, чтобы будить задачу.
+bool start_pinned_task(const char* name, TaskStep step, BaseType_t core,
+                       uint32_t stackSize = 8192, UBaseType_t priority = 2,
+                       TaskHandle_t* handle = nullptr);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef FIXED_STRING_HPP
+#define FIXED_STRING_HPP
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Строка с буфером внутри объекта (Capacity символов + ноль), без кучи.
+// Не помещающееся отбрасывается, truncated() это показывает: усечённые
+// SSID или топик лучше отвергнуть, чем молча использовать.
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char* text) { assign(text); }
+
+    template <size_t Other>
+    FixedString(const FixedString<Other>& other) { assign(other.c_str()); }
+
+    FixedString& operator=(const char* text) {
+        assign(text);
+        return *this;
+    }
+
+    void clear() {
+        _length = 0;
+        _truncated = false;
+        _data[0] = '\0';
+    }
+
+    bool assign(const char* text) {
+        clear();
+        return append(text);
+    }
+
+    bool assign(const char* text, size_t length) {
+        clear();
+        return append(text, length);
+    }
+
+    bool append(const char* text) {
+        return text ? append(text, strlen(text)) : true;
+    }
+
+    bool append(const char* text, size_t length) {
+        size_t room = Capacity - _length;
+        if (length > room) {
+            length = room;
+            _truncated = true;
+        }
+        memcpy(_data + _length, text, length);
+        _length += length;
+        _data[_length] = '\0';
+        return !_truncated;
+    }
+
+    bool append(char c) {
+        if (_length == Capacity) {
+            _truncated = true;
+            return false;
+        }
+        _data[_length++] = c;
+        _data[_length] = '\0';
+        return true;
+    }
+
+    // Дописывает по формату printf.
+    bool appendf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(_data + _length, Capacity - _length + 1, format, args);
+        va_end(args);
+        if (written < 0) {
+            _data[_length] = '\0';
+            return false;
+        }
+        if ((size_t)written > Capacity - _length) {
+            _length = Capacity;
+            _truncated = true;
+            return false;
+        }
+        _length += written;
+        return true;
+    }
+
+    // Убирает пробельные символы по краям.
+    void trim() {
+        size_t start = 0;
+        while (start < _length && is_space(_data[start])) {
+            start++;
+        }
+        size_t end = _length;
+        while (end > start && is_space(_data[end - 1])) {
+            end--;
+        }
+        _length = end - start;
+        memmove(_data, _data + start, _length);
+        _data[_length] = '\0';
+    }
+
+    const char* c_str() const { return _data; }
+    size_t length() const { return _length; }
+    bool empty() const { return _length == 0; }
+    bool truncated() const { return _truncated; }
+    static size_t capacity() { return Capacity; }
+
+    bool operator==(const char* text) const { return strcmp(_data, text) == 0; }
+    bool operator!=(const char* text) const { return !(*this == text); }
+
+private:
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    char _data[Capacity + 1];
+    size_t _length;
+    bool _truncated;
+};
+
+#endif
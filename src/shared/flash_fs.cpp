@@ -0,0 +1,31 @@
+#include "flash_fs.hpp"
+#include "binlog.hpp"
+#include <LittleFS.h>
+
+static bool mounted = false;
+static bool attempted = false;
+static bool formatted = false;
+
+bool flash_fs_mount() {
+    if (attempted) {
+        return mounted;
+    }
+    attempted = true;
+    mounted = LittleFS.begin(false);
+    if (mounted) {
+        return true;
+    }
+#if FLASH_FS_FORMAT_ON_FAIL
+    LOG_ERROR("[FS] LittleFS mount failed, formatting: stored config and queues are lost\n");
+    formatted = LittleFS.format();
+    mounted = formatted && LittleFS.begin(false);
+#endif
+    if (!mounted) {
+        LOG_ERROR("[FS] LittleFS unavailable\n");
+    }
+    return mounted;
+}
+
+bool flash_fs_formatted() {
+    return formatted;
+}
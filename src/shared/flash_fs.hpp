@@ -0,0 +1,17 @@
+#ifndef FLASH_FS_HPP
+#define FLASH_FS_HPP
+
+// Ошибка монтирования - форматировать раздел LittleFS? Форматирование стирает
+// конфигурацию, spill MQTT, кэш WiFi и состояние пробной прошивки OTA; без него
+// на новой плате (раздел ни разу не форматировали) файлов не будет вовсе.
+#ifndef FLASH_FS_FORMAT_ON_FAIL
+#define FLASH_FS_FORMAT_ON_FAIL 1
+#endif
+
+// Монтирует LittleFS один раз на всю прошивку; дальше только возвращает результат.
+// Форматирование, если оно понадобилось, пишется в лог как ошибка.
+bool flash_fs_mount();
+// true - при монтировании раздел был отформатирован, прежние файлы потеряны.
+bool flash_fs_formatted();
+
+#endif
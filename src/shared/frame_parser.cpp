@@ -0,0 +1,205 @@
+#include "frame_parser.hpp"
+#include "crc32.hpp"
+#include <string.h>
+
+const char* frame_error_name(FrameError error) {
+    switch (error) {
+        case FrameError::None:     return "none";
+        case FrameError::Crc:      return "crc";
+        case FrameError::Oversize: return "oversize";
+        case FrameError::Timeout:  return "timeout";
+    }
+    return "unknown";
+}
+
+// type, seq, length: заголовок кадра после синхропоследовательности.
+static const size_t HEADER = FRAME_HEADER_SIZE - 2;
+
+static void put_le32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+size_t frame_encode(uint8_t type, uint8_t sequence, const uint8_t* payload, size_t length,
+                    uint8_t* out, size_t capacity) {
+    if (length > 0xFFFF || capacity < length + FRAME_OVERHEAD) {
+        return 0;
+    }
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = type;
+    out[3] = sequence;
+    out[4] = length & 0xFF;
+    out[5] = (length >> 8) & 0xFF;
+    if (length > 0) {
+        memcpy(out + FRAME_HEADER_SIZE, payload, length);
+    }
+    put_le32(out + FRAME_HEADER_SIZE + length, crc32(out + 2, length + 4));
+    return length + FRAME_OVERHEAD;
+}
+
+FrameParser::FrameParser(uint8_t* buffer, size_t capacity, SchedulerClock clock, uint32_t timeoutMs)
+    : _buffer(buffer), _capacity(capacity), _clock(clock), _timeoutMs(timeoutMs) {}
+
+void FrameParser::reset() {
+    _state = State::Sync0;
+    _held = 0;
+    _length = 0;
+    _rejected = false;
+    _replayAt = 0;
+    _replayEnd = 0;
+}
+
+void FrameParser::reject(FrameError error) {
+    _lastError = error;
+    _errors++;
+    _rejected = true;
+}
+
+// Синхропоследовательность могла оказаться ложной: байты после неё
+// (_buffer[0, _held)) и ещё не просмотренный остаток [restAt, restEnd)
+// просматриваются заново. Запись нового кадра в _buffer всегда идёт левее
+// читаемого байта, поэтому повтор разбирается прямо из буфера.
+void FrameParser::rescan(size_t restAt, size_t restEnd) {
+    size_t held = _held;
+    memmove(_buffer + held, _buffer + restAt, restEnd - restAt);
+    _replayAt = 0;
+    _replayEnd = held + (restEnd - restAt);
+    _state = State::Sync0;
+    _held = 0;
+    _rejected = false;
+}
+
+uint32_t FrameParser::untilNext() const {
+    // До заголовка ждать нечего: в буфере ещё ничего не лежит.
+    if (!_clock || _state == State::Sync0 || _state == State::Sync1 || _state == State::Ready) {
+        return SCHEDULER_IDLE;
+    }
+    unsigned long elapsed = _clock() - _startedAt;
+    return elapsed >= _timeoutMs ? 0 : _timeoutMs - elapsed;
+}
+
+bool FrameParser::poll() {
+    feed(nullptr, 0);
+    return ready();
+}
+
+size_t FrameParser::feed(const uint8_t* data, size_t length) {
+    if (_state == State::Ready) {
+        _state = State::Sync0;
+        _held = 0;
+    }
+    if (untilNext() == 0) {
+        reject(FrameError::Timeout);
+        rescan(0, 0);
+    }
+
+    size_t used = 0;
+    for (;;) {
+        // Сначала байты отброшенного кадра, потом новые.
+        if (_replayAt < _replayEnd) {
+            size_t end = _replayEnd;
+            _replayAt += consume(_buffer + _replayAt, end - _replayAt);
+            if (_rejected) {
+                rescan(_replayAt, end);
+            } else if (_state == State::Ready) {
+                return used;
+            }
+            continue;
+        }
+        if (used == length) {
+            return used;
+        }
+        used += consume(data + used, length - used);
+        if (_rejected) {
+            rescan(0, 0);
+        } else if (_state == State::Ready) {
+            return used;
+        }
+    }
+}
+
+// Разбирает data до готового или отброшенного кадра либо до конца data.
+size_t FrameParser::consume(const uint8_t* data, size_t length) {
+    size_t used = 0;
+    while (used < length) {
+        uint8_t byte = data[used];
+        switch (_state) {
+            case State::Sync0:
+                // Мусор между кадрами пропускается целиком до следующего A5.
+                {
+                    const void* sync = memchr(data + used, FRAME_SYNC0, length - used);
+                    if (!sync) {
+                        return length;
+                    }
+                    used = (const uint8_t*)sync - data + 1;
+                    _state = State::Sync1;
+                }
+                continue;
+
+            case State::Sync1:
+                if (byte == FRAME_SYNC1) {
+                    _state = State::Header;
+                    _held = 0;
+                    _startedAt = _clock ? _clock() : 0;
+                    used++;
+                } else {
+                    // A5 A5 5A: второй A5 может быть началом кадра.
+                    _state = State::Sync0;
+                }
+                continue;
+
+            case State::Header:
+                _buffer[_held++] = byte;
+                used++;
+                if (_held == HEADER) {
+                    _length = _buffer[2] | (_buffer[3] << 8);
+                    if (_length > _capacity - FRAME_BODY_OVERHEAD) {
+                        reject(FrameError::Oversize);
+                        return used;
+                    }
+                    _crc = crc32_update(0, _buffer, _held);
+                    _state = _length > 0 ? State::Payload : State::Crc;
+                }
+                continue;
+
+            case State::Payload: {
+                size_t chunk = HEADER + _length - _held;
+                if (chunk > length - used) {
+                    chunk = length - used;
+                }
+                // При повторе data лежит в том же буфере правее: memmove.
+                memmove(_buffer + _held, data + used, chunk);
+                _crc = crc32_update(_crc, _buffer + _held, chunk);
+                _held += chunk;
+                used += chunk;
+                if (_held == HEADER + _length) {
+                    _state = State::Crc;
+                }
+                continue;
+            }
+
+            case State::Crc:
+                _buffer[_held++] = byte;
+                used++;
+                if (_held == HEADER + _length + 4) {
+                    const uint8_t* crc = _buffer + _held - 4;
+                    uint32_t expected = (uint32_t)crc[0] | ((uint32_t)crc[1] << 8) |
+                                        ((uint32_t)crc[2] << 16) | ((uint32_t)crc[3] << 24);
+                    if (expected != _crc) {
+                        reject(FrameError::Crc);
+                        return used;
+                    }
+                    _state = State::Ready;
+                    return used;
+                }
+                continue;
+
+            case State::Ready:
+                return used;
+        }
+    }
+    return used;
+}
@@ -0,0 +1,117 @@
+#ifndef FRAME_PARSER_HPP
+#define FRAME_PARSER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scheduler.hpp"
+
+// Кадры для потоковых каналов без границ сообщений (Bluetooth SPP, UART):
+//
+//   A5 5A | type | seq | length (LE16) | payload | CRC-32 (LE32)
+//
+// CRC считается по type..payload. Парсер инкрементальный: принимает любые
+// куски потока, пока кадр не собран, и ничего не ждёт. Битый кадр (CRC,
+// длина, таймаут) отбрасывается, и поиск начинается заново с байта после его
+// синхропоследовательности: A5 5A внутри данных, принятое за начало кадра,
+// не съедает следующие за ним настоящие кадры. Отправитель повторяет кадры,
+// на которые не пришёл ответ с тем же seq.
+// Не зависит от Arduino: собирается и фаззится на хосте (test/test_frame_parser).
+
+const uint8_t FRAME_SYNC0 = 0xA5;
+const uint8_t FRAME_SYNC1 = 0x5A;
+const size_t FRAME_HEADER_SIZE = 6;
+const size_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + 4;
+// Кадр без синхропоследовательности, как он лежит в буфере парсера.
+const size_t FRAME_BODY_OVERHEAD = FRAME_OVERHEAD - 2;
+
+// Сколько ждать конца начатого кадра (нужен clock в конструкторе).
+#ifndef FRAME_TIMEOUT_MS
+#define FRAME_TIMEOUT_MS 1000
+#endif
+
+enum class FrameError : uint8_t {
+    None,
+    Crc,       // контрольная сумма не сошлась
+    Oversize,  // длина больше буфера парсера
+    Timeout    // кадр не дописан за FRAME_TIMEOUT_MS
+};
+
+const char* frame_error_name(FrameError error);
+
+// Размер кадра в out; 0 - не поместилось или payload длиннее 65535.
+size_t frame_encode(uint8_t type, uint8_t sequence, const uint8_t* payload, size_t length,
+                    uint8_t* out, size_t capacity);
+
+class FrameParser {
+public:
+    // buffer держит кадр без синхропоследовательности (заголовок, payload,
+    // CRC): payload - до capacity - FRAME_BODY_OVERHEAD байт. Без clock
+    // начатый кадр ждёт продолжения сколько угодно.
+    FrameParser(uint8_t* buffer, size_t capacity, SchedulerClock clock = nullptr,
+                uint32_t timeoutMs = FRAME_TIMEOUT_MS);
+
+    // Берёт байты, пока не соберётся кадр, и возвращает, сколько взято;
+    // остаток передаётся следующим вызовом. Готовый кадр доступен через
+    // ready()/type()/payload() до следующего feed(). Кадр может собраться
+    // и из уже принятых байтов отброшенного кадра, тогда взято может быть 0.
+    size_t feed(const uint8_t* data, size_t length);
+    // Без новых данных: проверяет таймаут и дособирает кадры из уже
+    // принятых байтов. true - готов кадр; звать, пока возвращает true.
+    bool poll();
+    // Мс до таймаута начатого кадра, SCHEDULER_IDLE - ждать нечего.
+    uint32_t untilNext() const;
+
+    bool ready() const { return _state == State::Ready; }
+    uint8_t type() const { return _buffer[0]; }
+    uint8_t sequence() const { return _buffer[1]; }
+    const uint8_t* payload() const { return _buffer + FRAME_HEADER_SIZE - 2; }
+    size_t length() const { return _length; }
+
+    // Отброшенные кадры: последняя причина и общее число.
+    FrameError lastError() const { return _lastError; }
+    uint32_t errors() const { return _errors; }
+
+    // Новый поток: забыть и начатый кадр, и непросмотренные байты.
+    void reset();
+
+private:
+    enum class State : uint8_t {
+        Sync0,
+        Sync1,
+        Header,
+        Payload,
+        Crc,
+        Ready
+    };
+
+    size_t consume(const uint8_t* data, size_t length);
+    void reject(FrameError error);
+    void rescan(size_t restAt, size_t restEnd);
+
+    uint8_t* _buffer;
+    size_t _capacity;
+    SchedulerClock _clock;
+    uint32_t _timeoutMs;
+    State _state = State::Sync0;
+    size_t _held = 0;        // байт кадра в _buffer
+    size_t _length = 0;
+    uint32_t _crc = 0;
+    unsigned long _startedAt = 0;
+    bool _rejected = false;
+    size_t _replayAt = 0;    // [_replayAt, _replayEnd) в _buffer - байты,
+    size_t _replayEnd = 0;   // которые нужно просмотреть до новых данных
+    FrameError _lastError = FrameError::None;
+    uint32_t _errors = 0;
+};
+
+template <size_t MaxPayload>
+class StaticFrameParser : public FrameParser {
+public:
+    explicit StaticFrameParser(SchedulerClock clock = nullptr, uint32_t timeoutMs = FRAME_TIMEOUT_MS)
+        : FrameParser(_storage, sizeof(_storage), clock, timeoutMs) {}
+
+private:
+    uint8_t _storage[MaxPayload + FRAME_BODY_OVERHEAD];
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "gateway.hpp"
+#include <stdio.h>
+#include <string.h>
+
+static void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void put_le32(uint8_t* out, uint32_t value) {
+    put_le16(out, value & 0xFFFF);
+    put_le16(out + 2, value >> 16);
+}
+
+size_t gateway_encode(const uint8_t node[6], uint16_t boot, uint16_t sequence, const GatewayReading* readings,
+                      uint8_t count, uint8_t* out, size_t capacity) {
+    size_t length = GATEWAY_HEADER_SIZE + (size_t)count * GATEWAY_READING_SIZE;
+    if (count > GATEWAY_MAX_READINGS || capacity < length) {
+        return 0;
+    }
+    out[0] = GATEWAY_PACKET_MAGIC;
+    out[1] = GATEWAY_PACKET_VERSION;
+    memcpy(out + 2, node, 6);
+    put_le16(out + 8, boot);
+    put_le16(out + 10, sequence);
+    out[12] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t* reading = out + GATEWAY_HEADER_SIZE + i * GATEWAY_READING_SIZE;
+        reading[0] = readings[i].sensor;
+        put_le32(reading + 1, (uint32_t)readings[i].value);
+    }
+    return length;
+}
+
+Gateway::Gateway(SchedulerClock clock) : _clock(clock) {
+    memset(_nodes, 0, sizeof(_nodes));
+    _windowStart = clock();
+}
+
+uint8_t Gateway::nodes() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < GATEWAY_MAX_NODES; i++) {
+        count += _nodes[i].used;
+    }
+    return count;
+}
+
+bool Gateway::pending(const Node& node) const {
+    for (uint8_t i = 0; i < GATEWAY_MAX_SENSORS; i++) {
+        if (node.slots[i].count > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Известный узел или место под новый: свободное либо дольше всех молчавшего
+// узла без показаний в текущем окне.
+Gateway::Node* Gateway::find(const uint8_t id[6]) {
+    Node* victim = nullptr;
+    for (uint8_t i = 0; i < GATEWAY_MAX_NODES; i++) {
+        Node& node = _nodes[i];
+        if (node.used && memcmp(node.id, id, 6) == 0) {
+            return &node;
+        }
+        if (!node.used) {
+            if (!victim || victim->used) {
+                victim = &node;
+            }
+        } else if (!pending(node) && (!victim || (victim->used && node.lastHeard < victim->lastHeard))) {
+            victim = &node;
+        }
+    }
+    if (victim) {
+        memset(victim, 0, sizeof(*victim));
+        memcpy(victim->id, id, 6);
+    }
+    return victim;
+}
+
+bool Gateway::fresh(Node& node, uint16_t boot, uint16_t sequence) {
+    if (!node.used || node.boot != boot) {
+        if (node.used) {
+            _stats.restarts++;  // узел перезагрузился: seq начат заново
+        }
+        node.used = true;
+        node.boot = boot;
+        node.lastSequence = sequence;
+        node.seen = 1;
+        return true;
+    }
+    int16_t ahead = (int16_t)(sequence - node.lastSequence);
+    if (ahead > 0) {
+        node.seen = ahead >= 32 ? 1 : (node.seen << ahead) | 1;
+        node.lastSequence = sequence;
+        return true;
+    }
+    uint16_t behind = (uint16_t)-ahead;
+    if (behind >= 32) {
+        // Сильно назад - узел потерял seq, не сменив boot (сброс счётчика).
+        node.lastSequence = sequence;
+        node.seen = 1;
+        return true;
+    }
+    uint32_t bit = (uint32_t)1 << behind;
+    if (node.seen & bit) {
+        return false;
+    }
+    node.seen |= bit;
+    return true;
+}
+
+GatewayResult Gateway::ingest(const uint8_t* packet, size_t length) {
+    if (length < GATEWAY_HEADER_SIZE || packet[0] != GATEWAY_PACKET_MAGIC || packet[1] != GATEWAY_PACKET_VERSION ||
+        packet[12] > GATEWAY_MAX_READINGS || length != GATEWAY_HEADER_SIZE + packet[12] * GATEWAY_READING_SIZE) {
+        _stats.malformed++;
+        return GatewayResult::Malformed;
+    }
+
+    Node* node = find(packet + 2);
+    if (!node) {
+        _stats.dropped++;
+        return GatewayResult::Full;
+    }
+    uint16_t boot = packet[8] | (packet[9] << 8);
+    uint16_t sequence = packet[10] | (packet[11] << 8);
+    if (!fresh(*node, boot, sequence)) {
+        _stats.duplicates++;
+        return GatewayResult::Duplicate;
+    }
+    node->lastHeard = _clock();
+
+    GatewayResult result = GatewayResult::Accepted;
+    for (uint8_t i = 0; i < packet[12]; i++) {
+        const uint8_t* reading = packet + GATEWAY_HEADER_SIZE + i * GATEWAY_READING_SIZE;
+        int32_t value = (int32_t)((uint32_t)reading[1] | ((uint32_t)reading[2] << 8) |
+                                  ((uint32_t)reading[3] << 16) | ((uint32_t)reading[4] << 24));
+        Slot* slot = nullptr;
+        for (uint8_t s = 0; s < GATEWAY_MAX_SENSORS && !slot; s++) {
+            Slot& candidate = node->slots[s];
+            if (candidate.count > 0 ? candidate.sensor == reading[0] : true) {
+                slot = &candidate;
+            }
+        }
+        if (!slot) {
+            result = GatewayResult::Full;
+            continue;
+        }
+        if (slot->count == 0) {
+            slot->sensor = reading[0];
+            slot->min = value;
+            slot->max = value;
+        } else {
+            slot->min = value < slot->min ? value : slot->min;
+            slot->max = value > slot->max ? value : slot->max;
+        }
+        slot->last = value;
+        if (slot->count < 0xFFFF) {
+            slot->count++;
+        }
+    }
+    if (result == GatewayResult::Full) {
+        _stats.dropped++;
+    } else {
+        _stats.accepted++;
+    }
+    return result;
+}
+
+// Сообщение пачки в буфере: заголовок, узлы, закрывающие скобки. Под "]}"
+// узла и "]}" сообщения место оставлено заранее.
+namespace {
+struct BatchWriter {
+    char* buffer;
+    size_t limit;
+    const char* header;
+    size_t headerLength;
+    GatewayEmit emit;
+    void* context;
+    size_t length = 0;
+    size_t sent = 0;     // принятые emit()
+    size_t refused = 0;
+    bool nodeOpen = false;
+    bool accepting = true;
+
+    bool empty() const { return length <= headerLength; }
+
+    void append(const char* text, size_t size) {
+        memcpy(buffer + length, text, size);
+        length += size;
+    }
+
+    void closeNode() {
+        if (nodeOpen) {
+            append("]}", 2);
+            nodeOpen = false;
+        }
+    }
+
+    void send() {
+        if (empty()) {
+            return;
+        }
+        closeNode();
+        append("]}", 2);
+        if (accepting && emit(buffer, length, context)) {
+            sent++;
+        } else {
+            accepting = false;
+            refused++;
+        }
+        length = 0;
+    }
+
+    // false - показание не влезает даже в пустое сообщение.
+    bool add(const char* id, const char* reading, size_t readingLength) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (length == 0) {
+                memcpy(buffer, header, headerLength);
+                length = headerLength;
+            }
+            char prefix[32];
+            size_t prefixLength;
+            if (nodeOpen) {
+                prefixLength = 1;
+                prefix[0] = ',';
+            } else {
+                prefixLength = snprintf(prefix, sizeof(prefix), "%s{\"id\":\"%s\",\"s\":[", empty() ? "" : ",", id);
+            }
+            if (length + prefixLength + readingLength <= limit) {
+                append(prefix, prefixLength);
+                append(reading, readingLength);
+                nodeOpen = true;
+                return true;
+            }
+            if (empty()) {
+                return false;
+            }
+            send();
+        }
+        return false;
+    }
+};
+}
+
+size_t Gateway::flush(char* buffer, size_t capacity, GatewayEmit emit, void* context) {
+    unsigned long now = _clock();
+    char header[48];
+    int headerLength = snprintf(header, sizeof(header), "{\"t\":%lu,\"w\":%lu,\"n\":[", now, now - _windowStart);
+    _windowStart = now;
+    if (capacity < (size_t)headerLength + 4) {
+        return 0;
+    }
+
+    BatchWriter writer;
+    writer.buffer = buffer;
+    writer.limit = capacity - 4;
+    writer.header = header;
+    writer.headerLength = headerLength;
+    writer.emit = emit;
+    writer.context = context;
+
+    for (uint8_t n = 0; n < GATEWAY_MAX_NODES; n++) {
+        Node& node = _nodes[n];
+        if (!node.used) {
+            continue;
+        }
+        char id[13];
+        snprintf(id, sizeof(id), "%02x%02x%02x%02x%02x%02x", node.id[0], node.id[1], node.id[2], node.id[3],
+                 node.id[4], node.id[5]);
+        for (uint8_t s = 0; s < GATEWAY_MAX_SENSORS; s++) {
+            Slot& slot = node.slots[s];
+            if (slot.count == 0) {
+                continue;
+            }
+            char reading[64];
+            int readingLength = snprintf(reading, sizeof(reading), "[%u,%ld,%ld,%ld,%u]", slot.sensor,
+                                         (long)slot.last, (long)slot.min, (long)slot.max, slot.count);
+            slot.count = 0;
+            if (!writer.add(id, reading, readingLength)) {
+                _stats.dropped++;
+            }
+        }
+        writer.closeNode();
+    }
+    writer.send();
+    _stats.batches += writer.sent;
+    _stats.refused += writer.refused;
+    return writer.sent;
+}
+
+size_t LoopbackTransport::poll(Gateway& gateway) {
+    size_t count = 0;
+    while (GatewayPacket* packet = _queue.front()) {
+        gateway.ingest(packet->data, packet->length);
+        _queue.release();
+        count++;
+    }
+    return count;
+}
+
+bool LoopbackTransport::send(const uint8_t* packet, size_t length) {
+    GatewayPacket* slot = length <= GATEWAY_MAX_PACKET ? _queue.reserve() : nullptr;
+    if (!slot) {
+        return false;
+    }
+    slot->length = length;
+    memcpy(slot->data, packet, length);
+    _queue.commit();
+    return true;
+}
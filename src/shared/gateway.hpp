@@ -0,0 +1,137 @@
+#ifndef GATEWAY_HPP
+#define GATEWAY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scheduler.hpp"
+#include "spsc_queue.hpp"
+
+// Режим шлюза: хаб принимает показания дочерних узлов (ESP-NOW, UDP) и
+// публикует их пачками в MQTT - одна сессия с брокером на весь участок.
+//
+// Пакет узла (влезает в кадр ESP-NOW, 250 байт):
+//   'G' | version 1 | node id (6, обычно MAC) | boot (LE16) | seq (LE16) |
+//   count | count x (sensor id, value LE32 со знаком, в единицах узла)
+//
+// За окно на каждую пару (узел, датчик) остаются последнее значение, минимум,
+// максимум и число показаний. Повторы (один пакет через два канала или
+// повтор отправки) отбрасываются по seq. boot - случайное число, которое узел
+// выбирает при старте: новое значение означает перезагрузку, и seq с нуля
+// не принимается за повторы. Не зависит от Arduino.
+
+#ifndef GATEWAY_MAX_NODES
+#define GATEWAY_MAX_NODES 32
+#endif
+
+#ifndef GATEWAY_MAX_SENSORS
+#define GATEWAY_MAX_SENSORS 4
+#endif
+
+#define GATEWAY_MAX_PACKET 250
+
+const uint8_t GATEWAY_PACKET_MAGIC = 'G';
+const uint8_t GATEWAY_PACKET_VERSION = 1;
+const size_t GATEWAY_HEADER_SIZE = 13;
+const size_t GATEWAY_READING_SIZE = 5;
+const uint8_t GATEWAY_MAX_READINGS = (GATEWAY_MAX_PACKET - GATEWAY_HEADER_SIZE) / GATEWAY_READING_SIZE;
+
+struct GatewayReading {
+    uint8_t sensor;
+    int32_t value;
+};
+
+// Пакет узла; 0 - не поместилось или count > GATEWAY_MAX_READINGS.
+size_t gateway_encode(const uint8_t node[6], uint16_t boot, uint16_t sequence, const GatewayReading* readings,
+                      uint8_t count, uint8_t* out, size_t capacity);
+
+enum class GatewayResult : uint8_t {
+    Accepted,
+    Duplicate,
+    Malformed,
+    Full       // нет места под новый узел или датчик
+};
+
+struct GatewayStats {
+    uint32_t accepted;
+    uint32_t duplicates;
+    uint32_t malformed;
+    uint32_t dropped;
+    uint32_t restarts;  // узел сменил boot
+    uint32_t batches;   // сообщения, принятые emit()
+    uint32_t refused;   // сообщения, от которых emit() отказался
+};
+
+// Готовое сообщение пачки; false - не принято (очередь MQTT полна), флаш прерывается.
+typedef bool (*GatewayEmit)(const char* payload, size_t length, void* context);
+
+class Gateway {
+public:
+    explicit Gateway(SchedulerClock clock);
+
+    GatewayResult ingest(const uint8_t* packet, size_t length);
+
+    // Накопленное за окно - в сообщения не длиннее capacity, по одному emit()
+    // на сообщение; узел, не влезающий в одно сообщение, делится по датчикам:
+    //   {"t":<мс хаба>,"w":<окно мс>,"n":[{"id":"a4cf12b3c4d5","s":[[sensor,last,min,max,count],...]},...]}
+    // Возвращает число принятых emit() сообщений. Окно очищается, даже если
+    // emit() отказал: данные устаревают быстрее, чем очередь освобождается.
+    size_t flush(char* buffer, size_t capacity, GatewayEmit emit, void* context);
+
+    const GatewayStats& stats() const { return _stats; }
+    uint8_t nodes() const;
+
+private:
+    struct Slot {
+        uint8_t sensor;
+        uint16_t count;  // 0 - показаний в окне нет
+        int32_t last;
+        int32_t min;
+        int32_t max;
+    };
+
+    struct Node {
+        uint8_t id[6];
+        bool used;
+        uint16_t boot;
+        uint16_t lastSequence;
+        uint32_t seen;  // бит i: принят seq lastSequence - i
+        unsigned long lastHeard;
+        Slot slots[GATEWAY_MAX_SENSORS];
+    };
+
+    Node* find(const uint8_t id[6]);
+    bool fresh(Node& node, uint16_t boot, uint16_t sequence);
+    bool pending(const Node& node) const;
+
+    SchedulerClock _clock;
+    Node _nodes[GATEWAY_MAX_NODES];
+    unsigned long _windowStart;
+    GatewayStats _stats = {};
+};
+
+// Канал приёма пакетов узлов. poll() отдаёт накопленное в шлюз и не ждёт.
+class GatewayTransport {
+public:
+    virtual ~GatewayTransport() {}
+    virtual bool begin() = 0;
+    virtual size_t poll(Gateway& gateway) = 0;
+};
+
+struct GatewayPacket {
+    uint8_t length;
+    uint8_t data[GATEWAY_MAX_PACKET];
+};
+
+// Пакеты из того же процесса: узлы-симуляторы на хосте, бенчмарки.
+// send() - из одной задачи, poll() - из другой.
+class LoopbackTransport : public GatewayTransport {
+public:
+    bool begin() override { return true; }
+    size_t poll(Gateway& gateway) override;
+    bool send(const uint8_t* packet, size_t length);
+
+private:
+    SpscQueue<GatewayPacket, 16> _queue;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "gateway_udp.hpp"
+
+size_t UdpTransport::poll(Gateway& gateway) {
+    uint8_t packet[GATEWAY_MAX_PACKET];
+    size_t count = 0;
+    // Ограничение на вызов, чтобы поток датаграмм не занял сетевую задачу целиком.
+    while (count < 16) {
+        int length = _udp.parsePacket();
+        if (length <= 0) {
+            break;
+        }
+        if (length > (int)sizeof(packet)) {
+            gateway.ingest(packet, 0);  // учитывается как битый
+        } else {
+            _udp.read(packet, length);
+            gateway.ingest(packet, length);
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,25 @@
+#ifndef GATEWAY_UDP_HPP
+#define GATEWAY_UDP_HPP
+
+#include <WiFiUdp.h>
+#include "gateway.hpp"
+
+#ifndef GATEWAY_UDP_PORT
+#define GATEWAY_UDP_PORT 4210
+#endif
+
+// Пакеты узлов датаграммами UDP: узлы в той же Wi-Fi сети, что и хаб, и
+// симуляторы на хосте. Одна датаграмма - один пакет.
+class UdpTransport : public GatewayTransport {
+public:
+    explicit UdpTransport(uint16_t port = GATEWAY_UDP_PORT) : _port(port) {}
+
+    bool begin() override { return _udp.begin(_port) == 1; }
+    size_t poll(Gateway& gateway) override;
+
+private:
+    WiFiUDP _udp;
+    uint16_t _port;
+};
+
+#endif
@@ -0,0 +1,455 @@
+#include "json_schema.hpp"
+#include <string.h>
+
+const char* json_error_name(JsonError error) {
+    switch (error) {
+        case JsonError::Ok:       return "ok";
+        case JsonError::Syntax:   return "syntax";
+        case JsonError::Type:     return "type";
+        case JsonError::Oversize: return "oversize";
+        case JsonError::Missing:  return "missing";
+    }
+    return "unknown";
+}
+
+// --- Разбор ---
+
+namespace {
+
+const uint8_t MAX_DEPTH = 16;
+
+struct Reader {
+    const char* pos;
+    const char* end;
+
+    bool atEnd() const { return pos >= end; }
+    char peek() const { return pos < end ? *pos : '\0'; }
+
+    void skipSpace() {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+            pos++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (peek() != c) {
+            return false;
+        }
+        pos++;
+        return true;
+    }
+
+    bool literal(const char* text) {
+        size_t length = strlen(text);
+        if ((size_t)(end - pos) < length || memcmp(pos, text, length) != 0) {
+            return false;
+        }
+        pos += length;
+        return true;
+    }
+};
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool read_hex4(Reader& in, uint32_t& value) {
+    if (in.end - in.pos < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_digit(in.pos[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | (uint32_t)digit;
+    }
+    in.pos += 4;
+    return true;
+}
+
+size_t utf8_encode(uint32_t code, char* out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+// Строка с разбором экранирования прямо в target (capacity включает ноль).
+// target == nullptr - только пропустить.
+JsonError read_string(Reader& in, char* target, size_t capacity) {
+    if (in.peek() != '"') {
+        return JsonError::Type;
+    }
+    in.pos++;
+
+    size_t length = 0;
+    while (!in.atEnd()) {
+        char c = *in.pos++;
+        if (c == '"') {
+            if (target) {
+                target[length] = '\0';
+            }
+            return JsonError::Ok;
+        }
+        if ((uint8_t)c < 0x20) {
+            return JsonError::Syntax;
+        }
+
+        char decoded[4];
+        size_t decodedLength = 1;
+        decoded[0] = c;
+        if (c == '\\') {
+            if (in.atEnd()) {
+                return JsonError::Syntax;
+            }
+            char escape = *in.pos++;
+            switch (escape) {
+                case '"':  decoded[0] = '"'; break;
+                case '\\': decoded[0] = '\\'; break;
+                case '/':  decoded[0] = '/'; break;
+                case 'b':  decoded[0] = '\b'; break;
+                case 'f':  decoded[0] = '\f'; break;
+                case 'n':  decoded[0] = '\n'; break;
+                case 'r':  decoded[0] = '\r'; break;
+                case 't':  decoded[0] = '\t'; break;
+                case 'u': {
+                    uint32_t code;
+                    // \u0000 оборвал бы строку в char[] молча; одиночная
+                    // младшая половина пары - не символ.
+                    if (!read_hex4(in, code) || code == 0 || (code >= 0xDC00 && code <= 0xDFFF)) {
+                        return JsonError::Syntax;
+                    }
+                    // Суррогатная пара - символ вне BMP.
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        uint32_t low;
+                        if (!in.literal("\\u") || !read_hex4(in, low) || low < 0xDC00 || low > 0xDFFF) {
+                            return JsonError::Syntax;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    decodedLength = utf8_encode(code, decoded);
+                    break;
+                }
+                default:
+                    return JsonError::Syntax;
+            }
+        }
+
+        if (target) {
+            if (length + decodedLength >= capacity) {
+                return JsonError::Oversize;
+            }
+            memcpy(target + length, decoded, decodedLength);
+        }
+        length += decodedLength;
+    }
+    return JsonError::Syntax;
+}
+
+JsonError read_integer(Reader& in, bool allowNegative, int64_t minimum, int64_t maximum, int64_t& value) {
+    bool negative = false;
+    if (in.peek() == '-') {
+        if (!allowNegative) {
+            return JsonError::Oversize;
+        }
+        negative = true;
+        in.pos++;
+    }
+    char c = in.peek();
+    if (c < '0' || c > '9') {
+        return c == '"' || c == 't' || c == 'f' || c == 'n' || c == '{' || c == '['
+            ? JsonError::Type : JsonError::Syntax;
+    }
+
+    int64_t result = 0;
+    while (!in.atEnd() && *in.pos >= '0' && *in.pos <= '9') {
+        result = result * 10 + (*in.pos++ - '0');
+        if (result > maximum + (negative ? 1 : 0)) {
+            return JsonError::Oversize;
+        }
+    }
+    // Дробная часть и экспонента в целых полях не поддерживаются.
+    c = in.peek();
+    if (c == '.' || c == 'e' || c == 'E') {
+        return JsonError::Type;
+    }
+    value = negative ? -result : result;
+    return value < minimum || value > maximum ? JsonError::Oversize : JsonError::Ok;
+}
+
+JsonError skip_value(Reader& in, uint8_t depth);
+
+JsonError skip_container(Reader& in, char close, uint8_t depth) {
+    if (depth >= MAX_DEPTH) {
+        return JsonError::Syntax;
+    }
+    in.pos++;
+    if (in.consume(close)) {
+        return JsonError::Ok;
+    }
+    for (;;) {
+        in.skipSpace();
+        if (close == '}') {
+            if (read_string(in, nullptr, 0) != JsonError::Ok || !in.consume(':')) {
+                return JsonError::Syntax;
+            }
+            in.skipSpace();
+        }
+        JsonError error = skip_value(in, depth + 1);
+        if (error != JsonError::Ok) {
+            return error;
+        }
+        if (in.consume(',')) {
+            continue;
+        }
+        return in.consume(close) ? JsonError::Ok : JsonError::Syntax;
+    }
+}
+
+JsonError skip_value(Reader& in, uint8_t depth) {
+    switch (in.peek()) {
+        case '"': return read_string(in, nullptr, 0) == JsonError::Ok ? JsonError::Ok : JsonError::Syntax;
+        case '{': return skip_container(in, '}', depth);
+        case '[': return skip_container(in, ']', depth);
+        case 't': return in.literal("true") ? JsonError::Ok : JsonError::Syntax;
+        case 'f': return in.literal("false") ? JsonError::Ok : JsonError::Syntax;
+        case 'n': return in.literal("null") ? JsonError::Ok : JsonError::Syntax;
+        default:
+            break;
+    }
+    const char* start = in.pos;
+    while (!in.atEnd() && ((*in.pos != '\0' && strchr("+-.eE", *in.pos)) || (*in.pos >= '0' && *in.pos <= '9'))) {
+        in.pos++;
+    }
+    return in.pos > start ? JsonError::Ok : JsonError::Syntax;
+}
+
+JsonError read_field(Reader& in, const JsonField& field, uint8_t* message) {
+    void* target = message + field.offset;
+    switch (field.type) {
+        case JsonType::String:
+            return read_string(in, (char*)target, field.size);
+        case JsonType::Bool:
+            if (in.literal("true")) {
+                *(bool*)target = true;
+            } else if (in.literal("false")) {
+                *(bool*)target = false;
+            } else {
+                return JsonError::Type;
+            }
+            return JsonError::Ok;
+        case JsonType::Int: {
+            int64_t value;
+            JsonError error = read_integer(in, true, INT32_MIN, INT32_MAX, value);
+            if (error == JsonError::Ok) {
+                *(int32_t*)target = (int32_t)value;
+            }
+            return error;
+        }
+        case JsonType::Uint: {
+            int64_t value;
+            JsonError error = read_integer(in, false, 0, UINT32_MAX, value);
+            if (error == JsonError::Ok) {
+                *(uint32_t*)target = (uint32_t)value;
+            }
+            return error;
+        }
+    }
+    return JsonError::Type;
+}
+
+// Ключ сравнивается с именами полей как есть, без разбора экранирования:
+// в схемах только ASCII-имена.
+const JsonField* find_field(const JsonSchema& schema, const char* key, size_t length, uint8_t& index) {
+    for (uint8_t i = 0; i < schema.count; i++) {
+        const char* name = schema.fields[i].name;
+        if (strncmp(name, key, length) == 0 && name[length] == '\0') {
+            index = i;
+            return &schema.fields[i];
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+JsonError json_parse(const JsonSchema& schema, const char* json, size_t length, void* message) {
+    Reader in = { json, json + length };
+    uint32_t seen = 0;
+
+    if (!in.consume('{')) {
+        return JsonError::Syntax;
+    }
+    if (!in.consume('}')) {
+        for (;;) {
+            in.skipSpace();
+            if (in.peek() != '"') {
+                return JsonError::Syntax;
+            }
+            const char* key = in.pos + 1;
+            if (read_string(in, nullptr, 0) != JsonError::Ok) {
+                return JsonError::Syntax;
+            }
+            size_t keyLength = (size_t)(in.pos - 1 - key);
+            if (!in.consume(':')) {
+                return JsonError::Syntax;
+            }
+            in.skipSpace();
+
+            uint8_t index = 0;
+            const JsonField* field = find_field(schema, key, keyLength, index);
+            JsonError error = field ? read_field(in, *field, (uint8_t*)message) : skip_value(in, 0);
+            if (error != JsonError::Ok) {
+                return error;
+            }
+            if (field && index < 32) {
+                seen |= 1UL << index;
+            }
+
+            if (in.consume(',')) {
+                continue;
+            }
+            if (in.consume('}')) {
+                break;
+            }
+            return JsonError::Syntax;
+        }
+    }
+
+    in.skipSpace();
+    if (!in.atEnd()) {
+        return JsonError::Syntax;
+    }
+    for (uint8_t i = 0; i < schema.count && i < 32; i++) {
+        if (schema.fields[i].required && !(seen & (1UL << i))) {
+            return JsonError::Missing;
+        }
+    }
+    return JsonError::Ok;
+}
+
+// --- Сериализация ---
+
+namespace {
+
+struct Writer {
+    char* out;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    void put(char c) {
+        if (length + 1 >= capacity) {
+            overflow = true;
+            return;
+        }
+        out[length++] = c;
+    }
+
+    void put(const char* text, size_t size) {
+        if (length + size >= capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + length, text, size);
+        length += size;
+    }
+
+    void putUnsigned(uint32_t value, bool negative) {
+        char digits[11];
+        size_t pos = sizeof(digits);
+        do {
+            digits[--pos] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        if (negative) {
+            put('-');
+        }
+        put(digits + pos, sizeof(digits) - pos);
+    }
+
+    void putString(const char* text, size_t maxLength) {
+        static const char hex[] = "0123456789abcdef";
+        put('"');
+        for (size_t i = 0; i < maxLength && text[i] != '\0' && !overflow; i++) {
+            char c = text[i];
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(c);
+            } else if ((uint8_t)c < 0x20) {
+                char escape[6] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0x0F], hex[c & 0x0F] };
+                put(escape, sizeof(escape));
+            } else {
+                put(c);
+            }
+        }
+        put('"');
+    }
+};
+
+}  // namespace
+
+size_t json_serialize(const JsonSchema& schema, const void* message, char* output, size_t capacity) {
+    Writer out = { output, capacity, 0, false };
+    const uint8_t* base = (const uint8_t*)message;
+
+    out.put('{');
+    for (uint8_t i = 0; i < schema.count; i++) {
+        const JsonField& field = schema.fields[i];
+        const void* source = base + field.offset;
+        if (i > 0) {
+            out.put(',');
+        }
+        out.putString(field.name, strlen(field.name));
+        out.put(':');
+        switch (field.type) {
+            case JsonType::String:
+                out.putString((const char*)source, field.size);
+                break;
+            case JsonType::Bool:
+                if (*(const bool*)source) {
+                    out.put("true", 4);
+                } else {
+                    out.put("false", 5);
+                }
+                break;
+            case JsonType::Int: {
+                int32_t value = *(const int32_t*)source;
+                out.putUnsigned(value < 0 ? 0U - (uint32_t)value : (uint32_t)value, value < 0);
+                break;
+            }
+            case JsonType::Uint:
+                out.putUnsigned(*(const uint32_t*)source, false);
+                break;
+        }
+    }
+    out.put('}');
+
+    if (out.overflow || capacity == 0) {
+        return 0;
+    }
+    output[out.length] = '\0';
+    return out.length;
+}
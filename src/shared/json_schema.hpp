@@ -0,0 +1,61 @@
+#ifndef JSON_SCHEMA_HPP
+#define JSON_SCHEMA_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// JSON по схеме: сообщение - обычная структура, схема - статическая таблица
+// полей (имя, тип, смещение, размер), собранная компилятором через offsetof.
+// Разбор идёт одним проходом по входному буферу и пишет значения сразу в поля
+// структуры; сериализация пишет сразу в выходной буфер. Кучу не трогает.
+
+enum class JsonType : uint8_t {
+    String,  // char[N], N включает завершающий ноль
+    Bool,
+    Int,     // int32_t
+    Uint     // uint32_t
+};
+
+struct JsonField {
+    const char* name;
+    JsonType type;
+    bool required;
+    uint16_t offset;
+    uint16_t size;
+};
+
+struct JsonSchema {
+    const JsonField* fields;
+    uint8_t count;
+};
+
+enum class JsonError : uint8_t {
+    Ok,
+    Syntax,    // не JSON-объект или мусор после него
+    Type,      // значение не того типа
+    Oversize,  // строка не помещается в поле, число вне диапазона
+    Missing    // нет обязательного поля
+};
+
+const char* json_error_name(JsonError error);
+
+#define JSON_MEMBER_SIZE(Type, member) sizeof(((Type*)0)->member)
+
+#define JSON_FIELD(Type, member, key, jsonType, isRequired) \
+    { key, jsonType, isRequired, (uint16_t)offsetof(Type, member), (uint16_t)JSON_MEMBER_SIZE(Type, member) }
+
+#define JSON_STRING(Type, member, key) JSON_FIELD(Type, member, key, JsonType::String, true)
+#define JSON_BOOL(Type, member, key) JSON_FIELD(Type, member, key, JsonType::Bool, true)
+#define JSON_INT(Type, member, key) JSON_FIELD(Type, member, key, JsonType::Int, true)
+#define JSON_UINT(Type, member, key) JSON_FIELD(Type, member, key, JsonType::Uint, true)
+
+#define JSON_SCHEMA(fields) { fields, (uint8_t)(sizeof(fields) / sizeof(fields[0])) }
+
+// Неизвестные ключи пропускаются. Поля, которых нет во входе, не трогаются:
+// значения по умолчанию задаются до вызова.
+JsonError json_parse(const JsonSchema& schema, const char* json, size_t length, void* message);
+
+// Длина без завершающего нуля; 0 - не поместилось.
+size_t json_serialize(const JsonSchema& schema, const void* message, char* output, size_t capacity);
+
+#endif
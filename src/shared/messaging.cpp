@@ -1,18 +1,18 @@
 #include "messaging.hpp"
-#include <Arduino.h>
+#include "binlog.hpp"
 
 void Messaging::connect() {
-  Serial.println("Connecting to messaging service...");
+  LOG_INFO("Connecting to messaging service...\n");
 }
 
 void Messaging::disconnect() {
-  Serial.println("Disconnecting from messaging service...");
+  LOG_INFO("Disconnecting from messaging service...\n");
 }
 
 void Messaging::send_message(const char* message) {
-  Serial.println(message);
+  LOG_INFO("%s\n", message);
 }
 
 void Messaging::receive_message() {
-  Serial.println("Receiving message...");
+  LOG_INFO("Receiving message...\n");
 }
@@ -0,0 +1,127 @@
+#include "metrics.hpp"
+#include <WiFi.h>
+#include <stdio.h>
+
+// Заполняется конструкторами глобальных метрик при статической инициализации,
+// до запуска задач; после этого список только читается.
+static Metric* metrics_head = nullptr;
+
+Metric::Metric(const char* name, const char* key, const char* help, MetricType type)
+    : _name(name), _key(key), _help(help), _type(type), _next(metrics_head) {
+    metrics_head = this;
+}
+
+MetricHistogram::MetricHistogram(const char* name, const char* key, const char* help,
+                                 const uint32_t* bounds, uint8_t count)
+    : Metric(name, key, help, MetricType::Histogram),
+      _bounds(bounds),
+      _count(count > METRICS_MAX_BUCKETS ? METRICS_MAX_BUCKETS : count) {
+    for (uint8_t i = 0; i <= METRICS_MAX_BUCKETS; i++) {
+        _hits[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(uint32_t value) {
+    uint8_t bucket = 0;
+    while (bucket < _count && value > _bounds[bucket]) {
+        bucket++;
+    }
+    _hits[bucket].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint32_t MetricHistogram::count() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i <= _count; i++) {
+        total += hits(i);
+    }
+    return total;
+}
+
+static MetricGauge heap_free("heap_free_bytes", "hf", "Free heap");
+static MetricGauge heap_largest_block("heap_largest_block_bytes", "hb", "Largest allocatable heap block");
+static MetricGauge wifi_rssi("wifi_rssi_dbm", "rs", "Station RSSI, 0 when not connected");
+
+void metrics_sample_system() {
+    heap_free.set(ESP.getFreeHeap());
+    heap_largest_block.set(ESP.getMaxAllocHeap());
+    wifi_rssi.set(WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0);
+}
+
+const Metric* metrics_first() {
+    return metrics_head;
+}
+
+static void write_histogram(Print& out, const MetricHistogram& histogram) {
+    // Корзины читаются по одной, поэтому под нагрузкой _count может
+    // немного разойтись с суммой корзин - для Prometheus это допустимо.
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < histogram.buckets(); i++) {
+        cumulative += histogram.hits(i);
+        out.printf("%s_bucket{le=\"%u\"} %u\n", histogram.name(), (unsigned)histogram.bound(i),
+                   (unsigned)cumulative);
+    }
+    cumulative += histogram.hits(histogram.buckets());
+    out.printf("%s_bucket{le=\"+Inf\"} %u\n", histogram.name(), (unsigned)cumulative);
+    out.printf("%s_sum %llu\n", histogram.name(), (unsigned long long)histogram.sum());
+    out.printf("%s_count %u\n", histogram.name(), (unsigned)cumulative);
+}
+
+void metrics_write_prometheus(Print& out) {
+    for (const Metric* metric = metrics_first(); metric; metric = metric->next()) {
+        out.printf("# HELP %s %s\n", metric->name(), metric->help());
+        switch (metric->type()) {
+            case MetricType::Counter:
+                out.printf("# TYPE %s counter\n%s %u\n", metric->name(), metric->name(),
+                           (unsigned)static_cast<const MetricCounter*>(metric)->value());
+                break;
+            case MetricType::Gauge:
+                out.printf("# TYPE %s gauge\n%s %d\n", metric->name(), metric->name(),
+                           (int)static_cast<const MetricGauge*>(metric)->value());
+                break;
+            case MetricType::Histogram:
+                out.printf("# TYPE %s histogram\n", metric->name());
+                write_histogram(out, *static_cast<const MetricHistogram*>(metric));
+                break;
+        }
+    }
+}
+
+size_t metrics_write_compact(char* out, size_t cap) {
+    size_t length = 0;
+    char separator = '{';
+    for (const Metric* metric = metrics_first(); metric; metric = metric->next()) {
+        int written = 0;
+        switch (metric->type()) {
+            case MetricType::Counter:
+                written = snprintf(out + length, cap - length, "%c\"%s\":%u", separator, metric->key(),
+                                   (unsigned)static_cast<const MetricCounter*>(metric)->value());
+                break;
+            case MetricType::Gauge:
+                written = snprintf(out + length, cap - length, "%c\"%s\":%d", separator, metric->key(),
+                                   (int)static_cast<const MetricGauge*>(metric)->value());
+                break;
+            case MetricType::Histogram: {
+                const MetricHistogram* histogram = static_cast<const MetricHistogram*>(metric);
+                written = snprintf(out + length, cap - length, "%c\"%s\":[%u,%llu]", separator,
+                                   metric->key(), (unsigned)histogram->count(),
+                                   (unsigned long long)histogram->sum());
+                break;
+            }
+        }
+        if (written < 0 || (size_t)written >= cap - length) {
+            return 0;
+        }
+        length += written;
+        separator = ',';
+    }
+    if (length + (separator == '{' ? 3 : 2) > cap) {
+        return 0;
+    }
+    if (separator == '{') {
+        out[length++] = '{';
+    }
+    out[length++] = '}';
+    out[length] = '\0';
+    return length;
+}
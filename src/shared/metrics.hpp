@@ -0,0 +1,100 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef METRICS_MAX_BUCKETS
+#define METRICS_MAX_BUCKETS 12
+#endif
+
+// Метрики устройства: счётчики, значения и гистограммы с фиксированными
+// границами. Объявляются глобальными объектами и сами встают в общий список;
+// обновление - одна атомарная операция, из любой задачи (64-битная сумма
+// гистограммы на 32-битной плате идёт через libatomic с короткой блокировкой).
+// name - имя для Prometheus, key - короткий ключ для MQTT-статистики.
+
+enum class MetricType : uint8_t {
+    Counter,
+    Gauge,
+    Histogram
+};
+
+class Metric {
+public:
+    const char* name() const { return _name; }
+    const char* key() const { return _key; }
+    const char* help() const { return _help; }
+    MetricType type() const { return _type; }
+    const Metric* next() const { return _next; }
+
+protected:
+    Metric(const char* name, const char* key, const char* help, MetricType type);
+
+private:
+    const char* _name;
+    const char* _key;
+    const char* _help;
+    MetricType _type;
+    Metric* _next;
+};
+
+class MetricCounter : public Metric {
+public:
+    MetricCounter(const char* name, const char* key, const char* help)
+        : Metric(name, key, help, MetricType::Counter) {}
+    void add(uint32_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> _value{0};
+};
+
+class MetricGauge : public Metric {
+public:
+    MetricGauge(const char* name, const char* key, const char* help)
+        : Metric(name, key, help, MetricType::Gauge) {}
+    void set(int32_t value) { _value.store(value, std::memory_order_relaxed); }
+    int32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> _value{0};
+};
+
+// bounds - верхние границы корзин по возрастанию (не больше METRICS_MAX_BUCKETS),
+// последняя корзина (+Inf) добавляется сама. Массив должен жить всю программу.
+class MetricHistogram : public Metric {
+public:
+    MetricHistogram(const char* name, const char* key, const char* help,
+                    const uint32_t* bounds, uint8_t count);
+    void observe(uint32_t value);
+
+    uint8_t buckets() const { return _count; }
+    uint32_t bound(uint8_t bucket) const { return _bounds[bucket]; }
+    // Попадания в корзину bucket (не накопительно); bucket == buckets() - +Inf.
+    uint32_t hits(uint8_t bucket) const { return _hits[bucket].load(std::memory_order_relaxed); }
+    uint32_t count() const;
+    // 64 бита: мкс итераций в uint32_t переполнились бы за час с небольшим.
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+
+private:
+    const uint32_t* _bounds;
+    uint8_t _count;
+    std::atomic<uint32_t> _hits[METRICS_MAX_BUCKETS + 1];
+    std::atomic<uint64_t> _sum{0};
+};
+
+// Все зарегистрированные метрики (в обратном порядке объявления).
+const Metric* metrics_first();
+
+// Текстовый формат Prometheus 0.0.4.
+void metrics_write_prometheus(Print& out);
+
+// Обновляет общие значения устройства: свободная куча, самый большой блок, RSSI.
+void metrics_sample_system();
+
+// Компактный JSON для MQTT: {"key":value,...}, гистограмма - [count,sum].
+// 0 - не поместилось в cap.
+size_t metrics_write_compact(char* out, size_t cap);
+
+#endif
@@ -0,0 +1,24 @@
+#include "ota_sign.hpp"
+#include <string.h>
+
+void ota_sign(const char* key, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+              uint8_t signature[SHA256_SIZE]) {
+    uint8_t message[SHA256_SIZE + 5];
+    memcpy(message, digest, SHA256_SIZE);
+    message[SHA256_SIZE] = size & 0xFF;
+    message[SHA256_SIZE + 1] = (size >> 8) & 0xFF;
+    message[SHA256_SIZE + 2] = (size >> 16) & 0xFF;
+    message[SHA256_SIZE + 3] = (size >> 24) & 0xFF;
+    message[SHA256_SIZE + 4] = delta ? 1 : 0;
+    hmac_sha256(key, strlen(key), message, sizeof(message), signature);
+}
+
+bool ota_verify(const char* key, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+                const uint8_t signature[SHA256_SIZE]) {
+    if (!key || key[0] == '\0') {
+        return false;
+    }
+    uint8_t expected[SHA256_SIZE];
+    ota_sign(key, size, digest, delta, expected);
+    return digest_equal(expected, signature, SHA256_SIZE);
+}
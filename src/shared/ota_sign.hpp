@@ -0,0 +1,19 @@
+#ifndef OTA_SIGN_HPP
+#define OTA_SIGN_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha256.hpp"
+
+// Подпись OTA-сессии: HMAC-SHA256 ключом устройства по SHA-256 итогового
+// образа, длине потока (LE32) и признаку патча. Образ сверяется с этим
+// SHA-256 перед выбором слота для загрузки, так что подпись покрывает и его:
+// прошить устройство может только тот, у кого есть ключ.
+// Не зависит от Arduino: подписи готовит tools/ota_delta.cpp.
+void ota_sign(const char* key, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+              uint8_t signature[SHA256_SIZE]);
+// false и при пустом ключе: без ключа устройство обновления не принимает.
+bool ota_verify(const char* key, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+                const uint8_t signature[SHA256_SIZE]);
+
+#endif
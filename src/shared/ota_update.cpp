@@ -0,0 +1,344 @@
+#include "ota_update.hpp"
+#include "crc32.hpp"
+#include "binlog.hpp"
+#include "flash_fs.hpp"
+#include <LittleFS.h>
+#include <stddef.h>
+
+static const uint32_t OTA_TRIAL_MAGIC = 0x3141544F; // "OTA1"
+
+struct OtaTrialFile {
+    uint32_t magic;
+    char previous[17];  // метка слота, с которого обновлялись
+    uint8_t boots;
+    uint8_t reserved[2];
+    uint32_t crc;
+};
+
+const char* ota_state_name(OtaState state) {
+    switch (state) {
+        case OtaState::Idle:      return "idle";
+        case OtaState::Receiving: return "receiving";
+        case OtaState::Ready:     return "ready";
+        case OtaState::Failed:    return "failed";
+    }
+    return "unknown";
+}
+
+const char* ota_error_name(OtaError error) {
+    switch (error) {
+        case OtaError::None:      return "none";
+        case OtaError::Busy:      return "busy";
+        case OtaError::Partition: return "partition";
+        case OtaError::Sequence:  return "sequence";
+        case OtaError::Auth:      return "auth";
+        case OtaError::Size:      return "size";
+        case OtaError::Patch:     return "patch";
+        case OtaError::Write:     return "write";
+        case OtaError::Digest:    return "digest";
+        case OtaError::Image:     return "image";
+    }
+    return "unknown";
+}
+
+// Неблокирующий захват: запись во flash идёт долго, второй канал в это
+// время получает Busy, а не ждёт.
+class OtaUpdate::Guard {
+public:
+    explicit Guard(std::atomic<bool>& locked) : _locked(locked), _owned(!locked.exchange(true)) {}
+    ~Guard() {
+        if (_owned) {
+            _locked = false;
+        }
+    }
+    bool owned() const { return _owned; }
+
+private:
+    std::atomic<bool>& _locked;
+    bool _owned;
+};
+
+OtaUpdate::OtaUpdate(const char* key) : _key(key), _locked(false), _state(OtaState::Idle), _patcher(readRunning, writeImage, this) {}
+
+bool OtaUpdate::readRunning(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    OtaUpdate* ota = (OtaUpdate*)context;
+    return esp_partition_read(ota->_running, offset, out, length) == ESP_OK;
+}
+
+bool OtaUpdate::writeImage(const uint8_t* data, size_t length, void* context) {
+    OtaUpdate* ota = (OtaUpdate*)context;
+    esp_err_t result = esp_ota_write(ota->_handle, data, length);
+    if (result != ESP_OK) {
+        LOG_WARN("[OTA] Write failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+    ota->_sha.update(data, length);
+    return true;
+}
+
+OtaError OtaUpdate::fail(OtaError error) {
+    if (_state == OtaState::Receiving) {
+        esp_ota_abort(_handle);
+    }
+    _error = error;
+    _state = OtaState::Failed;
+    LOG_WARN("[OTA] Failed at %u of %u: %s\n", (unsigned)_received, (unsigned)_size, ota_error_name(error));
+    return error;
+}
+
+bool OtaUpdate::owns(OtaTransport transport) const {
+    return _state == OtaState::Receiving && _transport == transport;
+}
+
+OtaError OtaUpdate::begin(OtaTransport transport, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+                          const uint8_t signature[SHA256_SIZE]) {
+    Guard guard(_locked);
+    if (!guard.owned()) {
+        return OtaError::Busy;
+    }
+    // До всего остального: неподписанный begin не прерывает идущую сессию.
+    if (!ota_verify(_key, size, digest, delta, signature)) {
+        LOG_WARN("[OTA] Rejected %s: %s\n", delta ? "patch" : "image",
+                 _key[0] ? "bad signature" : "no OTA_KEY on this device");
+        return OtaError::Auth;
+    }
+    if (_state == OtaState::Receiving) {
+        if (transport != _transport && millis() - _lastActivity < OTA_SESSION_TIMEOUT_MS) {
+            return OtaError::Busy;
+        }
+        esp_ota_abort(_handle);
+        _state = OtaState::Idle;
+    }
+
+    _running = esp_ota_get_running_partition();
+    _target = esp_ota_get_next_update_partition(nullptr);
+    _transport = transport;
+    _received = 0;
+    _reported = 0;
+    _size = size;
+    _delta = delta;
+    _error = OtaError::None;
+    if (!_target) {
+        return fail(OtaError::Partition);
+    }
+    if (size == 0 || (!delta && size > _target->size)) {
+        return fail(OtaError::Size);
+    }
+    // Последовательная запись стирает по сектору перед записью: стирание
+    // всего слота заранее заняло бы секунды и оборвало бы связь.
+    esp_err_t result = esp_ota_begin(_target, OTA_WITH_SEQUENTIAL_WRITES, &_handle);
+    if (result != ESP_OK) {
+        LOG_WARN("[OTA] Cannot start: %s\n", esp_err_to_name(result));
+        return fail(OtaError::Partition);
+    }
+
+    memcpy(_digest, digest, SHA256_SIZE);
+    _sha.reset();
+    _patcher.reset();
+    _lastActivity = millis();
+    _state = OtaState::Receiving;
+    LOG_INFO("[OTA] Receiving %s of %u bytes into %s\n", delta ? "patch" : "image",
+             (unsigned)size, _target->label);
+    return OtaError::None;
+}
+
+OtaError OtaUpdate::write(OtaTransport transport, uint32_t offset, const uint8_t* data, size_t length) {
+    Guard guard(_locked);
+    if (!guard.owned() || (_state == OtaState::Receiving && _transport != transport)) {
+        return OtaError::Busy;
+    }
+    if (!owns(transport)) {
+        return _error != OtaError::None ? _error : OtaError::Sequence;
+    }
+    _lastActivity = millis();
+    if (offset < _received && length <= _received - offset) {
+        return OtaError::None;  // повтор: отправитель не дождался подтверждения
+    }
+    if (offset != _received) {
+        return OtaError::Sequence;
+    }
+    if (length > _size - _received) {
+        return fail(OtaError::Size);
+    }
+
+    if (_delta) {
+        if (_patcher.feed(data, length) != PatchError::None) {
+            LOG_WARN("[OTA] Patch rejected: %s\n", patch_error_name(_patcher.error()));
+            return fail(_patcher.error() == PatchError::Write ? OtaError::Write : OtaError::Patch);
+        }
+    } else if (!writeImage(data, length, this)) {
+        return fail(OtaError::Write);
+    }
+    _received += length;
+    return OtaError::None;
+}
+
+OtaError OtaUpdate::writeChunk(OtaTransport transport, const uint8_t* message, size_t length) {
+    if (length < 4) {
+        return OtaError::Size;
+    }
+    uint32_t offset = (uint32_t)message[0] | ((uint32_t)message[1] << 8) |
+                      ((uint32_t)message[2] << 16) | ((uint32_t)message[3] << 24);
+    return write(transport, offset, message + 4, length - 4);
+}
+
+OtaError OtaUpdate::finish(OtaTransport transport) {
+    Guard guard(_locked);
+    if (!guard.owned()) {
+        return OtaError::Busy;
+    }
+    if (_state == OtaState::Ready && _transport == transport) {
+        return OtaError::None;  // повторный end после потерянного ответа
+    }
+    if (_state == OtaState::Receiving && _transport != transport) {
+        return OtaError::Busy;
+    }
+    if (!owns(transport)) {
+        return _error != OtaError::None ? _error : OtaError::Sequence;
+    }
+    // Проверка исходного образа шла по куску на feed(): остаток - здесь.
+    while (_delta && _received == _size && !_patcher.sourceChecked()) {
+        if (_patcher.checkSource() != PatchError::None) {
+            LOG_WARN("[OTA] Patch rejected: %s\n", patch_error_name(_patcher.error()));
+            return fail(OtaError::Patch);
+        }
+    }
+    if (_received != _size || (_delta && !_patcher.complete())) {
+        return fail(OtaError::Size);
+    }
+
+    uint8_t digest[SHA256_SIZE];
+    _sha.finish(digest);
+    if (memcmp(digest, _digest, SHA256_SIZE) != 0) {
+        return fail(OtaError::Digest);
+    }
+    _state = OtaState::Idle;  // сессия esp_ota закрывается ниже, abort не нужен
+    esp_err_t result = esp_ota_end(_handle);
+    if (result != ESP_OK) {
+        LOG_WARN("[OTA] Image rejected: %s\n", esp_err_to_name(result));
+        return fail(OtaError::Image);
+    }
+    result = esp_ota_set_boot_partition(_target);
+    if (result != ESP_OK) {
+        LOG_WARN("[OTA] Cannot select %s: %s\n", _target->label, esp_err_to_name(result));
+        return fail(OtaError::Partition);
+    }
+
+    OtaTrialFile trial = {};
+    trial.magic = OTA_TRIAL_MAGIC;
+    snprintf(trial.previous, sizeof(trial.previous), "%s", _running->label);
+    trial.crc = crc32(&trial, offsetof(OtaTrialFile, crc));
+    File file = flash_fs_mount() ? LittleFS.open(OTA_TRIAL_PATH, "w") : File();
+    if (!file || file.write((const uint8_t*)&trial, sizeof(trial)) != sizeof(trial)) {
+        LOG_WARN("[OTA] Cannot store trial record, automatic rollback disabled\n");
+    }
+    if (file) {
+        file.close();
+    }
+
+    _state = OtaState::Ready;
+    LOG_INFO("[OTA] Image verified, next boot from %s\n", _target->label);
+    return OtaError::None;
+}
+
+void OtaUpdate::abort(OtaTransport transport) {
+    Guard guard(_locked);
+    if (guard.owned() && owns(transport)) {
+        esp_ota_abort(_handle);
+        _state = OtaState::Idle;
+        _error = OtaError::None;
+    }
+}
+
+bool OtaUpdate::progressDue() {
+    if (_received == _reported || (_received - _reported < OTA_PROGRESS_INTERVAL && _received != _size)) {
+        return false;
+    }
+    _reported = _received;
+    return true;
+}
+
+size_t OtaUpdate::writeStatus(OtaError result, char* out, size_t capacity) const {
+    OtaError error = result != OtaError::None ? result : _error;
+    int length = snprintf(out, capacity, "{\"state\":\"%s\",\"offset\":%u,\"size\":%u,\"error\":\"%s\"}",
+                          ota_state_name(_state), (unsigned)_received, (unsigned)_size, ota_error_name(error));
+    return length > 0 && (size_t)length < capacity ? (size_t)length : 0;
+}
+
+// --- Пробная загрузка и откат ---
+
+static bool read_trial(OtaTrialFile& trial) {
+    if (!flash_fs_mount() || !LittleFS.exists(OTA_TRIAL_PATH)) {
+        return false;
+    }
+    File file = LittleFS.open(OTA_TRIAL_PATH, "r");
+    if (!file) {
+        return false;
+    }
+    bool complete = file.read((uint8_t*)&trial, sizeof(trial)) == sizeof(trial);
+    file.close();
+    trial.previous[sizeof(trial.previous) - 1] = '\0';
+    return complete && trial.magic == OTA_TRIAL_MAGIC && trial.crc == crc32(&trial, offsetof(OtaTrialFile, crc));
+}
+
+static void clear_trial() {
+    if (flash_fs_mount() && LittleFS.exists(OTA_TRIAL_PATH)) {
+        LittleFS.remove(OTA_TRIAL_PATH);
+    }
+}
+
+bool ota_check_boot() {
+    OtaTrialFile trial;
+    if (!read_trial(trial)) {
+        return false;
+    }
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (strcmp(running->label, trial.previous) == 0) {
+        // Загрузчик не принял новый образ и сам вернулся на старый.
+        LOG_WARN("[OTA] Update did not boot, still running %s\n", running->label);
+        clear_trial();
+        return false;
+    }
+
+    trial.boots++;
+    if (trial.boots > OTA_MAX_TRIAL_BOOTS) {
+        ota_rollback();
+        return false;
+    }
+    trial.crc = crc32(&trial, offsetof(OtaTrialFile, crc));
+    File file = LittleFS.open(OTA_TRIAL_PATH, "w");
+    if (file) {
+        file.write((const uint8_t*)&trial, sizeof(trial));
+        file.close();
+    }
+    LOG_INFO("[OTA] Trial boot %u of %u from %s\n", (unsigned)trial.boots, (unsigned)OTA_MAX_TRIAL_BOOTS,
+             running->label);
+    return true;
+}
+
+void ota_confirm_boot() {
+    OtaTrialFile trial;
+    if (read_trial(trial)) {
+        LOG_INFO("[OTA] Update confirmed after %u boot(s)\n", (unsigned)trial.boots);
+        clear_trial();
+    }
+    // С включённым откатом в загрузчике образ ещё и в PENDING_VERIFY.
+    esp_ota_mark_app_valid_cancel_rollback();
+}
+
+void ota_rollback() {
+    OtaTrialFile trial;
+    if (!read_trial(trial)) {
+        return;
+    }
+    clear_trial();
+    const esp_partition_t* previous =
+        esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, trial.previous);
+    if (!previous || esp_ota_set_boot_partition(previous) != ESP_OK) {
+        LOG_WARN("[OTA] Cannot roll back to %s\n", trial.previous);
+        return;
+    }
+    LOG_WARN("[OTA] Update not confirmed, rolling back to %s\n", previous->label);
+    delay(100);
+    ESP.restart();
+}
@@ -0,0 +1,147 @@
+#ifndef OTA_UPDATE_HPP
+#define OTA_UPDATE_HPP
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <atomic>
+#include "delta_patch.hpp"
+#include "ota_sign.hpp"
+#include "sha256.hpp"
+
+// Ключ подписи обновлений (ota_sign.hpp), задаётся через build_flags. Без
+// него устройство не принимает OTA ни по MQTT, ни по HTTP.
+#ifndef OTA_KEY
+#define OTA_KEY ""
+#endif
+
+// Запись о пробной загрузке нового образа: переживает перезагрузки, пока
+// прошивка не подтвердит, что работает (ota_confirm_boot()).
+#ifndef OTA_TRIAL_PATH
+#define OTA_TRIAL_PATH "/ota_trial.bin"
+#endif
+
+// Столько перезагрузок новый образ может не дойти до подтверждения,
+// потом загрузка возвращается на предыдущий.
+#ifndef OTA_MAX_TRIAL_BOOTS
+#define OTA_MAX_TRIAL_BOOTS 3
+#endif
+
+// Столько новый образ может работать без ota_confirm_boot(), потом ota_rollback().
+#ifndef OTA_CONFIRM_TIMEOUT_MS
+#define OTA_CONFIRM_TIMEOUT_MS 300000
+#endif
+
+// Сессия без новых данных дольше этого может быть перехвачена другим каналом.
+#ifndef OTA_SESSION_TIMEOUT_MS
+#define OTA_SESSION_TIMEOUT_MS 60000
+#endif
+
+// Как часто (в байтах потока) отправителю сообщается прогресс.
+#ifndef OTA_PROGRESS_INTERVAL
+#define OTA_PROGRESS_INTERVAL 8192
+#endif
+
+enum class OtaTransport : uint8_t {
+    Mqtt,
+    Http
+};
+
+enum class OtaState : uint8_t {
+    Idle,
+    Receiving,
+    Ready,   // образ записан и выбран для загрузки, нужна перезагрузка
+    Failed
+};
+
+enum class OtaError : uint8_t {
+    None,
+    Busy,       // идёт сессия другого канала
+    Partition,  // нет слота для записи или не удалось выбрать его для загрузки
+    Sequence,   // кусок не с того смещения: отправитель продолжает с received()
+    Auth,       // подпись не сошлась или на устройстве нет ключа
+    Size,       // данных больше или меньше объявленного
+    Patch,      // патч не применился, см. patchError()
+    Write,      // ошибка записи во flash
+    Digest,     // SHA-256 образа не совпал
+    Image       // esp_ota_end() не принял образ
+};
+
+const char* ota_state_name(OtaState state);
+const char* ota_error_name(OtaError error);
+
+// Приём прошивки в неактивный слот потоком: полный образ или патч
+// (delta_patch.hpp) против текущего. SHA-256 считается по записанному образу
+// и сверяется перед выбором слота для загрузки; сам SHA-256 подписан ключом
+// устройства, без верной подписи сессия не начинается.
+//
+// Данные приходят кусками со смещением: повтор уже принятого куска
+// игнорируется, пропуск отвергается с OtaError::Sequence, и отправитель
+// продолжает с received(). По MQTT кусок вместе с топиком должен
+// помещаться в MQTT_RX_BUFFER_SIZE. Одновременно идёт одна сессия; вызовы из разных
+// задач не блокируют друг друга, а получают OtaError::Busy.
+class OtaUpdate {
+public:
+    // key должен жить дольше объекта.
+    explicit OtaUpdate(const char* key = OTA_KEY);
+
+    // size - длина потока (образа или патча), digest - SHA-256 итогового образа,
+    // signature - ota_sign() от них ключом устройства.
+    // Повторный begin() того же канала начинает сессию заново.
+    OtaError begin(OtaTransport transport, uint32_t size, const uint8_t digest[SHA256_SIZE], bool delta,
+                   const uint8_t signature[SHA256_SIZE]);
+    OtaError write(OtaTransport transport, uint32_t offset, const uint8_t* data, size_t length);
+    // Сообщение MQTT: смещение (LE32) и данные.
+    OtaError writeChunk(OtaTransport transport, const uint8_t* message, size_t length);
+    // Проверяет образ и выбирает его для следующей загрузки. Перезагружает вызывающий.
+    OtaError finish(OtaTransport transport);
+    void abort(OtaTransport transport);
+
+    OtaState state() const { return _state; }
+    OtaError error() const { return _error; }
+    PatchError patchError() const { return _patcher.error(); }
+    uint32_t received() const { return _received; }
+    uint32_t size() const { return _size; }
+
+    // Пора ли сообщить прогресс: true раз в OTA_PROGRESS_INTERVAL байт.
+    bool progressDue();
+    // {"state":"receiving","offset":8192,"size":40960,"error":"none"};
+    // error - result последнего вызова, если он не None, иначе ошибка сессии.
+    size_t writeStatus(OtaError result, char* out, size_t capacity) const;
+
+private:
+    class Guard;
+
+    OtaError fail(OtaError error);
+    bool owns(OtaTransport transport) const;
+    static bool readRunning(uint32_t offset, uint8_t* out, size_t length, void* context);
+    static bool writeImage(const uint8_t* data, size_t length, void* context);
+
+    const char* _key;
+    std::atomic<bool> _locked;
+    std::atomic<OtaState> _state;
+    OtaError _error = OtaError::None;
+    OtaTransport _transport = OtaTransport::Mqtt;
+    unsigned long _lastActivity = 0;
+
+    const esp_partition_t* _running = nullptr;
+    const esp_partition_t* _target = nullptr;
+    esp_ota_handle_t _handle = 0;
+    bool _delta = false;
+    uint32_t _size = 0;
+    uint32_t _received = 0;
+    uint32_t _reported = 0;
+    uint8_t _digest[SHA256_SIZE];
+    Sha256 _sha;
+    DeltaPatcher _patcher;
+};
+
+// В начале setup(): считает загрузки нового образа и после
+// OTA_MAX_TRIAL_BOOTS неподтверждённых возвращает предыдущий.
+// true - работает ещё не подтверждённый образ.
+bool ota_check_boot();
+// Новый образ работает (связь с брокером есть): откат больше не нужен.
+void ota_confirm_boot();
+// Вернуть предыдущий образ и перезагрузиться, если образ так и не подтвердился.
+void ota_rollback();
+
+#endif
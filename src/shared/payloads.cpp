@@ -0,0 +1,72 @@
+#include "payloads.hpp"
+
+static const JsonField wifiCredentialsFields[] = {
+    JSON_STRING(WiFiCredentials, ssid, "ssid"),
+    JSON_STRING(WiFiCredentials, password, "password")
+};
+const JsonSchema WIFI_CREDENTIALS_SCHEMA = JSON_SCHEMA(wifiCredentialsFields);
+
+static const JsonField deviceStatusFields[] = {
+    JSON_BOOL(DeviceStatus, wifiConnected, "wifi_connected"),
+    JSON_BOOL(DeviceStatus, configMode, "config_mode"),
+    JSON_STRING(DeviceStatus, ipAddress, "ip_address")
+};
+const JsonSchema DEVICE_STATUS_SCHEMA = JSON_SCHEMA(deviceStatusFields);
+
+static const JsonField bridgePublishFields[] = {
+    JSON_STRING(BridgePublish, topic, "topic"),
+    JSON_STRING(BridgePublish, message, "message")
+};
+const JsonSchema BRIDGE_PUBLISH_SCHEMA = JSON_SCHEMA(bridgePublishFields);
+
+static const JsonField sensorAggregateFields[] = {
+    JSON_STRING(SensorAggregate, sensor, "sensor"),
+    JSON_UINT(SensorAggregate, windowMs, "window_ms"),
+    JSON_UINT(SensorAggregate, count, "count"),
+    JSON_UINT(SensorAggregate, min, "min"),
+    JSON_UINT(SensorAggregate, max, "max"),
+    JSON_UINT(SensorAggregate, mean, "mean"),
+    JSON_UINT(SensorAggregate, p50, "p50"),
+    JSON_UINT(SensorAggregate, p90, "p90"),
+    JSON_UINT(SensorAggregate, p99, "p99")
+};
+const JsonSchema SENSOR_AGGREGATE_SCHEMA = JSON_SCHEMA(sensorAggregateFields);
+
+static const JsonField brokerConfigFields[] = {
+    JSON_STRING(BrokerConfig, host, "host"),
+    JSON_UINT(BrokerConfig, port, "port")
+};
+const JsonSchema BROKER_CONFIG_SCHEMA = JSON_SCHEMA(brokerConfigFields);
+
+static const JsonField otaBeginFields[] = {
+    JSON_UINT(OtaBegin, size, "size"),
+    JSON_STRING(OtaBegin, sha256, "sha256"),
+    JSON_FIELD(OtaBegin, delta, "delta", JsonType::Bool, false),
+    JSON_STRING(OtaBegin, signature, "sig")
+};
+const JsonSchema OTA_BEGIN_SCHEMA = JSON_SCHEMA(otaBeginFields);
+
+JsonError parse_wifi_credentials(const char* json, size_t length, WiFiCredentials& credentials) {
+    return json_parse(WIFI_CREDENTIALS_SCHEMA, json, length, &credentials);
+}
+
+JsonError parse_bridge_publish(const char* json, size_t length, BridgePublish& publish) {
+    return json_parse(BRIDGE_PUBLISH_SCHEMA, json, length, &publish);
+}
+
+JsonError parse_broker_config(const char* json, size_t length, BrokerConfig& config) {
+    JsonError error = json_parse(BROKER_CONFIG_SCHEMA, json, length, &config);
+    if (error == JsonError::Ok && (config.port == 0 || config.port > 65535)) {
+        return JsonError::Oversize;
+    }
+    return error;
+}
+
+JsonError parse_ota_begin(const char* json, size_t length, OtaBegin& begin) {
+    begin.delta = false;
+    return json_parse(OTA_BEGIN_SCHEMA, json, length, &begin);
+}
+
+size_t serialize_status(const DeviceStatus& status, char* output, size_t capacity) {
+    return json_serialize(DEVICE_STATUS_SCHEMA, &status, output, capacity);
+}
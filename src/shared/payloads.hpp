@@ -0,0 +1,106 @@
+#ifndef PAYLOADS_HPP
+#define PAYLOADS_HPP
+
+#include <Arduino.h>
+#include "json_schema.hpp"
+
+// JSON-сообщения, общие для прошивок: вынесены из приложений,
+// чтобы их можно было собрать и измерить на хосте.
+// Поля фиксированного размера: слишком длинное значение - ошибка разбора, а не куча.
+
+#define PAYLOAD_SSID_SIZE 33      // 32 символа по 802.11
+#define PAYLOAD_PASSWORD_SIZE 65  // 64 символа WPA2
+#define PAYLOAD_IP_SIZE 16
+#define PAYLOAD_TOPIC_SIZE 64     // как MQTT_QUEUE_TOPIC_SIZE
+#define PAYLOAD_MESSAGE_SIZE 256  // как MQTT_QUEUE_PAYLOAD_SIZE
+#define PAYLOAD_HOST_SIZE 64
+#define PAYLOAD_DEVICE_NAME_SIZE 33
+
+// {"ssid":"...","password":"..."}
+struct WiFiCredentials {
+    char ssid[PAYLOAD_SSID_SIZE];
+    char password[PAYLOAD_PASSWORD_SIZE];
+};
+
+// {"wifi_connected":true,"config_mode":false,"ip_address":"..."}
+struct DeviceStatus {
+    bool wifiConnected;
+    bool configMode;
+    char ipAddress[PAYLOAD_IP_SIZE];
+};
+
+// {"topic":"...","message":"..."} - публикация в MQTT через HTTP /mqtt
+struct BridgePublish {
+    char topic[PAYLOAD_TOPIC_SIZE];
+    char message[PAYLOAD_MESSAGE_SIZE];
+};
+
+// {"sensor":"moisture","window_ms":10000,"count":100000,"min":1210,"max":1388,
+//  "mean":1302,"p50":1304,"p90":1336,"p99":1368} - отсчёты АЦП за окно
+struct SensorAggregate {
+    char sensor[16];
+    uint32_t windowMs;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+};
+
+// {"host":"broker.local","port":1883}
+struct BrokerConfig {
+    char host[PAYLOAD_HOST_SIZE];
+    uint32_t port;
+};
+
+// {"size":40960,"sha256":"<64 hex>","delta":true,"sig":"<64 hex>"} - начало
+// OTA-сессии, sha256 - итогового образа, size - длина передаваемого потока,
+// sig - ota_sign() от них (ota_sign.hpp)
+struct OtaBegin {
+    uint32_t size;
+    char sha256[65];
+    bool delta;
+    char signature[65];
+};
+
+// Провижининг по Bluetooth: кадры frame_parser.hpp, тип кадра - команда.
+// Команды можно слать подряд, не дожидаясь ответов; на каждую приходит кадр
+// с типом command | PROVISION_REPLY, тем же seq и одним байтом ProvisionResult.
+// Сессию, начатую с '{', messaging разбирает по-старому: строка JSON
+// WiFiCredentials до '\n', ответ - текстом.
+enum class ProvisionCommand : uint8_t {
+    WiFiCredentials = 0x01,  // JSON WiFiCredentials
+    BrokerConfig = 0x02,     // JSON BrokerConfig
+    DeviceName = 0x03,       // имя устройства, до 32 байт без нуля
+    Apply = 0x04             // подключиться с полученными настройками
+};
+
+enum class ProvisionResult : uint8_t {
+    Ok,
+    BadPayload,   // не разобралось или значение вне допустимого
+    Unsupported,  // неизвестная команда
+    NotReady      // Apply без учётных данных WiFi
+};
+
+const uint8_t PROVISION_REPLY = 0x80;
+#define PROVISION_MAX_PAYLOAD 256
+
+extern const JsonSchema WIFI_CREDENTIALS_SCHEMA;
+extern const JsonSchema DEVICE_STATUS_SCHEMA;
+extern const JsonSchema BRIDGE_PUBLISH_SCHEMA;
+extern const JsonSchema SENSOR_AGGREGATE_SCHEMA;
+extern const JsonSchema BROKER_CONFIG_SCHEMA;
+extern const JsonSchema OTA_BEGIN_SCHEMA;
+
+JsonError parse_wifi_credentials(const char* json, size_t length, WiFiCredentials& credentials);
+JsonError parse_bridge_publish(const char* json, size_t length, BridgePublish& publish);
+JsonError parse_broker_config(const char* json, size_t length, BrokerConfig& config);
+// delta необязателен, по умолчанию полный образ.
+JsonError parse_ota_begin(const char* json, size_t length, OtaBegin& begin);
+
+// Длина JSON в output; 0 - не поместилось.
+size_t serialize_status(const DeviceStatus& status, char* output, size_t capacity);
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SAMPLE_AGGREGATOR_HPP
+#define SAMPLE_AGGREGATOR_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct SampleStats {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+    uint16_t p50;
+    uint16_t p90;
+    uint16_t p99;
+};
+
+// Агрегат окна выборок АЦП в фиксированной памяти: min/max/среднее точно,
+// процентили - по гистограмме с корзинами шириной 2^BucketShift отсчётов
+// (для 12-битного АЦП и сдвига 4: 256 корзин, точность 16 отсчётов, 1 КБ).
+// add() - O(1) на выборку, окно не хранится. Окна сменяются через reset().
+template <uint8_t BucketShift = 4, uint16_t MaxValue = 4095>
+class SampleAggregator {
+public:
+    static const size_t BUCKETS = (MaxValue >> BucketShift) + 1;
+
+    SampleAggregator() { reset(); }
+
+    void add(uint16_t value) {
+        if (value > MaxValue) {
+            value = MaxValue;
+        }
+        if (value < _min) {
+            _min = value;
+        }
+        if (value > _max) {
+            _max = value;
+        }
+        _sum += value;
+        _count++;
+        _histogram[value >> BucketShift]++;
+    }
+
+    void add(const uint16_t* values, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            add(values[i]);
+        }
+    }
+
+    uint32_t count() const { return _count; }
+
+    // Значение, не больше которого percent% выборок окна (середина корзины,
+    // ограниченная фактическими min/max).
+    uint16_t percentile(uint8_t percent) const {
+        if (_count == 0) {
+            return 0;
+        }
+        if (percent > 100) {
+            percent = 100;
+        }
+        uint32_t rank = (uint32_t)(((uint64_t)_count * percent + 99) / 100);
+        if (rank == 0) {
+            rank = 1;
+        }
+
+        uint32_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            seen += _histogram[bucket];
+            if (seen >= rank) {
+                uint32_t value = ((uint32_t)bucket << BucketShift) + ((1U << BucketShift) >> 1);
+                if (value < _min) {
+                    value = _min;
+                }
+                if (value > _max) {
+                    value = _max;
+                }
+                return (uint16_t)value;
+            }
+        }
+        return _max;
+    }
+
+    bool snapshot(SampleStats& stats) const {
+        if (_count == 0) {
+            return false;
+        }
+        stats.count = _count;
+        stats.min = _min;
+        stats.max = _max;
+        stats.mean = (uint16_t)((_sum + _count / 2) / _count);
+        stats.p50 = percentile(50);
+        stats.p90 = percentile(90);
+        stats.p99 = percentile(99);
+        return true;
+    }
+
+    void reset() {
+        _count = 0;
+        _sum = 0;
+        _min = MaxValue;
+        _max = 0;
+        memset(_histogram, 0, sizeof(_histogram));
+    }
+
+private:
+    uint32_t _count;
+    uint64_t _sum;
+    uint16_t _min;
+    uint16_t _max;
+    uint32_t _histogram[BUCKETS];
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "scheduler.hpp"
+#include <string.h>
+
+static const uint8_t INDEX_BITS = 6;
+static const uint16_t INDEX_MASK = (1 << INDEX_BITS) - 1;
+static const uint16_t GENERATION_MASK = 0xFFFF >> INDEX_BITS;
+
+static inline uint32_t level_shift(uint8_t level) {
+    return (uint32_t)level * TimerWheel::SLOT_BITS;
+}
+
+static inline bool due_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+// Сколько слотов от current до первого занятого (по кругу), 64 - ни одного.
+static uint8_t first_occupied(uint64_t bits, uint8_t current) {
+    if (bits == 0) {
+        return TimerWheel::SLOTS;
+    }
+    uint64_t rotated = current == 0 ? bits : (bits >> current) | (bits << (64 - current));
+    return (uint8_t)__builtin_ctzll(rotated);
+}
+
+TimerWheel::TimerWheel(SchedulerJob* jobs, uint8_t capacity, SchedulerClock clock)
+    : _jobs(jobs), _capacity(capacity), _clock(clock), _now((uint32_t)clock()) {
+    memset(_heads, -1, sizeof(_heads));
+    memset(_occupied, 0, sizeof(_occupied));
+    for (uint8_t i = 0; i < _capacity; i++) {
+        _jobs[i].active = false;
+        _jobs[i].generation = 0;
+        _jobs[i].next = i + 1 < _capacity ? (int8_t)(i + 1) : -1;
+    }
+    _free = 0;
+}
+
+JobId TimerWheel::idOf(int8_t index) const {
+    return (JobId)((_jobs[index].generation << INDEX_BITS) | (uint16_t)index);
+}
+
+SchedulerJob* TimerWheel::find(JobId id) const {
+    uint16_t index = id & INDEX_MASK;
+    if (id == NO_JOB || index >= _capacity) {
+        return nullptr;
+    }
+    SchedulerJob* job = &_jobs[index];
+    if (!job->active || job->generation != (id >> INDEX_BITS)) {
+        return nullptr;
+    }
+    return job;
+}
+
+JobId TimerWheel::after(uint32_t delayMs, JobCallback callback, void* context) {
+    return add(delayMs, 0, callback, context);
+}
+
+JobId TimerWheel::every(uint32_t periodMs, JobCallback callback, void* context,
+                        uint32_t firstDelayMs) {
+    if (periodMs == 0) {
+        return NO_JOB;
+    }
+    return add(firstDelayMs ? firstDelayMs : periodMs, periodMs, callback, context);
+}
+
+JobId TimerWheel::add(uint32_t delay, uint32_t period, JobCallback callback, void* context) {
+    if (!callback || _free < 0) {
+        return NO_JOB;
+    }
+    int8_t index = _free;
+    SchedulerJob& job = _jobs[index];
+    _free = job.next;
+
+    // Поколение 0 не выдаётся, чтобы id никогда не совпал с NO_JOB.
+    job.generation = (job.generation + 1) & GENERATION_MASK;
+    if (job.generation == 0) {
+        job.generation = 1;
+    }
+    job.due = (uint32_t)_clock() + (delay ? delay : 1);
+    job.period = period;
+    job.callback = callback;
+    job.context = context;
+    job.active = true;
+    insert(index);
+    _active++;
+    return idOf(index);
+}
+
+bool TimerWheel::cancel(JobId id) {
+    SchedulerJob* job = find(id);
+    if (!job) {
+        return false;
+    }
+    int8_t index = (int8_t)(job - _jobs);
+    unlink(index);
+    release(index);
+    return true;
+}
+
+bool TimerWheel::reschedule(JobId id, uint32_t delayMs) {
+    SchedulerJob* job = find(id);
+    if (!job) {
+        return false;
+    }
+    int8_t index = (int8_t)(job - _jobs);
+    unlink(index);
+    job->due = (uint32_t)_clock() + (delayMs ? delayMs : 1);
+    insert(index);
+    return true;
+}
+
+bool TimerWheel::scheduled(JobId id) const {
+    return find(id) != nullptr;
+}
+
+// Уровень выбирается по расстоянию от _now: на уровне L задача лежит в слоте
+// своего срока и спускается ниже, когда _now доходит до границы этого слота.
+void TimerWheel::insert(int8_t index) {
+    SchedulerJob& job = _jobs[index];
+    uint32_t delta = job.due - _now;
+    uint32_t placed = job.due;
+    if (delta > MAX_DELAY) {
+        placed = _now + MAX_DELAY;
+        delta = MAX_DELAY;
+    }
+
+    uint8_t level = 0;
+    while (level + 1 < LEVELS && delta >= (1UL << level_shift(level + 1))) {
+        level++;
+    }
+    uint8_t slot = (placed >> level_shift(level)) & (SLOTS - 1);
+
+    job.level = level;
+    job.slot = slot;
+    job.prev = -1;
+    job.next = _heads[level][slot];
+    if (job.next >= 0) {
+        _jobs[job.next].prev = index;
+    }
+    _heads[level][slot] = index;
+    _occupied[level] |= 1ULL << slot;
+}
+
+void TimerWheel::unlink(int8_t index) {
+    SchedulerJob& job = _jobs[index];
+    if (job.prev >= 0) {
+        _jobs[job.prev].next = job.next;
+    } else {
+        _heads[job.level][job.slot] = job.next;
+    }
+    if (job.next >= 0) {
+        _jobs[job.next].prev = job.prev;
+    }
+    if (_heads[job.level][job.slot] < 0) {
+        _occupied[job.level] &= ~(1ULL << job.slot);
+    }
+}
+
+void TimerWheel::release(int8_t index) {
+    SchedulerJob& job = _jobs[index];
+    job.active = false;
+    job.next = _free;
+    _free = index;
+    _active--;
+}
+
+void TimerWheel::cascade(uint8_t level, uint8_t slot) {
+    int8_t index = _heads[level][slot];
+    _heads[level][slot] = -1;
+    _occupied[level] &= ~(1ULL << slot);
+    while (index >= 0) {
+        int8_t next = _jobs[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+// Задачи вынимаются по одной: обработчик может снять или поставить любую задачу.
+void TimerWheel::expire(uint8_t slot, uint32_t now) {
+    int8_t index;
+    while ((index = _heads[0][slot]) >= 0) {
+        SchedulerJob& job = _jobs[index];
+        unlink(index);
+        JobCallback callback = job.callback;
+        void* context = job.context;
+
+        if (job.period) {
+            // После долгой паузы пропущенные периоды не догоняются.
+            uint32_t late = now - job.due;
+            job.due += job.period * (late / job.period + 1);
+            insert(index);
+        } else {
+            release(index);
+        }
+        callback(context);
+    }
+}
+
+uint32_t TimerWheel::run() {
+    uint32_t target = (uint32_t)_clock();
+    while (!due_before(target, _now)) {
+        uint32_t tick = _now;
+        if ((tick & (SLOTS - 1)) == 0) {
+            for (uint8_t level = 1; level < LEVELS; level++) {
+                uint8_t slot = (tick >> level_shift(level)) & (SLOTS - 1);
+                if (_occupied[level] & (1ULL << slot)) {
+                    cascade(level, slot);
+                }
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        uint8_t slot = tick & (SLOTS - 1);
+        if (_occupied[0] & (1ULL << slot)) {
+            expire(slot, target);
+        }
+
+        // Пустые тики пропускаются: до следующего занятого слота уровня 0
+        // или до границы, на которой может понадобиться перенос.
+        uint32_t step = SLOTS - (tick & (SLOTS - 1));
+        uint8_t next = first_occupied(_occupied[0], (tick + 1) & (SLOTS - 1));
+        if (next + 1U < step) {
+            step = next + 1;
+        }
+        _now = tick + step;
+        if (due_before(target, _now)) {
+            _now = target + 1;
+        }
+    }
+    return untilNext();
+}
+
+uint32_t TimerWheel::untilNext() const {
+    if (_active == 0) {
+        return SCHEDULER_IDLE;
+    }
+
+    // Слоты уровня упорядочены по сроку, поэтому ближайшая задача - в первом
+    // занятом слоте одного из уровней; на уровне 0 срок равен номеру слота.
+    uint32_t best = 0;
+    bool found = false;
+    for (uint8_t level = 0; level < LEVELS; level++) {
+        uint64_t bits = _occupied[level];
+        if (bits == 0) {
+            continue;
+        }
+        uint32_t shift = level_shift(level);
+        uint8_t current = (_now >> shift) & (SLOTS - 1);
+        if (level == 0) {
+            uint32_t at = _now + first_occupied(bits, current);
+            if (!found || due_before(at, best)) {
+                best = at;
+                found = true;
+            }
+            continue;
+        }
+        // Текущий слот уровня уже пройден, если _now не на его границе:
+        // в нём лежат задачи следующего оборота.
+        uint32_t span = 1UL << shift;
+        uint32_t distance;
+        if ((_now & (span - 1)) != 0) {
+            uint64_t ahead = bits & ~(1ULL << current);
+            distance = ahead ? first_occupied(ahead, current) : SLOTS;
+        } else {
+            distance = first_occupied(bits, current);
+        }
+        uint8_t slot = (current + distance) & (SLOTS - 1);
+        // Задача, поставленная дальше MAX_DELAY, лежит раньше своего срока:
+        // для неё берётся конец слота, чтобы не проспать задачи следующих слотов.
+        uint32_t slotEnd = (_now & ~(span - 1)) + distance * span + span - 1;
+        for (int8_t index = _heads[level][slot]; index >= 0; index = _jobs[index].next) {
+            uint32_t at = due_before(slotEnd, _jobs[index].due) ? slotEnd : _jobs[index].due;
+            if (!found || due_before(at, best)) {
+                best = at;
+                found = true;
+            }
+        }
+    }
+
+    uint32_t now = (uint32_t)_clock();
+    return due_before(now, best) ? best - now : 0;
+}
@@ -0,0 +1,96 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Иерархическое колесо таймеров с шагом 1 мс: 4 уровня по 64 слота
+// (64 мс, 4 с, 4.4 мин, 4.7 ч). Постановка и снятие - O(1), срабатывание -
+// O(1) на задачу плюс редкий перенос слота верхнего уровня вниз. Пустые
+// слоты пропускаются по битовым маскам, поэтому run() после долгого сна
+// не перебирает каждую миллисекунду.
+
+typedef void (*JobCallback)(void* context);
+typedef unsigned long (*SchedulerClock)();
+
+// 0 - нет задачи. В старших битах поколение: снятый и переиспользованный
+// слот не отменится по старому id.
+typedef uint16_t JobId;
+const JobId NO_JOB = 0;
+
+// untilNext(), когда задач нет.
+const uint32_t SCHEDULER_IDLE = 0xFFFFFFFFUL;
+
+struct SchedulerJob {
+    uint32_t due;
+    uint32_t period;  // 0 - однократная
+    JobCallback callback;
+    void* context;
+    int8_t next;
+    int8_t prev;
+    uint8_t level;
+    uint8_t slot;
+    uint16_t generation;
+    bool active;
+};
+
+class TimerWheel {
+public:
+    static const uint8_t LEVELS = 4;
+    static const uint8_t SLOT_BITS = 6;
+    static const uint8_t SLOTS = 1 << SLOT_BITS;
+    // Дальше этого задача ставится на максимум и переносится по мере приближения.
+    static const uint32_t MAX_DELAY = (1UL << (SLOT_BITS * LEVELS)) - 1;
+
+    // Однократная задача через delayMs (не раньше чем через 1 мс).
+    JobId after(uint32_t delayMs, JobCallback callback, void* context = nullptr);
+    // Периодическая; первый запуск через firstDelayMs (по умолчанию - через период).
+    JobId every(uint32_t periodMs, JobCallback callback, void* context = nullptr,
+                uint32_t firstDelayMs = 0);
+    bool cancel(JobId id);
+    // Переносит задачу на delayMs от текущего момента, период сохраняется.
+    bool reschedule(JobId id, uint32_t delayMs);
+    bool scheduled(JobId id) const;
+
+    // Выполняет всё, что наступило, и возвращает untilNext().
+    uint32_t run();
+    // Мс до ближайшего срока (0 - уже пора), SCHEDULER_IDLE - задач нет.
+    uint32_t untilNext() const;
+    size_t active() const { return _active; }
+
+protected:
+    TimerWheel(SchedulerJob* jobs, uint8_t capacity, SchedulerClock clock);
+
+private:
+    JobId add(uint32_t due, uint32_t period, JobCallback callback, void* context);
+    void insert(int8_t index);
+    void unlink(int8_t index);
+    void release(int8_t index);
+    void cascade(uint8_t level, uint8_t slot);
+    void expire(uint8_t slot, uint32_t now);
+    SchedulerJob* find(JobId id) const;
+    JobId idOf(int8_t index) const;
+
+    SchedulerJob* _jobs;
+    uint8_t _capacity;
+    SchedulerClock _clock;
+    uint32_t _now;  // первый ещё не обработанный тик
+    size_t _active = 0;
+    int8_t _free = -1;
+    int8_t _heads[LEVELS][SLOTS];
+    uint64_t _occupied[LEVELS];
+};
+
+// MaxJobs - не больше 64 (индекс и поколение делят 16 бит id).
+template <uint8_t MaxJobs>
+class Scheduler : public TimerWheel {
+public:
+    explicit Scheduler(SchedulerClock clock) : TimerWheel(_pool, MaxJobs, clock) {
+        static_assert(MaxJobs > 0 && MaxJobs <= 64, "Scheduler supports up to 64 jobs");
+    }
+
+private:
+    SchedulerJob _pool[MaxJobs];
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t SHA256_SIZE = 32;
+
+// SHA-256 по частям, без зависимостей от платформы: одинаково считается
+// на плате (проверка OTA) и на хосте (подготовка образов, бенчмарк).
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset();
+    void update(const void* data, size_t length);
+    // После finish() объект нужно reset() перед повторным использованием.
+    void finish(uint8_t digest[SHA256_SIZE]);
+
+private:
+    void transform(const uint8_t* block);
+
+    uint32_t _state[8];
+    uint64_t _bits;
+    uint8_t _block[64];
+    size_t _used;
+};
+
+// HMAC-SHA256 (RFC 2104), ключ любой длины.
+void hmac_sha256(const void* key, size_t keyLength, const void* data, size_t length, uint8_t mac[SHA256_SIZE]);
+// Сравнение за время, не зависящее от того, где байты расходятся.
+bool digest_equal(const uint8_t* a, const uint8_t* b, size_t length);
+
+// 64 шестнадцатеричные цифры в любом регистре -> 32 байта.
+bool sha256_from_hex(const char* hex, uint8_t digest[SHA256_SIZE]);
+// out - не меньше 65 байт.
+void sha256_to_hex(const uint8_t digest[SHA256_SIZE], char* out);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+// Размер строки кэша: индексы производителя и потребителя лежат в разных
+// строках, чтобы запись одного ядра не сбрасывала строку другого.
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE 64
+#endif
+
+// Lock-free single-producer/single-consumer ring buffer with preallocated
+// slots. Exactly one task may call the producer side (reserve/commit/push)
+// and exactly one the consumer side (front/release/pop); no locks, no heap.
+//
+// reserve()/commit() and front()/release() give direct access to the slot,
+// so large messages are built and consumed in place instead of being copied.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    // Производитель: свободный слот или nullptr, если очередь заполнена.
+    T* reserve() {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+        return &_slots[head & (Capacity - 1)];
+    }
+
+    void commit() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T& item) {
+        T* slot = reserve();
+        if (!slot) {
+            return false;
+        }
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    // Потребитель: самый старый элемент или nullptr, если очередь пуста.
+    T* front() {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail) {
+            return nullptr;
+        }
+        return &_slots[tail & (Capacity - 1)];
+    }
+
+    void release() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T& item) {
+        T* slot = front();
+        if (!slot) {
+            return false;
+        }
+        item = *slot;
+        release();
+        return true;
+    }
+
+    // Приблизительно, если вызывать не из производителя или потребителя.
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> _head{0};
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> _tail{0};
+    alignas(SPSC_CACHE_LINE) T _slots[Capacity];
+};
+
+#endif
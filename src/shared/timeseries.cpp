@@ -0,0 +1,258 @@
+#include "timeseries.hpp"
+#include "crc32.hpp"
+#include <string.h>
+
+// Код метки времени или значения: префикс и поле за ним.
+struct SampleCode {
+    uint16_t prefix;
+    uint8_t prefixBits;
+    uint32_t field;
+    uint8_t fieldBits;
+};
+
+static SampleCode time_code(uint32_t dod) {
+    int32_t value = (int32_t)dod;
+    if (value == 0) {
+        return { 0x0, 1, 0, 0 };
+    }
+    if (value >= -63 && value <= 64) {
+        return { 0x2, 2, (uint32_t)(value + 63), 7 };
+    }
+    if (value >= -255 && value <= 256) {
+        return { 0x6, 3, (uint32_t)(value + 255), 9 };
+    }
+    if (value >= -2047 && value <= 2048) {
+        return { 0xE, 4, (uint32_t)(value + 2047), 12 };
+    }
+    return { 0xF, 4, dod, 32 };
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static void put_le16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+TimeSeriesBlock::TimeSeriesBlock(uint8_t* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {
+    reset();
+}
+
+void TimeSeriesBlock::reset() {
+    _bitLength = 0;
+    _count = 0;
+    _sealed = false;
+    _firstTime = 0;
+    _time = 0;
+    _delta = 0;
+    _value = 0;
+    _leading = 0xFF;
+    _trailing = 0;
+    if (_capacity >= TIMESERIES_HEADER_SIZE) {
+        _buffer[0] = TIMESERIES_MAGIC;
+        _buffer[1] = TIMESERIES_VERSION;
+        put_le16(_buffer + 2, 0);
+    }
+}
+
+void TimeSeriesBlock::writeBits(uint32_t value, uint8_t bits) {
+    uint8_t* out = _buffer + TIMESERIES_HEADER_SIZE;
+    while (bits > 0) {
+        uint8_t used = _bitLength & 7;
+        uint8_t free = 8 - used;
+        uint8_t take = bits < free ? bits : free;
+        uint8_t chunk = (value >> (bits - take)) & ((1U << take) - 1);
+        uint8_t& byte = out[_bitLength >> 3];
+        if (used == 0) {
+            byte = 0;
+        }
+        byte |= chunk << (free - take);
+        _bitLength += take;
+        bits -= take;
+    }
+}
+
+bool TimeSeriesBlock::append(uint32_t time, float value) {
+    if (_sealed || _count == 0xFFFF) {
+        return false;
+    }
+    uint32_t bits = float_bits(value);
+
+    if (_count == 0) {
+        if (TIMESERIES_MIN_BLOCK > _capacity) {
+            return false;
+        }
+        writeBits(time, 32);
+        writeBits(bits, 32);
+        _firstTime = time;
+    } else {
+        uint32_t delta = time - _time;
+        SampleCode timeCode = time_code(delta - _delta);
+
+        SampleCode valueCode = { 0x0, 1, 0, 0 };
+        uint8_t leading = _leading;
+        uint8_t trailing = _trailing;
+        uint32_t x = bits ^ _value;
+        if (x != 0) {
+            uint8_t xLeading = __builtin_clz(x);
+            uint8_t xTrailing = __builtin_ctz(x);
+            if (_leading == 0xFF || xLeading < _leading || xTrailing < _trailing) {
+                // Новое окно: 11 | ведущие нули (5) | длина - 1 (5).
+                leading = xLeading;
+                trailing = xTrailing;
+                uint8_t length = 32 - leading - trailing;
+                valueCode = { (uint16_t)((0x3U << 10) | ((uint32_t)leading << 5) | (length - 1U)), 12,
+                              x >> trailing, length };
+            } else {
+                valueCode = { 0x2, 2, x >> trailing, (uint8_t)(32 - leading - trailing) };
+            }
+        }
+
+        size_t need = _bitLength + timeCode.prefixBits + timeCode.fieldBits + valueCode.prefixBits +
+                      valueCode.fieldBits;
+        if (TIMESERIES_HEADER_SIZE + (need + 7) / 8 + TIMESERIES_CRC_SIZE > _capacity) {
+            return false;
+        }
+        writeBits(timeCode.prefix, timeCode.prefixBits);
+        writeBits(timeCode.field, timeCode.fieldBits);
+        writeBits(valueCode.prefix, valueCode.prefixBits);
+        writeBits(valueCode.field, valueCode.fieldBits);
+        _delta = delta;
+        _leading = leading;
+        _trailing = trailing;
+    }
+
+    _time = time;
+    _value = bits;
+    _count++;
+    put_le16(_buffer + 2, _count);
+    return true;
+}
+
+size_t TimeSeriesBlock::seal() {
+    if (_count == 0) {
+        return 0;
+    }
+    size_t length = size() - TIMESERIES_CRC_SIZE;
+    if (!_sealed) {
+        uint32_t crc = crc32(_buffer, length);
+        _buffer[length] = crc & 0xFF;
+        _buffer[length + 1] = (crc >> 8) & 0xFF;
+        _buffer[length + 2] = (crc >> 16) & 0xFF;
+        _buffer[length + 3] = (crc >> 24) & 0xFF;
+        _sealed = true;
+    }
+    return length + TIMESERIES_CRC_SIZE;
+}
+
+TimeSeriesReader::TimeSeriesReader(const uint8_t* block, size_t length)
+    : _bits(block + TIMESERIES_HEADER_SIZE), _bitLength(0), _count(0), _valid(false) {
+    if (length < TIMESERIES_HEADER_SIZE + TIMESERIES_CRC_SIZE || block[0] != TIMESERIES_MAGIC ||
+        block[1] != TIMESERIES_VERSION) {
+        return;
+    }
+    size_t body = length - TIMESERIES_CRC_SIZE;
+    const uint8_t* tail = block + body;
+    uint32_t crc = tail[0] | ((uint32_t)tail[1] << 8) | ((uint32_t)tail[2] << 16) | ((uint32_t)tail[3] << 24);
+    if (crc32(block, body) != crc) {
+        return;
+    }
+    _bitLength = (body - TIMESERIES_HEADER_SIZE) * 8;
+    _count = block[2] | (block[3] << 8);
+    _valid = true;
+}
+
+TimeSeriesReader::TimeSeriesReader(const TimeSeriesBlock& block)
+    : _bits(block._buffer + TIMESERIES_HEADER_SIZE), _bitLength(block._bitLength), _count(block._count),
+      _valid(true) {}
+
+bool TimeSeriesReader::readBits(uint8_t bits, uint32_t& value) {
+    if (_bitLength - _position < bits) {
+        return false;
+    }
+    value = 0;
+    while (bits > 0) {
+        uint8_t used = _position & 7;
+        uint8_t available = 8 - used;
+        uint8_t take = bits < available ? bits : available;
+        uint8_t chunk = (_bits[_position >> 3] >> (available - take)) & ((1U << take) - 1);
+        value = (value << take) | chunk;
+        _position += take;
+        bits -= take;
+    }
+    return true;
+}
+
+bool TimeSeriesReader::decode() {
+    if (_index == 0) {
+        return readBits(32, _time) && readBits(32, _value);
+    }
+
+    // Префикс метки - до четырёх единиц.
+    static const uint8_t fieldBits[] = { 0, 7, 9, 12, 32 };
+    static const uint32_t offsets[] = { 0, 63, 255, 2047, 0 };
+    uint8_t ones = 0;
+    uint32_t bit;
+    while (ones < 4) {
+        if (!readBits(1, bit)) {
+            return false;
+        }
+        if (!bit) {
+            break;
+        }
+        ones++;
+    }
+    uint32_t dod = 0;
+    if (ones > 0) {
+        if (!readBits(fieldBits[ones], dod)) {
+            return false;
+        }
+        dod -= offsets[ones];
+    }
+    _delta += dod;
+    _time += _delta;
+
+    if (!readBits(1, bit)) {
+        return false;
+    }
+    if (!bit) {
+        return true;
+    }
+    if (!readBits(1, bit)) {
+        return false;
+    }
+    if (bit) {
+        uint32_t leading, length;
+        if (!readBits(5, leading) || !readBits(5, length) || leading + length + 1 > 32) {
+            return false;
+        }
+        _leading = leading;
+        _trailing = 32 - leading - (length + 1);
+    } else if (_leading == 0xFF) {
+        return false;
+    }
+    uint32_t x;
+    if (!readBits(32 - _leading - _trailing, x)) {
+        return false;
+    }
+    _value ^= x << _trailing;
+    return true;
+}
+
+bool TimeSeriesReader::next(uint32_t& time, float& value) {
+    if (!_valid || _index >= _count) {
+        return false;
+    }
+    if (!decode()) {
+        _valid = false;
+        return false;
+    }
+    _index++;
+    time = _time;
+    memcpy(&value, &_value, sizeof(value));
+    return true;
+}
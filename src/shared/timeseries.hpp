@@ -0,0 +1,119 @@
+#ifndef TIMESERIES_HPP
+#define TIMESERIES_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Сжатый ряд (время, значение) для хранения показаний без связи: время -
+// разность разностей, значение float - XOR с предыдущим (как в Gorilla).
+// Ровный шаг опроса стоит 1 бит на метку, медленно меняющийся датчик -
+// 1-2 байта на значение вместо десятков символов JSON.
+//
+// Блок:
+//   'T' | version 1 | count LE16 | биты, старший вперёд | CRC32 LE32
+//
+// Первая выборка: время 32 бита, значение 32 бита. Дальше метка времени
+// (dod = (t - t') - (t' - t''), по модулю 2^32, переполнение millis() не мешает):
+//   '0'                  dod = 0
+//   '10'   + 7 бит       dod + 63,   dod в [-63, 64]
+//   '110'  + 9 бит       dod + 255,  dod в [-255, 256]
+//   '1110' + 12 бит      dod + 2047, dod в [-2047, 2048]
+//   '1111' + 32 бита     dod
+// и значение (x = биты float XOR биты предыдущего):
+//   '0'                                    x = 0
+//   '10' + значащие биты                   в окне предыдущего значения
+//   '11' + ведущие нули 5 бит + (длина - 1) 5 бит + значащие биты
+//
+// append() - O(1), место проверяется до записи: не влезшая выборка не портит блок.
+// Не зависит от Arduino.
+
+const uint8_t TIMESERIES_MAGIC = 'T';
+const uint8_t TIMESERIES_VERSION = 1;
+const size_t TIMESERIES_HEADER_SIZE = 4;
+const size_t TIMESERIES_CRC_SIZE = 4;
+// Заголовок, CRC и первая выборка.
+const size_t TIMESERIES_MIN_BLOCK = TIMESERIES_HEADER_SIZE + TIMESERIES_CRC_SIZE + 8;
+
+class TimeSeriesBlock {
+public:
+    TimeSeriesBlock(uint8_t* buffer, size_t capacity);
+
+    // false - выборка не влезла или блок запечатан.
+    bool append(uint32_t time, float value);
+
+    // Дописывает CRC; дальше блок только читается до reset(). Возвращает длину
+    // готового блока (для flash или публикации), 0 - выборок нет.
+    size_t seal();
+    void reset();
+
+    uint16_t count() const { return _count; }
+    bool sealed() const { return _sealed; }
+    bool empty() const { return _count == 0; }
+    // Длина с заголовком и CRC, как после seal().
+    size_t size() const { return TIMESERIES_HEADER_SIZE + (_bitLength + 7) / 8 + TIMESERIES_CRC_SIZE; }
+    size_t capacity() const { return _capacity; }
+    const uint8_t* data() const { return _buffer; }
+    uint32_t firstTime() const { return _firstTime; }
+    uint32_t lastTime() const { return _time; }
+
+private:
+    friend class TimeSeriesReader;
+
+    void writeBits(uint32_t value, uint8_t bits);
+
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _bitLength;
+    uint16_t _count;
+    bool _sealed;
+    uint32_t _firstTime;
+    uint32_t _time;
+    uint32_t _delta;
+    uint32_t _value;
+    uint8_t _leading;   // окно значащих битов предыдущего значения,
+    uint8_t _trailing;  // _leading = 0xFF - окна ещё нет
+};
+
+template <size_t Capacity>
+class StaticTimeSeriesBlock : public TimeSeriesBlock {
+public:
+    StaticTimeSeriesBlock() : TimeSeriesBlock(_storage, Capacity) {}
+
+private:
+    static_assert(Capacity >= TIMESERIES_MIN_BLOCK, "Block too small for one sample");
+    uint8_t _storage[Capacity];
+};
+
+// Потоковое чтение: выборки по одной, без буфера под весь ряд.
+class TimeSeriesReader {
+public:
+    // Запечатанный блок (из flash, из сообщения); неверный CRC или
+    // заголовок - valid() == false, next() ничего не отдаёт.
+    TimeSeriesReader(const uint8_t* block, size_t length);
+    // Открытый блок, пока в него пишут (из той же задачи).
+    explicit TimeSeriesReader(const TimeSeriesBlock& block);
+
+    bool valid() const { return _valid; }
+    uint16_t count() const { return _count; }
+
+    // false - выборки кончились или блок испорчен.
+    bool next(uint32_t& time, float& value);
+
+private:
+    bool decode();
+    bool readBits(uint8_t bits, uint32_t& value);
+
+    const uint8_t* _bits;
+    size_t _bitLength;
+    size_t _position = 0;
+    uint16_t _count;
+    uint16_t _index = 0;
+    bool _valid;
+    uint32_t _time = 0;
+    uint32_t _delta = 0;
+    uint32_t _value = 0;
+    uint8_t _leading = 0xFF;
+    uint8_t _trailing = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "wifi_cache.hpp"
+#include "crc32.hpp"
+#include "binlog.hpp"
+#include "flash_fs.hpp"
+#include <LittleFS.h>
+
+static const uint32_t WIFI_CACHE_MAGIC = 0x32434657; // "WFC2", в "WFC1" был пароль
+
+struct WiFiCacheFile {
+    uint32_t magic;
+    WiFiCache cache;
+    uint32_t crc;
+};
+
+static bool read_file(WiFiCacheFile& file) {
+    if (!flash_fs_mount() || !LittleFS.exists(WIFI_CACHE_PATH)) {
+        return false;
+    }
+    File f = LittleFS.open(WIFI_CACHE_PATH, "r");
+    if (!f) {
+        return false;
+    }
+    bool complete = f.read((uint8_t*)&file, sizeof(file)) == sizeof(file);
+    f.close();
+    if (file.magic != WIFI_CACHE_MAGIC) {
+        // Старый формат хранил пароль открытым текстом: не оставляем его на flash.
+        LittleFS.remove(WIFI_CACHE_PATH);
+        return false;
+    }
+    return complete && file.crc == crc32(&file.cache, sizeof(file.cache));
+}
+
+bool wifi_cache_load(WiFiCache& cache) {
+    WiFiCacheFile file;
+    if (!read_file(file) || file.cache.ssid[0] == '\0') {
+        return false;
+    }
+    file.cache.ssid[sizeof(file.cache.ssid) - 1] = '\0';
+    cache = file.cache;
+    return true;
+}
+
+bool wifi_cache_store(const WiFiCache& cache) {
+    WiFiCacheFile file;
+    if (read_file(file) && memcmp(&file.cache, &cache, sizeof(cache)) == 0) {
+        return true;
+    }
+
+    file.magic = WIFI_CACHE_MAGIC;
+    file.cache = cache;
+    file.crc = crc32(&file.cache, sizeof(file.cache));
+
+    File f = LittleFS.open(WIFI_CACHE_PATH, "w");
+    if (!f) {
+        LOG_WARN("[FS] Cannot create %s\n", WIFI_CACHE_PATH);
+        return false;
+    }
+    bool written = f.write((const uint8_t*)&file, sizeof(file)) == sizeof(file);
+    f.close();
+    return written;
+}
+
+void wifi_cache_clear() {
+    if (flash_fs_mount() && LittleFS.exists(WIFI_CACHE_PATH)) {
+        LittleFS.remove(WIFI_CACHE_PATH);
+    }
+}
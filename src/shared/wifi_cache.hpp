@@ -0,0 +1,31 @@
+#ifndef WIFI_CACHE_HPP
+#define WIFI_CACHE_HPP
+
+#include <Arduino.h>
+
+#ifndef WIFI_CACHE_PATH
+#define WIFI_CACHE_PATH "/wifi_cache.bin"
+#endif
+
+// Последнее удачное подключение: по нему после перезагрузки можно подключиться
+// сразу к нужной точке (BSSID + канал, без сканирования) и со старым адресом
+// (без DHCP). Лежит в LittleFS с CRC, битая запись считается отсутствующей.
+// Пароля здесь нет: он хранится только в настройках приложения, кэш
+// применяется к той же сети, что уже задана в Auth.
+struct WiFiCache {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+bool wifi_cache_load(WiFiCache& cache);
+// Пишет только если запись изменилась, чтобы не тратить ресурс flash.
+bool wifi_cache_store(const WiFiCache& cache);
+void wifi_cache_clear();
+
+#endif
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+# Тесты lib/MQTT против локального mosquitto (нужен в PATH):
+#   test/integration/mosquitto.sh
+# Поднимает два брокера из mosquitto.conf: на MQTT_TEST_PORT (по умолчанию
+# 18830) и следующем порту, и TLS-брокер из mosquitto_tls.conf ещё через один
+# (сертификаты для localhost выпускает openssl), запускает test/test_mqtt_broker
+# (второй брокер тест останавливает сам, проверяя переход) и останавливает брокеры.
+set -euo pipefail
+cd "$(dirname "$0")/../.."
+
+PORT=${MQTT_TEST_PORT:-18830}
+PIO=${PIO:-pio}
+work=$(mktemp -d)
+trap 'kill $(cat "$work"/*.pid 2>/dev/null) 2>/dev/null || true; rm -rf "$work"' EXIT
+
+# start_broker NAME CONF PORT: брокер в фоне, ждём, пока примет соединение.
+start_broker() {
+    sed -e "s/@PORT@/$3/g" -e "s|@DIR@|$work|g" "$2" > "$work/$1.conf"
+    mosquitto -c "$work/$1.conf" > "$work/$1.log" 2>&1 &
+    echo $! > "$work/$1.pid"
+    for _ in $(seq 50); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$3") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "mosquitto $1 did not start on port $3:" >&2
+    cat "$work/$1.log" >&2
+    exit 1
+}
+
+# Свой CA на прогон; тесту - CA в DER, как его получает TlsConfig.
+make_certificates() {
+    openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj "/CN=mqtt-test-ca" \
+        -keyout "$work/ca.key" -out "$work/ca.crt" 2>/dev/null
+    openssl req -newkey rsa:2048 -nodes -subj "/CN=localhost" \
+        -keyout "$work/broker.key" -out "$work/broker.csr" 2>/dev/null
+    printf "subjectAltName=DNS:localhost,IP:127.0.0.1\n" > "$work/broker.ext"
+    openssl x509 -req -in "$work/broker.csr" -CA "$work/ca.crt" -CAkey "$work/ca.key" -CAcreateserial \
+        -days 1 -extfile "$work/broker.ext" -out "$work/broker.crt" 2>/dev/null
+    openssl x509 -in "$work/ca.crt" -outform der -out "$work/ca.der"
+}
+
+make_certificates
+start_broker plain test/integration/mosquitto.conf "$PORT"
+start_broker second test/integration/mosquitto.conf $((PORT + 1))
+start_broker tls test/integration/mosquitto_tls.conf $((PORT + 2))
+
+export MQTT_TEST_BROKER=127.0.0.1:$PORT
+export MQTT_TEST_BROKER2=127.0.0.1:$((PORT + 1))
+MQTT_TEST_BROKER2_PID=$(cat "$work/second.pid")
+export MQTT_TEST_BROKER2_PID
+export MQTT_TEST_TLS_BROKER=127.0.0.1:$((PORT + 2))
+export MQTT_TEST_TLS_CA=$work/ca.der
+"$PIO" test -e test -f test_mqtt_broker "$@"
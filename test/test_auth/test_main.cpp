@@ -0,0 +1,128 @@
+// Auth на станции ArduinoNative: события WiFi, пришедшие за один проход
+// loop_wifi(), разбираются в порядке прихода; кэш подключения без пароля.
+#include <unity.h>
+#include <LittleFS.h>
+#include "../../src/shared/auth.hpp"
+#include "../../src/shared/wifi_cache.hpp"
+
+static WiFiStation station;
+
+void setUp(void) {
+    station = WiFiStation();
+    WiFi.select(&station);
+    wifi_cache_clear();
+}
+
+void tearDown(void) {
+    WiFi.select(nullptr);
+}
+
+static void test_connects_on_got_ip(void) {
+    Auth auth("test", "test-password");
+    auth.connect_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connecting, auth.state());
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connected, auth.state());
+    TEST_ASSERT_TRUE(auth.is_connected());
+}
+
+// GOT_IP и сразу потеря точки доступа: DISCONNECTED не теряется.
+static void test_disconnect_after_got_ip_in_one_tick(void) {
+    Auth auth("test", "test-password");
+    auth.connect_wifi();
+    WiFi.setLinkUp(false);
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Failed, auth.state());
+    TEST_ASSERT_FALSE(auth.is_connected());
+}
+
+static void test_disconnect_after_connected_in_one_tick(void) {
+    Auth auth("test", "test-password");
+    auth.connect_wifi();
+    auth.loop_wifi();
+    WiFi.setLinkUp(false);
+    WiFi.setLinkUp(true);
+    WiFi.setLinkUp(false);
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Idle, auth.state());
+}
+
+// Новый begin() при живой ассоциации: ASSOC_LEAVE старой, затем GOT_IP новой.
+static void test_got_ip_after_disconnect_in_one_tick(void) {
+    Auth auth("test", "test-password");
+    auth.connect_wifi();
+    auth.loop_wifi();
+    auth.setCredentials("other", "other-password");
+    auth.connect_wifi();
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connected, auth.state());
+    TEST_ASSERT_EQUAL_STRING("other", WiFi.SSID().c_str());
+}
+
+static void test_cache_keeps_no_password(void) {
+    Auth auth("test", "cache-test-password");
+    auth.connect_wifi();
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connected, auth.state());
+
+    File file = LittleFS.open(WIFI_CACHE_PATH, "r");
+    TEST_ASSERT_TRUE((bool)file);
+    uint8_t image[256];
+    size_t length = file.read(image, sizeof(image));
+    file.close();
+    TEST_ASSERT_TRUE(length > 0);
+    const char* password = "cache-test-password";
+    for (size_t i = 0; i + strlen(password) <= length; i++) {
+        TEST_ASSERT_FALSE(memcmp(image + i, password, strlen(password)) == 0);
+    }
+
+    WiFiCache cache;
+    TEST_ASSERT_TRUE(wifi_cache_load(cache));
+    TEST_ASSERT_EQUAL_STRING("test", cache.ssid);
+}
+
+static void test_cache_only_for_same_network(void) {
+    Auth first("test", "test-password");
+    first.connect_wifi();
+    first.loop_wifi();
+
+    Auth none("", "");
+    TEST_ASSERT_FALSE(none.connect_cached());
+    Auth other("other", "other-password");
+    TEST_ASSERT_FALSE(other.connect_cached());
+    Auth same("test", "test-password");
+    TEST_ASSERT_TRUE(same.connect_cached());
+    same.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connected, same.state());
+    TEST_ASSERT_TRUE(same.usedCache());
+}
+
+// Быстрый путь не удался: подключение по сканированию уже не "из кэша".
+static void test_fallback_clears_used_cache(void) {
+    Auth first("test", "test-password");
+    first.connect_wifi();
+    first.loop_wifi();
+
+    Auth auth("test", "test-password");
+    WiFi.setLinkUp(false);
+    TEST_ASSERT_TRUE(auth.connect_cached());
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connecting, auth.state());
+    TEST_ASSERT_FALSE(auth.usedCache());
+    WiFi.setLinkUp(true);
+    auth.loop_wifi();
+    TEST_ASSERT_EQUAL(WiFiState::Connected, auth.state());
+    TEST_ASSERT_FALSE(auth.usedCache());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_on_got_ip);
+    RUN_TEST(test_disconnect_after_got_ip_in_one_tick);
+    RUN_TEST(test_disconnect_after_connected_in_one_tick);
+    RUN_TEST(test_got_ip_after_disconnect_in_one_tick);
+    RUN_TEST(test_cache_keeps_no_password);
+    RUN_TEST(test_cache_only_for_same_network);
+    RUN_TEST(test_fallback_clears_used_cache);
+    return UNITY_END();
+}
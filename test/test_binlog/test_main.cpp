@@ -0,0 +1,262 @@
+// Двоичный лог целиком на хосте (env:test_binlog, LOG_BINARY=1): LOG_* пишут
+// записи, log_drain() собирает кадры, разбор tools/log_decoder возвращает текст.
+// Аргументы varint/zigzag, float, обрезанные строки, log_secret(), счётчик
+// потерянных записей и сами кадры.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../src/shared/binlog.hpp"
+#include "../../src/shared/frame_parser.hpp"
+// tools/ не входит в сборку src: разбор берётся целиком, как его собирает log_decode.
+#include "../../tools/log_decoder.cpp"
+
+static_assert(LOG_BINARY, "test_binlog is built with -DLOG_BINARY=1 (pio test -e test_binlog)");
+static_assert(!LOG_DRAIN_TASK, "Frames are drained by the test, not by a task");
+
+typedef std::vector<uint8_t> Bytes;
+
+static LogFormats formats;
+
+// Все накопленные кадры подряд, как они ушли бы в UART.
+static Bytes drain_all() {
+    Bytes stream;
+    uint8_t frame[LOG_FRAME_SIZE];
+    size_t length;
+    while ((length = log_drain(frame, sizeof(frame))) > 0) {
+        stream.insert(stream.end(), frame, frame + length);
+    }
+    return stream;
+}
+
+// Текст расшифровки без колонки времени: "I text" на строку.
+static std::vector<std::string> decode(const Bytes& stream) {
+    LogDecoder decoder(formats);
+    std::string text;
+    decoder.feed(stream.data(), stream.size(), true, text);
+    std::vector<std::string> lines;
+    size_t start = 0;
+    for (size_t end; (end = text.find('\n', start)) != std::string::npos; start = end + 1) {
+        std::string line = text.substr(start, end - start);
+        lines.push_back(line.size() > 11 && line[10] == ' ' ? line.substr(11) : line);
+    }
+    return lines;
+}
+
+// Аргументы первой записи первого кадра, после её заголовка.
+static Bytes first_args(const Bytes& stream) {
+    TEST_ASSERT_TRUE(stream.size() > FRAME_OVERHEAD);
+    const uint8_t* record = stream.data() + FRAME_HEADER_SIZE;
+    return Bytes(record + 10, record + record[0]);
+}
+
+void setUp(void) {
+    drain_all();
+}
+
+void tearDown(void) {}
+
+static void test_varint_arguments(void) {
+    TEST_ASSERT_FALSE_MESSAGE(formats.empty(), "No LOG_* formats found in " __FILE__);
+    LOG_INFO("signed %d %d %d %d %ld %lld %lld\n", 0, -1, 1, -64, 64L, (long long)INT64_MIN, (long long)INT64_MAX);
+    LOG_INFO("unsigned %u %u %lu %llu %x %c\n", 0u, 127u, 128UL, (unsigned long long)UINT64_MAX, 0xBEEFu, 'z');
+    Bytes stream = drain_all();
+
+    // zigzag: 0 -> 0, -1 -> 1, 1 -> 2, -64 -> 127, 64 -> 128 (два байта).
+    const uint8_t expected[] = { 1, 0x00, 1, 0x01, 1, 0x02, 1, 0x7F, 1, 0x80, 0x01 };
+    Bytes args = first_args(stream);
+    TEST_ASSERT_TRUE(args.size() > sizeof(expected));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, args.data(), sizeof(expected));
+
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(2, lines.size());
+    TEST_ASSERT_EQUAL_STRING("I signed 0 -1 1 -64 64 -9223372036854775808 9223372036854775807", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("I unsigned 0 127 128 18446744073709551615 beef z", lines[1].c_str());
+}
+
+static void test_float_arguments(void) {
+    LOG_WARN("t=%.2f ratio=%g big=%e\n", 21.5f, -0.125, 1.0e30);
+    Bytes stream = drain_all();
+
+    // float LE32, double сужается до float.
+    const uint8_t expected[] = { 3, 0x00, 0x00, 0xAC, 0x41, 3, 0x00, 0x00, 0x00, 0xBE };
+    Bytes args = first_args(stream);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, args.data(), sizeof(expected));
+
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("W t=21.50 ratio=-0.125 big=1.000000e+30", lines[0].c_str());
+}
+
+// Строка режется до LOG_MAX_STRING, запись - до LOG_MAX_RECORD; аргументы,
+// которым не хватило места, выпадают целиком и печатаются как <?>.
+static void test_truncated_strings(void) {
+    std::string longText(100, 'a');
+    LOG_INFO("long=%s null=%s\n", longText.c_str(), (const char*)nullptr);
+    std::string full(LOG_MAX_STRING, 'b');
+    LOG_INFO("%s|%s|%s|%d\n", full.c_str(), full.c_str(), full.c_str(), 7);
+    Bytes stream = drain_all();
+
+    const uint8_t* first = stream.data() + FRAME_HEADER_SIZE;
+    const uint8_t* second = first + first[0];
+    TEST_ASSERT_EQUAL_UINT8(LOG_MAX_RECORD, second[0]);
+
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(2, lines.size());
+    TEST_ASSERT_EQUAL_STRING(("I long=" + std::string(LOG_MAX_STRING, 'a') + " null=(null)").c_str(), lines[0].c_str());
+    // 10 заголовок + 2 * (1 + 1 + 64) + 1 + 1 = 144, на третью строку остаётся 16.
+    std::string third(LOG_MAX_RECORD - 144, 'b');
+    TEST_ASSERT_EQUAL_STRING(("I " + full + "|" + full + "|" + third + "|<?>").c_str(), lines[1].c_str());
+}
+
+static void test_secret_is_not_written(void) {
+    LOG_INFO("[WiFi] PASS=%s user=%s\n", log_secret("hunter2"), "bob");
+    Bytes stream = drain_all();
+
+    const uint8_t expected[] = { 5, 4, 3, 'b', 'o', 'b' };
+    Bytes args = first_args(stream);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), args.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, args.data(), sizeof(expected));
+    std::string raw(stream.begin(), stream.end());
+    TEST_ASSERT_TRUE(raw.find("hunter2") == std::string::npos);
+
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("I [WiFi] PASS=[redacted] user=bob", lines[0].c_str());
+}
+
+// Переполненный буфер теряет записи, а не портит их; число потерь приходит
+// первой записью следующего кадра и только один раз.
+static void test_dropped_counter(void) {
+    uint32_t before = log_dropped();
+    unsigned written = 0;
+    while (log_dropped() - before < 5) {
+        TEST_ASSERT_TRUE(written < LOG_BUFFER_SIZE);
+        LOG_INFO("fill %u\n", written);
+        written++;
+    }
+    unsigned kept = written - 5;
+    TEST_ASSERT_TRUE(kept > LOG_BUFFER_SIZE / LOG_MAX_RECORD);
+
+    std::vector<std::string> lines = decode(drain_all());
+    TEST_ASSERT_EQUAL_UINT32(kept + 1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("W [log] 5 records dropped", lines[0].c_str());
+    for (unsigned i = 0; i < kept; i++) {
+        TEST_ASSERT_EQUAL_STRING(("I fill " + std::to_string(i)).c_str(), lines[i + 1].c_str());
+    }
+
+    LOG_INFO("fill %u\n", 0u);
+    lines = decode(drain_all());
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("I fill 0", lines[0].c_str());
+}
+
+// Кадры - обычные кадры frame_parser.hpp: тип LOG_FRAME_TYPE, seq подряд,
+// в payload только целые записи, не больше LOG_FRAME_SIZE на кадр.
+static void test_drain_framing(void) {
+    uint8_t frame[LOG_FRAME_SIZE];
+    TEST_ASSERT_EQUAL_UINT32(0, log_drain(frame, sizeof(frame)));
+    LOG_INFO("frame %u\n", 0u);
+    TEST_ASSERT_EQUAL_UINT32(0, log_drain(frame, sizeof(frame) - 1));  // мало места - запись ждёт
+
+    for (unsigned i = 1; i < 60; i++) {
+        LOG_INFO("frame %u\n", i);
+    }
+    Bytes stream = drain_all();
+
+    StaticFrameParser<LOG_FRAME_SIZE> parser;
+    size_t at = 0;
+    unsigned frames = 0;
+    size_t records = 0;
+    uint8_t sequence = 0;
+    while (at < stream.size()) {
+        at += parser.feed(stream.data() + at, stream.size() - at);
+        if (!parser.ready()) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_HEX8(LOG_FRAME_TYPE, parser.type());
+        TEST_ASSERT_TRUE(parser.length() + FRAME_OVERHEAD <= LOG_FRAME_SIZE);
+        if (frames > 0) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(sequence + 1), parser.sequence());
+        }
+        sequence = parser.sequence();
+        size_t offset = 0;
+        while (offset < parser.length()) {
+            offset += parser.payload()[offset];
+            records++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(parser.length(), offset);
+        frames++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, parser.errors());
+    TEST_ASSERT_TRUE(frames > 1);
+    TEST_ASSERT_EQUAL_UINT32(60, records);
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(60, lines.size());
+    TEST_ASSERT_EQUAL_STRING("I frame 59", lines[59].c_str());
+}
+
+// Текст между кадрами проходит как есть; пропавший или битый кадр виден в
+// расшифровке; поток можно скармливать по байту.
+static void test_decoder_stream(void) {
+    std::vector<Bytes> frames;
+    for (unsigned i = 0; i < 3; i++) {
+        LOG_ERROR("part %u\n", i);
+        frames.push_back(drain_all());
+    }
+    const std::string boot = "boot: ok\n";
+    Bytes stream(boot.begin(), boot.end());
+    stream.insert(stream.end(), frames[0].begin(), frames[0].end());
+    stream.insert(stream.end(), frames[2].begin(), frames[2].end());
+
+    std::vector<std::string> lines = decode(stream);
+    TEST_ASSERT_EQUAL_UINT32(4, lines.size());
+    TEST_ASSERT_EQUAL_STRING("boot: ok", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("E part 0", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("[log] 1 frame(s) lost", lines[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("E part 2", lines[3].c_str());
+
+    LogDecoder decoder(formats);
+    std::string whole;
+    decoder.feed(stream.data(), stream.size(), true, whole);
+    LogDecoder bytewise(formats);
+    std::string pieces;
+    for (uint8_t byte : stream) {
+        bytewise.feed(&byte, 1, false, pieces);
+    }
+    bytewise.feed(nullptr, 0, true, pieces);
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), pieces.c_str());
+
+    // Битый CRC: кадр не расшифрован (его байты идут как текст), следующий - да.
+    frames[1][frames[1].size() - 1] ^= 0xFF;
+    stream.assign(frames[1].begin(), frames[1].end());
+    stream.insert(stream.end(), frames[2].begin(), frames[2].end());
+    LogDecoder fresh(formats);
+    std::string text;
+    fresh.feed(stream.data(), stream.size(), true, text);
+    TEST_ASSERT_TRUE(text.find("part 1") == std::string::npos);
+    TEST_ASSERT_TRUE(text.find(" E part 2\n") != std::string::npos);
+}
+
+// Запись, чей формат не найден в исходниках, выводится с сырыми аргументами.
+static void test_unknown_format(void) {
+    log_write(LOG_LEVEL_DEBUG, 0x12345678, -5, "x");
+    std::vector<std::string> lines = decode(drain_all());
+    TEST_ASSERT_EQUAL_UINT32(1, lines.size());
+    TEST_ASSERT_EQUAL_STRING("D <unknown 12345678> -5 x", lines[0].c_str());
+}
+
+int main(int argc, char** argv) {
+    // Строки формата - из этого же файла, как log_decode берёт их из src.
+    log_scan_tree(__FILE__, formats);
+    UNITY_BEGIN();
+    RUN_TEST(test_varint_arguments);
+    RUN_TEST(test_float_arguments);
+    RUN_TEST(test_truncated_strings);
+    RUN_TEST(test_secret_is_not_written);
+    RUN_TEST(test_dropped_counter);
+    RUN_TEST(test_drain_framing);
+    RUN_TEST(test_decoder_stream);
+    RUN_TEST(test_unknown_format);
+    return UNITY_END();
+}
@@ -0,0 +1,230 @@
+// BrokerPool на поддельных часах: выбор по времени подключения и весу,
+// без прыжков между близкими брокерами, окно отказа. TcpProbe против
+// локальных сокетов: ни start(), ни poll() не ждут ответа брокера.
+#include <unity.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include "../../lib/MQTT/src/broker_pool.hpp"
+#include "../../lib/MQTT/src/tcp_probe.hpp"
+
+static unsigned long now_ms = 0;
+static unsigned long fake_clock() {
+    return now_ms;
+}
+
+static BrokerPoolConfig test_config() {
+    BrokerPoolConfig config;
+    config.probeIntervalMs = 1000;
+    config.cooldownBaseMs = 5000;
+    config.cooldownMaxMs = 40000;
+    config.failbackMarginPct = 25;
+    config.failbackProbes = 3;
+    return config;
+}
+
+// Одна проба: ждём интервал, проверяем того, чья очередь.
+static int8_t probe(BrokerPool& pool, const uint32_t* rtts) {
+    now_ms += 1000;
+    int8_t index = pool.probeDue();
+    TEST_ASSERT_TRUE(index >= 0);
+    pool.probed(index, true, rtts[index]);
+    return pool.failbackTarget();
+}
+
+void setUp(void) {
+    now_ms = 1000;
+}
+
+void tearDown(void) {}
+
+static void test_prefers_lowest_latency_per_weight(void) {
+    BrokerPool pool(fake_clock, test_config());
+    pool.add("a", 1883);
+    pool.add("b", 1883);
+    pool.add("c", 1883, 2);
+
+    // Без измерений - по порядку добавления.
+    TEST_ASSERT_EQUAL_INT8(0, pool.select());
+
+    pool.succeeded(0, 40);
+    pool.succeeded(1, 20);
+    pool.succeeded(2, 30);  // вес 2: оценка как у 15 мс
+    TEST_ASSERT_EQUAL_INT8(2, pool.select());
+
+    BrokerPool ties(fake_clock, test_config());
+    ties.add("a", 1883);
+    ties.add("b", 1883);
+    ties.succeeded(0, 20);
+    ties.succeeded(1, 20);
+    TEST_ASSERT_EQUAL_INT8(0, ties.select());
+}
+
+// Брокер быстрее в пределах запаса не переманивает сессию; заметно
+// быстрее - только после failbackProbes проб подряд.
+static void test_no_flapping_within_margin(void) {
+    BrokerPool pool(fake_clock, test_config());
+    pool.add("a", 1883);
+    pool.add("b", 1883);
+    pool.succeeded(0, 100);
+    TEST_ASSERT_EQUAL_INT8(0, pool.select());
+
+    const uint32_t close[] = { 100, 85 };
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_INT8(-1, probe(pool, close));
+    }
+
+    // Сглаженное время b сходится к 40 мс: переход на третьей удачной пробе b.
+    const uint32_t faster[] = { 100, 40 };
+    int8_t target = -1;
+    int probes = 0;
+    while (target < 0 && probes < 20) {
+        target = probe(pool, faster);
+        probes++;
+    }
+    TEST_ASSERT_EQUAL_INT8(1, target);
+    TEST_ASSERT_TRUE(probes >= 3);
+}
+
+static void test_failed_broker_cools_down(void) {
+    BrokerPool pool(fake_clock, test_config());
+    pool.add("a", 1883);
+    pool.add("b", 1883);
+    pool.succeeded(0, 10);
+    pool.succeeded(1, 50);
+    TEST_ASSERT_EQUAL_INT8(0, pool.select());
+
+    // Окно растёт вдвое: 5, 10, 20, 40 (потолок) секунд.
+    const unsigned long windows[] = { 5000, 10000, 20000, 40000, 40000 };
+    for (unsigned long window : windows) {
+        pool.failed(0);
+        TEST_ASSERT_FALSE(pool.healthy(0));
+        TEST_ASSERT_EQUAL_INT8(1, pool.select());
+        now_ms += window - 1;
+        TEST_ASSERT_FALSE(pool.healthy(0));
+        now_ms += 1;
+        TEST_ASSERT_TRUE(pool.healthy(0));
+        TEST_ASSERT_EQUAL_INT8(0, pool.select());
+    }
+
+    // Удача сбрасывает счёт отказов.
+    pool.succeeded(0, 10);
+    pool.failed(0);
+    now_ms += 5000;
+    TEST_ASSERT_TRUE(pool.healthy(0));
+
+    // Отказали все: первым пробуем того, чьё окно кончится раньше.
+    pool.failed(1);
+    now_ms += 100;
+    pool.failed(0);
+    TEST_ASSERT_EQUAL_INT8(1, pool.select());
+}
+
+// --- TcpProbe ---
+
+static int listen_socket(uint16_t& port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(fd, (sockaddr*)&address, sizeof(address)));
+    TEST_ASSERT_EQUAL(0, listen(fd, backlog));
+    socklen_t length = sizeof(address);
+    getsockname(fd, (sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+static unsigned long wall_ms() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Ждёт результата пробы; каждый вызов poll() должен вернуться сразу.
+static ProbeStatus wait_probe(TcpProbe& probe, uint32_t& rtt, unsigned long limitMs) {
+    unsigned long started = wall_ms();
+    for (;;) {
+        unsigned long before = wall_ms();
+        ProbeStatus status = probe.poll(rtt);
+        TEST_ASSERT_TRUE(wall_ms() - before < 20);
+        if (status != ProbeStatus::Pending || wall_ms() - started > limitMs) {
+            return status;
+        }
+        usleep(1000);
+    }
+}
+
+static void test_probe_reachable_and_refused(void) {
+    uint16_t port = 0;
+    int server = listen_socket(port, 4);
+    TcpProbe probe(wall_ms);
+    uint32_t rtt = 0;
+
+    TEST_ASSERT_TRUE(probe.start("127.0.0.1", port, 1000));
+    TEST_ASSERT_EQUAL(ProbeStatus::Reachable, wait_probe(probe, rtt, 2000));
+    TEST_ASSERT_FALSE(probe.active());
+    TEST_ASSERT_TRUE(rtt < 1000);
+
+    // По имени - тем же путём.
+    TEST_ASSERT_TRUE(probe.start("localhost", port, 1000));
+    TEST_ASSERT_EQUAL(ProbeStatus::Reachable, wait_probe(probe, rtt, 2000));
+
+    // Порт закрыт: отказ, а не таймаут.
+    close(server);
+    TEST_ASSERT_TRUE(probe.start("127.0.0.1", port, 1000));
+    TEST_ASSERT_EQUAL(ProbeStatus::Unreachable, wait_probe(probe, rtt, 2000));
+
+    TEST_ASSERT_TRUE(probe.start("no-such-host.invalid", port, 1000));
+    TEST_ASSERT_EQUAL(ProbeStatus::Unreachable, wait_probe(probe, rtt, 2000));
+}
+
+// Брокер молчит (очередь accept переполнена, SYN отбрасываются): проба
+// остаётся Pending, пока таймаут не истечёт по часам пробы.
+static void test_probe_times_out_without_blocking(void) {
+    uint16_t port = 0;
+    int server = listen_socket(port, 0);
+    // Заполняем очередь соединениями, которые никто не примет.
+    int fillers[4];
+    for (int& filler : fillers) {
+        filler = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        connect(filler, (sockaddr*)&address, sizeof(address));
+    }
+    usleep(50000);
+
+    TcpProbe probe(fake_clock);
+    uint32_t rtt = 0;
+    TEST_ASSERT_TRUE(probe.start("127.0.0.1", port, 1000));
+    for (int i = 0; i < 20; i++) {
+        ProbeStatus status = probe.poll(rtt);
+        if (status == ProbeStatus::Reachable) {
+            TEST_IGNORE_MESSAGE("kernel accepted past the listen backlog, cannot simulate a silent broker");
+        }
+        TEST_ASSERT_EQUAL(ProbeStatus::Pending, status);
+        now_ms += 40;
+        usleep(1000);
+    }
+    now_ms += 1000;
+    TEST_ASSERT_EQUAL(ProbeStatus::Unreachable, probe.poll(rtt));
+    TEST_ASSERT_FALSE(probe.active());
+
+    for (int filler : fillers) {
+        close(filler);
+    }
+    close(server);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_prefers_lowest_latency_per_weight);
+    RUN_TEST(test_no_flapping_within_margin);
+    RUN_TEST(test_failed_broker_cools_down);
+    RUN_TEST(test_probe_reachable_and_refused);
+    RUN_TEST(test_probe_times_out_without_blocking);
+    return UNITY_END();
+}
@@ -0,0 +1,239 @@
+// cbor_parse/cbor_serialize по тем же схемам, что и JSON: обмен JSON -> CBOR -> JSON
+// для каждой схемы payloads.hpp, обрезанный вход, чужие major type, ширины целых.
+#include <unity.h>
+#include <string.h>
+#include "../../src/shared/cbor_schema.hpp"
+#include "../../src/shared/payloads.hpp"
+
+struct Sample {
+    char name[8];
+    bool flag;
+    int32_t offset;
+    uint32_t count;
+};
+
+static const JsonField sampleFields[] = {
+    JSON_STRING(Sample, name, "name"),
+    JSON_BOOL(Sample, flag, "flag"),
+    JSON_INT(Sample, offset, "offset"),
+    JSON_UINT(Sample, count, "count"),
+};
+static const JsonSchema SAMPLE_SCHEMA = JSON_SCHEMA(sampleFields);
+
+static Sample sample;
+
+static JsonError parse(const uint8_t* data, size_t length) {
+    return cbor_parse(SAMPLE_SCHEMA, data, length, &sample);
+}
+
+void setUp(void) {
+    memset(&sample, 0, sizeof(sample));
+}
+
+void tearDown(void) {}
+
+// JSON -> структура -> CBOR -> структура -> тот же JSON.
+template <typename Message>
+static void round_trip(const JsonSchema& schema, const char* json) {
+    Message fromJson = {};
+    TEST_ASSERT_TRUE_MESSAGE(json_parse(schema, json, strlen(json), &fromJson) == JsonError::Ok, json);
+
+    uint8_t cbor[512];
+    size_t length = cbor_serialize(schema, &fromJson, cbor, sizeof(cbor));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_EQUAL_HEX8(0xA0 | schema.count, cbor[0]);
+    Message fromCbor = {};
+    TEST_ASSERT_TRUE_MESSAGE(cbor_parse(schema, cbor, length, &fromCbor) == JsonError::Ok, json);
+    TEST_ASSERT_EQUAL_MEMORY(&fromJson, &fromCbor, sizeof(Message));
+
+    char back[512];
+    TEST_ASSERT_TRUE(json_serialize(schema, &fromCbor, back, sizeof(back)) > 0);
+    TEST_ASSERT_EQUAL_STRING(json, back);
+
+    // Буфер на байт меньше - не поместилось, а не обрезанный CBOR.
+    TEST_ASSERT_EQUAL_UINT32(0, cbor_serialize(schema, &fromJson, cbor, length - 1));
+}
+
+static void test_payload_schemas_round_trip(void) {
+    round_trip<WiFiCredentials>(WIFI_CREDENTIALS_SCHEMA, "{\"ssid\":\"garden\",\"password\":\"p\xC3\xA4ss \\\"w\\\"\"}");
+    round_trip<DeviceStatus>(DEVICE_STATUS_SCHEMA,
+                             "{\"wifi_connected\":true,\"config_mode\":false,\"ip_address\":\"192.168.4.1\"}");
+    round_trip<BridgePublish>(BRIDGE_PUBLISH_SCHEMA, "{\"topic\":\"esp32/x/cmd\",\"message\":\"on\"}");
+    round_trip<SensorAggregate>(SENSOR_AGGREGATE_SCHEMA,
+                                "{\"sensor\":\"moisture\",\"window_ms\":10000,\"count\":100000,\"min\":0,"
+                                "\"max\":4294967295,\"mean\":23,\"p50\":24,\"p90\":255,\"p99\":65536}");
+    round_trip<BrokerConfig>(BROKER_CONFIG_SCHEMA, "{\"host\":\"broker.local\",\"port\":1883}");
+    round_trip<OtaBegin>(OTA_BEGIN_SCHEMA,
+                         "{\"size\":40960,"
+                         "\"sha256\":\"00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\","
+                         "\"delta\":true,"
+                         "\"sig\":\"ffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100\"}");
+}
+
+// Разбор принимает текстовые имена полей наравне с номерами и пропускает
+// неизвестные ключи вместе со значениями любой формы.
+static void test_text_keys_and_unknown_fields(void) {
+    const uint8_t data[] = {
+        0xA6,
+        0x64, 'n', 'a', 'm', 'e', 0x61, 'x',
+        0x01, 0xF5,
+        0x09, 0x82, 0x01, 0xA1, 0x00, 0x40,  // 9: [1, {0: h''}]
+        0xC1, 0x00, 0xF6,                    // ключ-тег с числом: null
+        0x66, 'o', 'f', 'f', 's', 'e', 't', 0x20,
+        0x03, 0x07,
+    };
+    TEST_ASSERT_TRUE(parse(data, sizeof(data)) == JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("x", sample.name);
+    TEST_ASSERT_TRUE(sample.flag);
+    TEST_ASSERT_EQUAL_INT32(-1, sample.offset);
+    TEST_ASSERT_EQUAL_UINT32(7, sample.count);
+}
+
+// Любой обрезанный префикс корректного сообщения - ошибка, не Ok.
+static void test_truncated_input(void) {
+    Sample source = {};
+    strcpy(source.name, "trunc");
+    source.flag = true;
+    source.offset = -100000;
+    source.count = 70000;
+    uint8_t data[64];
+    size_t length = cbor_serialize(SAMPLE_SCHEMA, &source, data, sizeof(data));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_TRUE(parse(data, length) == JsonError::Ok);
+
+    for (size_t prefix = 0; prefix < length; prefix++) {
+        // Копия ровно на prefix байт в куче - ASan поймает чтение за концом.
+        uint8_t* copy = new uint8_t[prefix];
+        memcpy(copy, data, prefix);
+        JsonError error = parse(copy, prefix);
+        delete[] copy;
+        TEST_ASSERT_TRUE(error != JsonError::Ok);
+    }
+
+    // Мусор после map тоже не принимается.
+    data[length] = 0x00;
+    TEST_ASSERT_TRUE(parse(data, length + 1) == JsonError::Syntax);
+}
+
+static void test_wrong_major_types(void) {
+    // {0: 5} - строка ожидалась
+    const uint8_t stringAsUint[] = { 0xA1, 0x00, 0x05 };
+    TEST_ASSERT_TRUE(parse(stringAsUint, sizeof(stringAsUint)) == JsonError::Type);
+    // {0: h'61'} - байтовая строка вместо текста
+    const uint8_t stringAsBytes[] = { 0xA1, 0x00, 0x41, 'a' };
+    TEST_ASSERT_TRUE(parse(stringAsBytes, sizeof(stringAsBytes)) == JsonError::Type);
+    // {1: 1}, {1: null}
+    const uint8_t boolAsUint[] = { 0xA1, 0x01, 0x01 };
+    TEST_ASSERT_TRUE(parse(boolAsUint, sizeof(boolAsUint)) == JsonError::Type);
+    const uint8_t boolAsNull[] = { 0xA1, 0x01, 0xF6 };
+    TEST_ASSERT_TRUE(parse(boolAsNull, sizeof(boolAsNull)) == JsonError::Type);
+    // {2: "1"}, {2: 1.5 (half)}
+    const uint8_t intAsText[] = { 0xA1, 0x02, 0x61, '1' };
+    TEST_ASSERT_TRUE(parse(intAsText, sizeof(intAsText)) == JsonError::Type);
+    const uint8_t intAsFloat[] = { 0xA1, 0x02, 0xF9, 0x3E, 0x00 };
+    TEST_ASSERT_TRUE(parse(intAsFloat, sizeof(intAsFloat)) == JsonError::Type);
+    // {3: true}; {3: -1} - вне диапазона uint
+    const uint8_t uintAsBool[] = { 0xA1, 0x03, 0xF5 };
+    TEST_ASSERT_TRUE(parse(uintAsBool, sizeof(uintAsBool)) == JsonError::Type);
+    const uint8_t uintNegative[] = { 0xA1, 0x03, 0x20 };
+    TEST_ASSERT_TRUE(parse(uintNegative, sizeof(uintNegative)) == JsonError::Oversize);
+
+    // Не map на верхнем уровне, неопределённая длина.
+    const uint8_t array[] = { 0x80 };
+    TEST_ASSERT_TRUE(parse(array, sizeof(array)) == JsonError::Syntax);
+    const uint8_t indefiniteMap[] = { 0xBF, 0xFF };
+    TEST_ASSERT_TRUE(parse(indefiniteMap, sizeof(indefiniteMap)) == JsonError::Syntax);
+    const uint8_t indefiniteText[] = { 0xA1, 0x00, 0x7F, 0x61, 'a', 0xFF };
+    TEST_ASSERT_TRUE(parse(indefiniteText, sizeof(indefiniteText)) == JsonError::Syntax);
+}
+
+static void test_missing_and_oversize(void) {
+    const uint8_t noCount[] = { 0xA3, 0x00, 0x60, 0x01, 0xF4, 0x02, 0x00 };
+    TEST_ASSERT_TRUE(parse(noCount, sizeof(noCount)) == JsonError::Missing);
+
+    // Строка ровно по полю (7 + ноль) проходит, на байт длиннее - нет.
+    const uint8_t fits[] = { 0xA1, 0x00, 0x67, '1', '2', '3', '4', '5', '6', '7' };
+    TEST_ASSERT_TRUE(parse(fits, sizeof(fits)) == JsonError::Missing);
+    TEST_ASSERT_EQUAL_STRING("1234567", sample.name);
+    const uint8_t tooLong[] = { 0xA1, 0x00, 0x68, '1', '2', '3', '4', '5', '6', '7', '8' };
+    TEST_ASSERT_TRUE(parse(tooLong, sizeof(tooLong)) == JsonError::Oversize);
+}
+
+// Число кодируется самым коротким заголовком; разбор принимает и длинные
+// формы, но проверяет диапазон поля, а не ширину заголовка.
+static void test_integer_width_edges(void) {
+    struct Edge {
+        uint32_t value;
+        uint8_t size;
+        uint8_t initial;
+    };
+    const Edge edges[] = {
+        { 0, 1, 0x00 },          { 23, 1, 0x17 },          { 24, 2, 0x18 },
+        { 255, 2, 0x18 },        { 256, 3, 0x19 },         { 65535, 3, 0x19 },
+        { 65536, 5, 0x1A },      { UINT32_MAX, 5, 0x1A },
+    };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        Sample source = {};
+        source.count = edges[i].value;
+        source.offset = -1 - (int32_t)(edges[i].value & INT32_MAX);
+        uint8_t data[64];
+        size_t length = cbor_serialize(SAMPLE_SCHEMA, &source, data, sizeof(data));
+        // map, 0: "", 1: false, 2: offset, 3: count - count последний.
+        TEST_ASSERT_EQUAL_UINT32(7 + 2 * edges[i].size, length);
+        TEST_ASSERT_EQUAL_HEX8(edges[i].initial, data[length - edges[i].size]);
+        TEST_ASSERT_TRUE(parse(data, length) == JsonError::Ok);
+        TEST_ASSERT_EQUAL_UINT32(edges[i].value, sample.count);
+        TEST_ASSERT_EQUAL_INT32(source.offset, sample.offset);
+    }
+
+    // INT32_MIN = -1 - 0x7FFFFFFF; на единицу меньше - вне диапазона.
+    const uint8_t intMin[] = { 0xA1, 0x02, 0x3A, 0x7F, 0xFF, 0xFF, 0xFF };
+    TEST_ASSERT_TRUE(parse(intMin, sizeof(intMin)) == JsonError::Missing);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, sample.offset);
+    const uint8_t belowIntMin[] = { 0xA1, 0x02, 0x3A, 0x80, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_TRUE(parse(belowIntMin, sizeof(belowIntMin)) == JsonError::Oversize);
+    const uint8_t aboveIntMax[] = { 0xA1, 0x02, 0x1A, 0x80, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_TRUE(parse(aboveIntMax, sizeof(aboveIntMax)) == JsonError::Oversize);
+
+    // Восьмибайтный заголовок: в пределах uint32 - принят, шире - Oversize.
+    const uint8_t wideFits[] = { 0xA1, 0x03, 0x1B, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF };
+    TEST_ASSERT_TRUE(parse(wideFits, sizeof(wideFits)) == JsonError::Missing);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, sample.count);
+    const uint8_t wideTooBig[] = { 0xA1, 0x03, 0x1B, 0, 0, 0, 1, 0, 0, 0, 0 };
+    TEST_ASSERT_TRUE(parse(wideTooBig, sizeof(wideTooBig)) == JsonError::Oversize);
+    const uint8_t nonMinimal[] = { 0xA1, 0x03, 0x19, 0x00, 0x05 };
+    TEST_ASSERT_TRUE(parse(nonMinimal, sizeof(nonMinimal)) == JsonError::Missing);
+    TEST_ASSERT_EQUAL_UINT32(5, sample.count);
+
+    // Зарезервированные значения дополнительной информации 28..30.
+    const uint8_t reserved[] = { 0xA1, 0x03, 0x1C };
+    TEST_ASSERT_TRUE(parse(reserved, sizeof(reserved)) == JsonError::Syntax);
+}
+
+// Пропуск неизвестных значений ограничен по глубине, как и в JSON.
+static void test_skip_depth(void) {
+    for (int depth = 1; depth <= 20; depth++) {
+        uint8_t data[64];
+        size_t length = 0;
+        data[length++] = 0xA1;
+        data[length++] = 0x09;  // неизвестный ключ
+        for (int i = 0; i < depth; i++) {
+            data[length++] = 0x81;
+        }
+        data[length++] = 0x00;
+        JsonError error = parse(data, length);
+        TEST_ASSERT_TRUE(error == (depth < 16 ? JsonError::Missing : JsonError::Syntax));
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_payload_schemas_round_trip);
+    RUN_TEST(test_text_keys_and_unknown_fields);
+    RUN_TEST(test_truncated_input);
+    RUN_TEST(test_wrong_major_types);
+    RUN_TEST(test_missing_and_oversize);
+    RUN_TEST(test_integer_width_edges);
+    RUN_TEST(test_skip_depth);
+    return UNITY_END();
+}
@@ -0,0 +1,169 @@
+// ConfigStore на файлах хоста: поля Secret на flash зашифрованы и читаются
+// обратно, открытые секреты старого файла переписываются, значения, не
+// влезающие в CONFIG_MAX_IMAGE, не пишутся молча обрезанными.
+#include <unity.h>
+#include <LittleFS.h>
+#include <string.h>
+#include <vector>
+#include "../../src/shared/config_store.hpp"
+
+#define TEST_PATH "/test_config"
+
+static unsigned long now_ms = 0;
+static unsigned long fake_clock() {
+    return now_ms;
+}
+
+struct TestConfig {
+    char name[24];
+    char password[48];
+    uint32_t port;
+};
+
+enum : uint8_t { ID_NAME = 1, ID_PASSWORD = 2, ID_PORT = 3 };
+
+static const ConfigField test_fields[] = {
+    CONFIG_STRING(TestConfig, name, ID_NAME, "name"),
+    CONFIG_SECRET(TestConfig, password, ID_PASSWORD, "password"),
+    CONFIG_UINT(TestConfig, port, ID_PORT, "port"),
+};
+CONFIG_ASSERT_FITS(TestConfig, test_fields);
+static const ConfigSchema TEST_SCHEMA = CONFIG_SCHEMA(test_fields, 1);
+
+// Прежняя прошивка: пароль был обычной строкой.
+static const ConfigField legacy_fields[] = {
+    CONFIG_STRING(TestConfig, name, ID_NAME, "name"),
+    CONFIG_STRING(TestConfig, password, ID_PASSWORD, "password"),
+    CONFIG_UINT(TestConfig, port, ID_PORT, "port"),
+};
+static const ConfigSchema LEGACY_SCHEMA = CONFIG_SCHEMA(legacy_fields, 1);
+
+static const TestConfig defaults = { "device", "", 1883 };
+
+static std::vector<uint8_t> read_file(const char* path) {
+    std::vector<uint8_t> data(CONFIG_MAX_IMAGE);
+    File file = LittleFS.open(path, "r");
+    TEST_ASSERT_TRUE((bool)file);
+    data.resize(file.read(data.data(), data.size()));
+    file.close();
+    return data;
+}
+
+static bool contains(const std::vector<uint8_t>& data, const char* text) {
+    size_t length = strlen(text);
+    for (size_t i = 0; i + length <= data.size(); i++) {
+        if (memcmp(data.data() + i, text, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void setUp(void) {
+    now_ms = 1000;
+    Config<TestConfig> config(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    config.reset();
+}
+
+void tearDown(void) {}
+
+static void test_secret_is_encrypted_and_reads_back(void) {
+    Config<TestConfig> config(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    TEST_ASSERT_FALSE(config.begin());
+    TEST_ASSERT_TRUE(config.setString(ID_NAME, "garden"));
+    TEST_ASSERT_TRUE(config.setString(ID_PASSWORD, "hunter2-wifi-password"));
+    TEST_ASSERT_TRUE(config.commit());
+
+    std::vector<uint8_t> first = read_file(TEST_PATH ".0");
+    TEST_ASSERT_TRUE(contains(first, "garden"));
+    TEST_ASSERT_FALSE(contains(first, "hunter2"));
+
+    // Следующая запись - другое поколение, другой поток: шифротекст другой.
+    TEST_ASSERT_TRUE(config.setUint(ID_PORT, 8883));
+    TEST_ASSERT_TRUE(config.commit());
+    std::vector<uint8_t> second = read_file(TEST_PATH ".1");
+    TEST_ASSERT_FALSE(contains(second, "hunter2"));
+    TEST_ASSERT_EQUAL(first.size(), second.size());
+    TEST_ASSERT_TRUE(memcmp(first.data() + 12, second.data() + 12, first.size() - 16) != 0);
+
+    Config<TestConfig> reloaded(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_STRING("garden", reloaded->name);
+    TEST_ASSERT_EQUAL_STRING("hunter2-wifi-password", reloaded->password);
+    TEST_ASSERT_EQUAL_UINT32(8883, reloaded->port);
+    TEST_ASSERT_FALSE(reloaded.dirty());
+}
+
+// Тот же пароль снова - не изменение: сравниваются открытые значения.
+static void test_unchanged_secret_skips_write(void) {
+    Config<TestConfig> config(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    config.begin();
+    config.setString(ID_PASSWORD, "secret");
+    TEST_ASSERT_TRUE(config.commit());
+    TEST_ASSERT_EQUAL_UINT32(1, config.commits());
+    config.setString(ID_PASSWORD, "other");
+    config.setString(ID_PASSWORD, "secret");
+    TEST_ASSERT_TRUE(config.commit());
+    TEST_ASSERT_EQUAL_UINT32(1, config.commits());
+}
+
+static void test_plaintext_secret_is_rewritten(void) {
+    {
+        Config<TestConfig> legacy(LEGACY_SCHEMA, defaults, fake_clock, TEST_PATH);
+        legacy.begin();
+        legacy.setString(ID_PASSWORD, "hunter2-wifi-password");
+        TEST_ASSERT_TRUE(legacy.commit());
+    }
+    TEST_ASSERT_TRUE(contains(read_file(TEST_PATH ".0"), "hunter2"));
+
+    Config<TestConfig> config(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    TEST_ASSERT_TRUE(config.begin());
+    TEST_ASSERT_EQUAL_STRING("hunter2-wifi-password", config->password);
+    TEST_ASSERT_TRUE(config.dirty());
+    TEST_ASSERT_EQUAL_UINT32(CONFIG_COMMIT_DELAY_MS, config.loop());
+    now_ms += CONFIG_COMMIT_DELAY_MS;
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, config.loop());
+    TEST_ASSERT_EQUAL_UINT32(1, config.commits());
+    TEST_ASSERT_FALSE(contains(read_file(TEST_PATH ".1"), "hunter2"));
+
+    Config<TestConfig> reloaded(TEST_SCHEMA, defaults, fake_clock, TEST_PATH);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    TEST_ASSERT_EQUAL_STRING("hunter2-wifi-password", reloaded->password);
+    TEST_ASSERT_FALSE(reloaded.dirty());
+}
+
+// Схема без CONFIG_ASSERT_FITS, которой не хватает образа: запись
+// отказывает целиком, а не теряет поля в конце.
+struct HugeConfig {
+    char first[300];
+    char second[300];
+};
+
+static const ConfigField huge_fields[] = {
+    CONFIG_STRING(HugeConfig, first, 1, "first"),
+    CONFIG_STRING(HugeConfig, second, 2, "second"),
+};
+static const ConfigSchema HUGE_SCHEMA = CONFIG_SCHEMA(huge_fields, 1);
+
+static void test_overflow_fails_instead_of_truncating(void) {
+    static const HugeConfig huge_defaults = {};
+    Config<HugeConfig> config(HUGE_SCHEMA, huge_defaults, fake_clock, TEST_PATH);
+    config.begin();
+    char text[300];
+    memset(text, 'a', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    TEST_ASSERT_TRUE(config.setString(1, text));
+    TEST_ASSERT_TRUE(config.setString(2, text));
+    TEST_ASSERT_FALSE(config.commit());
+    TEST_ASSERT_TRUE(config.dirty());
+    TEST_ASSERT_FALSE(LittleFS.exists(TEST_PATH ".0"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_secret_is_encrypted_and_reads_back);
+    RUN_TEST(test_unchanged_secret_skips_write);
+    RUN_TEST(test_plaintext_secret_is_rewritten);
+    RUN_TEST(test_overflow_fails_instead_of_truncating);
+    return UNITY_END();
+}
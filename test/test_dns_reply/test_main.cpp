@@ -0,0 +1,205 @@
+// dns_build_reply: ответ captive-портала на A, пустой NOERROR на прочие типы,
+// отказ на сжатые и слишком длинные имена, обрезанные запросы и тесный буфер.
+#include <unity.h>
+#include <string.h>
+#include "../../src/shared/dns_reply.hpp"
+
+static const uint8_t ADDRESS[4] = { 192, 168, 4, 1 };
+static DnsAnswer answer;
+
+// Запрос: id 0x1234, RD, один вопрос name/qtype/IN, необязательная запись EDNS.
+static size_t build_query(uint8_t* out, const char* name, uint16_t qtype, bool edns = false) {
+    const uint8_t header[] = { 0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                               (uint8_t)(edns ? 1 : 0) };
+    memcpy(out, header, sizeof(header));
+    size_t pos = sizeof(header);
+    while (*name) {
+        const char* dot = strchr(name, '.');
+        size_t length = dot ? (size_t)(dot - name) : strlen(name);
+        out[pos++] = (uint8_t)length;
+        memcpy(out + pos, name, length);
+        pos += length;
+        name += length + (dot ? 1 : 0);
+    }
+    out[pos++] = 0;
+    out[pos++] = (uint8_t)(qtype >> 8);
+    out[pos++] = (uint8_t)qtype;
+    out[pos++] = 0x00;
+    out[pos++] = 0x01;
+    if (edns) {
+        const uint8_t opt[] = { 0x00, 0x00, 0x29, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(out + pos, opt, sizeof(opt));
+        pos += sizeof(opt);
+    }
+    return pos;
+}
+
+void setUp(void) {
+    dns_prepare_answer(answer, ADDRESS, 0x01020304);
+}
+
+void tearDown(void) {}
+
+static void test_a_query(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    size_t length = build_query(query, "connectivitycheck.gstatic.com", 1);
+    uint8_t reply[DNS_MAX_PACKET];
+    size_t size = dns_build_reply(query, length, answer, reply, sizeof(reply));
+    TEST_ASSERT_EQUAL_UINT32(length + DNS_ANSWER_SIZE, size);
+
+    const uint8_t header[] = { 0x12, 0x34, 0x85, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(header, reply, sizeof(header));
+    TEST_ASSERT_EQUAL_MEMORY(query + 12, reply + 12, length - 12);
+    const uint8_t record[] = { 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x01, 0x02,
+                               0x03, 0x04, 0x00, 0x04, 192,  168,  4,    1 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(record, reply + length, sizeof(record));
+
+    // ANY - тоже с адресом; RD сброшен в запросе - сброшен и в ответе.
+    length = build_query(query, "example", 255);
+    query[2] = 0x00;
+    size = dns_build_reply(query, length, answer, reply, sizeof(reply));
+    TEST_ASSERT_EQUAL_UINT32(length + DNS_ANSWER_SIZE, size);
+    TEST_ASSERT_EQUAL_HEX8(0x84, reply[2]);
+    TEST_ASSERT_EQUAL_UINT8(1, reply[7]);
+}
+
+// AAAA, MX, HTTPS: пустой NOERROR без записей, чтобы клиент не ждал таймаута.
+static void test_non_a_types(void) {
+    const uint16_t types[] = { 28, 15, 65, 16 };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        uint8_t query[DNS_MAX_PACKET];
+        size_t length = build_query(query, "example.com", types[i]);
+        uint8_t reply[DNS_MAX_PACKET];
+        TEST_ASSERT_EQUAL_UINT32(length, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+        TEST_ASSERT_EQUAL_HEX8(0x85, reply[2]);
+        TEST_ASSERT_EQUAL_HEX8(0x80, reply[3]);
+        TEST_ASSERT_EQUAL_UINT8(0, reply[7]);
+        TEST_ASSERT_EQUAL_MEMORY(query + 12, reply + 12, length - 12);
+    }
+}
+
+// Запись EDNS из запроса в ответ не копируется, ARCOUNT обнуляется.
+static void test_additional_records_dropped(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    size_t plain = build_query(query, "example.com", 1);
+    size_t length = build_query(query, "example.com", 1, true);
+    uint8_t reply[DNS_MAX_PACKET];
+    TEST_ASSERT_EQUAL_UINT32(plain + DNS_ANSWER_SIZE, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+    TEST_ASSERT_EQUAL_UINT8(0, reply[11]);
+}
+
+static void test_compressed_and_overlong_names(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    uint8_t reply[DNS_MAX_PACKET];
+
+    // Указатель сжатия в вопросе запроса не встречается - не разбираем.
+    size_t length = build_query(query, "a", 1);
+    query[12] = 0xC0;
+    query[13] = 0x0C;
+    TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+    // Метка длиннее 63 байт (0x40 - зарезервированный тип метки).
+    char name[300];
+    memset(name, 'x', 64);
+    name[64] = '\0';
+    length = build_query(query, name, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+    name[63] = '\0';
+    length = build_query(query, name, 1);
+    TEST_ASSERT_EQUAL_UINT32(length + DNS_ANSWER_SIZE, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+
+    // Имя ровно 255 байт с нулевой меткой проходит, на байт длиннее - нет:
+    // 3 метки по 63 + метка 61 = 4 * 1 + 250 + 1.
+    memset(name, 'y', sizeof(name));
+    name[63] = name[127] = name[191] = '.';
+    name[253] = '\0';
+    length = build_query(query, name, 1);
+    TEST_ASSERT_EQUAL_UINT32(12 + 255 + 4, length);
+    TEST_ASSERT_EQUAL_UINT32(length + DNS_ANSWER_SIZE, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+    name[253] = 'y';
+    name[254] = '\0';
+    length = build_query(query, name, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+}
+
+// Короче заголовка, ответ вместо запроса, не QUERY, не один вопрос.
+static void test_rejected_headers(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    uint8_t reply[DNS_MAX_PACKET];
+    size_t length = build_query(query, "example.com", 1);
+    for (size_t prefix = 0; prefix < 12; prefix++) {
+        // Копия ровно на prefix байт в куче - ASan поймает чтение за концом.
+        uint8_t* copy = new uint8_t[prefix];
+        memcpy(copy, query, prefix);
+        size_t size = dns_build_reply(copy, prefix, answer, reply, sizeof(reply));
+        delete[] copy;
+        TEST_ASSERT_EQUAL_UINT32(0, size);
+    }
+
+    const struct {
+        uint8_t offset;
+        uint8_t value;
+    } broken[] = {
+        { 2, 0x81 },  // QR = 1
+        { 2, 0x09 },  // OPCODE = 1 (IQUERY)
+        { 2, 0x11 },  // OPCODE = 2 (STATUS)
+        { 5, 0x00 },  // QDCOUNT = 0
+        { 5, 0x02 },  // QDCOUNT = 2
+        { 4, 0x01 },  // QDCOUNT = 257
+    };
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        build_query(query, "example.com", 1);
+        query[broken[i].offset] = broken[i].value;
+        TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+    }
+}
+
+// Вопрос, обрезанный в любом месте, или метка, уходящая за конец пакета.
+static void test_truncated_question(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    uint8_t reply[DNS_MAX_PACKET];
+    size_t length = build_query(query, "www.example.com", 1);
+    for (size_t prefix = 12; prefix < length; prefix++) {
+        uint8_t* copy = new uint8_t[prefix];
+        memcpy(copy, query, prefix);
+        size_t size = dns_build_reply(copy, prefix, answer, reply, sizeof(reply));
+        delete[] copy;
+        TEST_ASSERT_EQUAL_UINT32(0, size);
+    }
+
+    query[12] = 60;  // метка длиннее оставшегося пакета
+    TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, reply, sizeof(reply)));
+}
+
+// Ответ не пишется за capacity: ровно по размеру - да, на байт меньше - 0.
+static void test_reply_capacity(void) {
+    uint8_t query[DNS_MAX_PACKET];
+    const uint16_t types[] = { 1, 28 };
+    for (size_t i = 0; i < 2; i++) {
+        size_t length = build_query(query, "example.com", types[i]);
+        size_t needed = length + (types[i] == 1 ? DNS_ANSWER_SIZE : 0);
+
+        uint8_t* exact = new uint8_t[needed];
+        TEST_ASSERT_EQUAL_UINT32(needed, dns_build_reply(query, length, answer, exact, needed));
+        delete[] exact;
+
+        uint8_t* tight = new uint8_t[needed - 1];
+        memset(tight, 0xAA, needed - 1);
+        TEST_ASSERT_EQUAL_UINT32(0, dns_build_reply(query, length, answer, tight, needed - 1));
+        for (size_t b = 0; b < needed - 1; b++) {
+            TEST_ASSERT_EQUAL_HEX8(0xAA, tight[b]);
+        }
+        delete[] tight;
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_a_query);
+    RUN_TEST(test_non_a_types);
+    RUN_TEST(test_additional_records_dropped);
+    RUN_TEST(test_compressed_and_overlong_names);
+    RUN_TEST(test_rejected_headers);
+    RUN_TEST(test_truncated_question);
+    RUN_TEST(test_reply_capacity);
+    return UNITY_END();
+}
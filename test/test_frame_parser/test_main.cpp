@@ -0,0 +1,263 @@
+// FrameParser: кадры туда и обратно кусками любого размера, ложные
+// синхропоследовательности в шуме, таймаут недописанного кадра и фаззинг
+// случайными потоками (под ASan).
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../../src/shared/frame_parser.hpp"
+
+static const size_t MAX_PAYLOAD = 64;
+
+static unsigned long now_ms = 0;
+static unsigned long fake_clock() {
+    return now_ms;
+}
+
+struct Frame {
+    uint8_t type;
+    uint8_t sequence;
+    std::vector<uint8_t> payload;
+};
+
+static uint32_t seed = 1;
+static uint32_t next_random() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static Frame random_frame(uint8_t sequence) {
+    Frame frame;
+    frame.type = (uint8_t)(next_random() % 8 + 1);
+    frame.sequence = sequence;
+    size_t length = next_random() % (MAX_PAYLOAD + 1);
+    for (size_t i = 0; i < length; i++) {
+        frame.payload.push_back((uint8_t)next_random());
+    }
+    return frame;
+}
+
+static void append_frame(std::vector<uint8_t>& stream, const Frame& frame) {
+    uint8_t encoded[MAX_PAYLOAD + FRAME_OVERHEAD];
+    size_t length = frame_encode(frame.type, frame.sequence, frame.payload.data(), frame.payload.size(),
+                                 encoded, sizeof(encoded));
+    TEST_ASSERT_TRUE(length > 0);
+    stream.insert(stream.end(), encoded, encoded + length);
+}
+
+// Ложное начало кадра: A5 5A и заголовок с правдоподобной длиной.
+static void append_false_sync(std::vector<uint8_t>& stream, uint16_t length) {
+    const uint8_t header[] = { FRAME_SYNC0, FRAME_SYNC1, 0x01, 0x00, (uint8_t)length, (uint8_t)(length >> 8) };
+    stream.insert(stream.end(), header, header + sizeof(header));
+}
+
+// Подаёт поток кусками от 1 до maxChunk байт, собирает готовые кадры.
+static std::vector<Frame> parse(FrameParser& parser, const std::vector<uint8_t>& stream, size_t maxChunk) {
+    std::vector<Frame> frames;
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        size_t chunk = next_random() % maxChunk + 1;
+        if (chunk > stream.size() - offset) {
+            chunk = stream.size() - offset;
+        }
+        size_t end = offset + chunk;
+        while (offset < end) {
+            offset += parser.feed(stream.data() + offset, end - offset);
+            if (parser.ready()) {
+                TEST_ASSERT_TRUE(parser.length() <= MAX_PAYLOAD);
+                frames.push_back(Frame{ parser.type(), parser.sequence(),
+                                        std::vector<uint8_t>(parser.payload(), parser.payload() + parser.length()) });
+            }
+        }
+    }
+    while (parser.poll()) {
+        frames.push_back(Frame{ parser.type(), parser.sequence(),
+                                std::vector<uint8_t>(parser.payload(), parser.payload() + parser.length()) });
+    }
+    return frames;
+}
+
+static void assert_frames(const std::vector<Frame>& expected, const std::vector<Frame>& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT8(expected[i].type, actual[i].type);
+        TEST_ASSERT_EQUAL_UINT8(expected[i].sequence, actual[i].sequence);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].payload.size(), actual[i].payload.size());
+        TEST_ASSERT_TRUE(expected[i].payload == actual[i].payload);
+    }
+}
+
+void setUp(void) {
+    now_ms = 0;
+    seed = 1;
+}
+
+void tearDown(void) {}
+
+static void test_round_trip_any_chunking(void) {
+    std::vector<Frame> frames;
+    std::vector<uint8_t> stream;
+    for (uint8_t i = 0; i < 50; i++) {
+        frames.push_back(random_frame(i));
+        append_frame(stream, frames.back());
+    }
+    for (size_t maxChunk : { (size_t)1, (size_t)3, (size_t)17, (size_t)1000 }) {
+        StaticFrameParser<MAX_PAYLOAD> parser;
+        assert_frames(frames, parse(parser, stream, maxChunk));
+        TEST_ASSERT_EQUAL_UINT32(0, parser.errors());
+    }
+}
+
+static void test_oversize_rejected(void) {
+    StaticFrameParser<MAX_PAYLOAD> parser;
+    std::vector<uint8_t> stream;
+    append_false_sync(stream, MAX_PAYLOAD + 1);
+    Frame frame = random_frame(7);
+    append_frame(stream, frame);
+    assert_frames({ frame }, parse(parser, stream, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1, parser.errors());
+    TEST_ASSERT_EQUAL(FrameError::Oversize, parser.lastError());
+}
+
+// Ложный A5 5A с длиной, покрывающей следующие кадры: после ошибки CRC
+// они находятся повторным просмотром, а не теряются.
+static void test_false_sync_does_not_swallow_frames(void) {
+    std::vector<Frame> frames;
+    std::vector<uint8_t> stream;
+    append_false_sync(stream, 40);
+    for (uint8_t i = 0; i < 6; i++) {
+        Frame frame = random_frame(i);
+        frame.payload.resize(i * 3);
+        frames.push_back(frame);
+        append_frame(stream, frame);
+    }
+    for (size_t maxChunk : { (size_t)1, (size_t)5, (size_t)1000 }) {
+        StaticFrameParser<MAX_PAYLOAD> parser;
+        assert_frames(frames, parse(parser, stream, maxChunk));
+        TEST_ASSERT_EQUAL_UINT32(1, parser.errors());
+        TEST_ASSERT_EQUAL(FrameError::Crc, parser.lastError());
+    }
+}
+
+// Ложные начала одно в другом: A5 5A внутри тела ложного кадра тоже ложное.
+static void test_nested_false_syncs(void) {
+    std::vector<Frame> frames;
+    std::vector<uint8_t> stream;
+    append_false_sync(stream, 30);
+    append_false_sync(stream, 20);
+    stream.push_back(FRAME_SYNC0);
+    append_false_sync(stream, 10);
+    for (uint8_t i = 0; i < 4; i++) {
+        frames.push_back(random_frame(i));
+        append_frame(stream, frames.back());
+    }
+    StaticFrameParser<MAX_PAYLOAD> parser;
+    assert_frames(frames, parse(parser, stream, 1000));
+    TEST_ASSERT_EQUAL_UINT32(3, parser.errors());
+}
+
+// Ложный кадр ждёт больше байт, чем придёт: настоящий кадр внутри отдаётся
+// по таймауту.
+static void test_timeout_releases_swallowed_frame(void) {
+    StaticFrameParser<MAX_PAYLOAD> parser(fake_clock, 500);
+    std::vector<uint8_t> stream;
+    append_false_sync(stream, MAX_PAYLOAD);
+    Frame frame = random_frame(3);
+    frame.payload.resize(5);
+    append_frame(stream, frame);
+
+    size_t used = parser.feed(stream.data(), stream.size());
+    TEST_ASSERT_EQUAL_UINT32(stream.size(), used);
+    TEST_ASSERT_FALSE(parser.ready());
+    TEST_ASSERT_EQUAL_UINT32(500, parser.untilNext());
+    now_ms = 499;
+    TEST_ASSERT_FALSE(parser.poll());
+    TEST_ASSERT_EQUAL_UINT32(1, parser.untilNext());
+    now_ms = 500;
+    TEST_ASSERT_TRUE(parser.poll());
+    TEST_ASSERT_EQUAL(FrameError::Timeout, parser.lastError());
+    TEST_ASSERT_EQUAL_UINT8(3, parser.sequence());
+    TEST_ASSERT_EQUAL_UINT32(5, parser.length());
+    TEST_ASSERT_FALSE(parser.poll());
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, parser.untilNext());
+}
+
+static void test_without_clock_waits(void) {
+    StaticFrameParser<MAX_PAYLOAD> parser;
+    std::vector<uint8_t> stream;
+    append_false_sync(stream, MAX_PAYLOAD);
+    parser.feed(stream.data(), stream.size());
+    now_ms = 100000;
+    TEST_ASSERT_FALSE(parser.poll());
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, parser.untilNext());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.errors());
+}
+
+// Кадры вперемешку с шумом, в котором часто встречаются A5 и A5 5A: все
+// кадры находятся (шум не дописывает кадр с верной CRC).
+static void test_fuzz_frames_in_noise(void) {
+    for (int round = 0; round < 1000; round++) {
+        std::vector<Frame> frames;
+        std::vector<uint8_t> stream;
+        for (uint8_t i = 0; i < 10; i++) {
+            size_t noise = next_random() % 12;
+            for (size_t n = 0; n < noise; n++) {
+                uint32_t pick = next_random() % 4;
+                stream.push_back(pick == 0 ? FRAME_SYNC0 : pick == 1 ? FRAME_SYNC1 : (uint8_t)next_random());
+            }
+            if (next_random() % 3 == 0) {
+                append_false_sync(stream, (uint16_t)(next_random() % (MAX_PAYLOAD + 8)));
+            }
+            frames.push_back(random_frame(i));
+            append_frame(stream, frames.back());
+        }
+        StaticFrameParser<MAX_PAYLOAD> parser(fake_clock, 100);
+        std::vector<Frame> parsed = parse(parser, stream, 1 + next_random() % 64);
+        // Каждый ложный кадр в хвосте потока ждёт свой таймаут.
+        while (parser.untilNext() != SCHEDULER_IDLE) {
+            now_ms += parser.untilNext();
+            while (parser.poll()) {
+                parsed.push_back(Frame{ parser.type(), parser.sequence(),
+                                        std::vector<uint8_t>(parser.payload(), parser.payload() + parser.length()) });
+            }
+        }
+        assert_frames(frames, parsed);
+    }
+}
+
+// Случайные байты: ничего не читается за пределами буферов (ASan), длина
+// готового кадра не больше буфера.
+static void test_fuzz_random_bytes(void) {
+    StaticFrameParser<MAX_PAYLOAD> parser(fake_clock, 50);
+    uint8_t data[512];
+    for (int round = 0; round < 2000; round++) {
+        size_t length = next_random() % sizeof(data);
+        for (size_t i = 0; i < length; i++) {
+            uint32_t pick = next_random() % 8;
+            data[i] = pick == 0 ? FRAME_SYNC0 : pick == 1 ? FRAME_SYNC1 : (uint8_t)next_random();
+        }
+        size_t offset = 0;
+        while (offset < length) {
+            offset += parser.feed(data + offset, length - offset);
+            if (parser.ready()) {
+                TEST_ASSERT_TRUE(parser.length() <= MAX_PAYLOAD);
+            }
+        }
+        now_ms += next_random() % 40;
+        while (parser.poll()) {
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_any_chunking);
+    RUN_TEST(test_oversize_rejected);
+    RUN_TEST(test_false_sync_does_not_swallow_frames);
+    RUN_TEST(test_nested_false_syncs);
+    RUN_TEST(test_timeout_releases_swallowed_frame);
+    RUN_TEST(test_without_clock_waits);
+    RUN_TEST(test_fuzz_frames_in_noise);
+    RUN_TEST(test_fuzz_random_bytes);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+// Gateway: повторы по seq, перезагрузка узла (новый boot), счёт пачек, когда
+// emit() отказывает.
+#include <unity.h>
+#include <string.h>
+#include "../../src/shared/gateway.hpp"
+
+static unsigned long now_ms = 0;
+static unsigned long fake_clock() {
+    return now_ms;
+}
+
+static const uint8_t node_a[6] = { 0xa4, 0xcf, 0x12, 0xb3, 0xc4, 0xd5 };
+static const uint8_t node_b[6] = { 0xa4, 0xcf, 0x12, 0xb3, 0xc4, 0xd6 };
+
+static GatewayResult send(Gateway& gateway, const uint8_t node[6], uint16_t boot, uint16_t sequence,
+                          int32_t value = 100) {
+    GatewayReading reading = { 1, value };
+    uint8_t packet[GATEWAY_MAX_PACKET];
+    size_t length = gateway_encode(node, boot, sequence, &reading, 1, packet, sizeof(packet));
+    TEST_ASSERT_TRUE(length > 0);
+    return gateway.ingest(packet, length);
+}
+
+struct Sink {
+    unsigned accept;  // сколько сообщений принять, дальше - отказ
+    unsigned calls;
+    char last[512];
+};
+
+static bool emit(const char* payload, size_t length, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->calls++;
+    if (sink->accept == 0) {
+        return false;
+    }
+    sink->accept--;
+    memcpy(sink->last, payload, length);
+    sink->last[length] = '\0';
+    return true;
+}
+
+void setUp(void) {
+    now_ms = 1000;
+}
+
+void tearDown(void) {}
+
+static void test_duplicates_and_reordering(void) {
+    Gateway gateway(fake_clock);
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 7, 10));
+    TEST_ASSERT_EQUAL(GatewayResult::Duplicate, send(gateway, node_a, 7, 10));
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 7, 12));
+    // Опоздавший, но не виденный - принимается один раз.
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 7, 11));
+    TEST_ASSERT_EQUAL(GatewayResult::Duplicate, send(gateway, node_a, 7, 11));
+    // Другой узел с тем же seq - не повтор.
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_b, 7, 10));
+
+    const GatewayStats& stats = gateway.stats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.accepted);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.restarts);
+}
+
+// Узел перезагрузился через секунду, seq снова с нуля: ни одного пакета
+// не теряется, хотя все они внутри окна повторов.
+static void test_restart_resets_sequence_window(void) {
+    Gateway gateway(fake_clock);
+    for (uint16_t seq = 0; seq < 20; seq++) {
+        TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 0x1234, seq));
+    }
+    now_ms += 1000;
+    for (uint16_t seq = 0; seq < 20; seq++) {
+        TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 0x9abc, seq));
+    }
+    const GatewayStats& stats = gateway.stats();
+    TEST_ASSERT_EQUAL_UINT32(40, stats.accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.restarts);
+
+    // Пакет прошлой загрузки, пришедший поздно, окно новой не сбивает дважды.
+    TEST_ASSERT_EQUAL(GatewayResult::Duplicate, send(gateway, node_a, 0x9abc, 19));
+}
+
+// Тот же boot, seq далеко назад (счётчик узла сброшен без перезагрузки).
+static void test_large_backwards_jump_resets_window(void) {
+    Gateway gateway(fake_clock);
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 1, 1000));
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 1, 5));
+    TEST_ASSERT_EQUAL(GatewayResult::Accepted, send(gateway, node_a, 1, 6));
+    TEST_ASSERT_EQUAL(GatewayResult::Duplicate, send(gateway, node_a, 1, 5));
+}
+
+static void test_malformed_packets(void) {
+    Gateway gateway(fake_clock);
+    GatewayReading reading = { 1, 5 };
+    uint8_t packet[GATEWAY_MAX_PACKET];
+    size_t length = gateway_encode(node_a, 1, 1, &reading, 1, packet, sizeof(packet));
+    TEST_ASSERT_EQUAL(GatewayResult::Malformed, gateway.ingest(packet, length - 1));
+    packet[1] = GATEWAY_PACKET_VERSION + 1;
+    TEST_ASSERT_EQUAL(GatewayResult::Malformed, gateway.ingest(packet, length));
+    TEST_ASSERT_EQUAL(0, gateway_encode(node_a, 1, 1, &reading, GATEWAY_MAX_READINGS + 1, packet, sizeof(packet)));
+    TEST_ASSERT_EQUAL_UINT32(2, gateway.stats().malformed);
+}
+
+static void test_flush_aggregates_window(void) {
+    Gateway gateway(fake_clock);
+    send(gateway, node_a, 1, 1, 30);
+    send(gateway, node_a, 1, 2, 10);
+    send(gateway, node_a, 1, 3, 20);
+    now_ms += 5000;
+    char buffer[256];
+    Sink sink = { 10, 0, {} };
+    TEST_ASSERT_EQUAL(1, gateway.flush(buffer, sizeof(buffer), emit, &sink));
+    TEST_ASSERT_EQUAL_STRING("{\"t\":6000,\"w\":5000,\"n\":[{\"id\":\"a4cf12b3c4d5\",\"s\":[[1,20,10,30,3]]}]}",
+                             sink.last);
+    // Окно очищено.
+    TEST_ASSERT_EQUAL(0, gateway.flush(buffer, sizeof(buffer), emit, &sink));
+    TEST_ASSERT_EQUAL_UINT32(1, gateway.stats().batches);
+}
+
+// Пачки, от которых emit() отказался, в batches не попадают.
+static void test_batches_count_only_accepted(void) {
+    Gateway gateway(fake_clock);
+    uint8_t node[6] = { 0xa4, 0xcf, 0x12, 0, 0, 0 };
+    for (uint8_t i = 0; i < 8; i++) {
+        node[5] = i;
+        send(gateway, node, 1, 1);
+    }
+    // Два узла на сообщение: четыре сообщения, emit() принимает только первое.
+    char buffer[96];
+    Sink sink = { 1, 0, {} };
+    size_t sent = gateway.flush(buffer, sizeof(buffer), emit, &sink);
+    TEST_ASSERT_EQUAL(1, sent);
+    TEST_ASSERT_EQUAL(2, sink.calls);  // после первого отказа emit() больше не зовётся
+    const GatewayStats& stats = gateway.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.batches);
+    TEST_ASSERT_TRUE(stats.refused >= 3);
+
+    sink.accept = 0;
+    sink.calls = 0;
+    send(gateway, node, 1, 2);
+    TEST_ASSERT_EQUAL(0, gateway.flush(buffer, sizeof(buffer), emit, &sink));
+    TEST_ASSERT_EQUAL_UINT32(1, gateway.stats().batches);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicates_and_reordering);
+    RUN_TEST(test_restart_resets_sequence_window);
+    RUN_TEST(test_large_backwards_jump_resets_window);
+    RUN_TEST(test_malformed_packets);
+    RUN_TEST(test_flush_aggregates_window);
+    RUN_TEST(test_batches_count_only_accepted);
+    return UNITY_END();
+}
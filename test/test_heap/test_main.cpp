@@ -0,0 +1,169 @@
+// Куча в установившемся режиме: после разогрева горячий путь (маршрутизация,
+// разбор в арене, ответ по схеме, метрики, таймеры) не выделяет память.
+// То же, что heap/steady_state в бенчмарке, но с проверкой.
+#include <unity.h>
+#include <new>
+#include <thread>
+#include "../../lib/MQTT/src/mqtt.hpp"
+#include "../../lib/MQTT/src/topic_router.hpp"
+#include "../../src/shared/payloads.hpp"
+#include "../../src/shared/scheduler.hpp"
+#include "../../src/shared/metrics.hpp"
+#include "../../src/shared/fixed_string.hpp"
+#include "../../src/shared/arena.hpp"
+
+// --- Подсчёт выделений памяти ---
+
+static unsigned long allocations = 0;
+
+// Под ASan malloc перехватывает санитайзер: считаем только operator new.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocations++;
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+#else
+void* operator new(size_t size) {
+    allocations++;
+    void* pointer = malloc(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+#endif
+
+static uint32_t clock_ms = 0;
+static unsigned long test_clock() {
+    return clock_ms;
+}
+
+static void count_job(void* context) {
+    (*(uint32_t*)context)++;
+}
+
+static const uint32_t latency_bounds[] = { 10, 100, 1000 };
+static MetricHistogram latency("test_heap_latency", "thl", "Steady state test latency", latency_bounds, 3);
+
+static StaticArena<1024> arena;
+static uint32_t handled = 0;
+
+static void handler(const char* topic, const uint8_t* payload, unsigned int length, void*) {
+    ArenaScope scope(arena);
+    WiFiCredentials* credentials = arena.create<WiFiCredentials>();
+    if (!credentials || parse_wifi_credentials((const char*)payload, length, *credentials) != JsonError::Ok) {
+        return;
+    }
+    FixedString<48> reply;
+    reply.appendf("esp32/stats/%s", credentials->ssid);
+    DeviceStatus status = { true, false, "10.0.0.7" };
+    char* out = (char*)arena.allocate(PAYLOAD_MESSAGE_SIZE, 1);
+    if (out && serialize_status(status, out, PAYLOAD_MESSAGE_SIZE) > 0 && !reply.truncated()) {
+        handled++;
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_steady_state_does_not_allocate(void) {
+    static TopicRouter<8, 16> router;
+    router.add("esp32/wifi", handler);
+    Scheduler<8> jobs(test_clock);
+    uint32_t fired = 0;
+    jobs.every(5, count_job, &fired);
+    static const char message[] = "{\"ssid\":\"Router-5G\",\"password\":\"correct horse battery\"}";
+
+    const int iterations = 20000;
+    unsigned long before = 0;
+    for (int i = 0; i < iterations * 2; i++) {
+        if (i == iterations) {
+            before = allocations;  // первая половина - разогрев
+        }
+        router.dispatch("esp32/wifi", (const uint8_t*)message, sizeof(message) - 1);
+        latency.observe(i & 1023);
+        clock_ms++;
+        jobs.run();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+    TEST_ASSERT_EQUAL_UINT32(iterations * 2, handled);
+    TEST_ASSERT_TRUE(fired > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, arena.used());
+    TEST_ASSERT_TRUE(arena.highWater() <= arena.capacity());
+    TEST_ASSERT_EQUAL_UINT32(0, arena.failures());
+}
+
+// publish(schema) кодирует в арене MQTT и кладёт в очередь без кучи.
+static void test_publish_schema_does_not_allocate(void) {
+    static MQTT mqtt;
+    DeviceStatus status = { true, false, "10.0.0.7" };
+    TEST_ASSERT_TRUE(mqtt.publish("esp32/status", DEVICE_STATUS_SCHEMA, &status));
+    unsigned long before = allocations;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(mqtt.publish("esp32/status", DEVICE_STATUS_SCHEMA, &status));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+    TEST_ASSERT_EQUAL_UINT32(5, mqtt.queueDepth());
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt.arena().used());
+}
+
+// Арена MQTT принадлежит задаче receive_message(): из другой задачи
+// publish(schema) отвергается, а не портит чужое сообщение.
+static void test_publish_schema_from_other_task_refused(void) {
+    static MQTT mqtt;
+    DeviceStatus status = { true, false, "10.0.0.7" };
+    mqtt.receive_message();
+    TEST_ASSERT_TRUE(mqtt.publish("esp32/status", DEVICE_STATUS_SCHEMA, &status));
+
+    bool published = true;
+    std::thread other([&]() {
+        published = mqtt.publish("esp32/status", DEVICE_STATUS_SCHEMA, &status);
+    });
+    other.join();
+    TEST_ASSERT_FALSE(published);
+    TEST_ASSERT_EQUAL_UINT32(1, mqtt.queueDepth());
+    // Готовый payload можно отдать из любой задачи.
+    TEST_ASSERT_TRUE(mqtt.publish("esp32/status", "{}"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_state_does_not_allocate);
+    RUN_TEST(test_publish_schema_does_not_allocate);
+    RUN_TEST(test_publish_schema_from_other_task_refused);
+    return UNITY_END();
+}
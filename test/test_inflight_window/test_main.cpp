@@ -0,0 +1,89 @@
+// InflightWindow: слоты QoS 1 до PUBACK, заполнение окна, повтор в порядке отправки.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/MQTT/src/inflight_window.hpp"
+
+typedef InflightWindow<16> Window;
+
+static void send(Window& window, uint16_t packetId, unsigned long now) {
+    Window::Slot* slot = window.reserve();
+    TEST_ASSERT_NOT_NULL(slot);
+    memset(slot->packet, (uint8_t)packetId, sizeof(slot->packet));
+    window.commit(slot, packetId, 4, now);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_fills_and_frees(void) {
+    Window window;
+    TEST_ASSERT_EQUAL_UINT32(0, window.count());
+    for (uint16_t id = 1; id <= MQTT_INFLIGHT_WINDOW; id++) {
+        TEST_ASSERT_FALSE(window.full());
+        send(window, id, id * 10);
+    }
+    TEST_ASSERT_TRUE(window.full());
+    TEST_ASSERT_NULL(window.reserve());
+
+    unsigned long sentAt = 0;
+    TEST_ASSERT_TRUE(window.ack(2, &sentAt));
+    TEST_ASSERT_EQUAL_UINT32(20, sentAt);
+    TEST_ASSERT_FALSE(window.contains(2));
+    TEST_ASSERT_TRUE(window.contains(3));
+    TEST_ASSERT_FALSE(window.full());
+    TEST_ASSERT_EQUAL_UINT32(MQTT_INFLIGHT_WINDOW - 1, window.count());
+    TEST_ASSERT_NOT_NULL(window.reserve());
+}
+
+// PUBACK на неизвестный или уже подтверждённый id ничего не меняет.
+static void test_unknown_and_repeated_ack(void) {
+    Window window;
+    send(window, 5, 0);
+    TEST_ASSERT_FALSE(window.ack(6));
+    TEST_ASSERT_TRUE(window.ack(5));
+    TEST_ASSERT_FALSE(window.ack(5));
+    TEST_ASSERT_EQUAL_UINT32(0, window.count());
+    TEST_ASSERT_FALSE(window.contains(5));
+}
+
+// Слот, освобождённый в середине, занимает новый пакет; повтор всё равно идёт
+// в порядке отправки, а не в порядке слотов.
+static void test_for_each_in_send_order(void) {
+    Window window;
+    for (uint16_t id = 1; id <= MQTT_INFLIGHT_WINDOW; id++) {
+        send(window, id, 0);
+    }
+    TEST_ASSERT_TRUE(window.ack(1));
+    TEST_ASSERT_TRUE(window.ack(3));
+    send(window, 100, 0);  // в слот пакета 1
+    send(window, 101, 0);  // в слот пакета 3
+
+    uint16_t order[MQTT_INFLIGHT_WINDOW];
+    size_t count = 0;
+    window.forEach([&](Window::Slot& slot) {
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)slot.packetId, slot.packet[0]);
+        order[count++] = slot.packetId;
+    });
+    TEST_ASSERT_EQUAL_UINT32(MQTT_INFLIGHT_WINDOW, count);
+    const uint16_t expected[] = { 2, 4, 100, 101 };
+    for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        TEST_ASSERT_EQUAL_UINT16(expected[i], order[i]);
+    }
+}
+
+static void test_for_each_on_empty_window(void) {
+    Window window;
+    size_t count = 0;
+    window.forEach([&](Window::Slot&) { count++; });
+    TEST_ASSERT_EQUAL_UINT32(0, count);
+}
+
+int main(int argc, char** argv) {
+    static_assert(MQTT_INFLIGHT_WINDOW == 4, "Tests assume the default window");
+    UNITY_BEGIN();
+    RUN_TEST(test_fills_and_frees);
+    RUN_TEST(test_unknown_and_repeated_ack);
+    RUN_TEST(test_for_each_in_send_order);
+    RUN_TEST(test_for_each_on_empty_window);
+    return UNITY_END();
+}
@@ -0,0 +1,209 @@
+// json_parse/json_serialize по схемам: круговой обмен, переполнение полей,
+// экранирование и \u, глубина вложенности пропускаемых значений, мусор на входе.
+#include <unity.h>
+#include <string.h>
+#include "../../src/shared/json_schema.hpp"
+#include "../../src/shared/payloads.hpp"
+
+struct Sample {
+    char name[8];
+    bool flag;
+    int32_t offset;
+    uint32_t count;
+    char note[8];
+};
+
+static const JsonField sampleFields[] = {
+    JSON_STRING(Sample, name, "name"),
+    JSON_BOOL(Sample, flag, "flag"),
+    JSON_INT(Sample, offset, "offset"),
+    JSON_UINT(Sample, count, "count"),
+    JSON_FIELD(Sample, note, "note", JsonType::String, false),
+};
+static const JsonSchema SAMPLE_SCHEMA = JSON_SCHEMA(sampleFields);
+
+static Sample sample;
+
+static JsonError parse(const char* json) {
+    return json_parse(SAMPLE_SCHEMA, json, strlen(json), &sample);
+}
+
+void setUp(void) {
+    memset(&sample, 0, sizeof(sample));
+}
+
+void tearDown(void) {}
+
+static void test_round_trip(void) {
+    Sample source = {};
+    strcpy(source.name, "a\"b\\c\n");
+    source.flag = true;
+    source.offset = INT32_MIN;
+    source.count = UINT32_MAX;
+    strcpy(source.note, "\x01x");
+
+    char json[160];
+    size_t length = json_serialize(SAMPLE_SCHEMA, &source, json, sizeof(json));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"a\\\"b\\\\c\\u000a\",\"flag\":true,\"offset\":-2147483648,"
+                             "\"count\":4294967295,\"note\":\"\\u0001x\"}",
+                             json);
+    TEST_ASSERT_TRUE(json_parse(SAMPLE_SCHEMA, json, length, &sample) == JsonError::Ok);
+    TEST_ASSERT_EQUAL_MEMORY(&source, &sample, sizeof(sample));
+}
+
+static void test_payload_schemas_round_trip(void) {
+    WiFiCredentials credentials = {};
+    strcpy(credentials.ssid, "garden");
+    strcpy(credentials.password, "p\u00e4ss \"word\"");
+    char json[PAYLOAD_MESSAGE_SIZE];
+    size_t length = json_serialize(WIFI_CREDENTIALS_SCHEMA, &credentials, json, sizeof(json));
+    TEST_ASSERT_TRUE(length > 0);
+    WiFiCredentials parsed = {};
+    TEST_ASSERT_TRUE(json_parse(WIFI_CREDENTIALS_SCHEMA, json, length, &parsed) == JsonError::Ok);
+    TEST_ASSERT_EQUAL_MEMORY(&credentials, &parsed, sizeof(parsed));
+
+    DeviceStatus status = {};
+    status.wifiConnected = true;
+    strcpy(status.ipAddress, "192.168.4.1");
+    length = json_serialize(DEVICE_STATUS_SCHEMA, &status, json, sizeof(json));
+    TEST_ASSERT_EQUAL_STRING("{\"wifi_connected\":true,\"config_mode\":false,\"ip_address\":\"192.168.4.1\"}", json);
+    DeviceStatus parsedStatus = {};
+    TEST_ASSERT_TRUE(json_parse(DEVICE_STATUS_SCHEMA, json, length, &parsedStatus) == JsonError::Ok);
+    TEST_ASSERT_EQUAL_MEMORY(&status, &parsedStatus, sizeof(status));
+
+    BridgePublish bridge = {};
+    strcpy(bridge.topic, "esp32/x/cmd");
+    memset(bridge.message, 'm', sizeof(bridge.message) - 1);
+    static char large[2 * PAYLOAD_MESSAGE_SIZE];
+    length = json_serialize(BRIDGE_PUBLISH_SCHEMA, &bridge, large, sizeof(large));
+    TEST_ASSERT_TRUE(length > 0);
+    BridgePublish parsedBridge = {};
+    TEST_ASSERT_TRUE(json_parse(BRIDGE_PUBLISH_SCHEMA, large, length, &parsedBridge) == JsonError::Ok);
+    TEST_ASSERT_EQUAL_MEMORY(&bridge, &parsedBridge, sizeof(bridge));
+}
+
+// Строка, на байт длиннее поля, - Oversize; ровно по полю - проходит.
+static void test_oversize(void) {
+    TEST_ASSERT_TRUE(parse("{\"name\":\"1234567\",\"flag\":false,\"offset\":0,\"count\":0}") == JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("1234567", sample.name);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"12345678\",\"flag\":false,\"offset\":0,\"count\":0}") == JsonError::Oversize);
+    // Многобайтный символ не режется пополам.
+    TEST_ASSERT_TRUE(parse("{\"name\":\"123456\\u00e9\",\"flag\":false,\"offset\":0,\"count\":0}") ==
+                     JsonError::Oversize);
+
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\",\"flag\":false,\"offset\":2147483648,\"count\":0}") == JsonError::Oversize);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\",\"flag\":false,\"offset\":-2147483649,\"count\":0}") == JsonError::Oversize);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\",\"flag\":false,\"offset\":0,\"count\":4294967296}") == JsonError::Oversize);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\",\"flag\":false,\"offset\":0,\"count\":-1}") == JsonError::Oversize);
+
+    char output[16];
+    TEST_ASSERT_EQUAL_UINT32(0, json_serialize(SAMPLE_SCHEMA, &sample, output, sizeof(output)));
+}
+
+static void test_escapes(void) {
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\\\"\\\\\\/\\b\\f\\n\\r\",\"flag\":true,\"offset\":1,\"count\":2}") ==
+                     JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("\"\\/\b\f\n\r", sample.name);
+    // Два байта UTF-8, три байта, суррогатная пара - четыре.
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\\u00e9\\u20ac\",\"flag\":true,\"offset\":1,\"count\":2}") == JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("\xC3\xA9\xE2\x82\xAC", sample.name);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"\\uD83D\\uDE00\",\"flag\":true,\"offset\":1,\"count\":2}") == JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("\xF0\x9F\x98\x80", sample.name);
+}
+
+// \u0000 оборвал бы поле молча, одиночная половина пары - не символ.
+static void test_rejected_escapes(void) {
+    const char* const inputs[] = {
+        "{\"name\":\"a\\u0000b\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\uDC00\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\uDFFFx\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\uD83D\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\uD83Dx\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\uD83D\\u0041\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\u12G4\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\u12\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"\\x\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"name\":\"tab\there\",\"flag\":true,\"offset\":1,\"count\":2}",
+        // В пропускаемом значении и в ключе - так же.
+        "{\"name\":\"\",\"flag\":true,\"offset\":1,\"count\":2,\"other\":\"\\u0000\"}",
+        "{\"name\":\"\",\"flag\":true,\"offset\":1,\"count\":2,\"\\uDC00\":1}",
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(parse(inputs[i]) == JsonError::Syntax, inputs[i]);
+    }
+}
+
+// Неизвестные значения любой формы пропускаются, но не глубже MAX_DEPTH (16).
+static void test_nesting_depth(void) {
+    const char* prefix = "{\"name\":\"n\",\"flag\":true,\"offset\":1,\"count\":2,\"skip\":";
+    char json[256];
+    for (int depth = 1; depth <= 20; depth++) {
+        size_t length = strlen(prefix);
+        memcpy(json, prefix, length);
+        for (int i = 0; i < depth; i++) {
+            json[length++] = i % 2 ? '{' : '[';
+            if (i % 2) {
+                memcpy(json + length, "\"k\":", 4);
+                length += 4;
+            }
+        }
+        json[length++] = '1';
+        for (int i = depth - 1; i >= 0; i--) {
+            json[length++] = i % 2 ? '}' : ']';
+        }
+        json[length++] = '}';
+        JsonError error = json_parse(SAMPLE_SCHEMA, json, length, &sample);
+        TEST_ASSERT_TRUE(error == (depth <= 16 ? JsonError::Ok : JsonError::Syntax));
+    }
+
+    TEST_ASSERT_TRUE(parse("{\"skip\":[1,-2.5e3,\"s\",true,false,null,{},[]],\"name\":\"n\",\"flag\":true,"
+                           "\"offset\":1,\"count\":2}") == JsonError::Ok);
+}
+
+static void test_malformed_input(void) {
+    const char* const inputs[] = {
+        "",
+        "[]",
+        "{",
+        "{\"name\"}",
+        "{\"name\":\"n\",}",
+        "{\"name\":\"n\" \"flag\":true}",
+        "{\"name\":\"n\",\"flag\":true,\"offset\":1,\"count\":2}x",
+        "{\"name\":\"open",
+        "{name:\"n\"}",
+        "{\"skip\":[1,2,\"name\":\"n\",\"flag\":true,\"offset\":1,\"count\":2}",
+        "{\"skip\":tru,\"name\":\"n\",\"flag\":true,\"offset\":1,\"count\":2}",
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(parse(inputs[i]) == JsonError::Syntax, inputs[i]);
+    }
+
+    TEST_ASSERT_TRUE(parse("{\"name\":1,\"flag\":true,\"offset\":1,\"count\":2}") == JsonError::Type);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"n\",\"flag\":1,\"offset\":1,\"count\":2}") == JsonError::Type);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"n\",\"flag\":true,\"offset\":\"1\",\"count\":2}") == JsonError::Type);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"n\",\"flag\":true,\"offset\":1.5,\"count\":2}") == JsonError::Type);
+    TEST_ASSERT_TRUE(parse("{\"name\":\"n\",\"flag\":true,\"offset\":1}") == JsonError::Missing);
+}
+
+// Необязательное поле можно опустить, отсутствующие поля не трогаются.
+static void test_optional_and_defaults(void) {
+    strcpy(sample.note, "keep");
+    TEST_ASSERT_TRUE(parse(" { \"count\" : 7 , \"offset\":-3,\"flag\":false,\"name\":\"n\" } ") == JsonError::Ok);
+    TEST_ASSERT_EQUAL_STRING("keep", sample.note);
+    TEST_ASSERT_EQUAL_INT32(-3, sample.offset);
+    TEST_ASSERT_EQUAL_UINT32(7, sample.count);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_payload_schemas_round_trip);
+    RUN_TEST(test_oversize);
+    RUN_TEST(test_escapes);
+    RUN_TEST(test_rejected_escapes);
+    RUN_TEST(test_nesting_depth);
+    RUN_TEST(test_malformed_input);
+    RUN_TEST(test_optional_and_defaults);
+    return UNITY_END();
+}
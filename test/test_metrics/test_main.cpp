@@ -0,0 +1,57 @@
+// Гистограмма метрик: корзины, сумма больше 2^32 и оба формата вывода.
+#include <unity.h>
+#include <string>
+#include "../../src/shared/metrics.hpp"
+
+static const uint32_t bounds[] = { 10, 100, 1000 };
+static MetricHistogram latency("test_latency_us", "tl", "Test latency", bounds, 3);
+
+struct StringPrint : Print {
+    std::string text;
+    size_t write(const uint8_t* buffer, size_t size) override {
+        text.append((const char*)buffer, size);
+        return size;
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_buckets_and_sum(void) {
+    uint32_t before = latency.count();
+    uint64_t sumBefore = latency.sum();
+    latency.observe(5);
+    latency.observe(10);
+    latency.observe(11);
+    latency.observe(5000);
+    TEST_ASSERT_EQUAL_UINT32(before + 4, latency.count());
+    TEST_ASSERT_TRUE(latency.sum() == sumBefore + 5026);
+    TEST_ASSERT_TRUE(latency.hits(0) >= 2);
+    TEST_ASSERT_TRUE(latency.hits(3) >= 1);
+}
+
+static void test_sum_past_32_bits(void) {
+    uint64_t before = latency.sum();
+    latency.observe(4000000000u);
+    latency.observe(4000000000u);
+    TEST_ASSERT_TRUE(latency.sum() == before + 8000000000ull);
+
+    StringPrint out;
+    metrics_write_prometheus(out);
+    char line[64];
+    snprintf(line, sizeof(line), "test_latency_us_sum %llu\n", (unsigned long long)latency.sum());
+    TEST_ASSERT_TRUE(out.text.find(line) != std::string::npos);
+
+    char compact[512];
+    TEST_ASSERT_TRUE(metrics_write_compact(compact, sizeof(compact)) > 0);
+    snprintf(line, sizeof(line), "\"tl\":[%u,%llu]", (unsigned)latency.count(),
+             (unsigned long long)latency.sum());
+    TEST_ASSERT_NOT_NULL(strstr(compact, line));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets_and_sum);
+    RUN_TEST(test_sum_past_32_bits);
+    return UNITY_END();
+}
@@ -0,0 +1,371 @@
+// lib/MQTT против настоящего брокера: подписки, QoS 0 и 1, сохранённая сессия,
+// RPC, переход на запасной брокер, TLS. Брокеры поднимает test/integration/mosquitto.sh
+// и передаёт адреса в MQTT_TEST_BROKER, MQTT_TEST_BROKER2 и MQTT_TEST_TLS_BROKER
+// (host:port), pid второго - в MQTT_TEST_BROKER2_PID, CA TLS-брокера (DER) - в
+// MQTT_TEST_TLS_CA; без них тесты пропускаются.
+#include <unity.h>
+#include <Arduino.h>
+#include <WiFi.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../lib/MQTT/src/mqtt.hpp"
+#include "../../lib/MQTT/src/mqtt_rpc.hpp"
+#include "../../src/shared/auth.hpp"
+
+static char broker_host[64];
+static uint16_t broker_port = 0;
+static uint16_t second_port = 0;
+static pid_t second_pid = 0;
+static uint16_t tls_port = 0;
+static const char* tls_ca = nullptr;
+static Auth auth("test", "test-password");
+
+struct Received {
+    char topic[MQTT_QUEUE_TOPIC_SIZE];
+    char payload[MQTT_QUEUE_PAYLOAD_SIZE + 1];
+    unsigned count;
+};
+
+static void on_message(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    Received* received = (Received*)context;
+    snprintf(received->topic, sizeof(received->topic), "%s", topic);
+    memcpy(received->payload, payload, length);
+    received->payload[length] = '\0';
+    received->count++;
+}
+
+// MQTT большой (буферы пакетов), поэтому в куче; client id уникален на запуск,
+// чтобы не получить сессию от прошлого прогона.
+static MQTT* make_client(const char* name) {
+    MQTT* client = new MQTT();
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "%s-%d", name, (int)getpid() % 100000);
+    client->setClientId(clientId);
+    client->addBroker(broker_host, broker_port);
+    client->setAuthInstance(&auth);
+    return client;
+}
+
+template <typename Done>
+static bool run_until(MQTT* a, MQTT* b, uint32_t timeoutMs, Done done) {
+    unsigned long started = millis();
+    while (millis() - started < timeoutMs) {
+        auth.loop_wifi();
+        a->receive_message();
+        if (b) {
+            b->receive_message();
+        }
+        if (done()) {
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+static void require_broker() {
+    if (broker_port == 0) {
+        TEST_IGNORE_MESSAGE("MQTT_TEST_BROKER not set, run test/integration/mosquitto.sh");
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_session_comes_up_after_all_subacks(void) {
+    require_broker();
+    Received received = {};
+    MQTT* client = make_client("it-suback");
+    client->on("itest/suback/+/a", on_message, &received);
+    client->on("itest/suback/#", on_message, &received);
+    client->on("itest/suback/x", on_message, &received);
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+    client->disconnect();
+    delete client;
+}
+
+static void test_qos0_and_qos1_round_trip(void) {
+    require_broker();
+    Received received = {};
+    MQTT* client = make_client("it-echo");
+    client->on("itest/echo/+", on_message, &received);
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+
+    TEST_ASSERT_TRUE(client->publish("itest/echo/q0", "zero", 0));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000, [&] { return received.count == 1; }));
+    TEST_ASSERT_EQUAL_STRING("itest/echo/q0", received.topic);
+    TEST_ASSERT_EQUAL_STRING("zero", received.payload);
+
+    TEST_ASSERT_TRUE(client->publish("itest/echo/q1", "one", 1));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000,
+                               [&] { return received.count == 2 && client->inflight() == 0; }));
+    TEST_ASSERT_EQUAL_STRING("itest/echo/q1", received.topic);
+    TEST_ASSERT_EQUAL_STRING("one", received.payload);
+    TEST_ASSERT_EQUAL_UINT32(0, client->retransmits());
+
+    client->disconnect();
+    delete client;
+}
+
+static void test_full_payload_round_trip(void) {
+    require_broker();
+    Received received = {};
+    MQTT* client = make_client("it-large");
+    client->on("itest/large", on_message, &received);
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+
+    char payload[MQTT_QUEUE_PAYLOAD_SIZE + 1];
+    for (size_t i = 0; i < MQTT_QUEUE_PAYLOAD_SIZE; i++) {
+        payload[i] = 'a' + i % 26;
+    }
+    payload[MQTT_QUEUE_PAYLOAD_SIZE] = '\0';
+    TEST_ASSERT_TRUE(client->publish("itest/large", payload, 1));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000, [&] { return received.count == 1; }));
+    TEST_ASSERT_EQUAL_STRING(payload, received.payload);
+
+    client->disconnect();
+    delete client;
+}
+
+// clean session = 0: QoS 1 сообщения, пришедшие без устройства, брокер отдаёт
+// после переподключения.
+static void test_persistent_session_gets_offline_messages(void) {
+    require_broker();
+    Received received = {};
+    MQTT* device = make_client("it-offline");
+    device->on("itest/offline/cmd", on_message, &received);
+    device->connect();
+    TEST_ASSERT_TRUE(run_until(device, nullptr, 5000, [&] { return device->is_connected(); }));
+    device->disconnect();
+
+    MQTT* sender = make_client("it-sender");
+    sender->connect();
+    TEST_ASSERT_TRUE(run_until(sender, nullptr, 5000, [&] { return sender->is_connected(); }));
+    TEST_ASSERT_TRUE(sender->publish("itest/offline/cmd", "first", 1));
+    TEST_ASSERT_TRUE(sender->publish("itest/offline/cmd", "second", 1));
+    TEST_ASSERT_TRUE(run_until(sender, nullptr, 3000, [&] { return sender->inflight() == 0; }));
+    TEST_ASSERT_EQUAL(0, received.count);
+
+    device->connect();
+    TEST_ASSERT_TRUE(run_until(device, sender, 5000, [&] { return received.count == 2; }));
+    TEST_ASSERT_EQUAL_STRING("second", received.payload);
+
+    sender->disconnect();
+    device->disconnect();
+    delete sender;
+    delete device;
+}
+
+struct RpcCount {
+    uint32_t calls;
+};
+
+static const JsonField rpc_count_fields[] = {
+    JSON_UINT(RpcCount, calls, "calls"),
+};
+static const JsonSchema RPC_COUNT_SCHEMA = JSON_SCHEMA(rpc_count_fields);
+
+static RpcStatus rpc_count(const RpcEmpty& request, RpcCount& response, const RpcCall& call, void* context) {
+    uint32_t* calls = (uint32_t*)context;
+    response.calls = ++*calls;
+    return RpcStatus::Ok;
+}
+
+// Запросы, которые RpcServer должен отбросить, не выполняя: топик без метода,
+// повтор уже выполненного id, id, ответ на который не влезет в топик.
+// Срок 0 и 2^32-1 не переполняет дедлайн: вызов выполняется, а не "timeout".
+static void test_rpc_rejects_bad_topics_and_redelivery(void) {
+    require_broker();
+    // 45 символов: ответ <base>/res/<id> влезает в MQTT_QUEUE_TOPIC_SIZE при id до 13 символов.
+    static char base[64];
+    snprintf(base, sizeof(base), "itest/rpc/%05d-xxxxxxxxxxxxxxxxxxxxxxxxxxxxx", (int)getpid() % 100000);
+    TEST_ASSERT_EQUAL(45, strlen(base));
+
+    uint32_t calls = 0;
+    Received received = {};
+    MQTT* device = make_client("it-rpc");
+    RpcServer rpc(*device, millis);
+    TEST_ASSERT_TRUE(rpc.begin(base));
+    TEST_ASSERT_TRUE(rpc.on("count", RPC_EMPTY_SCHEMA, RPC_COUNT_SCHEMA, rpc_count, &calls));
+    MQTT* caller = make_client("it-rpc-caller");
+    char filter[128];
+    snprintf(filter, sizeof(filter), "%s/res/#", base);
+    caller->on(filter, on_message, &received);
+    device->connect();
+    caller->connect();
+    TEST_ASSERT_TRUE(run_until(device, caller, 5000,
+                               [&] { return device->is_connected() && caller->is_connected(); }));
+
+    char topic[128];
+    auto request = [&](const char* suffix) {
+        snprintf(topic, sizeof(topic), "%s/req%s", base, suffix);
+        TEST_ASSERT_TRUE(caller->publish(topic, "", 1));
+    };
+    auto settle = [&](uint32_t ms) {
+        run_until(device, caller, ms, [&] {
+            rpc.loop();
+            return false;
+        });
+    };
+
+    request("");
+    request("/count");
+    request("/count/abcdefghijklmn");  // 14 символов - ответ не влезет
+    settle(500);
+    TEST_ASSERT_EQUAL_UINT32(0, calls);
+    TEST_ASSERT_EQUAL(0, received.count);
+
+    request("/count/abcdefghijklm/4294967295");
+    TEST_ASSERT_TRUE(run_until(device, caller, 3000, [&] {
+        rpc.loop();
+        return received.count == 1;
+    }));
+    TEST_ASSERT_EQUAL_STRING("{\"calls\":1}", received.payload);
+
+    request("/count/zero/0");
+    TEST_ASSERT_TRUE(run_until(device, caller, 3000, [&] {
+        rpc.loop();
+        return received.count == 2;
+    }));
+    TEST_ASSERT_EQUAL_STRING("{\"calls\":2}", received.payload);
+
+    // Повтор доставки после ответа - не выполняется снова.
+    request("/count/abcdefghijklm/4294967295");
+    settle(500);
+    TEST_ASSERT_EQUAL_UINT32(2, calls);
+    TEST_ASSERT_EQUAL(2, received.count);
+    TEST_ASSERT_EQUAL(0, rpc.pending());
+
+    caller->disconnect();
+    device->disconnect();
+    delete caller;
+    delete device;
+}
+
+// Второй брокер первым в списке: сессия идёт через него, после его остановки
+// клиент переходит на первый и снова в сети. Останавливает брокер - последним.
+static void test_fails_over_when_broker_dies(void) {
+    require_broker();
+    if (second_port == 0 || second_pid <= 0) {
+        TEST_IGNORE_MESSAGE("MQTT_TEST_BROKER2 not set, run test/integration/mosquitto.sh");
+    }
+    Received received = {};
+    MQTT* client = new MQTT();
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "it-failover-%d", (int)getpid() % 100000);
+    client->setClientId(clientId);
+    // Разные имена одного адреса - чтобы видеть по brokerHost(), где сессия.
+    client->addBroker("localhost", second_port);
+    client->addBroker(broker_host, broker_port);
+    client->setAuthInstance(&auth);
+    client->on("itest/failover", on_message, &received);
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+    TEST_ASSERT_EQUAL_STRING("localhost", client->brokerHost());
+
+    TEST_ASSERT_EQUAL(0, kill(second_pid, SIGTERM));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return !client->is_connected(); }));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 20000, [&] { return client->is_connected(); }));
+    TEST_ASSERT_EQUAL_STRING(broker_host, client->brokerHost());
+    TEST_ASSERT_FALSE(client->brokers().healthy(0));
+
+    // Подписки восстановлены на новом брокере.
+    TEST_ASSERT_TRUE(client->publish("itest/failover", "after", 1));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000, [&] { return received.count == 1; }));
+    TEST_ASSERT_EQUAL_STRING("after", received.payload);
+
+    client->disconnect();
+    delete client;
+}
+
+// Первое подключение - полное рукопожатие, второе к тому же брокеру
+// возобновляет сессию первого.
+static void test_tls_session_resumes(void) {
+    require_broker();
+    if (tls_port == 0 || !tls_ca) {
+        TEST_IGNORE_MESSAGE("MQTT_TEST_TLS_BROKER not set, run test/integration/mosquitto.sh");
+    }
+    static uint8_t ca[4096];
+    FILE* file = fopen(tls_ca, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    size_t caLength = fread(ca, 1, sizeof(ca), file);
+    fclose(file);
+    TEST_ASSERT_TRUE(caLength > 0 && caLength < sizeof(ca));
+
+    TlsConfig tls;
+    TlsCredentials credentials;
+    credentials.caCert = ca;
+    credentials.caCertLength = caLength;
+    credentials.serverName = "localhost";
+    TEST_ASSERT_TRUE(tls.begin(credentials));
+
+    Received received = {};
+    MQTT* client = new MQTT();
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "it-tls-%d", (int)getpid() % 100000);
+    client->setClientId(clientId);
+    client->addBroker(broker_host, tls_port);
+    client->setAuthInstance(&auth);
+    TEST_ASSERT_TRUE(client->setTls(&tls));
+    client->on("itest/tls", on_message, &received);
+
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+    TEST_ASSERT_EQUAL_UINT32(1, client->tlsStats().handshakes);
+    TEST_ASSERT_FALSE(client->tlsStats().lastResumed);
+    TEST_ASSERT_TRUE(client->publish("itest/tls", "secure", 1));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000, [&] { return received.count == 1; }));
+    TEST_ASSERT_EQUAL_STRING("secure", received.payload);
+    client->disconnect();
+
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 5000, [&] { return client->is_connected(); }));
+    TEST_ASSERT_EQUAL_UINT32(2, client->tlsStats().handshakes);
+    TEST_ASSERT_TRUE(client->tlsStats().lastResumed);
+    TEST_ASSERT_EQUAL_UINT32(1, client->tlsStats().resumed);
+    TEST_ASSERT_TRUE(client->publish("itest/tls", "resumed", 1));
+    TEST_ASSERT_TRUE(run_until(client, nullptr, 3000, [&] { return received.count == 2; }));
+    TEST_ASSERT_EQUAL_UINT32(0, client->tlsStats().failures);
+
+    client->disconnect();
+    delete client;
+}
+
+int main(int argc, char** argv) {
+    const char* broker = getenv("MQTT_TEST_BROKER");
+    const char* colon = broker ? strrchr(broker, ':') : nullptr;
+    if (colon && (size_t)(colon - broker) < sizeof(broker_host)) {
+        memcpy(broker_host, broker, colon - broker);
+        broker_port = (uint16_t)atoi(colon + 1);
+        auth.connect_wifi();
+    }
+    const char* second = getenv("MQTT_TEST_BROKER2");
+    const char* pid = getenv("MQTT_TEST_BROKER2_PID");
+    colon = second ? strrchr(second, ':') : nullptr;
+    if (colon && pid) {
+        second_port = (uint16_t)atoi(colon + 1);
+        second_pid = (pid_t)atoi(pid);
+    }
+    const char* tlsBroker = getenv("MQTT_TEST_TLS_BROKER");
+    colon = tlsBroker ? strrchr(tlsBroker, ':') : nullptr;
+    if (colon) {
+        tls_port = (uint16_t)atoi(colon + 1);
+        tls_ca = getenv("MQTT_TEST_TLS_CA");
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_session_comes_up_after_all_subacks);
+    RUN_TEST(test_qos0_and_qos1_round_trip);
+    RUN_TEST(test_full_payload_round_trip);
+    RUN_TEST(test_persistent_session_gets_offline_messages);
+    RUN_TEST(test_rpc_rejects_bad_topics_and_redelivery);
+    RUN_TEST(test_tls_session_resumes);
+    RUN_TEST(test_fails_over_when_broker_dies);
+    return UNITY_END();
+}
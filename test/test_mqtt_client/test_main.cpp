@@ -0,0 +1,202 @@
+// MQTT против подставного брокера в том же процессе (loopback, без mosquitto):
+// пакеты, которые не помещаются в буфер приёма, пропускаются, но PUBLISH
+// QoS 1/2 из них подтверждается - иначе брокер повторяет его вечно.
+#include <unity.h>
+#include <Arduino.h>
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include "../../lib/MQTT/src/mqtt.hpp"
+#include "../../src/shared/auth.hpp"
+
+static Auth auth("test", "test-password");
+
+// Брокер на одно соединение: отвечает на CONNECT, SUBSCRIBE и PINGREQ,
+// запоминает подтверждения от клиента.
+struct FakeBroker {
+    int listener = -1;
+    int client = -1;
+    uint16_t port = 0;
+    uint8_t in[1024];
+    size_t inLength = 0;
+    MqttPacketType ackType = MQTT_CONNECT;  // последний PUBACK/PUBREC от клиента
+    uint16_t ackId = 0;
+    unsigned acks = 0;
+
+    bool begin() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0 ||
+            getsockname(listener, (sockaddr*)&address, &length) != 0) {
+            return false;
+        }
+        fcntl(listener, F_SETFL, O_NONBLOCK);
+        port = ntohs(address.sin_port);
+        return true;
+    }
+
+    ~FakeBroker() {
+        if (client >= 0) {
+            close(client);
+        }
+        if (listener >= 0) {
+            close(listener);
+        }
+    }
+
+    void send(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t sent = ::send(client, data, length, 0);
+            if (sent <= 0) {
+                TEST_ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+                usleep(1000);
+                continue;
+            }
+            data += sent;
+            length -= sent;
+        }
+    }
+
+    void reply(MqttPacketType type, uint8_t flags, const uint8_t* body, size_t length) {
+        uint8_t packet[8] = { (uint8_t)((type << 4) | flags), (uint8_t)length };
+        memcpy(packet + 2, body, length);
+        send(packet, 2 + length);
+    }
+
+    void poll() {
+        if (client < 0) {
+            client = accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                return;
+            }
+            fcntl(client, F_SETFL, O_NONBLOCK);
+        }
+        ssize_t received = recv(client, in + inLength, sizeof(in) - inLength, 0);
+        if (received > 0) {
+            inLength += received;
+        }
+        MqttPacket packet;
+        while (mqtt_decode(in, inLength, sizeof(in), packet) == MqttDecode::Ok) {
+            if (packet.type == MQTT_CONNECT) {
+                const uint8_t connack[] = { 0, 0 };
+                reply(MQTT_CONNACK, 0, connack, sizeof(connack));
+            } else if (packet.type == MQTT_SUBSCRIBE) {
+                const uint8_t suback[] = { packet.body[0], packet.body[1], 1 };
+                reply(MQTT_SUBACK, 0, suback, sizeof(suback));
+            } else if (packet.type == MQTT_PINGREQ) {
+                reply(MQTT_PINGRESP, 0, nullptr, 0);
+            } else if (packet.type == MQTT_PUBACK || packet.type == MQTT_PUBREC) {
+                ackType = (MqttPacketType)packet.type;
+                ackId = packet.packetId;
+                acks++;
+            }
+            memmove(in, in + packet.size, inLength - packet.size);
+            inLength -= packet.size;
+        }
+    }
+};
+
+struct Received {
+    char topic[MQTT_QUEUE_TOPIC_SIZE];
+    unsigned count;
+};
+
+static void on_message(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    Received* received = (Received*)context;
+    snprintf(received->topic, sizeof(received->topic), "%s", topic);
+    received->count++;
+}
+
+template <typename Done>
+static bool run_until(MQTT* client, FakeBroker& broker, uint32_t timeoutMs, Done done) {
+    unsigned long started = millis();
+    while (millis() - started < timeoutMs) {
+        auth.loop_wifi();
+        client->receive_message();
+        broker.poll();
+        if (done()) {
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+static FakeBroker* broker;
+static MQTT* client;
+static Received received;
+
+void setUp(void) {
+    broker = new FakeBroker();
+    TEST_ASSERT_TRUE(broker->begin());
+    received = Received();
+    client = new MQTT();
+    client->setClientId("it-oversize");
+    client->addBroker("127.0.0.1", broker->port);
+    client->setAuthInstance(&auth);
+    client->on("small", on_message, &received);
+    client->connect();
+    TEST_ASSERT_TRUE(run_until(client, *broker, 5000, [] { return client->is_connected(); }));
+}
+
+void tearDown(void) {
+    client->disconnect();
+    delete client;
+    delete broker;
+}
+
+// Большой PUBLISH и за ним обычный: первый подтверждён, не доставлен,
+// второй доставлен - поток пакетов после пропуска не сбился.
+static void send_oversized(const char* topic, size_t payloadLength, uint8_t qos, uint16_t packetId) {
+    static uint8_t payload[4096];
+    static uint8_t packet[8192];
+    memset(payload, 'x', payloadLength);
+    size_t length = mqtt_encode_publish(packet, sizeof(packet), topic, payload, payloadLength, qos, false, packetId);
+    TEST_ASSERT_TRUE(length > MQTT_RX_BUFFER_SIZE);
+    broker->send(packet, length);
+    length = mqtt_encode_publish(packet, sizeof(packet), "small", (const uint8_t*)"ok", 2, 0, false, 0);
+    broker->send(packet, length);
+}
+
+static void test_oversized_qos1_publish_is_acked(void) {
+    send_oversized("small", 3 * MQTT_RX_BUFFER_SIZE, 1, 0x1234);
+    TEST_ASSERT_TRUE(run_until(client, *broker, 3000, [] { return broker->acks == 1 && received.count == 1; }));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PUBACK, broker->ackType);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, broker->ackId);
+    TEST_ASSERT_EQUAL_STRING("small", received.topic);
+    TEST_ASSERT_TRUE(client->is_connected());
+}
+
+// Топик длиннее буфера: packet id приходит уже в пропускаемой части.
+static void test_oversized_qos2_publish_with_long_topic_gets_pubrec(void) {
+    static char topic[MQTT_RX_BUFFER_SIZE + 100];
+    memset(topic, 't', sizeof(topic) - 1);
+    topic[sizeof(topic) - 1] = '\0';
+    send_oversized(topic, 10, 2, 77);
+    TEST_ASSERT_TRUE(run_until(client, *broker, 3000, [] { return broker->acks == 1 && received.count == 1; }));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PUBREC, broker->ackType);
+    TEST_ASSERT_EQUAL_UINT16(77, broker->ackId);
+}
+
+static void test_oversized_qos0_publish_is_not_acked(void) {
+    send_oversized("small", 2 * MQTT_RX_BUFFER_SIZE, 0, 0);
+    TEST_ASSERT_TRUE(run_until(client, *broker, 3000, [] { return received.count == 1; }));
+    TEST_ASSERT_EQUAL_UINT32(0, broker->acks);
+}
+
+int main(int argc, char** argv) {
+    auth.connect_wifi();
+    UNITY_BEGIN();
+    RUN_TEST(test_oversized_qos1_publish_is_acked);
+    RUN_TEST(test_oversized_qos2_publish_with_long_topic_gets_pubrec);
+    RUN_TEST(test_oversized_qos0_publish_is_not_acked);
+    return UNITY_END();
+}
@@ -0,0 +1,277 @@
+// Кодек MQTT 3.1.1 без брокера: кодирование и разбор пакетов, неполные и
+// испорченные пакеты, пропуск пакета больше буфера с ответом на QoS 1/2.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/MQTT/src/mqtt_codec.hpp"
+
+static uint8_t buffer[4096];
+
+void setUp(void) {
+    memset(buffer, 0, sizeof(buffer));
+}
+
+void tearDown(void) {}
+
+static void test_publish_round_trip(void) {
+    const uint8_t payload[] = { 'o', 'n', 0, 0xFF };
+    size_t length = mqtt_encode_publish(buffer, sizeof(buffer), "a/b", payload, sizeof(payload), 1, true, 0x1234);
+    // 0x33 | 2+3 (топик) + 2 (id) + 4 = 11
+    TEST_ASSERT_EQUAL_UINT32(13, length);
+    TEST_ASSERT_EQUAL_HEX8(0x33, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT8(11, buffer[1]);
+
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, length, sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PUBLISH, packet.type);
+    TEST_ASSERT_EQUAL_UINT32(length, packet.size);
+    TEST_ASSERT_EQUAL_UINT8(1, packet.qos);
+    TEST_ASSERT_TRUE(packet.retain);
+    TEST_ASSERT_FALSE(packet.dup);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, packet.packetId);
+    TEST_ASSERT_EQUAL_STRING("a/b", packet.topic);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(payload), packet.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(payload, packet.payload, sizeof(payload));
+}
+
+static void test_qos0_publish_has_no_packet_id(void) {
+    size_t length = mqtt_encode_publish(buffer, sizeof(buffer), "t", (const uint8_t*)"x", 1, 0, false, 7);
+    TEST_ASSERT_EQUAL_UINT32(6, length);
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, length, sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_EQUAL_UINT8(0, packet.qos);
+    TEST_ASSERT_EQUAL_UINT16(0, packet.packetId);
+    TEST_ASSERT_EQUAL_STRING("t", packet.topic);
+    TEST_ASSERT_EQUAL_UINT8('x', packet.payload[0]);
+}
+
+// Длина 200 занимает два байта remaining length.
+static void test_multibyte_remaining_length(void) {
+    uint8_t payload[200];
+    memset(payload, 'p', sizeof(payload));
+    size_t length = mqtt_encode_publish(buffer, sizeof(buffer), "topic", payload, sizeof(payload), 0, false, 0);
+    TEST_ASSERT_EQUAL_UINT32(3 + 2 + 5 + 200, length);
+    TEST_ASSERT_EQUAL_HEX8(0x80 | (207 % 128), buffer[1]);
+    TEST_ASSERT_EQUAL_HEX8(207 / 128, buffer[2]);
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, length, sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_EQUAL_UINT32(200, packet.payloadLength);
+}
+
+static void test_acks_and_empty_packets(void) {
+    const MqttPacketType types[] = { MQTT_PUBACK, MQTT_PUBREC, MQTT_PUBREL, MQTT_PUBCOMP };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        size_t length = mqtt_encode_ack(buffer, sizeof(buffer), types[i], 0xBEEF);
+        TEST_ASSERT_EQUAL_UINT32(4, length);
+        // PUBREL - с обязательными флагами 0010.
+        TEST_ASSERT_EQUAL_HEX8((types[i] << 4) | (types[i] == MQTT_PUBREL ? 2 : 0), buffer[0]);
+        MqttPacket packet;
+        TEST_ASSERT_TRUE(mqtt_decode(buffer, length, sizeof(buffer), packet) == MqttDecode::Ok);
+        TEST_ASSERT_EQUAL_UINT8(types[i], packet.type);
+        TEST_ASSERT_EQUAL_HEX16(0xBEEF, packet.packetId);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(2, mqtt_encode_empty(buffer, sizeof(buffer), MQTT_PINGRESP));
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, 2, sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PINGRESP, packet.type);
+}
+
+static void test_connack_and_suback(void) {
+    const uint8_t connack[] = { 0x20, 0x02, 0x01, 0x05 };
+    memcpy(buffer, connack, sizeof(connack));
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(connack), sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_TRUE(packet.sessionPresent);
+    TEST_ASSERT_EQUAL_UINT8(5, packet.returnCode);
+
+    const uint8_t suback[] = { 0x90, 0x03, 0x00, 0x09, 0x80 };
+    memcpy(buffer, suback, sizeof(suback));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(suback), sizeof(buffer), packet) == MqttDecode::Ok);
+    TEST_ASSERT_EQUAL_UINT16(9, packet.packetId);
+    TEST_ASSERT_EQUAL_HEX8(0x80, packet.returnCode);
+}
+
+static void test_connect_and_subscribe_layout(void) {
+    MqttConnectOptions options;
+    options.clientId = "dev";
+    options.username = "u";
+    options.password = "pw";
+    options.keepAliveS = 30;
+    options.cleanSession = false;
+    size_t length = mqtt_encode_connect(buffer, sizeof(buffer), options);
+    const uint8_t expected[] = { 0x10, 22, 0, 4, 'M', 'Q', 'T', 'T', 4, 0xC0, 0, 30,
+                                 0, 3, 'd', 'e', 'v', 0, 1, 'u', 0, 2, 'p', 'w' };
+    TEST_ASSERT_EQUAL_UINT32(sizeof(expected), length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof(expected));
+
+    length = mqtt_encode_subscribe(buffer, sizeof(buffer), 3, "a/#", 1);
+    const uint8_t subscribe[] = { 0x82, 8, 0, 3, 0, 3, 'a', '/', '#', 1 };
+    TEST_ASSERT_EQUAL_UINT32(sizeof(subscribe), length);
+    TEST_ASSERT_EQUAL_MEMORY(subscribe, buffer, sizeof(subscribe));
+}
+
+static void test_encoders_refuse_small_buffers(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt_encode_publish(buffer, 8, "topic", (const uint8_t*)"payload", 7, 1, false, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt_encode_ack(buffer, 3, MQTT_PUBACK, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, mqtt_encode_publish(buffer, sizeof(buffer), "t", (const uint8_t*)"x", 1, 3, false, 1));
+}
+
+// Любой префикс целого пакета - Incomplete, а не Malformed.
+static void test_every_prefix_is_incomplete(void) {
+    uint8_t payload[150];
+    memset(payload, 'z', sizeof(payload));
+    uint8_t packet_bytes[256];
+    size_t length = mqtt_encode_publish(packet_bytes, sizeof(packet_bytes), "x/y", payload, sizeof(payload), 2,
+                                        false, 42);
+    for (size_t prefix = 0; prefix < length; prefix++) {
+        memcpy(buffer, packet_bytes, length);
+        MqttPacket packet;
+        TEST_ASSERT_TRUE(mqtt_decode(buffer, prefix, sizeof(buffer), packet) == MqttDecode::Incomplete);
+    }
+}
+
+static void test_malformed_packets(void) {
+    MqttPacket packet;
+    // Пять байтов remaining length.
+    const uint8_t longLength[] = { 0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    memcpy(buffer, longLength, sizeof(longLength));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(longLength), sizeof(buffer), packet) == MqttDecode::Malformed);
+
+    // QoS 3.
+    const uint8_t qos3[] = { 0x36, 0x04, 0x00, 0x01, 't', 0x00 };
+    memcpy(buffer, qos3, sizeof(qos3));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(qos3), sizeof(buffer), packet) == MqttDecode::Malformed);
+
+    // Топик длиннее пакета.
+    const uint8_t topic[] = { 0x30, 0x03, 0x00, 0x09, 't' };
+    memcpy(buffer, topic, sizeof(topic));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(topic), sizeof(buffer), packet) == MqttDecode::Malformed);
+
+    // У QoS 1 нет места под packet id.
+    const uint8_t noId[] = { 0x32, 0x03, 0x00, 0x01, 't' };
+    memcpy(buffer, noId, sizeof(noId));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(noId), sizeof(buffer), packet) == MqttDecode::Malformed);
+
+    const uint8_t connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    memcpy(buffer, connack, sizeof(connack));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(connack), sizeof(buffer), packet) == MqttDecode::Malformed);
+
+    const uint8_t pingresp[] = { 0xD0, 0x01, 0x00 };
+    memcpy(buffer, pingresp, sizeof(pingresp));
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(pingresp), sizeof(buffer), packet) == MqttDecode::Malformed);
+}
+
+// TooLarge известен по первым байтам, до прихода остального пакета.
+static void test_too_large_reports_header(void) {
+    const uint8_t header[] = { 0x32, 0xE8, 0x07 };  // 1000 байтов тела
+    memcpy(buffer, header, sizeof(header));
+    MqttPacket packet;
+    TEST_ASSERT_TRUE(mqtt_decode(buffer, sizeof(header), 512, packet) == MqttDecode::TooLarge);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PUBLISH, packet.type);
+    TEST_ASSERT_EQUAL_HEX8(0x02, packet.flags);
+    TEST_ASSERT_EQUAL_UINT32(1003, packet.size);
+    TEST_ASSERT_EQUAL_UINT32(1000, packet.bodyLength);
+}
+
+// Пропуск большого PUBLISH кусками chunk байтов; возвращает, нужен ли ответ.
+static bool skip_in_chunks(const uint8_t* packet_bytes, size_t length, size_t maxPacket, size_t chunk,
+                           MqttPacketType& type, uint16_t& packetId) {
+    MqttPacket packet;
+    memcpy(buffer, packet_bytes, 8);
+    if (mqtt_decode(buffer, 8, maxPacket, packet) != MqttDecode::TooLarge) {
+        return false;
+    }
+    MqttSkip skip;
+    skip.begin(packet);
+    TEST_ASSERT_EQUAL_UINT32(length, skip.remaining());
+    size_t position = 0;
+    while (skip.remaining() > 0) {
+        TEST_ASSERT_FALSE(skip.ack(type, packetId));
+        size_t take = length - position < chunk ? length - position : chunk;
+        skip.feed(packet_bytes + position, take);
+        position += take;
+    }
+    TEST_ASSERT_EQUAL_UINT32(length, position);
+    return skip.ack(type, packetId);
+}
+
+static void test_skipped_publish_is_acked(void) {
+    static uint8_t payload[2000];
+    static uint8_t packet_bytes[3000];
+    memset(payload, 'b', sizeof(payload));
+    size_t length = mqtt_encode_publish(packet_bytes, sizeof(packet_bytes), "big", payload, sizeof(payload), 1,
+                                        false, 0x1234);
+    const size_t chunks[] = { 1, 2, 3, 7, 64, 512, 4096 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        MqttPacketType type = MQTT_CONNECT;
+        uint16_t packetId = 0;
+        TEST_ASSERT_TRUE(skip_in_chunks(packet_bytes, length, 512, chunks[i], type, packetId));
+        TEST_ASSERT_EQUAL_UINT8(MQTT_PUBACK, type);
+        TEST_ASSERT_EQUAL_HEX16(0x1234, packetId);
+    }
+
+    length = mqtt_encode_publish(packet_bytes, sizeof(packet_bytes), "big", payload, sizeof(payload), 2, false, 77);
+    MqttPacketType type = MQTT_CONNECT;
+    uint16_t packetId = 0;
+    TEST_ASSERT_TRUE(skip_in_chunks(packet_bytes, length, 512, 64, type, packetId));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_PUBREC, type);
+    TEST_ASSERT_EQUAL_UINT16(77, packetId);
+
+    length = mqtt_encode_publish(packet_bytes, sizeof(packet_bytes), "big", payload, sizeof(payload), 0, false, 0);
+    TEST_ASSERT_FALSE(skip_in_chunks(packet_bytes, length, 512, 64, type, packetId));
+}
+
+// Топик длиннее буфера приёма: packet id приходит уже после того, как буфер
+// переполнен, и вычитывается из пропускаемых байтов.
+static void test_packet_id_after_long_topic(void) {
+    static char topic[1200];
+    static uint8_t packet_bytes[1400];
+    memset(topic, 't', sizeof(topic) - 1);
+    topic[sizeof(topic) - 1] = '\0';
+    size_t length = mqtt_encode_publish(packet_bytes, sizeof(packet_bytes), topic, (const uint8_t*)"v", 1, 1, false,
+                                        0xA55A);
+    const size_t chunks[] = { 1, 5, 64, 1199, 1200, 1201, 1202 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        MqttPacketType type = MQTT_CONNECT;
+        uint16_t packetId = 0;
+        TEST_ASSERT_TRUE(skip_in_chunks(packet_bytes, length, 512, chunks[i], type, packetId));
+        TEST_ASSERT_EQUAL_UINT8(MQTT_PUBACK, type);
+        TEST_ASSERT_EQUAL_HEX16(0xA55A, packetId);
+    }
+}
+
+// Большой пакет не PUBLISH (или PUBLISH без места под id) ответа не требует.
+static void test_skipped_non_publish_is_not_acked(void) {
+    static uint8_t packet_bytes[1000];
+    memset(packet_bytes, 0, sizeof(packet_bytes));
+    packet_bytes[0] = MQTT_SUBACK << 4;
+    packet_bytes[1] = 0x80 | (997 % 128);
+    packet_bytes[2] = 997 / 128;
+    MqttPacketType type;
+    uint16_t packetId;
+    TEST_ASSERT_FALSE(skip_in_chunks(packet_bytes, sizeof(packet_bytes), 512, 100, type, packetId));
+
+    // QoS 1, длина топика больше пакета.
+    packet_bytes[0] = 0x32;
+    packet_bytes[3] = 0xFF;
+    packet_bytes[4] = 0xFF;
+    TEST_ASSERT_FALSE(skip_in_chunks(packet_bytes, sizeof(packet_bytes), 512, 100, type, packetId));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_round_trip);
+    RUN_TEST(test_qos0_publish_has_no_packet_id);
+    RUN_TEST(test_multibyte_remaining_length);
+    RUN_TEST(test_acks_and_empty_packets);
+    RUN_TEST(test_connack_and_suback);
+    RUN_TEST(test_connect_and_subscribe_layout);
+    RUN_TEST(test_encoders_refuse_small_buffers);
+    RUN_TEST(test_every_prefix_is_incomplete);
+    RUN_TEST(test_malformed_packets);
+    RUN_TEST(test_too_large_reports_header);
+    RUN_TEST(test_skipped_publish_is_acked);
+    RUN_TEST(test_packet_id_after_long_topic);
+    RUN_TEST(test_skipped_non_publish_is_not_acked);
+    return UNITY_END();
+}
@@ -0,0 +1,223 @@
+// MqttConnection с подставными часами и транспортом: backoff, таймауты шагов,
+// потеря сети и брокера без настоящего времени и сокетов.
+#include <unity.h>
+#include "../../lib/MQTT/src/mqtt_connection.hpp"
+
+static unsigned long now_ms = 0;
+static uint32_t random_value = 0;
+
+static unsigned long fake_clock() {
+    return now_ms;
+}
+
+static uint32_t fake_random() {
+    return random_value;
+}
+
+struct FakeLink : MqttLink {
+    bool network = true;
+    LinkStatus open = LinkStatus::Pending;
+    LinkStatus subscribed = LinkStatus::Pending;
+    bool alive = true;
+    int opens = 0;
+    int closes = 0;
+    int services = 0;
+
+    bool networkReady() override { return network; }
+    LinkStatus openSession() override {
+        opens++;
+        return open;
+    }
+    LinkStatus subscribe() override { return subscribed; }
+    bool sessionAlive() override { return alive; }
+    void closeSession() override { closes++; }
+    void service() override { services++; }
+};
+
+static MqttConnectionConfig test_config() {
+    MqttConnectionConfig config;
+    config.backoffBaseMs = 1000;
+    config.backoffMaxMs = 8000;
+    config.stepTimeoutMs = 5000;
+    return config;
+}
+
+static void advance(MqttConnection& connection, unsigned long ms) {
+    now_ms += ms;
+    connection.tick();
+}
+
+static void bring_online(MqttConnection& connection, FakeLink& link) {
+    link.open = LinkStatus::Ok;
+    link.subscribed = LinkStatus::Ok;
+    connection.tick();  // Idle -> Connecting
+    connection.tick();  // -> Subscribing
+    connection.tick();  // -> Online
+}
+
+void setUp(void) {
+    now_ms = 1000;
+    random_value = 0;
+}
+
+void tearDown(void) {}
+
+static void test_waits_for_start_and_network(void) {
+    FakeLink link;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Idle);
+
+    link.network = false;
+    connection.start();
+    advance(connection, 10000);
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Idle);
+    TEST_ASSERT_EQUAL(0, link.opens);
+
+    link.network = true;
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Connecting);
+}
+
+static void test_connect_timeout_enters_backoff(void) {
+    FakeLink link;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    connection.tick();
+
+    advance(connection, 5000);
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Connecting);
+    advance(connection, 1);
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Backoff);
+    TEST_ASSERT_EQUAL(1, link.closes);
+}
+
+static void test_backoff_doubles_up_to_max(void) {
+    FakeLink link;
+    link.open = LinkStatus::Failed;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    connection.tick();
+
+    // random 0 - нижняя граница окна: половина от 1, 2, 4, 8, 8 с.
+    const unsigned long expected[] = { 500, 1000, 2000, 4000, 4000 };
+    for (unsigned i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        connection.tick();
+        TEST_ASSERT_TRUE(connection.state() == MqttState::Backoff);
+        TEST_ASSERT_EQUAL(expected[i], connection.backoffRemaining());
+        advance(connection, expected[i] - 1);
+        TEST_ASSERT_TRUE(connection.state() == MqttState::Backoff);
+        advance(connection, 1);
+        TEST_ASSERT_TRUE(connection.state() == MqttState::Connecting);
+    }
+}
+
+static void test_backoff_jitter_stays_in_window(void) {
+    Backoff backoff(1000, 60000);
+    uint32_t window = 1000;
+    for (int attempt = 0; attempt < 40; attempt++) {
+        Backoff low = backoff;
+        Backoff high = backoff;
+        TEST_ASSERT_EQUAL_UINT32(window / 2, low.next(0));
+        TEST_ASSERT_EQUAL_UINT32(window, high.next(window - window / 2));
+        uint32_t delay = backoff.next(0xFFFFFFFFu);
+        TEST_ASSERT_GREATER_OR_EQUAL(window / 2, delay);
+        TEST_ASSERT_LESS_OR_EQUAL(window, delay);
+        window = window * 2 > 60000 ? 60000 : window * 2;
+    }
+}
+
+static void test_subscribe_timeout(void) {
+    FakeLink link;
+    link.open = LinkStatus::Ok;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    connection.tick();
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Subscribing);
+
+    advance(connection, 5001);
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Backoff);
+}
+
+static void test_online_resets_backoff(void) {
+    FakeLink link;
+    link.open = LinkStatus::Failed;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    connection.tick();
+    connection.tick();
+    advance(connection, 500);
+    connection.tick();
+    TEST_ASSERT_EQUAL(1000, connection.backoffRemaining());
+
+    advance(connection, 1000);
+    link.open = LinkStatus::Ok;
+    link.subscribed = LinkStatus::Ok;
+    connection.tick();
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Online);
+    TEST_ASSERT_EQUAL(0, connection.reconnects());
+
+    connection.tick();
+    TEST_ASSERT_EQUAL(1, link.services);
+
+    // Потеря брокера - снова первая ступень backoff, а не сразу Connecting.
+    link.alive = false;
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Backoff);
+    TEST_ASSERT_EQUAL(500, connection.backoffRemaining());
+
+    link.alive = true;
+    advance(connection, 500);
+    connection.tick();
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Online);
+    TEST_ASSERT_EQUAL(1, connection.reconnects());
+}
+
+static void test_network_loss_returns_to_idle(void) {
+    FakeLink link;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    bring_online(connection, link);
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Online);
+
+    link.network = false;
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Idle);
+    TEST_ASSERT_EQUAL(1, link.closes);
+
+    link.network = true;
+    connection.tick();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Connecting);
+}
+
+static void test_reconnect_skips_backoff(void) {
+    FakeLink link;
+    MqttConnection connection(link, fake_clock, fake_random, test_config());
+    connection.start();
+    bring_online(connection, link);
+
+    connection.reconnect();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Connecting);
+    TEST_ASSERT_EQUAL(1, link.closes);
+
+    connection.stop();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Idle);
+    connection.reconnect();
+    TEST_ASSERT_TRUE(connection.state() == MqttState::Idle);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_waits_for_start_and_network);
+    RUN_TEST(test_connect_timeout_enters_backoff);
+    RUN_TEST(test_backoff_doubles_up_to_max);
+    RUN_TEST(test_backoff_jitter_stays_in_window);
+    RUN_TEST(test_subscribe_timeout);
+    RUN_TEST(test_online_resets_backoff);
+    RUN_TEST(test_network_loss_returns_to_idle);
+    RUN_TEST(test_reconnect_skips_backoff);
+    return UNITY_END();
+}
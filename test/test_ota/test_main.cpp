@@ -0,0 +1,319 @@
+// OTA: патч применяется кусками любого размера, исходный образ проверяется
+// по куску за вызов, неподписанное обновление не принимается, подписанное
+// (образ или патч) выбирается для загрузки. esp_ota_* - из ArduinoNative.
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "../../src/shared/delta_patch.hpp"
+#include "../../src/shared/ota_update.hpp"
+#include "../../src/shared/ota_sign.hpp"
+#include "../../src/shared/crc32.hpp"
+
+typedef std::vector<uint8_t> Bytes;
+
+static const char* KEY = "test-ota-key";
+
+struct Image {
+    Bytes source;
+    Bytes output;
+    size_t sourceRead = 0;
+};
+
+static bool read_source(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    Image* image = (Image*)context;
+    if (offset > image->source.size() || length > image->source.size() - offset) {
+        return false;
+    }
+    memcpy(out, image->source.data() + offset, length);
+    image->sourceRead += length;
+    return true;
+}
+
+static bool write_output(const uint8_t* data, size_t length, void* context) {
+    Image* image = (Image*)context;
+    image->output.insert(image->output.end(), data, data + length);
+    return true;
+}
+
+static void put_le32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+static Bytes patch_header(const Bytes& source, uint32_t targetSize) {
+    Bytes patch = { 'O', 'D', 'P', '1' };
+    put_le32(patch, (uint32_t)source.size());
+    put_le32(patch, crc32(source.data(), source.size()));
+    put_le32(patch, targetSize);
+    return patch;
+}
+
+static void op_copy(Bytes& patch, uint32_t offset, uint32_t length) {
+    patch.push_back(DELTA_OP_COPY);
+    put_le32(patch, offset);
+    put_le32(patch, length);
+}
+
+static void op_insert(Bytes& patch, const Bytes& data) {
+    patch.push_back(DELTA_OP_INSERT);
+    put_le32(patch, (uint32_t)data.size());
+    patch.insert(patch.end(), data.begin(), data.end());
+}
+
+static Bytes pattern(size_t length, uint32_t seed) {
+    Bytes out(length);
+    for (size_t i = 0; i < length; i++) {
+        seed = seed * 1103515245 + 12345;
+        out[i] = (uint8_t)(seed >> 16);
+    }
+    return out;
+}
+
+static PatchError feed_chunked(DeltaPatcher& patcher, const Bytes& patch, size_t chunk) {
+    PatchError error = PatchError::None;
+    for (size_t offset = 0; offset < patch.size() && error == PatchError::None; offset += chunk) {
+        size_t length = patch.size() - offset < chunk ? patch.size() - offset : chunk;
+        error = patcher.feed(patch.data() + offset, length);
+    }
+    while (error == PatchError::None && !patcher.sourceChecked()) {
+        error = patcher.checkSource();
+    }
+    return error;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {
+    ota_confirm_boot();  // запись о пробной загрузке не переходит в следующий тест
+}
+
+static void test_patch_any_chunking(void) {
+    Image image;
+    image.source = pattern(20000, 1);
+    Bytes inserted = pattern(300, 2);
+    Bytes expected(image.source.begin() + 1000, image.source.begin() + 9000);
+    expected.insert(expected.end(), inserted.begin(), inserted.end());
+    expected.insert(expected.end(), image.source.begin(), image.source.begin() + 50);
+
+    Bytes patch = patch_header(image.source, (uint32_t)expected.size());
+    op_copy(patch, 1000, 8000);
+    op_insert(patch, inserted);
+    op_copy(patch, 0, 50);
+
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)64, patch.size() }) {
+        image.output.clear();
+        DeltaPatcher patcher(read_source, write_output, &image);
+        TEST_ASSERT_EQUAL(PatchError::None, feed_chunked(patcher, patch, chunk));
+        TEST_ASSERT_TRUE(patcher.complete());
+        TEST_ASSERT_TRUE(image.output == expected);
+    }
+}
+
+// Первый кусок патча не читает весь исходный образ: не больше
+// DELTA_CHECK_CHUNK байт проверки за вызов feed().
+static void test_source_check_is_incremental(void) {
+    Image image;
+    image.source = pattern(DELTA_CHECK_CHUNK * 10 + 123, 3);
+    Bytes inserted = pattern(64, 4);
+    Bytes patch = patch_header(image.source, (uint32_t)inserted.size());
+    op_insert(patch, inserted);
+
+    DeltaPatcher patcher(read_source, write_output, &image);
+    size_t calls = 0;
+    for (size_t offset = 0; offset < patch.size(); offset += 8) {
+        size_t before = image.sourceRead;
+        size_t length = patch.size() - offset < 8 ? patch.size() - offset : 8;
+        TEST_ASSERT_EQUAL(PatchError::None, patcher.feed(patch.data() + offset, length));
+        TEST_ASSERT_TRUE(image.sourceRead - before <= DELTA_CHECK_CHUNK);
+        calls++;
+    }
+    // Первый вызов принёс только половину заголовка: проверять было нечего.
+    TEST_ASSERT_EQUAL_UINT32((calls - 1) * DELTA_CHECK_CHUNK, image.sourceRead);
+    TEST_ASSERT_FALSE(patcher.sourceChecked());
+    TEST_ASSERT_FALSE(patcher.complete());
+
+    while (!patcher.sourceChecked()) {
+        TEST_ASSERT_EQUAL(PatchError::None, patcher.checkSource());
+    }
+    TEST_ASSERT_EQUAL_UINT32(image.source.size(), image.sourceRead);
+    TEST_ASSERT_TRUE(patcher.complete());
+    TEST_ASSERT_TRUE(image.output == inserted);
+}
+
+static void test_wrong_source_rejected(void) {
+    Image image;
+    image.source = pattern(DELTA_CHECK_CHUNK * 3, 5);
+    Bytes patch = patch_header(image.source, 10);
+    op_copy(patch, 0, 10);
+    image.source[DELTA_CHECK_CHUNK * 2 + 1] ^= 0x01;  // на устройстве другая прошивка
+
+    DeltaPatcher patcher(read_source, write_output, &image);
+    TEST_ASSERT_EQUAL(PatchError::Source, feed_chunked(patcher, patch, 4));
+    TEST_ASSERT_FALSE(patcher.complete());
+    // После ошибки всё отвергается до reset().
+    TEST_ASSERT_EQUAL(PatchError::Source, patcher.feed(patch.data(), 1));
+}
+
+static void test_range_and_format_errors(void) {
+    Image image;
+    image.source = pattern(100, 6);
+
+    Bytes copyPastSource = patch_header(image.source, 50);
+    op_copy(copyPastSource, 80, 30);
+    DeltaPatcher patcher(read_source, write_output, &image);
+    TEST_ASSERT_EQUAL(PatchError::Range, feed_chunked(patcher, copyPastSource, 64));
+
+    Bytes insertPastTarget = patch_header(image.source, 4);
+    op_insert(insertPastTarget, pattern(5, 7));
+    patcher.reset();
+    TEST_ASSERT_EQUAL(PatchError::Range, feed_chunked(patcher, insertPastTarget, 64));
+
+    Bytes afterEnd = patch_header(image.source, 10);
+    op_copy(afterEnd, 0, 10);
+    op_copy(afterEnd, 0, 1);
+    patcher.reset();
+    TEST_ASSERT_EQUAL(PatchError::Format, feed_chunked(patcher, afterEnd, 64));
+
+    Bytes badMagic = patch_header(image.source, 10);
+    badMagic[3] = '2';
+    patcher.reset();
+    TEST_ASSERT_EQUAL(PatchError::Format, feed_chunked(patcher, badMagic, 64));
+
+    Bytes badOpcode = patch_header(image.source, 10);
+    badOpcode.push_back(0x7F);
+    patcher.reset();
+    TEST_ASSERT_EQUAL(PatchError::Format, feed_chunked(patcher, badOpcode, 64));
+}
+
+// RFC 4231, тесты 2 и 6 (ключ длиннее блока).
+static void test_hmac_sha256_vectors(void) {
+    uint8_t mac[SHA256_SIZE];
+    char hex[SHA256_SIZE * 2 + 1];
+    const char* data = "what do ya want for nothing?";
+    hmac_sha256("Jefe", 4, data, strlen(data), mac);
+    sha256_to_hex(mac, hex);
+    TEST_ASSERT_EQUAL_STRING("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", hex);
+
+    uint8_t key[131];
+    memset(key, 0xAA, sizeof(key));
+    const char* large = "Test Using Larger Than Block-Size Key - Hash Key First";
+    hmac_sha256(key, sizeof(key), large, strlen(large), mac);
+    sha256_to_hex(mac, hex);
+    TEST_ASSERT_EQUAL_STRING("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54", hex);
+}
+
+static Bytes firmware(size_t length, uint32_t seed) {
+    Bytes image = pattern(length, seed);
+    image[0] = 0xE9;  // esp_ota_end() принимает только образ ESP32
+    return image;
+}
+
+static void digest_of(const Bytes& image, uint8_t digest[SHA256_SIZE]) {
+    Sha256 sha;
+    sha.update(image.data(), image.size());
+    sha.finish(digest);
+}
+
+static OtaError send(OtaUpdate& ota, const Bytes& stream, size_t chunk) {
+    for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+        size_t length = stream.size() - offset < chunk ? stream.size() - offset : chunk;
+        OtaError error = ota.write(OtaTransport::Mqtt, (uint32_t)offset, stream.data() + offset, length);
+        if (error != OtaError::None) {
+            return error;
+        }
+    }
+    return ota.finish(OtaTransport::Mqtt);
+}
+
+static void test_unsigned_update_rejected(void) {
+    Bytes image = firmware(5000, 8);
+    uint8_t digest[SHA256_SIZE];
+    uint8_t signature[SHA256_SIZE];
+    digest_of(image, digest);
+    ota_sign(KEY, (uint32_t)image.size(), digest, false, signature);
+
+    // Без ключа на устройстве не принимается даже подписанное.
+    OtaUpdate keyless("");
+    TEST_ASSERT_EQUAL(OtaError::Auth, keyless.begin(OtaTransport::Mqtt, image.size(), digest, false, signature));
+    TEST_ASSERT_EQUAL(OtaState::Idle, keyless.state());
+
+    OtaUpdate ota(KEY);
+    // Подпись другого размера, другого режима и испорченная.
+    TEST_ASSERT_EQUAL(OtaError::Auth, ota.begin(OtaTransport::Mqtt, image.size() + 1, digest, false, signature));
+    TEST_ASSERT_EQUAL(OtaError::Auth, ota.begin(OtaTransport::Mqtt, image.size(), digest, true, signature));
+    signature[5] ^= 0x10;
+    TEST_ASSERT_EQUAL(OtaError::Auth, ota.begin(OtaTransport::Http, image.size(), digest, false, signature));
+    TEST_ASSERT_EQUAL(OtaState::Idle, ota.state());
+
+    // Неподписанный begin не прерывает идущую сессию.
+    signature[5] ^= 0x10;
+    TEST_ASSERT_EQUAL(OtaError::None, ota.begin(OtaTransport::Mqtt, image.size(), digest, false, signature));
+    signature[0] ^= 0x01;
+    TEST_ASSERT_EQUAL(OtaError::Auth, ota.begin(OtaTransport::Mqtt, image.size(), digest, false, signature));
+    TEST_ASSERT_EQUAL(OtaState::Receiving, ota.state());
+    ota.abort(OtaTransport::Mqtt);
+}
+
+static void test_signed_image_selected_for_boot(void) {
+    Bytes image = firmware(10000, 9);
+    uint8_t digest[SHA256_SIZE];
+    uint8_t signature[SHA256_SIZE];
+    digest_of(image, digest);
+    ota_sign(KEY, (uint32_t)image.size(), digest, false, signature);
+
+    OtaUpdate ota(KEY);
+    TEST_ASSERT_EQUAL(OtaError::None, ota.begin(OtaTransport::Mqtt, image.size(), digest, false, signature));
+    TEST_ASSERT_EQUAL(OtaError::None, send(ota, image, 1024));
+    TEST_ASSERT_EQUAL(OtaState::Ready, ota.state());
+
+    const esp_partition_t* target = esp_ota_get_boot_partition();
+    TEST_ASSERT_TRUE(target != esp_ota_get_running_partition());
+    Bytes written(image.size());
+    esp_partition_read(target, 0, written.data(), written.size());
+    TEST_ASSERT_TRUE(written == image);
+    esp_ota_set_boot_partition(esp_ota_get_running_partition());
+}
+
+// Патч против работающего слота: проверка исходного образа (1 МБ) идёт
+// по куску на write(), остаток дочитывает finish().
+static void test_signed_patch_selected_for_boot(void) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    Bytes source(1 << 20);
+    esp_partition_read(running, 0, source.data(), source.size());
+
+    Bytes inserted = firmware(2000, 10);
+    Bytes expected = inserted;
+    expected.insert(expected.end(), source.begin(), source.begin() + 30000);
+    Bytes patch = patch_header(source, (uint32_t)expected.size());
+    op_insert(patch, inserted);
+    op_copy(patch, 0, 30000);
+
+    uint8_t digest[SHA256_SIZE];
+    uint8_t signature[SHA256_SIZE];
+    digest_of(expected, digest);
+    ota_sign(KEY, (uint32_t)patch.size(), digest, true, signature);
+
+    OtaUpdate ota(KEY);
+    TEST_ASSERT_EQUAL(OtaError::None, ota.begin(OtaTransport::Mqtt, patch.size(), digest, true, signature));
+    TEST_ASSERT_EQUAL(OtaError::None, send(ota, patch, 512));
+    TEST_ASSERT_EQUAL(OtaState::Ready, ota.state());
+
+    Bytes written(expected.size());
+    esp_partition_read(esp_ota_get_boot_partition(), 0, written.data(), written.size());
+    TEST_ASSERT_TRUE(written == expected);
+    esp_ota_set_boot_partition(running);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_patch_any_chunking);
+    RUN_TEST(test_source_check_is_incremental);
+    RUN_TEST(test_wrong_source_rejected);
+    RUN_TEST(test_range_and_format_errors);
+    RUN_TEST(test_hmac_sha256_vectors);
+    RUN_TEST(test_unsigned_update_rejected);
+    RUN_TEST(test_signed_image_selected_for_boot);
+    RUN_TEST(test_signed_patch_selected_for_boot);
+    return UNITY_END();
+}
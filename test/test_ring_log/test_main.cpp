@@ -0,0 +1,172 @@
+// RingLog в памяти: заголовок пишется пачками, перезагрузка теряет не больше
+// пачки и никогда не читает перезаписанные записи.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/MQTT/src/ring_log.hpp"
+
+static const uint32_t CAPACITY = 4096;
+
+struct MemoryStorage : LogStorage {
+    uint8_t bytes[CAPACITY];
+    uint32_t flushes = 0;
+
+    bool read(uint32_t offset, void* data, size_t length) override {
+        if (offset + length > CAPACITY) {
+            return false;
+        }
+        memcpy(data, bytes + offset, length);
+        return true;
+    }
+    bool write(uint32_t offset, const void* data, size_t length) override {
+        if (offset + length > CAPACITY) {
+            return false;
+        }
+        memcpy(bytes + offset, data, length);
+        return true;
+    }
+    void flush() override { flushes++; }
+};
+
+static MemoryStorage storage;
+
+static OutboundMessage message(uint32_t number, size_t length = 40) {
+    OutboundMessage result;
+    uint8_t payload[MQTT_QUEUE_PAYLOAD_SIZE];
+    memset(payload, (uint8_t)number, length);
+    memcpy(payload, &number, sizeof(number));
+    result.set("sensors/test", payload, length, 1);
+    return result;
+}
+
+static uint32_t number_of(const OutboundMessage& message) {
+    uint32_t number;
+    memcpy(&number, message.payload, sizeof(number));
+    return number;
+}
+
+void setUp(void) {
+    memset(storage.bytes, 0xFF, sizeof(storage.bytes));
+    storage.flushes = 0;
+}
+
+void tearDown(void) {}
+
+static void test_header_written_in_batches(void) {
+    RingLog log(storage, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    uint32_t initial = storage.flushes;
+    for (uint32_t i = 0; i < 40; i++) {
+        TEST_ASSERT_TRUE(log.push(message(i)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(40 / RING_LOG_SYNC_EVERY, storage.flushes - initial);
+    log.commit();
+    log.commit();  // без изменений - без записи
+    TEST_ASSERT_EQUAL_UINT32(40 / RING_LOG_SYNC_EVERY + 1, storage.flushes - initial);
+}
+
+static void test_reboot_after_commit_keeps_everything(void) {
+    {
+        RingLog log(storage, CAPACITY);
+        log.begin();
+        for (uint32_t i = 0; i < 20; i++) {
+            log.push(message(i));
+        }
+        OutboundMessage out;
+        for (uint32_t i = 0; i < 5; i++) {
+            TEST_ASSERT_TRUE(log.peek(out));
+            log.pop();
+        }
+        log.commit();
+    }
+    RingLog log(storage, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_EQUAL(15, log.count());
+    OutboundMessage out;
+    TEST_ASSERT_TRUE(log.peek(out));
+    TEST_ASSERT_EQUAL_UINT32(5, number_of(out));
+}
+
+static void test_reboot_without_commit_loses_at_most_a_batch(void) {
+    {
+        RingLog log(storage, CAPACITY);
+        log.begin();
+        for (uint32_t i = 0; i < 20; i++) {
+            log.push(message(i));
+        }
+    }
+    RingLog log(storage, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_EQUAL(RING_LOG_SYNC_EVERY, log.count());
+    TEST_ASSERT_EQUAL_UINT32(0, log.corrupted());
+}
+
+static void test_reuse_of_popped_space_syncs_first(void) {
+    // Лог заполняется, начало читается без commit, затем новые записи
+    // занимают освобождённое место: после перезагрузки записи на flash целы.
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    {
+        RingLog log(storage, CAPACITY);
+        log.begin();
+        while (log.push(message(pushed, 120))) {
+            pushed++;
+        }
+        log.commit();
+        OutboundMessage out;
+        for (uint32_t i = 0; i < 4; i++) {
+            TEST_ASSERT_TRUE(log.peek(out));
+            log.pop();
+            popped++;
+        }
+        while (log.push(message(pushed, 120))) {
+            pushed++;
+        }
+    }
+    RingLog log(storage, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    OutboundMessage out;
+    uint32_t expected = number_of(message(0));
+    bool first = true;
+    uint32_t read = 0;
+    while (log.peek(out)) {
+        uint32_t number = number_of(out);
+        if (first) {
+            TEST_ASSERT_LESS_OR_EQUAL(popped, number);
+            expected = number;
+            first = false;
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected, number);
+        expected++;
+        read++;
+        log.pop();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, log.corrupted());
+    TEST_ASSERT_GREATER_THAN(0, read);
+    TEST_ASSERT_LESS_OR_EQUAL(pushed, expected);
+    TEST_ASSERT_GREATER_OR_EQUAL(pushed - RING_LOG_SYNC_EVERY, expected);
+}
+
+static void test_torn_record_resets_log(void) {
+    RingLog log(storage, CAPACITY);
+    log.begin();
+    log.push(message(1));
+    log.commit();
+    storage.bytes[40] ^= 0xFF;  // внутри первой записи
+
+    RingLog reopened(storage, CAPACITY);
+    TEST_ASSERT_TRUE(reopened.begin());
+    OutboundMessage out;
+    TEST_ASSERT_FALSE(reopened.peek(out));
+    TEST_ASSERT_EQUAL_UINT32(1, reopened.corrupted());
+    TEST_ASSERT_EQUAL(0, reopened.count());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_header_written_in_batches);
+    RUN_TEST(test_reboot_after_commit_keeps_everything);
+    RUN_TEST(test_reboot_without_commit_loses_at_most_a_batch);
+    RUN_TEST(test_reuse_of_popped_space_syncs_first);
+    RUN_TEST(test_torn_record_resets_log);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+// SampleAggregator на известных окнах: min/max/среднее/число точно,
+// процентили - с точностью корзины.
+#include <unity.h>
+#include "../../src/shared/sample_aggregator.hpp"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_empty_window(void) {
+    SampleAggregator<> aggregator;
+    SampleStats stats;
+    TEST_ASSERT_FALSE(aggregator.snapshot(stats));
+    TEST_ASSERT_EQUAL_UINT32(0, aggregator.count());
+    TEST_ASSERT_EQUAL_UINT16(0, aggregator.percentile(50));
+}
+
+static void test_known_values(void) {
+    SampleAggregator<> aggregator;
+    const uint16_t values[] = { 100, 4000, 250, 1200, 7, 3333, 2048, 999 };
+    aggregator.add(values, sizeof(values) / sizeof(values[0]));
+
+    SampleStats stats;
+    TEST_ASSERT_TRUE(aggregator.snapshot(stats));
+    TEST_ASSERT_EQUAL_UINT32(8, stats.count);
+    TEST_ASSERT_EQUAL_UINT16(7, stats.min);
+    TEST_ASSERT_EQUAL_UINT16(4000, stats.max);
+    // (100 + 4000 + 250 + 1200 + 7 + 3333 + 2048 + 999) / 8 = 1492.125
+    TEST_ASSERT_EQUAL_UINT16(1492, stats.mean);
+}
+
+static void test_mean_rounds_to_nearest(void) {
+    SampleAggregator<> aggregator;
+    aggregator.add(1);
+    aggregator.add(2);
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.mean);  // 1.5
+    aggregator.add(2);
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.mean);  // 1.67
+    aggregator.add(1);
+    aggregator.add(1);
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.mean);  // 1.4
+}
+
+// 0..999: процентиль попадает в свою корзину шириной 16.
+static void test_percentiles_within_bucket(void) {
+    SampleAggregator<> aggregator;
+    for (uint16_t value = 0; value < 1000; value++) {
+        aggregator.add(value);
+    }
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT32(1000, stats.count);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.min);
+    TEST_ASSERT_EQUAL_UINT16(999, stats.max);
+    TEST_ASSERT_EQUAL_UINT16(500, stats.mean);  // 499.5
+    TEST_ASSERT_UINT16_WITHIN(16, 499, stats.p50);
+    TEST_ASSERT_UINT16_WITHIN(16, 899, stats.p90);
+    TEST_ASSERT_UINT16_WITHIN(16, 989, stats.p99);
+    TEST_ASSERT_EQUAL_UINT16(stats.max, aggregator.percentile(100));
+}
+
+// Одно значение: процентили ограничены фактическими min/max, а не серединой корзины.
+static void test_constant_window(void) {
+    SampleAggregator<> aggregator;
+    for (int i = 0; i < 50; i++) {
+        aggregator.add(1234);
+    }
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT16(1234, stats.min);
+    TEST_ASSERT_EQUAL_UINT16(1234, stats.max);
+    TEST_ASSERT_EQUAL_UINT16(1234, stats.mean);
+    TEST_ASSERT_EQUAL_UINT16(1234, stats.p50);
+    TEST_ASSERT_EQUAL_UINT16(1234, stats.p99);
+}
+
+static void test_clamps_to_max_value(void) {
+    SampleAggregator<4, 1023> aggregator;
+    aggregator.add(5000);
+    aggregator.add(1023);
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT16(1023, stats.max);
+    TEST_ASSERT_EQUAL_UINT16(1023, stats.mean);
+}
+
+static void test_reset_starts_new_window(void) {
+    SampleAggregator<> aggregator;
+    aggregator.add(4095);
+    aggregator.add(0);
+    aggregator.reset();
+    aggregator.add(10);
+    aggregator.add(20);
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.count);
+    TEST_ASSERT_EQUAL_UINT16(10, stats.min);
+    TEST_ASSERT_EQUAL_UINT16(20, stats.max);
+    TEST_ASSERT_EQUAL_UINT16(15, stats.mean);
+}
+
+// Сумма окна больше 2^32: среднее не переполняется.
+static void test_large_window_mean(void) {
+    SampleAggregator<> aggregator;
+    const uint32_t count = 2000000;  // 2e6 * 4095 > 2^32
+    for (uint32_t i = 0; i < count; i++) {
+        aggregator.add(4095);
+    }
+    aggregator.add(0);
+    SampleStats stats;
+    aggregator.snapshot(stats);
+    TEST_ASSERT_EQUAL_UINT32(count + 1, stats.count);
+    TEST_ASSERT_EQUAL_UINT16(4095, stats.mean);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.min);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_known_values);
+    RUN_TEST(test_mean_rounds_to_nearest);
+    RUN_TEST(test_percentiles_within_bucket);
+    RUN_TEST(test_constant_window);
+    RUN_TEST(test_clamps_to_max_value);
+    RUN_TEST(test_reset_starts_new_window);
+    RUN_TEST(test_large_window_mean);
+    return UNITY_END();
+}
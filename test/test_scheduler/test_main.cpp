@@ -0,0 +1,295 @@
+// TimerWheel на подставных часах: порядок срабатывания через границы уровней,
+// снятие, перепостановка из обработчика, untilNext() и переход через 2^32 мс.
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../src/shared/scheduler.hpp"
+
+static uint32_t fakeNow;
+
+static unsigned long fake_clock() {
+    return fakeNow;
+}
+
+typedef Scheduler<32> Wheel;
+
+struct Fired {
+    uint32_t at;
+    intptr_t tag;
+};
+
+static Fired fired[256];
+static size_t firedCount;
+
+static void record(void* context) {
+    TEST_ASSERT_TRUE(firedCount < sizeof(fired) / sizeof(fired[0]));
+    fired[firedCount].at = fakeNow;
+    fired[firedCount].tag = (intptr_t)context;
+    firedCount++;
+}
+
+static void* tag(intptr_t value) {
+    return (void*)value;
+}
+
+// Спит ровно untilNext(), как цикл на устройстве, пока не наберётся count
+// срабатываний. Заниженный untilNext() только добавит холостой run(),
+// завышенный - сдвинет срабатывание, и проверка времени его поймает.
+static void drive(TimerWheel& wheel, size_t count) {
+    for (unsigned guard = 0; firedCount < count; guard++) {
+        TEST_ASSERT_TRUE_MESSAGE(guard < 10000, "wheel stalled");
+        uint32_t wait = wheel.untilNext();
+        TEST_ASSERT_TRUE(wait != SCHEDULER_IDLE);
+        fakeNow += wait;
+        wheel.run();
+    }
+}
+
+// Задержки по обе стороны границ уровней: 64 мс, 4096 мс, 262144 мс.
+static const uint32_t DELAYS[] = { 1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 262143, 262144, 262145, 1000000 };
+static const size_t DELAY_COUNT = sizeof(DELAYS) / sizeof(DELAYS[0]);
+
+void setUp(void) {
+    fakeNow = 12345;  // не на границе слотов
+    firedCount = 0;
+}
+
+void tearDown(void) {}
+
+static void test_order_across_levels(void) {
+    Wheel wheel(fake_clock);
+    uint32_t start = fakeNow;
+    // В обратном порядке, чтобы порядок в слотах не совпал с порядком сроков.
+    for (size_t i = DELAY_COUNT; i-- > 0;) {
+        TEST_ASSERT_TRUE(wheel.after(DELAYS[i], record, tag(i)) != NO_JOB);
+    }
+    drive(wheel, DELAY_COUNT);
+    for (size_t i = 0; i < DELAY_COUNT; i++) {
+        TEST_ASSERT_EQUAL_INT(i, fired[i].tag);
+        TEST_ASSERT_EQUAL_UINT32(start + DELAYS[i], fired[i].at);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.active());
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, wheel.untilNext());
+}
+
+// Один run() после долгого сна выполняет всё наступившее в порядке сроков
+// и не трогает то, что ещё впереди.
+static void test_long_sleep_runs_in_order(void) {
+    Wheel wheel(fake_clock);
+    for (size_t i = DELAY_COUNT; i-- > 0;) {
+        wheel.after(DELAYS[i], record, tag(i));
+    }
+    fakeNow += 262144;
+    uint32_t wait = wheel.run();
+    TEST_ASSERT_EQUAL_UINT32(DELAY_COUNT - 2, firedCount);
+    for (size_t i = 0; i < firedCount; i++) {
+        TEST_ASSERT_EQUAL_INT(i, fired[i].tag);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, wait);
+    TEST_ASSERT_EQUAL_UINT32(2, wheel.active());
+}
+
+// Дальше MAX_DELAY задача ставится на максимум и всё равно срабатывает в срок.
+static void test_delay_beyond_wheel(void) {
+    Wheel wheel(fake_clock);
+    uint32_t start = fakeNow;
+    uint32_t delay = TimerWheel::MAX_DELAY * 3 + 777;
+    wheel.after(delay, record, tag(1));
+    wheel.after(TimerWheel::MAX_DELAY + 1, record, tag(0));
+    drive(wheel, 2);
+    TEST_ASSERT_EQUAL_INT(0, fired[0].tag);
+    TEST_ASSERT_EQUAL_UINT32(start + TimerWheel::MAX_DELAY + 1, fired[0].at);
+    TEST_ASSERT_EQUAL_UINT32(start + delay, fired[1].at);
+}
+
+static Wheel* cancelWheel;
+static JobId rivals[2];
+
+// Две задачи одного слота снимают друг друга: срабатывает ровно одна.
+static void cancel_other(void* context) {
+    record(context);
+    TEST_ASSERT_TRUE(cancelWheel->cancel(rivals[1 - (intptr_t)context]));
+}
+
+static void test_cancel(void) {
+    Wheel wheel(fake_clock);
+    JobId near = wheel.after(10, record, tag(1));
+    JobId far = wheel.after(5000, record, tag(2));
+    JobId periodic = wheel.every(100, record, tag(3));
+    TEST_ASSERT_TRUE(wheel.cancel(far));
+    TEST_ASSERT_FALSE(wheel.cancel(far));
+    TEST_ASSERT_FALSE(wheel.scheduled(far));
+    TEST_ASSERT_TRUE(wheel.cancel(periodic));
+    TEST_ASSERT_FALSE(wheel.cancel(NO_JOB));
+
+    // Слот снятой задачи переиспользован: старый id нового не снимает.
+    JobId reused = wheel.after(20, record, tag(4));
+    TEST_ASSERT_TRUE(reused != far && reused != periodic);
+    TEST_ASSERT_FALSE(wheel.cancel(far));
+    TEST_ASSERT_FALSE(wheel.cancel(periodic));
+    TEST_ASSERT_TRUE(wheel.scheduled(reused));
+
+    fakeNow += 10000;
+    wheel.run();
+    TEST_ASSERT_EQUAL_UINT32(2, firedCount);
+    TEST_ASSERT_EQUAL_INT(1, fired[0].tag);
+    TEST_ASSERT_EQUAL_INT(4, fired[1].tag);
+    TEST_ASSERT_FALSE(wheel.cancel(near));  // уже сработала
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.active());
+
+    // Из обработчика можно снять задачу того же слота.
+    cancelWheel = &wheel;
+    rivals[0] = wheel.after(5, cancel_other, tag(0));
+    rivals[1] = wheel.after(5, cancel_other, tag(1));
+    JobId later = wheel.after(6, record, tag(7));
+    fakeNow += 6;
+    wheel.run();
+    TEST_ASSERT_EQUAL_UINT32(4, firedCount);
+    TEST_ASSERT_TRUE(fired[2].tag == 0 || fired[2].tag == 1);
+    TEST_ASSERT_EQUAL_INT(7, fired[3].tag);
+    TEST_ASSERT_FALSE(wheel.scheduled(later));
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.active());
+}
+
+static Wheel* rearmWheel;
+static JobId rearmId;
+static unsigned rearmCount;
+
+// Однократная задача ставит себя снова - каждый раз на другой уровень.
+static void rearm_after(void* context) {
+    record(context);
+    static const uint32_t next[] = { 63, 64, 5000, 1 };
+    if (rearmCount < sizeof(next) / sizeof(next[0])) {
+        rearmId = rearmWheel->after(next[rearmCount++], rearm_after, context);
+        TEST_ASSERT_TRUE(rearmId != NO_JOB);
+    }
+}
+
+// Периодическая переносит себя: период сохраняется от нового срока.
+static void rearm_reschedule(void* context) {
+    record(context);
+    if (rearmCount++ == 0) {
+        TEST_ASSERT_TRUE(rearmWheel->reschedule(rearmId, 1000));
+    }
+}
+
+static void test_rearm_from_callback(void) {
+    Wheel wheel(fake_clock);
+    rearmWheel = &wheel;
+    rearmCount = 0;
+    uint32_t start = fakeNow;
+    rearmId = wheel.after(10, rearm_after, tag(1));
+    drive(wheel, 5);
+    const uint32_t expected[] = { 10, 73, 137, 5137, 5138 };
+    for (size_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT32(start + expected[i], fired[i].at);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.active());
+
+    firedCount = 0;
+    rearmCount = 0;
+    start = fakeNow;
+    rearmId = wheel.every(100, rearm_reschedule, tag(2));
+    drive(wheel, 3);
+    TEST_ASSERT_EQUAL_UINT32(start + 100, fired[0].at);
+    TEST_ASSERT_EQUAL_UINT32(start + 1100, fired[1].at);
+    TEST_ASSERT_EQUAL_UINT32(start + 1200, fired[2].at);
+    TEST_ASSERT_TRUE(wheel.cancel(rearmId));
+}
+
+// Периодическая после долгой паузы не догоняет пропущенные запуски.
+static void test_periodic_skips_missed_periods(void) {
+    Wheel wheel(fake_clock);
+    uint32_t start = fakeNow;
+    wheel.every(100, record, tag(1), 30);
+    fakeNow = start + 30;
+    wheel.run();
+    fakeNow = start + 555;
+    wheel.run();
+    TEST_ASSERT_EQUAL_UINT32(2, firedCount);
+    TEST_ASSERT_EQUAL_UINT32(75, wheel.untilNext());  // следующий - start + 130 + 500
+    drive(wheel, 3);
+    TEST_ASSERT_EQUAL_UINT32(start + 630, fired[2].at);
+}
+
+static void test_until_next(void) {
+    Wheel wheel(fake_clock);
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, wheel.untilNext());
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, wheel.run());
+
+    // Ближайший срок точен на любом уровне, независимо от порядка постановки.
+    for (size_t i = DELAY_COUNT; i-- > 0;) {
+        Wheel single(fake_clock);
+        single.after(DELAYS[i], record);
+        TEST_ASSERT_EQUAL_UINT32(DELAYS[i], single.untilNext());
+        fakeNow += 3;
+        TEST_ASSERT_EQUAL_UINT32(DELAYS[i] > 3 ? DELAYS[i] - 3 : 0, single.untilNext());
+        fakeNow -= 3;
+    }
+
+    wheel.after(5000, record, tag(1));
+    wheel.after(300, record, tag(2));
+    TEST_ASSERT_EQUAL_UINT32(300, wheel.untilNext());
+    fakeNow += 299;
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.run());
+    fakeNow += 1;
+    TEST_ASSERT_EQUAL_UINT32(4700, wheel.run());
+    // Часы ушли вперёд без run(): пора уже сейчас, не "через 2^32".
+    fakeNow += 4800;
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.untilNext());
+    TEST_ASSERT_EQUAL_UINT32(SCHEDULER_IDLE, wheel.run());
+    TEST_ASSERT_EQUAL_UINT32(2, firedCount);
+
+    // Задача с нулевой задержкой - не раньше чем через 1 мс.
+    wheel.after(0, record, tag(3));
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.untilNext());
+    wheel.run();
+    TEST_ASSERT_EQUAL_UINT32(2, firedCount);
+}
+
+// millis() переполняется через ~49.7 суток: сроки по ту сторону 2^32
+// срабатывают в том же порядке и вовремя.
+static void test_rollover(void) {
+    const uint32_t starts[] = { 0xFFFFFFFFUL - 100, 0xFFFFFFFFUL, 0xFFFFFFFFUL - 262144 + 7 };
+    for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+        fakeNow = starts[s];
+        firedCount = 0;
+        Wheel wheel(fake_clock);
+        uint32_t start = fakeNow;
+        for (size_t i = DELAY_COUNT; i-- > 0;) {
+            wheel.after(DELAYS[i], record, tag(i));
+        }
+        drive(wheel, DELAY_COUNT);
+        for (size_t i = 0; i < DELAY_COUNT; i++) {
+            TEST_ASSERT_EQUAL_INT(i, fired[i].tag);
+            TEST_ASSERT_EQUAL_UINT32((uint32_t)(start + DELAYS[i]), fired[i].at);
+        }
+    }
+
+    // Периодическая через переход, в том числе одним длинным run().
+    fakeNow = 0xFFFFFFFFUL - 150;
+    firedCount = 0;
+    Wheel wheel(fake_clock);
+    wheel.every(64, record, tag(1));
+    drive(wheel, 4);
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT32((uint32_t)(0xFFFFFFFFUL - 150 + 64 * (i + 1)), fired[i].at);
+    }
+    TEST_ASSERT_EQUAL_UINT32(64, wheel.untilNext());
+    fakeNow += 64 * 10 + 5;
+    TEST_ASSERT_EQUAL_UINT32(59, wheel.run());
+    TEST_ASSERT_EQUAL_UINT32(5, firedCount);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_order_across_levels);
+    RUN_TEST(test_long_sleep_runs_in_order);
+    RUN_TEST(test_delay_beyond_wheel);
+    RUN_TEST(test_cancel);
+    RUN_TEST(test_rearm_from_callback);
+    RUN_TEST(test_periodic_skips_missed_periods);
+    RUN_TEST(test_until_next);
+    RUN_TEST(test_rollover);
+    return UNITY_END();
+}
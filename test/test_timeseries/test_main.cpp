@@ -0,0 +1,193 @@
+// TimeSeriesBlock/TimeSeriesReader на случайных рядах: всё записанное
+// читается обратно бит в бит, испорченный блок не читается за пределы буфера.
+// Ряды детерминированы (xorshift с фиксированным зерном); под ASan/UBSan -
+// с -fsanitize=address,undefined в build_flags env:test.
+#include <unity.h>
+#include <string.h>
+#include "../../src/shared/timeseries.hpp"
+#include "../../src/shared/crc32.hpp"
+
+static const int ROUNDS = 2000;
+static const size_t MAX_BLOCK = 512;
+static const size_t MAX_SAMPLES = 4096;
+
+static uint32_t state;
+
+static uint32_t random32() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static uint32_t random_below(uint32_t limit) {
+    return random32() % limit;
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Шаг времени: ровный опрос, дрожание, пропуски, скачки на весь диапазон.
+static uint32_t next_step(uint32_t step) {
+    switch (random_below(6)) {
+        case 0:  return step;
+        case 1:  return step + random_below(129) - 64;
+        case 2:  return step + random_below(513) - 256;
+        case 3:  return step + random_below(4097) - 2048;
+        case 4:  return random32();
+        default: return step * 2;
+    }
+}
+
+// Значение: то же, медленный дрейф, случайные биты (NaN, бесконечности, денормали).
+static uint32_t next_value(uint32_t bits) {
+    switch (random_below(5)) {
+        case 0:  return bits;
+        case 1:  return float_bits(bits_float(bits) + 0.25f);
+        case 2:  return bits ^ (1U << random_below(32));
+        case 3:  return bits ^ (random32() & 0xFFFF);
+        default: return random32();
+    }
+}
+
+struct Sample {
+    uint32_t time;
+    uint32_t value;
+};
+
+static Sample samples[MAX_SAMPLES];
+static uint8_t storage[MAX_BLOCK];
+
+// Пишет случайный ряд в блок случайной ёмкости; возвращает число принятых выборок.
+static size_t fill(TimeSeriesBlock& block) {
+    uint32_t time = random32();
+    uint32_t step = random_below(100000);
+    uint32_t value = random32();
+    size_t count = 0;
+    while (count < MAX_SAMPLES) {
+        if (!block.append(time, bits_float(value))) {
+            break;
+        }
+        samples[count].time = time;
+        samples[count].value = value;
+        count++;
+        step = next_step(step);
+        time += step;
+        value = next_value(value);
+    }
+    return count;
+}
+
+static void expect_samples(TimeSeriesReader& reader, size_t count) {
+    TEST_ASSERT_TRUE(reader.valid());
+    TEST_ASSERT_EQUAL_UINT32(count, reader.count());
+    for (size_t i = 0; i < count; i++) {
+        uint32_t time;
+        float value;
+        TEST_ASSERT_TRUE(reader.next(time, value));
+        TEST_ASSERT_EQUAL_HEX32(samples[i].time, time);
+        TEST_ASSERT_EQUAL_HEX32(samples[i].value, float_bits(value));
+    }
+    uint32_t time;
+    float value;
+    TEST_ASSERT_FALSE(reader.next(time, value));
+}
+
+void setUp(void) {
+    state = 0x9E3779B9;
+}
+
+void tearDown(void) {}
+
+static void test_random_series_round_trip(void) {
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t capacity = TIMESERIES_MIN_BLOCK + random_below(MAX_BLOCK - TIMESERIES_MIN_BLOCK + 1);
+        TimeSeriesBlock block(storage, capacity);
+        size_t count = fill(block);
+        TEST_ASSERT_TRUE(count > 0);
+        TEST_ASSERT_EQUAL_UINT32(count, block.count());
+        TEST_ASSERT_TRUE(block.size() <= capacity);
+
+        TimeSeriesReader open(block);
+        expect_samples(open, count);
+
+        size_t length = block.seal();
+        TEST_ASSERT_EQUAL_UINT32(block.size(), length);
+        TEST_ASSERT_FALSE(block.append(0, 0.0f));
+
+        // Копия ровно по длине: чтение за концом блока поймает ASan.
+        uint8_t* copy = new uint8_t[length];
+        memcpy(copy, block.data(), length);
+        TimeSeriesReader sealed(copy, length);
+        expect_samples(sealed, count);
+        delete[] copy;
+    }
+}
+
+static void test_corrupted_blocks_are_rejected(void) {
+    for (int round = 0; round < ROUNDS; round++) {
+        TimeSeriesBlock block(storage, TIMESERIES_MIN_BLOCK + random_below(MAX_BLOCK - TIMESERIES_MIN_BLOCK + 1));
+        fill(block);
+        size_t length = block.seal();
+        uint8_t* copy = new uint8_t[length];
+        memcpy(copy, block.data(), length);
+
+        size_t cut = random_below(length);
+        copy[random_below(length)] ^= 1 << random_below(8);
+        TimeSeriesReader flipped(copy, length);
+        TEST_ASSERT_FALSE(flipped.valid());
+        TimeSeriesReader truncated(copy, cut);
+        TEST_ASSERT_FALSE(truncated.valid());
+        delete[] copy;
+    }
+}
+
+// Мусор с верными заголовком и CRC: разбор битов идёт до конца и не выходит
+// за буфер, сколько бы выборок ни обещал count.
+static void test_garbage_with_valid_crc(void) {
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t length = TIMESERIES_HEADER_SIZE + TIMESERIES_CRC_SIZE + random_below(64);
+        uint8_t* block = new uint8_t[length];
+        for (size_t i = 0; i < length; i++) {
+            block[i] = random32() & 0xFF;
+        }
+        block[0] = TIMESERIES_MAGIC;
+        block[1] = TIMESERIES_VERSION;
+        size_t body = length - TIMESERIES_CRC_SIZE;
+        uint32_t crc = crc32(block, body);
+        block[body] = crc & 0xFF;
+        block[body + 1] = (crc >> 8) & 0xFF;
+        block[body + 2] = (crc >> 16) & 0xFF;
+        block[body + 3] = (crc >> 24) & 0xFF;
+
+        TimeSeriesReader reader(block, length);
+        TEST_ASSERT_TRUE(reader.valid());
+        uint32_t time;
+        float value;
+        size_t read = 0;
+        while (reader.next(time, value)) {
+            read++;
+        }
+        TEST_ASSERT_TRUE(read <= reader.count());
+        // Каждая выборка после первой - не меньше двух битов.
+        TEST_ASSERT_TRUE(read <= 1 + (body - TIMESERIES_HEADER_SIZE) * 4);
+        delete[] block;
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_random_series_round_trip);
+    RUN_TEST(test_corrupted_blocks_are_rejected);
+    RUN_TEST(test_garbage_with_valid_crc);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+// TopicRouter: точные фильтры, '+', '#', "a/#" на самом "a", исчерпание узлов
+// и маршрутов, топики '$...' против шаблонов первого уровня. topic_matches()
+// проверяется на тех же парах - правила у них общие.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/MQTT/src/topic_router.hpp"
+
+struct Hits {
+    unsigned count;
+    char topic[64];
+};
+
+static void on_topic(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    Hits* hits = (Hits*)context;
+    hits->count++;
+    strncpy(hits->topic, topic, sizeof(hits->topic) - 1);
+    TEST_ASSERT_EQUAL_UINT32(2, length);
+    TEST_ASSERT_EQUAL_MEMORY("ok", payload, 2);
+}
+
+static unsigned dispatch_one(const char* filter, const char* topic) {
+    TopicRouter<4, 16> router;
+    Hits hits = {};
+    TEST_ASSERT_TRUE_MESSAGE(router.add(filter, on_topic, &hits), filter);
+    unsigned handled = router.dispatch(topic, (const uint8_t*)"ok", 2);
+    TEST_ASSERT_EQUAL_UINT32(handled, hits.count);
+    return handled;
+}
+
+struct Case {
+    const char* filter;
+    const char* topic;
+    bool matches;
+};
+
+static const Case CASES[] = {
+    { "a/b/c", "a/b/c", true },
+    { "a/b/c", "a/b", false },
+    { "a/b", "a/b/c", false },
+    { "a/b/c", "a/x/c", false },
+    { "a/b", "a/bc", false },
+    { "a/", "a/", true },
+    { "a/", "a", false },
+    { "a", "a/", false },
+    { "/a", "/a", true },
+    { "+/b", "a/b", true },
+    { "a/+", "a/b", true },
+    { "a/+", "a/", true },  // пустой уровень - тоже уровень
+    { "a/+", "a", false },
+    { "a/+", "a/b/c", false },
+    { "+/+", "/", true },
+    { "+", "a", true },
+    { "+", "a/b", false },
+    { "a/+/c", "a/b/c", true },
+    { "a/+/c", "a/b/d", false },
+    { "#", "a", true },
+    { "#", "a/b/c", true },
+    { "#", "/", true },
+    { "a/#", "a/b/c", true },
+    { "a/#", "a", true },  // родительский уровень
+    { "a/#", "a/", true },
+    { "a/#", "ab", false },
+    { "a/#", "b/a", false },
+    { "a/b/#", "a", false },
+    { "+/#", "a", true },
+    { "a/+/#", "a/b", true },
+    { "a/+/#", "a", false },
+    // '$...' не совпадают с шаблоном на первом уровне, но точный фильтр работает.
+    { "#", "$SYS/broker/uptime", false },
+    { "+/broker/uptime", "$SYS/broker/uptime", false },
+    { "+", "$SYS", false },
+    { "$SYS/#", "$SYS/broker/uptime", true },
+    { "$SYS/#", "$SYS", true },
+    { "$SYS/+/uptime", "$SYS/broker/uptime", true },
+    { "$SYS/broker/uptime", "$SYS/broker/uptime", true },
+    { "a/#", "a/$b", true },  // '$' не на первом уровне - обычный символ
+    { "a/+", "a/$b", true },
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_filter_matching(void) {
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        char message[128];
+        snprintf(message, sizeof(message), "%s vs %s", CASES[i].filter, CASES[i].topic);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(CASES[i].matches ? 1 : 0, dispatch_one(CASES[i].filter, CASES[i].topic),
+                                         message);
+        TEST_ASSERT_TRUE_MESSAGE(topic_matches(CASES[i].filter, CASES[i].topic) == CASES[i].matches, message);
+    }
+}
+
+// Все подходящие обработчики вызываются по разу, в том числе несколько на одном фильтре.
+static void test_dispatch_to_every_match(void) {
+    TopicRouter<8, 32> router;
+    Hits exact = {}, level = {}, rest = {}, parent = {}, other = {}, again = {};
+    TEST_ASSERT_TRUE(router.add("site/1/status", on_topic, &exact));
+    TEST_ASSERT_TRUE(router.add("site/+/status", on_topic, &level));
+    TEST_ASSERT_TRUE(router.add("#", on_topic, &rest));
+    TEST_ASSERT_TRUE(router.add("site/1/status/#", on_topic, &parent));
+    TEST_ASSERT_TRUE(router.add("site/2/#", on_topic, &other));
+    TEST_ASSERT_TRUE(router.add("site/+/status", on_topic, &again));
+    TEST_ASSERT_EQUAL_UINT32(6, router.routes());
+
+    TEST_ASSERT_EQUAL_UINT32(5, router.dispatch("site/1/status", (const uint8_t*)"ok", 2));
+    TEST_ASSERT_EQUAL_UINT32(1, exact.count);
+    TEST_ASSERT_EQUAL_UINT32(1, level.count);
+    TEST_ASSERT_EQUAL_UINT32(1, rest.count);
+    TEST_ASSERT_EQUAL_UINT32(1, parent.count);
+    TEST_ASSERT_EQUAL_UINT32(0, other.count);
+    TEST_ASSERT_EQUAL_UINT32(1, again.count);
+    TEST_ASSERT_EQUAL_STRING("site/1/status", exact.topic);
+
+    TEST_ASSERT_EQUAL_UINT32(0, router.dispatch("$SYS/x", (const uint8_t*)"ok", 2));
+
+    // Один вызов на уникальный фильтр - для подписки.
+    unsigned filters = 0;
+    router.forEachFilter([&](const char*) {
+        filters++;
+        return true;
+    });
+    TEST_ASSERT_EQUAL_UINT32(5, filters);
+}
+
+// Узел на каждый уникальный уровень плюс корень; общий префикс узлы не тратит.
+static void test_node_capacity(void) {
+    TopicRouter<8, 5> router;
+    Hits hits = {};
+    TEST_ASSERT_TRUE(router.add("a/b", on_topic, &hits));      // корень + 2
+    TEST_ASSERT_FALSE(router.add("x/y/z", on_topic, &hits));   // нужно 3, свободно 2
+    TEST_ASSERT_FALSE(router.add("a/b/c/d/e", on_topic, &hits));
+    TEST_ASSERT_EQUAL_UINT32(1, router.routes());
+
+    // Неудачные добавления не оставили узлов: оба свободных ещё доступны.
+    TEST_ASSERT_TRUE(router.add("a/b/c", on_topic, &hits));
+    TEST_ASSERT_TRUE(router.add("a/d", on_topic, &hits));
+    TEST_ASSERT_FALSE(router.add("e", on_topic, &hits));
+    TEST_ASSERT_TRUE(router.add("a/b/c", on_topic, &hits));  // узел уже есть
+    TEST_ASSERT_EQUAL_UINT32(4, router.routes());
+
+    TEST_ASSERT_EQUAL_UINT32(0, router.dispatch("x/y/z", (const uint8_t*)"ok", 2));
+    TEST_ASSERT_EQUAL_UINT32(2, router.dispatch("a/b/c", (const uint8_t*)"ok", 2));
+    TEST_ASSERT_EQUAL_UINT32(1, router.dispatch("a/d", (const uint8_t*)"ok", 2));
+    TEST_ASSERT_EQUAL_UINT32(1, router.dispatch("a/b", (const uint8_t*)"ok", 2));
+
+    unsigned filters = 0;
+    router.forEachFilter([&](const char*) {
+        filters++;
+        return true;
+    });
+    TEST_ASSERT_EQUAL_UINT32(3, filters);
+}
+
+static void test_route_capacity(void) {
+    TopicRouter<2, 16> router;
+    Hits hits = {};
+    TEST_ASSERT_TRUE(router.add("a", on_topic, &hits));
+    TEST_ASSERT_TRUE(router.add("a", on_topic, &hits));
+    TEST_ASSERT_FALSE(router.add("b", on_topic, &hits));
+    TEST_ASSERT_EQUAL_UINT32(2, router.routes());
+    TEST_ASSERT_EQUAL_UINT32(0, router.dispatch("b", (const uint8_t*)"ok", 2));
+    TEST_ASSERT_EQUAL_UINT32(2, router.dispatch("a", (const uint8_t*)"ok", 2));
+}
+
+static void test_invalid_filters(void) {
+    TopicRouter<8, 16> router;
+    Hits hits = {};
+    const char* const invalid[] = { "", "a/#/b", "a#", "#/", "a+", "+a/b", "a/b+" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(router.add(invalid[i], on_topic, &hits), invalid[i]);
+    }
+    TEST_ASSERT_FALSE(router.add(nullptr, on_topic, &hits));
+    TEST_ASSERT_FALSE(router.add("a", nullptr, &hits));
+
+    // Уровень длиннее 255 байт не помещается в узел.
+    static char longLevel[300];
+    memset(longLevel, 'x', sizeof(longLevel) - 1);
+    TEST_ASSERT_FALSE(router.add(longLevel, on_topic, &hits));
+    TEST_ASSERT_EQUAL_UINT32(0, router.routes());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_filter_matching);
+    RUN_TEST(test_dispatch_to_every_match);
+    RUN_TEST(test_node_capacity);
+    RUN_TEST(test_route_capacity);
+    RUN_TEST(test_invalid_filters);
+    return UNITY_END();
+}
@@ -0,0 +1,49 @@
+// Расшифровывает двоичный лог (src/shared/binlog.hpp) из вывода UART:
+//   g++ -std=c++17 -O2 -Ilib/ArduinoNative/src -o log_decode
+//       tools/log_decode.cpp tools/log_decoder.cpp src/shared/crc32.cpp
+//   ./log_decode capture.bin src lib
+//   pio device monitor --raw | ./log_decode - src lib
+// Строки формата берутся из вызовов LOG_ERROR/WARN/INFO/DEBUG в указанных
+// каталогах исходников: id записи - тот же log_hash() строки. Исходники
+// должны соответствовать прошивке, иначе запись печатается как unknown с
+// сырыми аргументами. Обычный текст между кадрами выводится как есть.
+// Сам разбор - в log_decoder.cpp.
+#include "log_decoder.hpp"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <capture.bin | -> <source dir>...\n", argv[0]);
+        return 2;
+    }
+    LogFormats formats;
+    for (int i = 2; i < argc; i++) {
+        if (!log_scan_tree(argv[i], formats)) {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+        }
+    }
+    fprintf(stderr, "%zu format strings\n", formats.size());
+
+    int input = strcmp(argv[1], "-") == 0 ? 0 : open(argv[1], O_RDONLY);
+    if (input < 0) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    LogDecoder decoder(formats);
+    uint8_t buffer[4096];
+    ssize_t count;
+    std::string text;
+    while ((count = read(input, buffer, sizeof(buffer))) > 0) {
+        decoder.feed(buffer, count, false, text);
+        fwrite(text.data(), 1, text.size(), stdout);
+        fflush(stdout);
+        text.clear();
+    }
+    decoder.feed(nullptr, 0, true, text);
+    fwrite(text.data(), 1, text.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,389 @@
+#include "log_decoder.hpp"
+#include "../src/shared/frame_parser.hpp"
+#include "../src/shared/crc32.hpp"
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static bool read_text(const std::string& path, std::string& out) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.append(buffer, count);
+    }
+    fclose(file);
+    return true;
+}
+
+// Строковый литерал C с позиции i (на кавычке); склеивает соседние литералы.
+static bool parse_literal(const std::string& text, size_t& i, std::string& out) {
+    bool any = false;
+    for (;;) {
+        while (i < text.size() && isspace((unsigned char)text[i])) {
+            i++;
+        }
+        if (i >= text.size() || text[i] != '"') {
+            return any;
+        }
+        i++;
+        while (i < text.size() && text[i] != '"') {
+            char c = text[i++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (i >= text.size()) {
+                return false;
+            }
+            c = text[i++];
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': {
+                    int value = c - '0';
+                    for (int n = 0; n < 2 && i < text.size() && text[i] >= '0' && text[i] <= '7'; n++) {
+                        value = value * 8 + (text[i++] - '0');
+                    }
+                    out += (char)value;
+                    break;
+                }
+                case 'x': {
+                    int value = 0;
+                    while (i < text.size() && isxdigit((unsigned char)text[i])) {
+                        char h = text[i++];
+                        value = value * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+                    }
+                    out += (char)value;
+                    break;
+                }
+                default: out += c; break;
+            }
+        }
+        if (i >= text.size()) {
+            return false;
+        }
+        i++;
+        any = true;
+    }
+}
+
+void log_scan_text(const std::string& text, LogFormats& formats) {
+    static const char* const macros[] = { "LOG_ERROR", "LOG_WARN", "LOG_INFO", "LOG_DEBUG" };
+    for (const char* macro : macros) {
+        size_t length = strlen(macro);
+        for (size_t at = text.find(macro); at != std::string::npos; at = text.find(macro, at + length)) {
+            if (at > 0 && (isalnum((unsigned char)text[at - 1]) || text[at - 1] == '_')) {
+                continue;
+            }
+            size_t i = at + length;
+            while (i < text.size() && isspace((unsigned char)text[i])) {
+                i++;
+            }
+            if (i >= text.size() || text[i] != '(') {
+                continue;
+            }
+            i++;
+            std::string format;
+            if (!parse_literal(text, i, format)) {
+                continue; // определение макроса или формат не литералом
+            }
+            uint32_t id = log_hash(format.c_str());
+            auto known = formats.find(id);
+            if (known != formats.end() && known->second != format) {
+                fprintf(stderr, "hash collision: \"%s\" and \"%s\"\n", known->second.c_str(), format.c_str());
+            }
+            formats[id] = format;
+        }
+    }
+}
+
+bool log_scan_tree(const std::string& path, LogFormats& formats) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        std::string text;
+        if (!read_text(path, text)) {
+            return false;
+        }
+        log_scan_text(text, formats);
+        return true;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string child = path + "/" + name;
+        size_t dot = name.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : name.substr(dot);
+        bool directory = stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+        if (directory || extension == ".cpp" || extension == ".hpp" || extension == ".h" || extension == ".c") {
+            log_scan_tree(child, formats);
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+static bool read_varint(const uint8_t*& data, const uint8_t* end, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = *data++;
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool log_read_args(const uint8_t* data, const uint8_t* end, std::vector<LogValue>& args) {
+    while (data < end) {
+        LogValue arg = {};
+        arg.type = (LogArg)*data++;
+        unsigned long long raw;
+        switch (arg.type) {
+            case LogArg::Signed:
+                if (!read_varint(data, end, raw)) return false;
+                arg.number = (long long)(raw >> 1) ^ -(long long)(raw & 1);
+                arg.unsignedNumber = (unsigned long long)arg.number;
+                arg.real = (double)arg.number;
+                break;
+            case LogArg::Unsigned:
+                if (!read_varint(data, end, raw)) return false;
+                arg.unsignedNumber = raw;
+                arg.number = (long long)raw;
+                arg.real = (double)raw;
+                break;
+            case LogArg::Float: {
+                if (end - data < 4) return false;
+                uint32_t bits = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                arg.real = value;
+                arg.number = (long long)value;
+                arg.unsignedNumber = (unsigned long long)arg.number;
+                data += 4;
+                break;
+            }
+            case LogArg::String: {
+                if (data >= end || end - data - 1 < data[0]) return false;
+                arg.text.assign((const char*)data + 1, data[0]);
+                data += 1 + data[0];
+                break;
+            }
+            case LogArg::Secret:
+                break;
+            default:
+                return false;
+        }
+        args.push_back(arg);
+    }
+    return true;
+}
+
+static std::string describe(const LogValue& arg) {
+    char text[64];
+    switch (arg.type) {
+        case LogArg::Signed:   snprintf(text, sizeof(text), "%lld", arg.number); return text;
+        case LogArg::Unsigned: snprintf(text, sizeof(text), "%llu", arg.unsignedNumber); return text;
+        case LogArg::Float:    snprintf(text, sizeof(text), "%g", arg.real); return text;
+        case LogArg::String:   return arg.text;
+        default:               return "[redacted]";
+    }
+}
+
+std::string log_format_record(const std::string& format, const std::vector<LogValue>& args) {
+    std::string out;
+    size_t next = 0;
+    for (size_t i = 0; i < format.size(); i++) {
+        if (format[i] != '%') {
+            out += format[i];
+            continue;
+        }
+        if (i + 1 < format.size() && format[i + 1] == '%') {
+            out += '%';
+            i++;
+            continue;
+        }
+        std::string spec = "%";
+        size_t j = i + 1;
+        while (j < format.size() && strchr("-+ #0", format[j])) {
+            spec += format[j++];
+        }
+        for (int part = 0; part < 2; part++) {
+            if (part == 1) {
+                if (j >= format.size() || format[j] != '.') break;
+                spec += format[j++];
+            }
+            if (j < format.size() && format[j] == '*') {
+                j++;
+                spec += std::to_string(next < args.size() ? args[next++].number : 0);
+            } else {
+                while (j < format.size() && isdigit((unsigned char)format[j])) {
+                    spec += format[j++];
+                }
+            }
+        }
+        while (j < format.size() && strchr("hlLqjzt", format[j])) {
+            j++;
+        }
+        if (j >= format.size()) {
+            break;
+        }
+        char conversion = format[j];
+        i = j;
+        if (next >= args.size()) {
+            out += "<?>";
+            continue;
+        }
+        const LogValue& arg = args[next++];
+        char text[128];
+        if (arg.type == LogArg::Secret) {
+            out += "[redacted]";
+            continue;
+        }
+        switch (conversion) {
+            case 'd': case 'i':
+                snprintf(text, sizeof(text), (spec + "lld").c_str(), arg.number);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                snprintf(text, sizeof(text), (spec + "ll" + conversion).c_str(), arg.unsignedNumber);
+                break;
+            case 'c':
+                snprintf(text, sizeof(text), (spec + "c").c_str(), (int)arg.number);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                snprintf(text, sizeof(text), (spec + conversion).c_str(), arg.real);
+                break;
+            case 'p':
+                snprintf(text, sizeof(text), "0x%llx", arg.unsignedNumber);
+                break;
+            case 's':
+                snprintf(text, sizeof(text), (spec + "s").c_str(), describe(arg).c_str());
+                break;
+            default:
+                snprintf(text, sizeof(text), "%s", describe(arg).c_str());
+                break;
+        }
+        out += text;
+    }
+    return out;
+}
+
+static const char* const LEVEL_NAMES[] = { "-", "E", "W", "I", "D" };
+
+void log_print_records(const LogFormats& formats, const uint8_t* payload, size_t length, std::string& out) {
+    size_t offset = 0;
+    while (offset < length) {
+        uint8_t size = payload[offset];
+        if (size < 10 || offset + size > length) {
+            out += "[log] malformed record\n";
+            return;
+        }
+        const uint8_t* record = payload + offset;
+        uint8_t level = record[1];
+        uint32_t time = record[2] | (record[3] << 8) | (record[4] << 16) | ((uint32_t)record[5] << 24);
+        uint32_t id = record[6] | (record[7] << 8) | (record[8] << 16) | ((uint32_t)record[9] << 24);
+        offset += size;
+
+        std::vector<LogValue> args;
+        bool valid = log_read_args(record + 10, record + size, args);
+        std::string text;
+        if (id == LOG_ID_DROPPED) {
+            text = "[log] " + (args.empty() ? std::string("?") : describe(args[0])) + " records dropped\n";
+        } else {
+            auto format = formats.find(id);
+            if (format != formats.end()) {
+                text = log_format_record(format->second, args);
+            } else {
+                char unknown[32];
+                snprintf(unknown, sizeof(unknown), "<unknown %08x>", (unsigned)id);
+                text = unknown;
+                for (const LogValue& arg : args) {
+                    text += " " + describe(arg);
+                }
+                text += "\n";
+            }
+        }
+        if (!valid) {
+            text += " <truncated args>\n";
+        }
+        if (text.empty() || text.back() != '\n') {
+            text += '\n';
+        }
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "%10.3f %s ", time / 1000.0, level < 5 ? LEVEL_NAMES[level] : "?");
+        out += prefix;
+        out += text;
+    }
+}
+
+void LogDecoder::feed(const uint8_t* data, size_t length, bool end, std::string& out) {
+    _pending.insert(_pending.end(), data, data + length);
+    size_t at = 0;
+    while (at < _pending.size()) {
+        const uint8_t* sync = (const uint8_t*)memchr(_pending.data() + at, FRAME_SYNC0, _pending.size() - at);
+        size_t start = sync ? sync - _pending.data() : _pending.size();
+        text(at, start, out);
+        at = start;
+        if (at >= _pending.size()) {
+            break;
+        }
+        size_t available = _pending.size() - at;
+        if (available < FRAME_HEADER_SIZE) {
+            if (end) { text(at, _pending.size(), out); at = _pending.size(); }
+            break;
+        }
+        const uint8_t* frame = _pending.data() + at;
+        size_t payload = frame[4] | (frame[5] << 8);
+        if (frame[1] != FRAME_SYNC1 || frame[2] != LOG_FRAME_TYPE || payload > LOG_FRAME_SIZE) {
+            text(at, at + 1, out);
+            at++;
+            continue;
+        }
+        if (available < payload + FRAME_OVERHEAD) {
+            if (end) { text(at, _pending.size(), out); at = _pending.size(); }
+            break;
+        }
+        const uint8_t* crc = frame + FRAME_HEADER_SIZE + payload;
+        uint32_t expected = crc[0] | (crc[1] << 8) | (crc[2] << 16) | ((uint32_t)crc[3] << 24);
+        if (expected != crc32(frame + 2, payload + 4)) {
+            text(at, at + 1, out);
+            at++;
+            continue;
+        }
+        if (_started && frame[3] != _sequence) {
+            char lost[48];
+            snprintf(lost, sizeof(lost), "[log] %u frame(s) lost\n", (unsigned)(uint8_t)(frame[3] - _sequence));
+            out += lost;
+        }
+        _started = true;
+        _sequence = frame[3] + 1;
+        log_print_records(_formats, frame + FRAME_HEADER_SIZE, payload, out);
+        at += payload + FRAME_OVERHEAD;
+    }
+    _pending.erase(_pending.begin(), _pending.begin() + at);
+}
+
+void LogDecoder::text(size_t from, size_t to, std::string& out) const {
+    for (size_t i = from; i < to; i++) {
+        uint8_t c = _pending[i];
+        if (c == '\n' || c == '\t' || (c >= 0x20 && c < 0x7F) || c >= 0x80) {
+            out += (char)c;
+        }
+    }
+}
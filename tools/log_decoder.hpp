@@ -0,0 +1,58 @@
+#ifndef LOG_DECODER_HPP
+#define LOG_DECODER_HPP
+
+// Разбор двоичного лога (src/shared/binlog.hpp) на хосте: строки формата из
+// исходников, аргументы записей, кадры в потоке UART. Общий для
+// tools/log_decode и test/test_binlog; вывод - в строку, печатает вызывающий.
+#include "../src/shared/binlog.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// id записи (log_hash строки формата) -> строка формата.
+typedef std::unordered_map<uint32_t, std::string> LogFormats;
+
+// Находит вызовы LOG_ERROR/WARN/INFO/DEBUG с литералом формата в тексте исходника.
+void log_scan_text(const std::string& text, LogFormats& formats);
+// Файл или каталог рекурсивно (.cpp, .hpp, .h, .c); false - путь не читается.
+bool log_scan_tree(const std::string& path, LogFormats& formats);
+
+struct LogValue {
+    LogArg type;
+    long long number;
+    unsigned long long unsignedNumber;
+    double real;
+    std::string text;
+};
+
+// Аргументы записи после заголовка; false - последний обрезан или тип неизвестен
+// (то, что разобралось до него, остаётся в args).
+bool log_read_args(const uint8_t* data, const uint8_t* end, std::vector<LogValue>& args);
+
+// printf по разобранным аргументам: модификаторы длины не важны, тип берётся
+// из записи, а спецификатор задаёт только вид.
+std::string log_format_record(const std::string& format, const std::vector<LogValue>& args);
+
+// Записи из payload кадра, по строке на запись: "время уровень текст".
+void log_print_records(const LogFormats& formats, const uint8_t* payload, size_t length, std::string& out);
+
+// Кадры ищутся в потоке по синхробайтам; всё, что не кадр, - обычный текст.
+class LogDecoder {
+public:
+    explicit LogDecoder(const LogFormats& formats) : _formats(formats) {}
+
+    // end - потока больше не будет: недописанный хвост выводится как текст.
+    void feed(const uint8_t* data, size_t length, bool end, std::string& out);
+
+private:
+    void text(size_t from, size_t to, std::string& out) const;
+
+    const LogFormats& _formats;
+    std::vector<uint8_t> _pending;
+    bool _started = false;
+    uint8_t _sequence = 0;
+};
+
+#endif
@@ -0,0 +1,191 @@
+// Готовит патч для OTA по схеме src/shared/delta_patch.hpp:
+//   g++ -std=c++17 -O2 -Isrc/shared -o ota_delta tools/ota_delta.cpp
+//       src/shared/delta_patch.cpp src/shared/ota_sign.cpp src/shared/sha256.cpp src/shared/crc32.cpp
+//   OTA_KEY=<ключ устройств> ./ota_delta old/firmware.bin new/firmware.bin update.odp
+// old - прошивка, которая сейчас стоит на устройствах. Патч перед записью
+// применяется тем же DeltaPatcher, что и на плате, и сверяется с new.
+// Печатает SHA-256 нового образа и подписи (ota_sign.hpp) для патча и для
+// полного образа: их ждут /update и esp32/ota/<device>/begin.
+#include "delta_patch.hpp"
+#include "ota_sign.hpp"
+#include "sha256.hpp"
+#include "crc32.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+// Совпадения короче не окупают 9 байт COPY.
+static const size_t MIN_MATCH = 24;
+static const size_t WINDOW = 16;
+// Кандидатов на одно окно: повторяющиеся заполнители (0xFF, нули) иначе
+// превращают поиск в квадратичный.
+static const size_t MAX_CANDIDATES = 8;
+
+static bool read_file(const char* path, Bytes& out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + count);
+    }
+    fclose(file);
+    return true;
+}
+
+static void put_le32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+static uint64_t window_hash(const uint8_t* data) {
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < WINDOW; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void flush_insert(Bytes& patch, const Bytes& target, size_t start, size_t end) {
+    if (end > start) {
+        patch.push_back(DELTA_OP_INSERT);
+        put_le32(patch, (uint32_t)(end - start));
+        patch.insert(patch.end(), target.begin() + start, target.begin() + end);
+    }
+}
+
+static Bytes make_patch(const Bytes& source, const Bytes& target) {
+    std::unordered_map<uint64_t, std::vector<uint32_t>> index;
+    for (size_t i = 0; i + WINDOW <= source.size(); i++) {
+        std::vector<uint32_t>& positions = index[window_hash(&source[i])];
+        if (positions.size() < MAX_CANDIDATES) {
+            positions.push_back((uint32_t)i);
+        }
+    }
+
+    Bytes patch = { 'O', 'D', 'P', '1' };
+    put_le32(patch, (uint32_t)source.size());
+    put_le32(patch, crc32(source.data(), source.size()));
+    put_le32(patch, (uint32_t)target.size());
+
+    size_t pending = 0;  // начало ещё не записанного INSERT
+    size_t position = 0;
+    size_t expected = SIZE_MAX;  // продолжение предыдущего COPY проверяется первым
+    while (position + WINDOW <= target.size()) {
+        size_t bestOffset = 0;
+        size_t bestLength = 0;
+        auto consider = [&](size_t offset) {
+            size_t length = 0;
+            while (offset + length < source.size() && position + length < target.size() &&
+                   source[offset + length] == target[position + length]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestOffset = offset;
+            }
+        };
+        if (expected < source.size()) {
+            consider(expected);
+        }
+        auto found = index.find(window_hash(&target[position]));
+        if (found != index.end()) {
+            for (uint32_t offset : found->second) {
+                consider(offset);
+            }
+        }
+
+        if (bestLength < MIN_MATCH) {
+            position++;
+            expected = SIZE_MAX;
+            continue;
+        }
+        flush_insert(patch, target, pending, position);
+        patch.push_back(DELTA_OP_COPY);
+        put_le32(patch, (uint32_t)bestOffset);
+        put_le32(patch, (uint32_t)bestLength);
+        position += bestLength;
+        pending = position;
+        expected = bestOffset + bestLength;
+    }
+    flush_insert(patch, target, pending, target.size());
+    return patch;
+}
+
+static bool read_source(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    const Bytes& source = *(const Bytes*)((void**)context)[0];
+    if (offset + length > source.size()) {
+        return false;
+    }
+    memcpy(out, &source[offset], length);
+    return true;
+}
+
+static bool write_target(const uint8_t* data, size_t length, void* context) {
+    Bytes& out = *(Bytes*)((void**)context)[1];
+    out.insert(out.end(), data, data + length);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <old.bin> <new.bin> <patch.odp>\n", argv[0]);
+        return 2;
+    }
+    Bytes source, target;
+    if (!read_file(argv[1], source) || !read_file(argv[2], target)) {
+        fprintf(stderr, "cannot read input images\n");
+        return 1;
+    }
+
+    Bytes patch = make_patch(source, target);
+
+    Bytes applied;
+    void* context[2] = { &source, &applied };
+    DeltaPatcher patcher(read_source, write_target, context);
+    PatchError error = patcher.feed(patch.data(), patch.size());
+    while (error == PatchError::None && !patcher.sourceChecked()) {
+        error = patcher.checkSource();
+    }
+    if (error != PatchError::None || !patcher.complete() || applied != target) {
+        fprintf(stderr, "self-check failed: %s\n", patch_error_name(error));
+        return 1;
+    }
+
+    FILE* file = fopen(argv[3], "wb");
+    if (!file || fwrite(patch.data(), 1, patch.size(), file) != patch.size()) {
+        fprintf(stderr, "cannot write %s\n", argv[3]);
+        return 1;
+    }
+    fclose(file);
+
+    uint8_t digest[SHA256_SIZE];
+    Sha256 sha;
+    sha.update(target.data(), target.size());
+    sha.finish(digest);
+    char hex[SHA256_SIZE * 2 + 1];
+    sha256_to_hex(digest, hex);
+    printf("patch %zu bytes (%.1f%% of %zu), sha256 %s\n", patch.size(),
+           100.0 * patch.size() / (target.empty() ? 1 : target.size()), target.size(), hex);
+
+    const char* key = getenv("OTA_KEY");
+    if (!key || key[0] == '\0') {
+        fprintf(stderr, "OTA_KEY is not set: devices will reject the update without a signature\n");
+        return 0;
+    }
+    uint8_t signature[SHA256_SIZE];
+    ota_sign(key, (uint32_t)patch.size(), digest, true, signature);
+    sha256_to_hex(signature, hex);
+    printf("sig (patch, delta=1) %s\n", hex);
+    ota_sign(key, (uint32_t)target.size(), digest, false, signature);
+    sha256_to_hex(signature, hex);
+    printf("sig (full image)     %s\n", hex);
+    return 0;
+}